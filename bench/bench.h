@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal microbenchmark harness for sensors_read_bench. A case body runs
+// its operation `iterations` times and returns the number of payload bytes
+// it produced or consumed (0 when throughput in bytes is meaningless). The
+// harness grows the iteration count until a run lasts long enough to time,
+// then reports ns/op, heap allocations/op and throughput.
+namespace bench {
+
+using Body = std::function<std::size_t(std::size_t iterations)>;
+
+struct Case {
+  std::string name;
+  Body body;
+};
+
+std::vector<Case> &registry();
+
+// Registers a case at static-initialization time:
+//   const bench::Registrar kFormatImu("format_imu", [](std::size_t n) { ... });
+struct Registrar {
+  Registrar(std::string name, Body body);
+};
+
+// Keeps the compiler from discarding a computed value.
+template <typename T>
+inline void do_not_optimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+} // namespace bench
@@ -0,0 +1,56 @@
+#include "bench.h"
+
+#include "attitude_filter.h"
+#include "imu_sensor.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// Cost of the on-board attitude filter, which runs once per IMU sample on
+// the acquisition thread.
+namespace {
+
+constexpr std::int64_t kSamplePeriodNs = 1000000; // 1 kHz
+
+// A slowly tumbling body: readings vary from one sample to the next, so the
+// normalizations and the gradient are never constant-folded.
+std::array<ImuReading, 64> tumbling_readings() {
+  std::array<ImuReading, 64> readings{};
+  for (std::size_t idx = 0; idx < readings.size(); ++idx) {
+    const float angle = 0.01f * static_cast<float>(idx);
+    ImuReading &reading = readings[idx];
+    reading.valid = true;
+    reading.ax = 0.1f * std::sin(angle);
+    reading.ay = -0.2f * std::cos(angle);
+    reading.az = 0.97f;
+    reading.gx_rad = 0.01f * std::cos(angle);
+    reading.gy_rad = -0.02f;
+    reading.gz_rad = 0.3f * std::sin(angle);
+    reading.mx = 0.21f + 0.01f * std::cos(angle);
+    reading.my = -0.03f;
+    reading.mz = 0.4f;
+  }
+  return readings;
+}
+
+std::size_t run_filter(std::size_t iterations, bool use_magnetometer) {
+  std::array<ImuReading, 64> readings = tumbling_readings();
+  AttitudeFilter filter(0.1f, use_magnetometer);
+  AttitudeReading estimate;
+  std::int64_t now_ns = kSamplePeriodNs;
+  for (std::size_t idx = 0; idx < iterations; ++idx) {
+    ImuReading &reading = readings[idx % readings.size()];
+    reading.time.monotonic_ns = now_ns;
+    now_ns += kSamplePeriodNs;
+    filter.update(reading, estimate);
+    bench::do_not_optimize(estimate);
+  }
+  return 0;
+}
+
+const bench::Registrar kAttitudeImu("attitude_imu", [](std::size_t n) { return run_filter(n, false); });
+
+const bench::Registrar kAttitudeMarg("attitude_marg", [](std::size_t n) { return run_filter(n, true); });
+
+} // namespace
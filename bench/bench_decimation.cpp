@@ -0,0 +1,48 @@
+#include "bench.h"
+
+#include "adc_sensor.h"
+#include "decimator.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// Cost per input sample of the --decimate filters, which run on the
+// acquisition thread after every IMU and ADC read.
+namespace {
+
+constexpr std::int64_t kSamplePeriodNs = 1000000; // 1 kHz
+
+template <std::size_t Channels>
+std::array<std::array<float, Channels>, 64> vibration() {
+  std::array<std::array<float, Channels>, 64> samples{};
+  for (std::size_t idx = 0; idx < samples.size(); ++idx) {
+    for (std::size_t channel = 0; channel < Channels; ++channel) {
+      samples[idx][channel] = std::sin(0.3f * static_cast<float>(idx) + static_cast<float>(channel));
+    }
+  }
+  return samples;
+}
+
+template <std::size_t Channels>
+std::size_t run_cascade(std::size_t iterations, std::span<const double> rates_hz) {
+  const auto samples = vibration<Channels>();
+  DecimationCascade cascade(Channels, 1e9 / static_cast<double>(kSamplePeriodNs), rates_hz);
+  SampleTime time;
+  for (std::size_t idx = 0; idx < iterations; ++idx) {
+    time.monotonic_ns += kSamplePeriodNs;
+    cascade.push(time, samples[idx % samples.size()],
+                 [](std::size_t, const SampleTime &, std::span<const float> out) { bench::do_not_optimize(out); });
+  }
+  return 0;
+}
+
+// The README example: 1 kHz IMU samples down to 200 Hz and 10 Hz.
+constexpr double kImuRates[] = {200.0, 10.0};
+const bench::Registrar kDecimateImu("decimate_imu", [](std::size_t n) { return run_cascade<9>(n, kImuRates); });
+
+constexpr double kAdcRates[] = {100.0};
+const bench::Registrar kDecimateAdc("decimate_adc",
+                                    [](std::size_t n) { return run_cascade<kAdcMaxChannels>(n, kAdcRates); });
+
+} // namespace
@@ -0,0 +1,66 @@
+#include "bench.h"
+
+#include "imu_fusion.h"
+#include "imu_sensor.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// Cost of one fused grid sample: two pushes from the acquisition side, then
+// the drain, rotation, interpolation, consistency check and average.
+namespace {
+
+constexpr std::int64_t kSamplePeriodNs = 5000000; // 200 Hz
+
+std::array<ImuReading, 64> vibrating_readings() {
+  std::array<ImuReading, 64> readings{};
+  for (std::size_t idx = 0; idx < readings.size(); ++idx) {
+    const float angle = 0.05f * static_cast<float>(idx);
+    ImuReading &reading = readings[idx];
+    reading.valid = true;
+    reading.ax = 0.02f * std::sin(angle);
+    reading.ay = 0.01f * std::cos(angle);
+    reading.az = 1.0f;
+    reading.gx_rad = 0.01f * std::sin(3.0f * angle);
+    reading.gy_rad = 0.02f * std::cos(angle);
+    reading.gz_rad = 0.005f;
+    reading.mx = 0.21f;
+    reading.my = -0.03f + 0.001f * std::sin(angle);
+    reading.mz = 0.4f;
+  }
+  return readings;
+}
+
+std::size_t run_fusion(std::size_t iterations) {
+  std::array<ImuReading, 64> readings = vibrating_readings();
+  FusionOptions options;
+  options.rate_hz = 1e9 / static_cast<double>(kSamplePeriodNs);
+  ImuFusion fusion(options);
+  AxisRotation yaw90;
+  axis_rotation("yaw90", yaw90);
+  fusion.set_rotation(1, yaw90);
+  FusedImuReading fused;
+  std::int64_t now_ns = kSamplePeriodNs;
+  for (std::size_t idx = 0; idx < iterations; ++idx) {
+    ImuReading mpu = readings[idx % readings.size()];
+    mpu.time.monotonic_ns = now_ns;
+    // The second device samples half a period later, so every grid point
+    // is interpolated.
+    ImuReading lsm = mpu;
+    lsm.time.monotonic_ns = now_ns + kSamplePeriodNs / 2;
+    lsm.ax = mpu.ay;
+    lsm.ay = -mpu.ax;
+    now_ns += kSamplePeriodNs;
+    fusion.push(0, mpu);
+    fusion.push(1, lsm);
+    while (fusion.next(fused)) {
+      bench::do_not_optimize(fused);
+    }
+  }
+  return 0;
+}
+
+const bench::Registrar kImuFusion("imu_fusion", run_fusion);
+
+} // namespace
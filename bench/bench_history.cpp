@@ -0,0 +1,47 @@
+#include "bench.h"
+
+#include "sample_history.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+// Cost of --history: copying every published sample into its key's ring on
+// the publisher thread, and answering a late joiner's `last=500` query.
+// Samples are 70-byte binary IMU records from a 1 kHz stream.
+namespace {
+
+constexpr std::int64_t kSamplePeriodNs = 1000000; // 1 kHz
+constexpr std::size_t kHistorySamples = 10000;
+
+const bench::Registrar kHistoryRecord("history_record", [](std::size_t n) {
+  telemetry::SampleHistory history(kHistorySamples, std::chrono::milliseconds(0));
+  std::array<std::uint8_t, 70> payload{};
+  for (std::size_t idx = 0; idx < n; ++idx) {
+    payload[0] = static_cast<std::uint8_t>(idx);
+    history.record(static_cast<std::int64_t>(idx) * kSamplePeriodNs, payload);
+  }
+  bench::do_not_optimize(history);
+  return n * payload.size();
+});
+
+const bench::Registrar kHistoryQuery("history_query_500", [](std::size_t n) {
+  telemetry::SampleHistory history(kHistorySamples, std::chrono::milliseconds(0));
+  const std::array<std::uint8_t, 70> payload{};
+  for (std::size_t idx = 0; idx < kHistorySamples; ++idx) {
+    history.record(static_cast<std::int64_t>(idx) * kSamplePeriodNs, payload);
+  }
+  const std::int64_t now_ns = static_cast<std::int64_t>(kHistorySamples) * kSamplePeriodNs;
+  telemetry::HistorySelector selector;
+  selector.last = 500;
+  telemetry::HistorySnapshot snapshot;
+  std::size_t bytes = 0;
+  for (std::size_t idx = 0; idx < n; ++idx) {
+    history.snapshot(selector, now_ns, snapshot);
+    bench::do_not_optimize(snapshot.slots.data());
+    bytes += snapshot.size() * payload.size();
+  }
+  return bytes;
+});
+
+} // namespace
@@ -0,0 +1,94 @@
+#include "bench.h"
+
+#include "telemetry_codec.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Cost per sample of --imu-window: quantizing and delta-packing a reading on
+// the acquisition thread, and expanding it again on the subscriber. The
+// bytes reported are the packed ones, so throughput divided by the 70-byte
+// record size tells how far a window shrinks the stream.
+namespace {
+
+constexpr std::int64_t kSamplePeriodNs = 1000000; // 1 kHz
+constexpr std::size_t kWindowSamples = 50;
+
+// A level vehicle vibrating slightly, with a few LSBs of sensor noise.
+std::array<codec::ImuRecord, 64> vibration() {
+  std::array<codec::ImuRecord, 64> samples{};
+  std::uint32_t noise = 12345;
+  auto jitter = [&noise](float scale) {
+    noise = noise * 1664525u + 1013904223u;
+    return scale * (static_cast<float>(noise >> 8) / 16777216.0f - 0.5f);
+  };
+  for (std::size_t idx = 0; idx < samples.size(); ++idx) {
+    codec::ImuRecord &sample = samples[idx];
+    const float phase = 0.3f * static_cast<float>(idx);
+    sample.device = codec::ImuDevice::Mpu9250;
+    sample.valid = true;
+    sample.ax = 0.05f * std::sin(phase) + jitter(0.02f);
+    sample.ay = jitter(0.02f);
+    sample.az = 9.80665f + 0.05f * std::cos(phase) + jitter(0.02f);
+    sample.gx = 0.01f * std::sin(phase) + jitter(0.002f);
+    sample.gy = jitter(0.002f);
+    sample.gz = 0.0628f + jitter(0.002f);
+    sample.mx = 22.0f + jitter(0.3f);
+    sample.my = -3.25f + jitter(0.3f);
+    sample.mz = 40.0f + jitter(0.3f);
+  }
+  return samples;
+}
+
+constexpr codec::ImuQuantization kSteps{0.001f, 0.0001f, 0.01f};
+
+const bench::Registrar kImuWindowEncode("imu_window_encode", [](std::size_t n) {
+  auto samples = vibration();
+  codec::ImuWindowEncoder window(kSteps);
+  std::size_t bytes = 0;
+  auto flush = [&] {
+    bytes += window.record().size();
+    bench::do_not_optimize(window.record().data());
+    window.clear();
+  };
+  std::int64_t time_ns = 0;
+  for (std::size_t idx = 0; idx < n; ++idx) {
+    codec::ImuRecord &sample = samples[idx % samples.size()];
+    time_ns += kSamplePeriodNs;
+    sample.time.monotonic_ns = time_ns;
+    if (!window.add(sample)) {
+      flush();
+      window.add(sample);
+    }
+    if (window.count() == kWindowSamples) {
+      flush();
+    }
+  }
+  return bytes + window.record().size();
+});
+
+const bench::Registrar kImuWindowDecode("imu_window_decode", [](std::size_t n) {
+  auto samples = vibration();
+  codec::ImuWindowEncoder window(kSteps);
+  for (std::size_t idx = 0; idx < kWindowSamples; ++idx) {
+    codec::ImuRecord &sample = samples[idx % samples.size()];
+    sample.time.monotonic_ns = static_cast<std::int64_t>(idx + 1) * kSamplePeriodNs;
+    window.add(sample);
+  }
+  const std::vector<std::uint8_t> record(window.record().begin(), window.record().end());
+  std::size_t bytes = 0;
+  for (std::size_t done = 0; done < n;) {
+    codec::ImuWindowReader reader(record);
+    codec::ImuRecord sample;
+    while (done < n && reader.next(sample)) {
+      bench::do_not_optimize(sample);
+      ++done;
+    }
+    bytes += record.size();
+  }
+  return bytes;
+});
+
+} // namespace
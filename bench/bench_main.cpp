@@ -0,0 +1,219 @@
+#include "bench.h"
+
+#include "logging.h"
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+namespace {
+
+std::atomic<std::uint64_t> g_allocations{0};
+
+void *counted_alloc(std::size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void *counted_aligned_alloc(std::size_t size, std::align_val_t align) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  const auto alignment = static_cast<std::size_t>(align);
+  // aligned_alloc wants the size to be a multiple of the alignment.
+  const std::size_t rounded = (size + alignment - 1) / alignment * alignment;
+  if (void *ptr = std::aligned_alloc(alignment, rounded ? rounded : alignment)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+enum class OutputFormat { Text, Json, Csv };
+
+struct Result {
+  const bench::Case *bench_case;
+  std::size_t iterations;
+  double ns_per_op;
+  double allocs_per_op;
+  double ops_per_s;
+  double mb_per_s;
+};
+
+Result run(const bench::Case &bench_case, std::chrono::nanoseconds min_time) {
+  // Warm caches and lazily initialized state before timing.
+  bench_case.body(1);
+  std::size_t iterations = 1;
+  while (true) {
+    const std::uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t bytes = bench_case.body(iterations);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    const std::uint64_t allocated = g_allocations.load(std::memory_order_relaxed) - allocations;
+    if (elapsed >= min_time || iterations >= (std::size_t{1} << 32)) {
+      const double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+      const double n = static_cast<double>(iterations);
+      return {&bench_case, iterations, ns / n, static_cast<double>(allocated) / n, n * 1e9 / ns,
+              static_cast<double>(bytes) * 1e3 / ns};
+    }
+    // Aim just past min_time, growing at most 10x per round.
+    const double ns = std::max<double>(1.0, static_cast<double>(elapsed.count()));
+    const double target = static_cast<double>(min_time.count()) * 1.2 / ns * static_cast<double>(iterations);
+    iterations = static_cast<std::size_t>(std::min(target, static_cast<double>(iterations) * 10.0)) + 1;
+  }
+}
+
+void print(const Result &result, OutputFormat format, bool first) {
+  switch (format) {
+  case OutputFormat::Text:
+    std::printf("%-36s %12zu %12.1f %10.2f %14.0f %10.1f\n", result.bench_case->name.c_str(),
+                result.iterations, result.ns_per_op, result.allocs_per_op, result.ops_per_s,
+                result.mb_per_s);
+    break;
+  case OutputFormat::Json:
+    std::printf("%s\n    {\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.3f, "
+                "\"allocs_per_op\": %.3f, \"ops_per_s\": %.1f, \"mb_per_s\": %.3f}",
+                first ? "" : ",", result.bench_case->name.c_str(), result.iterations,
+                result.ns_per_op, result.allocs_per_op, result.ops_per_s, result.mb_per_s);
+    break;
+  case OutputFormat::Csv:
+    std::printf("%s,%zu,%.3f,%.3f,%.1f,%.3f\n", result.bench_case->name.c_str(), result.iterations,
+                result.ns_per_op, result.allocs_per_op, result.ops_per_s, result.mb_per_s);
+    break;
+  }
+}
+
+void print_usage(const char *prog) {
+  std::cout << "Usage: " << prog << " [options]\n"
+            << "  --format <text|json|csv> Output format (default: text)\n"
+            << "  --filter <substring>     Only run cases whose name contains substring\n"
+            << "  --min-time <ms>          Minimum timed duration per case (default: 200)\n"
+            << "  --list                   List the cases and exit\n"
+            << "  --help                   Show this message\n";
+}
+
+} // namespace
+
+void *operator new(std::size_t size) { return counted_alloc(size); }
+void *operator new[](std::size_t size) { return counted_alloc(size); }
+void *operator new(std::size_t size, std::align_val_t align) { return counted_aligned_alloc(size, align); }
+void *operator new[](std::size_t size, std::align_val_t align) { return counted_aligned_alloc(size, align); }
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+namespace bench {
+
+std::vector<Case> &registry() {
+  static std::vector<Case> cases;
+  return cases;
+}
+
+Registrar::Registrar(std::string name, Body body) {
+  registry().push_back({std::move(name), std::move(body)});
+}
+
+} // namespace bench
+
+int main(int argc, char *argv[]) {
+  OutputFormat format = OutputFormat::Text;
+  std::string filter;
+  long min_time_ms = 200;
+  bool list = false;
+
+  const struct option long_opts[] = {{"format", required_argument, nullptr, 'f'},
+                                     {"filter", required_argument, nullptr, 'F'},
+                                     {"min-time", required_argument, nullptr, 'm'},
+                                     {"list", no_argument, nullptr, 'L'},
+                                     {"help", no_argument, nullptr, 'h'},
+                                     {nullptr, 0, nullptr, 0}};
+  int opt;
+  while ((opt = getopt_long(argc, argv, "h", long_opts, nullptr)) != -1) {
+    switch (opt) {
+    case 'f': {
+      const std::string value = optarg;
+      if (value == "text") {
+        format = OutputFormat::Text;
+      } else if (value == "json") {
+        format = OutputFormat::Json;
+      } else if (value == "csv") {
+        format = OutputFormat::Csv;
+      } else {
+        std::cerr << "Invalid format, expected text, json or csv\n";
+        return EXIT_FAILURE;
+      }
+      break;
+    }
+    case 'F':
+      filter = optarg;
+      break;
+    case 'm': {
+      char *end = nullptr;
+      min_time_ms = std::strtol(optarg, &end, 10);
+      if (!end || *end != '\0' || min_time_ms <= 0) {
+        std::cerr << "Invalid --min-time\n";
+        return EXIT_FAILURE;
+      }
+      break;
+    }
+    case 'L':
+      list = true;
+      break;
+    case 'h':
+      print_usage(argv[0]);
+      return EXIT_SUCCESS;
+    default:
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (list) {
+    for (const auto &bench_case : bench::registry()) {
+      std::cout << bench_case.name << '\n';
+    }
+    return EXIT_SUCCESS;
+  }
+
+  // Only the cases that measure logging change the level.
+  logging::set_level(logging::Level::Warning);
+
+  switch (format) {
+  case OutputFormat::Text:
+    std::printf("%-36s %12s %12s %10s %14s %10s\n", "case", "iterations", "ns/op", "allocs/op",
+                "ops/s", "MB/s");
+    break;
+  case OutputFormat::Json:
+    std::printf("{\n  \"benchmarks\": [");
+    break;
+  case OutputFormat::Csv:
+    std::printf("name,iterations,ns_per_op,allocs_per_op,ops_per_s,mb_per_s\n");
+    break;
+  }
+  bool first = true;
+  for (const auto &bench_case : bench::registry()) {
+    if (!filter.empty() && bench_case.name.find(filter) == std::string::npos) {
+      continue;
+    }
+    print(run(bench_case, std::chrono::milliseconds(min_time_ms)), format, first);
+    std::fflush(stdout);
+    first = false;
+  }
+  if (format == OutputFormat::Json) {
+    std::printf("\n  ]\n}\n");
+  }
+  return EXIT_SUCCESS;
+}
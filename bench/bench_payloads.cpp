@@ -0,0 +1,151 @@
+#include "bench.h"
+
+#include "adc_sensor.h"
+#include "barometer_sensor.h"
+#include "gps_sensor.h"
+#include "imu_sensor.h"
+#include "payload_parser.h"
+#include "rcinput_sensor.h"
+#include "sample_time.h"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+
+// Serialization cost per sample: the text formatters and binary encoders
+// run on every published reading.
+namespace {
+
+constexpr std::size_t kPayloadCapacity = 512;
+
+ImuReading sample_imu() {
+  ImuReading reading;
+  reading.valid = true;
+  reading.time = SampleTime::now();
+  reading.ax = 0.0123f;
+  reading.ay = -0.4567f;
+  reading.az = 9.80665f;
+  reading.gx_rad = 0.00123f;
+  reading.gy_rad = -0.0456f;
+  reading.gz_rad = 0.0789f;
+  reading.mx = 21.5f;
+  reading.my = -3.25f;
+  reading.mz = 40.125f;
+  return reading;
+}
+
+AdcReading sample_adc() {
+  AdcReading reading;
+  reading.time = SampleTime::now();
+  reading.count = 6;
+  reading.values = {4.998, 5.102, 12.412, 0.815, 0.001, 0.0};
+  return reading;
+}
+
+BarometerReading sample_barometer() {
+  BarometerReading reading;
+  reading.valid = true;
+  reading.fresh = true;
+  reading.time = SampleTime::now();
+  reading.temperature_c = 25.37;
+  reading.pressure_mbar = 1013.254;
+  return reading;
+}
+
+GpsReading sample_gps() {
+  GpsReading reading;
+  reading.has_position = true;
+  reading.has_status = true;
+  reading.time = SampleTime::now();
+  reading.time_of_week_s = 345678.2;
+  reading.latitude_deg = 42.1697123;
+  reading.longitude_deg = -8.6876456;
+  reading.height_m = 451.234;
+  reading.hmsl_m = 399.87;
+  reading.horizontal_accuracy_m = 1.45;
+  reading.vertical_accuracy_m = 2.31;
+  reading.fix_type = 3;
+  reading.fix_ok = true;
+  return reading;
+}
+
+RcInputReading sample_rcinput() {
+  RcInputReading reading;
+  reading.time = SampleTime::now();
+  reading.count = 8;
+  reading.values = {1500, 1480, 1100, 1520, 1000, 2000, 1500, 1500};
+  return reading;
+}
+
+// Runs serialize(out) n times into one reused buffer; returns total bytes.
+template <typename Serialize>
+std::size_t serialize_loop(std::size_t iterations, Serialize &&serialize) {
+  std::array<std::uint8_t, kPayloadCapacity> buffer{};
+  std::size_t bytes = 0;
+  for (std::size_t idx = 0; idx < iterations; ++idx) {
+    bytes += serialize(std::span<std::uint8_t>(buffer));
+    bench::do_not_optimize(buffer);
+  }
+  return bytes;
+}
+
+std::span<char> as_chars(std::span<std::uint8_t> out) {
+  return {reinterpret_cast<char *>(out.data()), out.size()};
+}
+
+const std::string kImuName = "MPU9250";
+
+const bench::Registrar kFormatImu("format_imu", [](std::size_t n) {
+  const ImuReading reading = sample_imu();
+  return serialize_loop(n, [&](std::span<std::uint8_t> out) { return format_imu(as_chars(out), kImuName, reading); });
+});
+
+const bench::Registrar kEncodeImu("encode_imu", [](std::size_t n) {
+  const ImuReading reading = sample_imu();
+  return serialize_loop(n, [&](std::span<std::uint8_t> out) { return encode_imu(kImuName, reading, out); });
+});
+
+const bench::Registrar kFormatAdc("format_adc", [](std::size_t n) {
+  const AdcReading reading = sample_adc();
+  return serialize_loop(n, [&](std::span<std::uint8_t> out) { return format_adc(as_chars(out), reading); });
+});
+
+const bench::Registrar kFormatBarometer("format_barometer", [](std::size_t n) {
+  const BarometerReading reading = sample_barometer();
+  return serialize_loop(n, [&](std::span<std::uint8_t> out) { return format_barometer(as_chars(out), reading); });
+});
+
+const bench::Registrar kFormatGps("format_gps", [](std::size_t n) {
+  const GpsReading reading = sample_gps();
+  return serialize_loop(n, [&](std::span<std::uint8_t> out) { return format_gps(as_chars(out), reading); });
+});
+
+const bench::Registrar kFormatRcinput("format_rcinput", [](std::size_t n) {
+  const RcInputReading reading = sample_rcinput();
+  return serialize_loop(n, [&](std::span<std::uint8_t> out) { return format_rcinput(as_chars(out), reading); });
+});
+
+// The subscriber's text decode path, on a typical IMU payload.
+const bench::Registrar kParseTextImu("parse_text_imu", [](std::size_t n) {
+  std::array<char, kPayloadCapacity> buffer{};
+  const std::string payload(buffer.data(), format_imu(buffer, kImuName, sample_imu()));
+  std::size_t bytes = 0;
+  codec::ImuRecord record;
+  for (std::size_t idx = 0; idx < n; ++idx) {
+    parse_text(payload, record);
+    bench::do_not_optimize(record);
+    bytes += payload.size();
+  }
+  return bytes;
+});
+
+const bench::Registrar kSampleTimeNow("sample_time_now", [](std::size_t n) {
+  for (std::size_t idx = 0; idx < n; ++idx) {
+    const SampleTime time = SampleTime::now();
+    bench::do_not_optimize(time);
+  }
+  return std::size_t{0};
+});
+
+} // namespace
@@ -0,0 +1,137 @@
+#include "bench.h"
+
+#include "imu_sensor.h"
+#include "logging.h"
+#include "main.h"
+#include "telemetry_publisher.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <span>
+
+// Costs paid on every acquisition cycle outside the serializers: log calls
+// and the Zenoh put.
+namespace {
+
+// Points stderr at /dev/null for the lifetime of the object so enabled log
+// output does not flood the report.
+class DiscardStderr {
+public:
+  DiscardStderr() : saved_(dup(STDERR_FILENO)) {
+    std::fflush(stderr);
+    const int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) {
+      dup2(null_fd, STDERR_FILENO);
+      close(null_fd);
+    }
+  }
+  ~DiscardStderr() {
+    std::fflush(stderr);
+    if (saved_ >= 0) {
+      dup2(saved_, STDERR_FILENO);
+      close(saved_);
+    }
+  }
+  DiscardStderr(const DiscardStderr &) = delete;
+  DiscardStderr &operator=(const DiscardStderr &) = delete;
+
+private:
+  int saved_;
+};
+
+std::size_t log_loop(std::size_t iterations) {
+  const float ax = 0.0123f;
+  const float ay = -0.4567f;
+  const float az = 9.80665f;
+  for (std::size_t idx = 0; idx < iterations; ++idx) {
+    logging::log(logging::Level::Debug, "MPU9250 Accel: ", ax, " ", ay, " ", az);
+  }
+  return 0;
+}
+
+// A DEBUG call while the level is WARNING: the common case in the field.
+const bench::Registrar kLogDisabled("log_disabled", [](std::size_t n) {
+  logging::set_level(logging::Level::Warning);
+  return log_loop(n);
+});
+
+const bench::Registrar kLogEnabledSync("log_enabled_sync", [](std::size_t n) {
+  DiscardStderr discard;
+  logging::set_level(logging::Level::Debug);
+  const std::size_t bytes = log_loop(n);
+  logging::set_level(logging::Level::Warning);
+  return bytes;
+});
+
+// Cost on the calling thread with the background writer, as sensors_read
+// runs. Lines the writer cannot keep up with are dropped, not waited for.
+const bench::Registrar kLogEnabledAsync("log_enabled_async", [](std::size_t n) {
+  DiscardStderr discard;
+  logging::set_level(logging::Level::Debug);
+  logging::start_async();
+  const std::size_t bytes = log_loop(n);
+  logging::set_level(logging::Level::Warning);
+  logging::stop_async();
+  return bytes;
+});
+
+// One publisher shared by the publish cases; it opens a default (peer) Zenoh
+// session on first use, so no router is needed.
+telemetry::TelemetryPublisher *publisher() {
+  static std::unique_ptr<telemetry::TelemetryPublisher> instance;
+  if (!instance) {
+    instance = std::make_unique<telemetry::TelemetryPublisher>();
+  }
+  return instance->ready() ? instance.get() : nullptr;
+}
+
+const bench::Registrar kPublishImuBinary("publish_imu_binary", [](std::size_t n) {
+  telemetry::TelemetryPublisher *target = publisher();
+  if (!target) {
+    return std::size_t{0};
+  }
+  ImuReading reading;
+  reading.valid = true;
+  reading.time = SampleTime::now();
+  reading.az = 9.80665f;
+  const std::string name = "MPU9250";
+  std::array<std::uint8_t, 256> buffer{};
+  const std::size_t size = encode_imu(name, reading, buffer);
+  const std::span<const std::uint8_t> payload(buffer.data(), size);
+  std::size_t bytes = 0;
+  for (std::size_t idx = 0; idx < n; ++idx) {
+    if (target->publish(main_const::imu_topic, payload)) {
+      bytes += size;
+    }
+  }
+  return bytes;
+});
+
+const bench::Registrar kPublishImuWith("publish_with_imu_text", [](std::size_t n) {
+  telemetry::TelemetryPublisher *target = publisher();
+  if (!target) {
+    return std::size_t{0};
+  }
+  ImuReading reading;
+  reading.valid = true;
+  reading.time = SampleTime::now();
+  reading.az = 9.80665f;
+  const std::string name = "MPU9250";
+  std::size_t bytes = 0;
+  auto serialize = [&](std::span<std::uint8_t> out) {
+    const std::size_t size = format_imu(std::span<char>(reinterpret_cast<char *>(out.data()), out.size()), name, reading);
+    bytes += size;
+    return size;
+  };
+  for (std::size_t idx = 0; idx < n; ++idx) {
+    target->publish_with(main_const::imu_topic, 512, serialize);
+  }
+  return bytes;
+});
+
+} // namespace
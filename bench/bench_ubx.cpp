@@ -0,0 +1,86 @@
+#include "bench.h"
+
+#include "gps_sensor.h"
+#include "ubx_parser.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Cost of the GPS drain thread per byte received: UBX framing and checksum,
+// and decoding the NAV messages into a GpsReading. The stream is one 5 Hz
+// epoch of a u-blox M8 on SPI, NMEA noise and idle bytes included.
+namespace {
+
+void append_frame(std::vector<std::uint8_t> &out, std::uint8_t id, std::span<const std::uint8_t> payload) {
+  const std::size_t start = out.size();
+  out.insert(out.end(), {0xB5, 0x62, kUbxClassNav, id, static_cast<std::uint8_t>(payload.size()),
+                         static_cast<std::uint8_t>(payload.size() >> 8)});
+  out.insert(out.end(), payload.begin(), payload.end());
+  std::uint8_t checksum_a = 0;
+  std::uint8_t checksum_b = 0;
+  for (std::size_t idx = start + 2; idx < out.size(); ++idx) {
+    checksum_a = static_cast<std::uint8_t>(checksum_a + out[idx]);
+    checksum_b = static_cast<std::uint8_t>(checksum_b + checksum_a);
+  }
+  out.push_back(checksum_a);
+  out.push_back(checksum_b);
+}
+
+void put_u32(std::span<std::uint8_t> out, std::size_t offset, std::uint32_t value) {
+  for (std::size_t idx = 0; idx < 4; ++idx) {
+    out[offset + idx] = static_cast<std::uint8_t>(value >> (8 * idx));
+  }
+}
+
+std::vector<std::uint8_t> nav_epoch() {
+  std::vector<std::uint8_t> stream;
+  std::array<std::uint8_t, 92> pvt{};
+  put_u32(pvt, 0, 356400000);
+  pvt[20] = 3;
+  pvt[21] = 0x01;
+  put_u32(pvt, 24, static_cast<std::uint32_t>(1218000));
+  put_u32(pvt, 28, static_cast<std::uint32_t>(522043000));
+  put_u32(pvt, 32, 45230);
+  put_u32(pvt, 36, 0);
+  put_u32(pvt, 40, 1500);
+  put_u32(pvt, 44, 2500);
+  append_frame(stream, kUbxNavPvt, pvt);
+  std::array<std::uint8_t, 28> posllh{};
+  put_u32(posllh, 0, 356400000);
+  put_u32(posllh, 4, static_cast<std::uint32_t>(1218000));
+  put_u32(posllh, 8, static_cast<std::uint32_t>(522043000));
+  append_frame(stream, kUbxNavPosllh, posllh);
+  std::array<std::uint8_t, 16> status{};
+  status[4] = 3;
+  status[5] = 0x01;
+  append_frame(stream, kUbxNavStatus, status);
+  constexpr std::string_view kNmea = "$GNGGA,094000.00,5212.25800,N,00007.30800,E,1,12,0.80,45.2,M,47.0,M,,*4F\r\n";
+  stream.insert(stream.end(), kNmea.begin(), kNmea.end());
+  stream.insert(stream.end(), 64, 0xFF);
+  return stream;
+}
+
+const bench::Registrar kUbxParse("ubx_parse", [](std::size_t n) {
+  const std::vector<std::uint8_t> epoch = nav_epoch();
+  UbxParser parser;
+  GpsReading state;
+  std::size_t bytes = 0;
+  std::size_t offset = 0;
+  for (std::size_t idx = 0; idx < n; ++idx) {
+    // One op is one SPI transfer of up to 128 bytes, as drain() reads them,
+    // through an endless repetition of the epoch.
+    const std::size_t count = std::min<std::size_t>(128, epoch.size() - offset);
+    parser.feed(std::span<const std::uint8_t>(epoch).subspan(offset, count),
+                [&](const UbxMessage &message) { apply_ubx(message, SampleTime{}, state); });
+    bench::do_not_optimize(state);
+    offset = (offset + count) % epoch.size();
+    bytes += count;
+  }
+  return bytes;
+});
+
+} // namespace
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "adc_pipeline.h"
+#include "adc_sensor.h"
+#include "barometer_pipeline.h"
+#include "barometer_sensor.h"
+#include "flight_recorder.h"
+#include "gps_pipeline.h"
+#include "gps_sensor.h"
+#include "imu_fusion.h"
+#include "imu_pipeline.h"
+#include "imu_sensor.h"
+#include "pipeline.h"
+#include "publish_queue.h"
+#include "rcinput_pipeline.h"
+#include "rcinput_sensor.h"
+#include "utils.h"
+
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+class SensorBackend;
+
+namespace telemetry {
+class TelemetryPublisher;
+}
+
+// The sensors, their pipelines and the publish queue they feed, set up from
+// the command-line options. main() runs the tasks on SensorWorkers; anything
+// else can call them directly.
+class Acquisition {
+public:
+  // backend is null for the Navio2 drivers.
+  Acquisition(const utils::ProgramOptions &options, SensorBackend *backend,
+              telemetry::TelemetryPublisher &publisher);
+
+  Acquisition(const Acquisition &) = delete;
+  Acquisition &operator=(const Acquisition &) = delete;
+
+  // Resolves the options into pipeline stages, opens the flight recorder
+  // and declares the histories of every channel. Returns false, after
+  // logging why at Critical, on options the pipelines cannot use.
+  bool init();
+
+  // --once: reads every sensor once, publishes the readings and returns
+  // once they have been handed to the publisher.
+  void snapshot();
+
+  // What the acquisition workers run; empty with --once.
+  const std::vector<PipelineTask> &tasks() const { return tasks_; }
+
+  // Starts the publisher thread, before the first task runs.
+  void start();
+  // Sends the IMU windows still open, drains the queue and closes the
+  // flight log. Called once no task runs any more.
+  void finish();
+
+  Pipeline pipeline(const std::vector<std::unique_ptr<SensorWorker>> &workers) const;
+  std::span<ReadMetric> reads() { return reads_; }
+
+private:
+  DecimatedOutputs decimated_channels(const std::string &producer, const std::string &topic,
+                                      const std::vector<double> &rates_hz);
+  bool make_tasks();
+
+  const utils::ProgramOptions &options_;
+  telemetry::TelemetryPublisher &publisher_;
+  const bool binary_;
+
+  ImuSensor mpu_sensor_;
+  ImuSensor lsm_sensor_;
+  AdcSensor adc_sensor_;
+  BarometerSensor barometer_sensor_;
+  GpsSensor gps_sensor_;
+  RcInputSensor rc_sensor_;
+
+  // --heartbeat: the slow sensors publish only when a field moved beyond
+  // its --deadband since the last published sample, and at least once per
+  // heartbeat so consumers can tell a quiet sensor from a dead one.
+  ChangeStage changes_[4] = {{"ADC", "adc", kAdcChangeFields, nullptr},
+                             {"Barometer", "barometer", kBarometerChangeFields, nullptr},
+                             {"GPS", "gps", kGpsChangeFields, nullptr},
+                             {"RCInput", "rcinput", kRcInputChangeFields, nullptr}};
+  // One per sensor, in the order of the pipelines; a FIFO drain counts as
+  // one read.
+  ReadMetric reads_[6] = {{"MPU9250", {}}, {"LSM9DS1", {}}, {"ADC", {}},
+                          {"Barometer", {}}, {"GPS", {}}, {"RCInput", {}}};
+
+  // Declared before the queue, whose destructor may still drain into it.
+  std::unique_ptr<telemetry::FlightRecorder> recorder_;
+  // Acquisition threads only serialize into their own queue; a separate
+  // publisher thread performs the Zenoh puts.
+  telemetry::PublishQueue queue_;
+
+  // Each adds its channel to the queue, so the recorder's channel order
+  // starts with the raw sensor streams.
+  ImuPipeline mpu_;
+  ImuPipeline lsm_;
+  AdcPipeline adc_;
+  BarometerPipeline barometer_;
+  GpsPipeline gps_;
+  RcInputPipeline rc_;
+
+  std::unique_ptr<ImuFusion> fusion_;
+  std::unique_ptr<FusedImuPipeline> fused_;
+  // --decimate rates of both IMUs, highest first.
+  std::vector<double> imu_decimation_;
+  std::vector<PipelineTask> tasks_;
+};
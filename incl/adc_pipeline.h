@@ -0,0 +1,27 @@
+#pragma once
+
+#include "adc_sensor.h"
+#include "pipeline.h"
+
+// Everything the ADC's acquisition thread does with a reading: publish it
+// when it changed, and run the --decimate cascade over every reading.
+class AdcPipeline {
+public:
+  AdcPipeline(AdcSensor &sensor, telemetry::PublishChannel &channel, bool binary,
+              metrics::DurationMetric &read_duration, ChangeStage &change);
+
+  // The outputs come with their cascade already built, at the ADC read rate.
+  void set_decimation(DecimatedOutputs outputs);
+
+  void read();
+
+private:
+  void decimate(const AdcReading &reading);
+
+  AdcSensor &sensor_;
+  telemetry::PublishChannel &channel_;
+  bool binary_;
+  metrics::DurationMetric &read_duration_;
+  ChangeStage &change_;
+  DecimatedOutputs decimated_;
+};
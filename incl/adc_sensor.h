@@ -1,21 +1,113 @@
 #pragma once
 
+#include "sample_time.h"
+#include "seqlock.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <span>
 #include <string>
-#include <vector>
 
 class ADC;
+class SensorBackend;
+
+constexpr std::size_t kAdcMaxChannels = 16;
+
+struct AdcReading {
+  std::size_t count = 0;
+  // Set when a backend had no new sample since the previous read; the
+  // pipelines publish nothing for it.
+  bool stale = false;
+  SampleTime time;
+  std::array<double, kAdcMaxChannels> values{};
+  // Channels that are read; the others are NaN and left out of text payloads.
+  std::uint16_t mask = 0xFFFF;
+};
+
+// How the background sampler reads one channel: every divider-th sampler
+// tick, reducing each block of oversample reads to their mean or median.
+// Failed reads are left out of a block; a block without a good read is NaN.
+struct AdcSampling {
+  static constexpr std::size_t kMaxOversample = 64;
+
+  double rate_hz = 0.0;
+  std::size_t oversample = 1;
+  bool median = false;
+};
 
+// Without sampling configured, read() reads the enabled channels one after
+// the other on the caller's thread. Once a channel has an AdcSampling, every
+// enabled channel is read by sample() on a worker of its own, at its own
+// rate (every tick for a channel without one), and read() copies the latest
+// reduced values out of a seqlock. Failed reads are counted per channel.
 class AdcSensor {
 public:
-  AdcSensor();
+  // With a backend, readings come from it instead of the Navio2 driver.
+  explicit AdcSensor(SensorBackend *backend = nullptr);
   ~AdcSensor();
 
   bool available() const;
-  std::vector<double> read();
+  AdcReading read();
+
+  // Configure before reading starts. Channels outside the mask are never
+  // read from the bus.
+  void set_channel_mask(std::uint16_t mask);
+  std::uint16_t channel_mask() const { return mask_; }
+  void set_sampling(std::size_t channel, const AdcSampling &sampling);
+
+  // True when the channels need sample() calls, at sampler_rate_hz(): the
+  // fastest channel rate, of which the others read every divider-th tick.
+  bool sampling() const { return sampler_rate_hz_ > 0.0; }
+  double sampler_rate_hz() const { return sampler_rate_hz_; }
+  // Reads the channels due this tick. Returns true once every enabled
+  // channel has a value.
+  bool sample();
+  // Rate a sampled channel is actually read at, after rounding its divider.
+  double channel_rate_hz(std::size_t channel) const;
+
+  // Channels in the latest reading, enabled or not.
+  std::size_t channel_count() const { return reported_count_.load(std::memory_order_relaxed); }
+  std::uint64_t failures(std::size_t channel) const;
+  std::string summary() const;
 
 private:
+  struct Channel {
+    AdcSampling sampling;
+    std::size_t divider = 1;
+    std::size_t phase = 0;
+    std::array<double, AdcSampling::kMaxOversample> block{};
+    std::size_t attempts = 0;
+    std::size_t good = 0;
+    bool has_value = false;
+  };
+
+  bool enabled(std::size_t channel) const { return (mask_ >> channel) & 1u; }
+  // Channels reported out of the ones available: up to the highest enabled.
+  std::size_t reported(std::size_t available) const;
+  // Returns false and counts the failure when a channel read fails.
+  bool read_channel(std::size_t channel, double &value);
+  static double reduce(Channel &channel);
+
+  SensorBackend *backend_;
   std::unique_ptr<ADC> adc_;
+  std::uint16_t mask_ = 0xFFFF;
+  double sampler_rate_hz_ = 0.0;
+  std::array<Channel, kAdcMaxChannels> channels_{};
+  // Sampler thread state: the backend reading of the current tick and the
+  // latest reduced values.
+  AdcReading backend_reading_;
+  AdcReading state_;
+  SeqLock<AdcReading> latest_;
+  std::atomic<std::size_t> reported_count_{0};
+  std::array<std::atomic<std::uint64_t>, kAdcMaxChannels> failures_{};
 };
 
-std::string format_adc(const std::vector<double> &values, const std::string &timestamp);
+// Mean or median of one block of good reads, NaN when there are none. The
+// median reorders the block.
+double reduce_adc_block(std::span<double> block, bool median);
+
+std::size_t format_adc(std::span<char> out, const AdcReading &reading);
+std::size_t encode_adc(const AdcReading &reading, std::span<std::uint8_t> out);
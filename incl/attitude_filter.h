@@ -0,0 +1,70 @@
+#pragma once
+
+#include "imu_sensor.h"
+#include "sample_time.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+struct AttitudeReading {
+  bool valid = false;
+  // Time of the IMU reading the estimate includes.
+  SampleTime time;
+  // Body-to-earth rotation, w first.
+  std::array<float, 4> q = {1.0f, 0.0f, 0.0f, 0.0f};
+  float roll_deg = 0.0f;
+  float pitch_deg = 0.0f;
+  float yaw_deg = 0.0f;
+};
+
+// Madgwick gradient-descent attitude filter over one IMU's readings. Every
+// update integrates the gyroscope over the time since the previous reading,
+// taken from the readings' CLOCK_MONOTONIC stamps, and corrects the drift
+// towards the accelerometer's gravity vector (and, with use_magnetometer,
+// magnetic north) with gain beta. Without the magnetometer yaw is relative
+// to the start and drifts with the gyroscope bias.
+//
+// The state is four floats and an update touches no heap memory, so it runs
+// on the IMU's acquisition thread at the full sample rate.
+class AttitudeFilter {
+public:
+  // Longer gaps between readings re-seed the estimate instead of
+  // integrating across them.
+  static constexpr std::int64_t kMaxStepNs = 1000000000;
+
+  AttitudeFilter(float beta, bool use_magnetometer);
+
+  // Folds in one reading and writes the new estimate to out. Returns false,
+  // leaving out untouched, for invalid readings and readings not newer than
+  // the previous one. The first reading, and the first after a gap, seeds
+  // roll and pitch from the accelerometer alone.
+  bool update(const ImuReading &reading, AttitudeReading &out);
+  void reset();
+
+  std::uint64_t updates() const { return updates_; }
+  std::uint64_t reseeds() const { return reseeds_; }
+
+private:
+  bool seed(const ImuReading &reading);
+  void estimate(const ImuReading &reading, AttitudeReading &out) const;
+
+  float beta_;
+  bool use_magnetometer_;
+  std::array<float, 4> q_ = {1.0f, 0.0f, 0.0f, 0.0f};
+  std::int64_t last_ns_ = 0;
+  bool seeded_ = false;
+  std::uint64_t updates_ = 0;
+  std::uint64_t reseeds_ = 0;
+};
+
+// One Madgwick step: integrates gyro (rad/s) over dt seconds into q, pulled
+// towards accel and, when mag is non-null and non-zero, the magnetometer.
+// Accelerometer and magnetometer units do not matter; both are normalized.
+void madgwick_step(std::array<float, 4> &q, const std::array<float, 3> &gyro, const std::array<float, 3> &accel,
+                   const std::array<float, 3> *mag, float beta, float dt);
+
+std::size_t format_attitude(std::span<char> out, const std::string &name, const AttitudeReading &data);
+std::size_t encode_attitude(const std::string &name, const AttitudeReading &data, std::span<std::uint8_t> out);
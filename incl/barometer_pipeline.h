@@ -0,0 +1,21 @@
+#pragma once
+
+#include "barometer_sensor.h"
+#include "pipeline.h"
+
+// Publishes the barometer's samples when they changed.
+class BarometerPipeline {
+public:
+  BarometerPipeline(BarometerSensor &sensor, telemetry::PublishChannel &channel, bool binary,
+                    metrics::DurationMetric &read_duration, ChangeStage &change);
+
+  // Returns false while the conversion pipeline has no new sample.
+  bool read();
+
+private:
+  BarometerSensor &sensor_;
+  telemetry::PublishChannel &channel_;
+  bool binary_;
+  metrics::DurationMetric &read_duration_;
+  ChangeStage &change_;
+};
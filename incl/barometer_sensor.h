@@ -2,26 +2,63 @@
 
 #include <Common/MS5611.h>
 
+#include "sample_time.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <limits>
+#include <span>
 #include <string>
 
+class SensorBackend;
+
 struct BarometerReading {
   bool valid = false;
+  // True only when this read() completed a new pressure sample; otherwise
+  // the reading repeats the last computed values.
+  bool fresh = false;
+  // When the last pressure conversion was collected.
+  SampleTime time;
   double temperature_c = std::numeric_limits<double>::quiet_NaN();
   double pressure_mbar = std::numeric_limits<double>::quiet_NaN();
 };
 
 class BarometerSensor {
 public:
-  BarometerSensor();
+  // oversampling is the MS5611 OSR (256, 512, 1024, 2048 or 4096).
+  // temperature_every is the number of pressure samples that reuse one
+  // temperature conversion.
+  // With a backend, readings come from it instead of the MS5611.
+  explicit BarometerSensor(int oversampling = 4096, int temperature_every = 1,
+                           SensorBackend *backend = nullptr);
   ~BarometerSensor();
 
   bool available() const;
+  // Non-blocking: collects a finished conversion, if any, and starts the next
+  // one before returning.
   BarometerReading read();
 
+  static bool valid_oversampling(int oversampling);
+
 private:
+  enum class Phase { Idle, ConvertingPressure, ConvertingTemperature };
+
+  void start_conversion(std::chrono::steady_clock::time_point now);
+
   bool ready_ = false;
+  SensorBackend *backend_;
   MS5611 barometer_;
+  std::uint8_t pressure_command_ = MS5611_RA_D1_OSR_4096;
+  std::uint8_t temperature_command_ = MS5611_RA_D2_OSR_4096;
+  std::chrono::microseconds conversion_time_{0};
+  int temperature_every_ = 1;
+  Phase phase_ = Phase::Idle;
+  std::chrono::steady_clock::time_point conversion_done_;
+  int pressure_samples_since_temperature_ = 0;
+  bool have_temperature_ = false;
+  BarometerReading latest_;
 };
 
-std::string format_barometer(const BarometerReading &reading, const std::string &timestamp);
+std::size_t format_barometer(std::span<char> out, const BarometerReading &reading);
+std::size_t encode_barometer(const BarometerReading &reading, std::span<std::uint8_t> out);
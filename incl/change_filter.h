@@ -0,0 +1,65 @@
+#pragma once
+
+#include "adc_sensor.h"
+#include "barometer_sensor.h"
+#include "gps_sensor.h"
+#include "rcinput_sensor.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Change-driven publishing for a slow-moving sensor. A sample is let
+// through when one of its fields moved beyond that field's deadband since
+// the last sample let through, when its set of fields changed (a sensor
+// going unavailable, a GPS fix appearing), or when heartbeat_ns passed
+// without one, so consumers still see the sensor is alive. A zero deadband
+// passes any change; NaN only equals NaN.
+class ChangeFilter {
+public:
+  static constexpr std::size_t kMaxFields = 16;
+
+  // names lists the fields in the order change_fields() writes them.
+  ChangeFilter(std::span<const std::string_view> names, std::int64_t heartbeat_ns);
+
+  // Sets the deadband of one field by name, or of every field for an empty
+  // name. Returns false for an unknown field.
+  bool set_deadband(std::string_view field, double deadband);
+
+  // Returns true when the sample with these fields must be published, and
+  // then remembers them as the last published values.
+  bool update(std::int64_t now_ns, std::span<const double> fields);
+
+  std::uint64_t passed() const { return passed_.load(std::memory_order_relaxed); }
+  std::uint64_t suppressed() const { return suppressed_.load(std::memory_order_relaxed); }
+  std::string summary() const;
+
+private:
+  std::span<const std::string_view> names_;
+  std::int64_t heartbeat_ns_;
+  std::array<double, kMaxFields> deadbands_{};
+  std::array<double, kMaxFields> last_{};
+  std::size_t last_count_ = 0;
+  std::int64_t last_ns_ = 0;
+  bool published_ = false;
+  std::atomic<std::uint64_t> passed_{0};
+  std::atomic<std::uint64_t> suppressed_{0};
+};
+
+// Field names of each sensor, as in its text payload where it has one.
+// GPS accuracies are h_acc and v_acc; RC fields are pulse widths in µs.
+extern const std::array<std::string_view, kAdcMaxChannels> kAdcChangeFields;
+extern const std::array<std::string_view, 2> kBarometerChangeFields;
+extern const std::array<std::string_view, 13> kGpsChangeFields;
+extern const std::array<std::string_view, 4> kRcInputChangeFields;
+
+// The fields a change filter compares, in the order of the names above.
+// An unavailable sensor has none.
+std::size_t change_fields(const AdcReading &reading, std::span<double> out);
+std::size_t change_fields(const BarometerReading &reading, std::span<double> out);
+std::size_t change_fields(const GpsReading &reading, std::span<double> out);
+std::size_t change_fields(const RcInputReading &reading, std::span<double> out);
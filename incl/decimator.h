@@ -0,0 +1,90 @@
+#pragma once
+
+#include "lanes.h"
+#include "sample_time.h"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Anti-aliasing FIR decimation of a multi-channel stream by an integer
+// factor M. The low-pass is a Blackman-windowed sinc cut off at half the
+// output rate with kTapsPerFactor * M + 1 taps: flat to about a third of the
+// output rate and at least ~70 dB down from two thirds of it, so nothing
+// above the new Nyquist frequency folds into the passband.
+//
+// Only every M-th output is computed (the polyphase form of the filter);
+// the other inputs are just copied into the history. Channels are packed
+// four to a Lanes vector and the history is stored twice over, so the
+// window is always contiguous and the dot product is a plain vector
+// multiply-accumulate. Every buffer is sized in the constructor; push()
+// does not allocate.
+class Decimator {
+public:
+  static constexpr std::size_t kTapsPerFactor = 16;
+
+  Decimator(std::size_t channels, std::size_t factor);
+
+  // Feeds one input sample of channels() values. Every factor()-th call
+  // once the history is full writes an output sample to out and returns
+  // true. The output is stamped with the time of the input at the centre of
+  // the window, which is the filter's group delay, so it lines up with the
+  // undecimated stream.
+  bool push(const SampleTime &time, std::span<const float> in, SampleTime &out_time, std::span<float> out);
+  void reset();
+
+  std::size_t channels() const { return channels_; }
+  std::size_t factor() const { return factor_; }
+  std::size_t taps() const { return taps_.size(); }
+
+private:
+  std::size_t channels_;
+  std::size_t blocks_;
+  std::size_t factor_;
+  std::vector<float> taps_;
+  // Two copies of the last taps() samples, blocks_ Lanes each.
+  std::vector<Lanes> history_;
+  std::vector<SampleTime> times_;
+  std::vector<Lanes> sum_;
+  std::size_t next_ = 0;
+  std::size_t filled_ = 0;
+  std::size_t phase_ = 0;
+};
+
+// The factor taking from_hz to to_hz, or 0 when to_hz is not an integer
+// fraction of from_hz at least two times lower.
+std::size_t decimation_factor(double from_hz, double to_hz);
+
+// Several output rates from one input stream. Stage i decimates the output
+// of stage i - 1 (stage 0 the input), so rates must be given highest first
+// and each must pass decimation_factor() against the one before it. A
+// cascade of small factors needs far fewer taps than decimating the input
+// straight down to every rate.
+class DecimationCascade {
+public:
+  DecimationCascade(std::size_t channels, double input_rate_hz, std::span<const double> rates_hz);
+
+  // Feeds one input sample and calls emit(stage, time, values) for every
+  // stage it completes a sample of, highest rate first.
+  template <typename Emit>
+  void push(const SampleTime &time, std::span<const float> in, Emit &&emit) {
+    SampleTime stage_time = time;
+    std::span<const float> stage_in = in;
+    for (std::size_t stage = 0; stage < stages_.size(); ++stage) {
+      std::span<float> out = outputs_[stage];
+      if (!stages_[stage].push(stage_time, stage_in, stage_time, out)) {
+        return;
+      }
+      emit(stage, static_cast<const SampleTime &>(stage_time), std::span<const float>(out));
+      stage_in = out;
+    }
+  }
+
+  std::size_t stages() const { return stages_.size(); }
+  double rate_hz(std::size_t stage) const { return rates_hz_[stage]; }
+
+private:
+  std::vector<Decimator> stages_;
+  std::vector<double> rates_hz_;
+  std::vector<std::vector<float>> outputs_;
+};
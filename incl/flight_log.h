@@ -0,0 +1,142 @@
+#pragma once
+
+// On-disk format of the flight recorder segments, shared by sensors_read and
+// sensors_read_dump.
+//
+// A segment starts with a fixed 1024-byte header:
+//   magic "SRFLIGHT" | version (u32) | header size (u32) |
+//   segment start CLOCK_MONOTONIC (i64 ns) | CLOCK_REALTIME offset (i64 ns) |
+//   sequence number (u32) | channel count (u32) |
+//   channel names (kMaxChannels x kChannelNameSize bytes, NUL padded)
+// followed by records, each aligned to 8 bytes:
+//   channel id (u16, 1-based index into the names) | reserved (u16) |
+//   payload length (u32) | CLOCK_MONOTONIC enqueue time (i64 ns) | payload
+// Payloads are the published text or binary payloads, unchanged. Unused
+// space is zero, so a zero channel id marks the end of the data; a closed
+// segment is truncated right after its last record.
+// All integers are little-endian.
+
+#include "telemetry_codec.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace flight_log {
+
+constexpr std::array<char, 8> kMagic = {'S', 'R', 'F', 'L', 'I', 'G', 'H', 'T'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::size_t kSegmentHeaderSize = 1024;
+constexpr std::size_t kChannelTableOffset = 40;
+constexpr std::size_t kMaxChannels = 32;
+constexpr std::size_t kChannelNameSize = 24;
+constexpr std::size_t kRecordHeaderSize = 16;
+constexpr std::size_t kRecordAlignment = 8;
+
+static_assert(kChannelTableOffset + kMaxChannels * kChannelNameSize <= kSegmentHeaderSize);
+
+constexpr std::size_t record_size(std::size_t payload_size) {
+  return (kRecordHeaderSize + payload_size + kRecordAlignment - 1) / kRecordAlignment * kRecordAlignment;
+}
+
+struct SegmentHeader {
+  std::uint32_t version = kVersion;
+  std::int64_t start_monotonic_ns = 0;
+  std::int64_t realtime_offset_ns = 0;
+  std::uint32_t sequence = 0;
+  std::vector<std::string> channels;
+};
+
+struct Record {
+  std::uint16_t channel = 0;
+  std::int64_t monotonic_ns = 0;
+  std::span<const std::uint8_t> payload;
+};
+
+// Writes the header into the first kSegmentHeaderSize bytes of out.
+inline bool encode_segment_header(const SegmentHeader &header, std::span<std::uint8_t> out) {
+  if (out.size() < kSegmentHeaderSize || header.channels.size() > kMaxChannels) {
+    return false;
+  }
+  std::memset(out.data(), 0, kSegmentHeaderSize);
+  std::memcpy(out.data(), kMagic.data(), kMagic.size());
+  codec::Writer writer(out.subspan(kMagic.size()));
+  writer.u32(header.version);
+  writer.u32(static_cast<std::uint32_t>(kSegmentHeaderSize));
+  writer.i64(header.start_monotonic_ns);
+  writer.i64(header.realtime_offset_ns);
+  writer.u32(header.sequence);
+  writer.u32(static_cast<std::uint32_t>(header.channels.size()));
+  for (std::size_t idx = 0; idx < header.channels.size(); ++idx) {
+    const std::string &name = header.channels[idx];
+    std::memcpy(out.data() + kChannelTableOffset + idx * kChannelNameSize, name.data(),
+                std::min(name.size(), kChannelNameSize - 1));
+  }
+  return writer.ok();
+}
+
+inline bool decode_segment_header(std::span<const std::uint8_t> in, SegmentHeader &header) {
+  if (in.size() < kSegmentHeaderSize || std::memcmp(in.data(), kMagic.data(), kMagic.size()) != 0) {
+    return false;
+  }
+  codec::Reader reader(in.subspan(kMagic.size()));
+  header.version = reader.u32();
+  const std::uint32_t header_size = reader.u32();
+  header.start_monotonic_ns = reader.i64();
+  header.realtime_offset_ns = reader.i64();
+  header.sequence = reader.u32();
+  const std::uint32_t count = reader.u32();
+  if (!reader.ok() || header.version != kVersion || header_size != kSegmentHeaderSize || count > kMaxChannels) {
+    return false;
+  }
+  header.channels.clear();
+  for (std::size_t idx = 0; idx < count; ++idx) {
+    const char *name = reinterpret_cast<const char *>(in.data() + kChannelTableOffset + idx * kChannelNameSize);
+    header.channels.emplace_back(name, strnlen(name, kChannelNameSize));
+  }
+  return true;
+}
+
+// Iterates the records of a segment image (header included).
+class SegmentReader {
+public:
+  explicit SegmentReader(std::span<const std::uint8_t> segment)
+      : segment_(segment), pos_(kSegmentHeaderSize) {}
+
+  // Returns false at the end of the data or at a corrupt record; truncated()
+  // tells the two apart.
+  bool next(Record &record) {
+    if (segment_.size() < pos_ + kRecordHeaderSize) {
+      return false;
+    }
+    codec::Reader reader(segment_.subspan(pos_, kRecordHeaderSize));
+    record.channel = reader.u16();
+    reader.u16();
+    const std::uint32_t length = reader.u32();
+    record.monotonic_ns = reader.i64();
+    if (record.channel == 0) {
+      return false;
+    }
+    if (segment_.size() - pos_ - kRecordHeaderSize < length) {
+      truncated_ = true;
+      return false;
+    }
+    record.payload = segment_.subspan(pos_ + kRecordHeaderSize, length);
+    pos_ += std::min(record_size(length), segment_.size() - pos_);
+    return true;
+  }
+
+  bool truncated() const { return truncated_; }
+
+private:
+  std::span<const std::uint8_t> segment_;
+  std::size_t pos_;
+  bool truncated_ = false;
+};
+
+} // namespace flight_log
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace telemetry {
+
+struct RecorderOptions {
+  std::string directory;
+  std::size_t segment_bytes = 64u << 20;
+  // Zero rotates on size only.
+  std::chrono::seconds segment_duration{0};
+};
+
+// Append-only on-board log of every queued payload, in the flight_log.h
+// format. Segments are preallocated and memory-mapped, so appending is a
+// memcpy into the page cache; written ranges are handed to writeback with
+// msync(MS_ASYNC) and dropped from the process with madvise(MADV_DONTNEED).
+// File operations only happen when a segment is opened or closed.
+//
+// Not thread-safe: the publisher thread is the only writer.
+class FlightRecorder {
+public:
+  explicit FlightRecorder(RecorderOptions options);
+  ~FlightRecorder();
+
+  FlightRecorder(const FlightRecorder &) = delete;
+  FlightRecorder &operator=(const FlightRecorder &) = delete;
+
+  // Channel ids in append() are 1-based indexes into channel_names.
+  bool open(std::vector<std::string> channel_names);
+  bool append(std::uint16_t channel, std::int64_t monotonic_ns, std::span<const std::uint8_t> payload);
+  // Truncates the current segment to its data and closes it.
+  void close();
+
+  std::uint64_t records() const { return records_.load(std::memory_order_relaxed); }
+  std::uint64_t failed() const { return failed_.load(std::memory_order_relaxed); }
+  std::string summary() const;
+
+private:
+  bool open_segment(std::int64_t monotonic_ns);
+  void finish_segment();
+  void release_written();
+
+  RecorderOptions options_;
+  std::vector<std::string> channels_;
+  bool active_ = false;
+  int fd_ = -1;
+  std::uint8_t *map_ = nullptr;
+  std::size_t used_ = 0;
+  std::size_t released_ = 0;
+  std::int64_t segment_start_ns_ = 0;
+  std::uint32_t sequence_ = 0;
+  std::string path_;
+  std::atomic<std::uint64_t> records_{0};
+  std::atomic<std::uint64_t> bytes_{0};
+  std::atomic<std::uint64_t> segments_{0};
+  std::atomic<std::uint64_t> failed_{0};
+};
+
+} // namespace telemetry
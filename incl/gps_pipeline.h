@@ -0,0 +1,21 @@
+#pragma once
+
+#include "gps_sensor.h"
+#include "pipeline.h"
+
+// Publishes the GPS state when it changed. The UBX stream itself is drained
+// by its own worker, through GpsSensor::drain().
+class GpsPipeline {
+public:
+  GpsPipeline(GpsSensor &sensor, telemetry::PublishChannel &channel, bool binary,
+              metrics::DurationMetric &read_duration, ChangeStage &change);
+
+  void read();
+
+private:
+  GpsSensor &sensor_;
+  telemetry::PublishChannel &channel_;
+  bool binary_;
+  metrics::DurationMetric &read_duration_;
+  ChangeStage &change_;
+};
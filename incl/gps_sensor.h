@@ -2,14 +2,26 @@
 
 #include <Common/Ublox.h>
 
+#include "sample_time.h"
+#include "seqlock.h"
+#include "ubx_parser.h"
+
+#include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
+class SensorBackend;
+
 struct GpsReading {
   bool has_position = false;
   bool has_status = false;
+  bool has_velocity = false;
+  // When the latest NAV message was decoded.
+  SampleTime time;
   double time_of_week_s = std::numeric_limits<double>::quiet_NaN();
   double latitude_deg = std::numeric_limits<double>::quiet_NaN();
   double longitude_deg = std::numeric_limits<double>::quiet_NaN();
@@ -17,21 +29,61 @@ struct GpsReading {
   double hmsl_m = std::numeric_limits<double>::quiet_NaN();
   double horizontal_accuracy_m = std::numeric_limits<double>::quiet_NaN();
   double vertical_accuracy_m = std::numeric_limits<double>::quiet_NaN();
+  // Velocity in the local north-east-down frame, horizontal speed, heading
+  // of motion (degrees clockwise from north) and speed accuracy.
+  double velocity_north_mps = std::numeric_limits<double>::quiet_NaN();
+  double velocity_east_mps = std::numeric_limits<double>::quiet_NaN();
+  double velocity_down_mps = std::numeric_limits<double>::quiet_NaN();
+  double ground_speed_mps = std::numeric_limits<double>::quiet_NaN();
+  double heading_deg = std::numeric_limits<double>::quiet_NaN();
+  double speed_accuracy_mps = std::numeric_limits<double>::quiet_NaN();
   int fix_type = 0;
   bool fix_ok = false;
 };
 
+// The u-blox receiver's UBX stream is decoded continuously: drain(), on a
+// worker of its own, reads everything the receiver has queued on SPI and
+// parses every frame in it, and read() only copies the latest decoded fix
+// out of a seqlock. Reading the GPS therefore takes constant time and no
+// message is skipped while waiting for another.
 class GpsSensor {
 public:
-  GpsSensor();
+  // How often drain() should run: several times per navigation solution
+  // (5 Hz) so a fix waits at most 20 ms in the receiver.
+  static constexpr double kDrainRateHz = 50.0;
+
+  // With a backend, readings come from it instead of the u-blox receiver.
+  explicit GpsSensor(SensorBackend *backend = nullptr);
   ~GpsSensor();
 
   bool available() const;
   GpsReading read();
 
+  // True when the receiver's stream needs drain() calls.
+  bool streaming() const { return static_cast<bool>(gps_); }
+  // Reads the receiver until it has nothing queued. Returns true when a NAV
+  // message updated the fix.
+  bool drain();
+  // Decodes UBX bytes as if the receiver had sent them, e.g. a recorded
+  // stream. Same thread as drain().
+  bool feed(std::span<const std::uint8_t> bytes);
+  const UbxParser &parser() const { return parser_; }
+
 private:
+  SensorBackend *backend_;
   std::unique_ptr<Ublox> gps_;
+  // Backend readings, or the receiver's fix as decoded so far on the drain
+  // thread.
   GpsReading state_;
+  SeqLock<GpsReading> latest_;
+  UbxParser parser_;
+  std::vector<unsigned char> tx_;
+  std::vector<unsigned char> rx_;
 };
 
-std::string format_gps(const GpsReading &state, const std::string &timestamp);
+// Applies a NAV-POSLLH, NAV-STATUS, NAV-VELNED or NAV-PVT message decoded at
+// time to state. Returns false for any other message or a short payload.
+bool apply_ubx(const UbxMessage &message, const SampleTime &time, GpsReading &state);
+
+std::size_t format_gps(std::span<char> out, const GpsReading &state);
+std::size_t encode_gps(const GpsReading &state, std::span<std::uint8_t> out);
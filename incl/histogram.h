@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// Log-linear histogram of non-negative integer values (nanoseconds in
+// practice). Values below 64 get exact buckets; above that every power of two
+// is split into 32 sub-buckets, bounding the relative error to about 3%.
+// Recording is lock-free so one thread can record while another reads.
+class LatencyHistogram {
+public:
+  static constexpr unsigned kSubBucketBits = 5;
+  static constexpr unsigned kMaxBits = 40;
+  static constexpr std::uint64_t kLinearLimit = std::uint64_t{1} << (kSubBucketBits + 1);
+  static constexpr std::size_t kBucketCount =
+      kLinearLimit + (kMaxBits - kSubBucketBits - 1) * (std::size_t{1} << kSubBucketBits);
+  static constexpr std::uint64_t kMaxValue = (std::uint64_t{1} << kMaxBits) - 1;
+
+  void record(std::uint64_t value) {
+    if (value > kMaxValue) {
+      value = kMaxValue;
+    }
+    buckets_[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    std::uint64_t current = max_.load(std::memory_order_relaxed);
+    while (value > current &&
+           !max_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  std::uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  std::uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+  // Returns the upper bound of the bucket holding the given percentile
+  // (0-100), or 0 when nothing has been recorded.
+  std::uint64_t percentile(double percent) const {
+    const std::uint64_t total = count();
+    if (total == 0) {
+      return 0;
+    }
+    if (percent >= 100.0) {
+      return max();
+    }
+    auto rank = static_cast<std::uint64_t>(percent / 100.0 * static_cast<double>(total));
+    if (rank >= total) {
+      rank = total - 1;
+    }
+    std::uint64_t seen = 0;
+    for (std::size_t idx = 0; idx < kBucketCount; ++idx) {
+      seen += buckets_[idx].load(std::memory_order_relaxed);
+      if (seen > rank) {
+        const std::uint64_t upper = bucket_upper(idx);
+        const std::uint64_t maximum = max();
+        return upper < maximum ? upper : maximum;
+      }
+    }
+    return max();
+  }
+
+  void reset() {
+    for (auto &bucket : buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  static std::size_t bucket_index(std::uint64_t value) {
+    if (value < kLinearLimit) {
+      return static_cast<std::size_t>(value);
+    }
+    const unsigned msb = static_cast<unsigned>(std::bit_width(value)) - 1;
+    const unsigned shift = msb - kSubBucketBits;
+    const std::uint64_t sub = (value >> shift) - (std::uint64_t{1} << kSubBucketBits);
+    return static_cast<std::size_t>(kLinearLimit +
+                                    (msb - kSubBucketBits - 1) * (std::uint64_t{1} << kSubBucketBits) + sub);
+  }
+
+  static std::uint64_t bucket_upper(std::size_t index) {
+    if (index < kLinearLimit) {
+      return index;
+    }
+    const std::size_t offset = index - kLinearLimit;
+    const unsigned shift = static_cast<unsigned>(offset >> kSubBucketBits) + 1;
+    const std::uint64_t sub = offset & ((std::size_t{1} << kSubBucketBits) - 1);
+    const std::uint64_t lower = ((std::uint64_t{1} << kSubBucketBits) + sub) << shift;
+    return lower + (std::uint64_t{1} << shift) - 1;
+  }
+
+  std::array<std::atomic<std::uint64_t>, kBucketCount> buckets_{};
+  std::atomic<std::uint64_t> count_{0};
+  std::atomic<std::uint64_t> max_{0};
+};
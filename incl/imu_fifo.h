@@ -0,0 +1,88 @@
+#pragma once
+
+#include "imu_registers.h"
+#include "imu_sensor.h"
+#include "register_bus.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Reads an IMU through its on-chip FIFO: the chip samples at its own output
+// data rate and every queued sample is collected in a few SPI bursts,
+// instead of one register transaction per polled sample.
+//
+// The FIFO carries no timestamps. Samples of one drain are stamped backwards
+// from the drain time at the configured sample period, newest last. The FIFO
+// stops accepting samples when full; an overflow is counted and the FIFO is
+// reset after the queued samples have been read.
+class ImuFifo {
+public:
+  virtual ~ImuFifo() = default;
+
+  // Programs the output data rate closest to odr_hz, enables the FIFO and
+  // empties it. Returns false on bus errors.
+  virtual bool configure(double odr_hz) = 0;
+  // Appends every complete queued sample to out, oldest first. Only the
+  // accelerometer, gyroscope and time fields are set; magnetometer fields are
+  // zero unless the driver can read them without disturbing the FIFO.
+  virtual bool drain(std::vector<ImuReading> &out) = 0;
+  // FIFO depth in samples.
+  virtual std::size_t capacity() const = 0;
+
+  double odr_hz() const { return odr_hz_; }
+  std::uint64_t samples() const { return samples_; }
+  std::uint64_t drains() const { return drains_; }
+  std::uint64_t overflows() const { return overflows_; }
+  std::string summary() const;
+
+protected:
+  // Sets the time of out[first..] from the drain time and the sample period.
+  void stamp(std::vector<ImuReading> &out, std::size_t first) const;
+
+  double odr_hz_ = 0.0;
+  std::uint64_t samples_ = 0;
+  std::uint64_t drains_ = 0;
+  std::uint64_t overflows_ = 0;
+};
+
+class Mpu9250Fifo : public ImuFifo {
+public:
+  explicit Mpu9250Fifo(RegisterBus &bus);
+
+  bool configure(double odr_hz) override;
+  bool drain(std::vector<ImuReading> &out) override;
+  std::size_t capacity() const override;
+
+private:
+  bool reset();
+
+  RegisterBus &bus_;
+  float accel_scale_ = 0.0f;
+  float gyro_scale_ = 0.0f;
+  std::array<std::uint8_t, mpu9250_reg::kFifoBytes> buffer_{};
+};
+
+class Lsm9ds1Fifo : public ImuFifo {
+public:
+  // The magnetometer bus is optional; with it each drain also reads the
+  // current magnetic field into the drained samples.
+  Lsm9ds1Fifo(RegisterBus &accel_gyro, RegisterBus *magnetometer = nullptr);
+
+  bool configure(double odr_hz) override;
+  bool drain(std::vector<ImuReading> &out) override;
+  std::size_t capacity() const override;
+
+private:
+  bool reset();
+
+  RegisterBus &bus_;
+  RegisterBus *magnetometer_;
+  float accel_scale_ = 0.0f;
+  float gyro_scale_ = 0.0f;
+  float mag_scale_ = 0.0f;
+  std::array<std::uint8_t, lsm9ds1_reg::kFifoSamples * lsm9ds1_reg::kAxisBlockBytes> accel_buffer_{};
+  std::array<std::uint8_t, lsm9ds1_reg::kFifoSamples * lsm9ds1_reg::kAxisBlockBytes> gyro_buffer_{};
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "imu_sensor.h"
+#include "lanes.h"
+#include "sample_time.h"
+#include "spsc_ring.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+// One 9-axis sample as three lane vectors, accelerometer, gyroscope and
+// magnetometer, each with its fourth lane zero. Alignment, interpolation,
+// bias correction and averaging each take three vector operations.
+struct ImuBlock {
+  std::array<Lanes, 3> sensor{};
+};
+
+// Maps a device's axes onto the common body frame: column j is where the
+// device's axis j points.
+using AxisRotation = std::array<Lanes, 3>;
+
+// Looks up a named mounting rotation: none, roll180, pitch180, yaw90,
+// yaw180 or yaw270 (the device frame turned by that angle about the body
+// axis, as in ArduPilot's AHRS_ORIENTATION).
+bool axis_rotation(std::string_view name, AxisRotation &rotation);
+
+struct FusedImuReading {
+  bool valid = false;
+  // The grid instant the devices were resampled to.
+  SampleTime time;
+  // Bit i set when device i contributed.
+  std::uint8_t sources = 0;
+  float ax = 0.0f;
+  float ay = 0.0f;
+  float az = 0.0f;
+  float gx_rad = 0.0f;
+  float gy_rad = 0.0f;
+  float gz_rad = 0.0f;
+  float mx = 0.0f;
+  float my = 0.0f;
+  float mz = 0.0f;
+  // Consistency: norm of the bias-corrected difference between the two
+  // devices per sensor, NaN when only one could be resampled.
+  float accel_residual = 0.0f;
+  float gyro_residual = 0.0f;
+  float mag_residual = 0.0f;
+};
+
+struct FusionOptions {
+  // Grid rate of the fused stream.
+  double rate_hz = 100.0;
+  // Readings buffered per device between two fusion passes.
+  std::size_t input_depth = 256;
+  // Residuals above these count as a disagreement.
+  float accel_tolerance = 0.25f;
+  float gyro_tolerance = 0.25f;
+  // Time constant of the relative bias estimate.
+  double bias_time_constant_s = 10.0;
+};
+
+// Fuses the two IMUs into one stream on a common time grid.
+//
+// Each acquisition thread pushes its readings into its own lock-free input;
+// a fusion thread calls next() to drain them, rotate every reading into the
+// body frame and linearly interpolate both devices at each grid instant
+// once both have a reading at or after it. While both are healthy the
+// second device's offset from the first is tracked with a slow low-pass
+// filter and removed, the fused sample is their mean and the remaining
+// difference is reported as the residual.
+//
+// A device stops contributing while it is:
+//   stuck   - kStuckReadings consecutive bit-identical readings;
+//   outlier - kOutlierPoints consecutive grid points disagreeing beyond
+//             the tolerance, blamed on the device whose value jumped more
+//             since the previous point; it rejoins after kRecoverPoints
+//             points in agreement;
+//   stale   - no reading within max(kStaleMinNs, 3 grid periods) of one
+//             the other device already delivered.
+// The fused stream then continues from the other device alone, keeping the
+// last bias correction, so failover needs no action from consumers.
+class ImuFusion {
+public:
+  static constexpr std::size_t kDevices = 2;
+  static constexpr std::size_t kHistory = 64;
+  static constexpr std::uint32_t kStuckReadings = 25;
+  static constexpr std::uint32_t kOutlierPoints = 5;
+  static constexpr std::uint32_t kRecoverPoints = 50;
+  static constexpr std::int64_t kStaleMinNs = 100000000;
+
+  enum class Health : std::uint8_t { Healthy, Stuck, Outlier, Stale };
+
+  explicit ImuFusion(const FusionOptions &options);
+
+  ImuFusion(const ImuFusion &) = delete;
+  ImuFusion &operator=(const ImuFusion &) = delete;
+
+  // Set before the first push().
+  void set_rotation(std::size_t device, const AxisRotation &rotation);
+
+  // Producer side, one thread per device.
+  void push(std::size_t device, const ImuReading &reading);
+
+  // Consumer side: the next fused grid sample, or false until both devices
+  // (or the only live one) have delivered readings past it.
+  bool next(FusedImuReading &out);
+
+  double rate_hz() const { return options_.rate_hz; }
+  Health health(std::size_t device) const;
+  std::uint64_t fused() const { return fused_.load(std::memory_order_relaxed); }
+  std::uint64_t stuck_events(std::size_t device) const;
+  std::uint64_t outlier_events(std::size_t device) const;
+  std::uint64_t stale_events(std::size_t device) const;
+  std::string summary() const;
+
+private:
+  struct Sample {
+    std::int64_t time_ns = 0;
+    ImuBlock block;
+  };
+
+  struct Device {
+    std::unique_ptr<SpscRing<ImuReading>> input;
+    AxisRotation rotation;
+    std::array<Sample, kHistory> history;
+    std::size_t first = 0;
+    std::size_t count = 0;
+    std::array<float, 9> last_raw{};
+    std::uint32_t identical = 0;
+    std::uint32_t disagreements = 0;
+    std::uint32_t agreements = 0;
+    bool outlier = false;
+    bool stale = false;
+    // Previous grid value, to tell which device jumped.
+    ImuBlock previous;
+    bool has_previous = false;
+    std::atomic<Health> health{Health::Healthy};
+    std::atomic<std::uint64_t> stuck_events{0};
+    std::atomic<std::uint64_t> outlier_events{0};
+    std::atomic<std::uint64_t> stale_events{0};
+  };
+
+  void drain(Device &device);
+  void append(Device &device, std::int64_t time_ns, const ImuBlock &block);
+  std::int64_t newest_ns(const Device &device) const;
+  bool interpolate(Device &device, std::int64_t time_ns, ImuBlock &out);
+  void update_health(Device &device);
+  void check_agreement(const std::array<ImuBlock, kDevices> &values, const ImuBlock &residual);
+
+  FusionOptions options_;
+  std::int64_t period_ns_;
+  std::int64_t stale_ns_;
+  float bias_gain_;
+  std::array<Device, kDevices> devices_;
+  // Offset of device 1 from device 0, subtracted from device 1.
+  ImuBlock bias_;
+  std::int64_t next_ns_ = 0;
+  std::int64_t realtime_offset_ns_ = 0;
+  std::atomic<std::uint64_t> fused_{0};
+};
+
+std::size_t format_fused_imu(std::span<char> out, const FusedImuReading &data);
+std::size_t encode_fused_imu(const FusedImuReading &data, std::span<std::uint8_t> out);
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "attitude_filter.h"
+#include "imu_sensor.h"
+#include "pipeline.h"
+#include "telemetry_codec.h"
+#include "utils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+class ImuFusion;
+
+// Everything one IMU's acquisition thread does with a reading: publish it,
+// or pack it into a window with --imu-window, then feed the attitude
+// filter, the --decimate cascade and the fusion stage when they are set up.
+class ImuPipeline {
+public:
+  ImuPipeline(ImuSensor &sensor, telemetry::PublishChannel &channel, bool binary,
+              metrics::DurationMetric &read_duration);
+
+  // Optional stages, set up before the first read. The decimation outputs
+  // come without a cascade, which make_task() builds.
+  void set_attitude(const AttitudeFilter &filter, telemetry::PublishChannel &channel);
+  void set_decimation(DecimatedOutputs outputs);
+  void set_window(const codec::ImuQuantization &steps, std::size_t max_samples, std::int64_t max_latency_ns);
+  void set_fusion(ImuFusion &fusion, std::size_t input);
+
+  // Puts the IMU in FIFO mode with --imu-fifo and builds the decimation
+  // cascade for the rate the samples really arrive at. Returns false when
+  // the --decimate rates do not divide it.
+  bool make_task(const utils::ProgramOptions &options, std::vector<double> decimation_hz, PipelineTask &task);
+
+  // Polled mode: one reading per call.
+  void read();
+  // FIFO mode: every sample the chip queued since the previous call.
+  void drain();
+  // Queues the window record, if it holds any samples, and starts a new one.
+  void flush_window();
+
+  ImuSensor &sensor() { return sensor_; }
+
+private:
+  // --imu-window: valid readings packed into a compressed window record,
+  // sent when it holds max_samples or max_latency_ns after its first
+  // sample (never for zero).
+  struct Window {
+    codec::ImuWindowEncoder encoder;
+    std::size_t max_samples;
+    std::int64_t max_latency_ns;
+  };
+
+  void publish(const ImuReading &reading);
+  void publish_attitude(const ImuReading &reading);
+  void decimate(const ImuReading &reading);
+
+  ImuSensor &sensor_;
+  telemetry::PublishChannel &channel_;
+  bool binary_;
+  std::string label_;
+  metrics::DurationMetric &read_duration_;
+  std::optional<AttitudeFilter> attitude_;
+  telemetry::PublishChannel *attitude_channel_ = nullptr;
+  std::string attitude_label_;
+  DecimatedOutputs decimated_;
+  std::optional<Window> window_;
+  ImuFusion *fusion_ = nullptr;
+  std::size_t fusion_input_ = 0;
+  // Samples of one FIFO drain; keeps its capacity between drains.
+  std::vector<ImuReading> samples_;
+};
+
+// Publishes every grid instant both IMUs have covered since the last run.
+class FusedImuPipeline {
+public:
+  FusedImuPipeline(ImuFusion &fusion, telemetry::PublishChannel &channel, bool binary);
+
+  void run();
+
+private:
+  ImuFusion &fusion_;
+  telemetry::PublishChannel &channel_;
+  bool binary_;
+};
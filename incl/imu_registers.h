@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Register addresses and bit fields used by the IMU FIFO drivers and their
+// register-level mocks. Only what those need is listed.
+
+namespace mpu9250_reg {
+
+constexpr std::uint8_t kSmplrtDiv = 0x19;
+constexpr std::uint8_t kConfig = 0x1A;
+constexpr std::uint8_t kGyroConfig = 0x1B;
+constexpr std::uint8_t kAccelConfig = 0x1C;
+constexpr std::uint8_t kFifoEnable = 0x23;
+constexpr std::uint8_t kIntStatus = 0x3A;
+constexpr std::uint8_t kUserCtrl = 0x6A;
+constexpr std::uint8_t kFifoCountH = 0x72;
+constexpr std::uint8_t kFifoCountL = 0x73;
+constexpr std::uint8_t kFifoRw = 0x74;
+
+constexpr std::uint8_t kConfigFifoMode = 0x40;  // Stop writing when full.
+constexpr std::uint8_t kConfigDlpfMask = 0x07;
+constexpr std::uint8_t kFifoEnableAccelGyro = 0x78;
+constexpr std::uint8_t kIntStatusFifoOverflow = 0x10;
+constexpr std::uint8_t kUserCtrlFifoEnable = 0x40;
+constexpr std::uint8_t kUserCtrlFifoReset = 0x04;
+
+constexpr std::size_t kFifoBytes = 512;
+// Big-endian accel X/Y/Z followed by gyro X/Y/Z.
+constexpr std::size_t kFifoFrameBytes = 12;
+constexpr double kInternalRateHz = 1000.0;
+
+} // namespace mpu9250_reg
+
+namespace lsm9ds1_reg {
+
+// Accelerometer/gyroscope device.
+constexpr std::uint8_t kCtrlReg1G = 0x10;
+constexpr std::uint8_t kOutXLG = 0x18;
+constexpr std::uint8_t kCtrlReg6XL = 0x20;
+constexpr std::uint8_t kCtrlReg9 = 0x23;
+constexpr std::uint8_t kOutXLXL = 0x28;
+constexpr std::uint8_t kFifoCtrl = 0x2E;
+constexpr std::uint8_t kFifoSrc = 0x2F;
+
+constexpr std::uint8_t kOdrMask = 0xE0;
+constexpr std::uint8_t kFullScaleMask = 0x18;
+constexpr std::uint8_t kCtrlReg9FifoEnable = 0x02;
+constexpr std::uint8_t kFifoModeBypass = 0x00;
+constexpr std::uint8_t kFifoModeStopWhenFull = 0x20;
+constexpr std::uint8_t kFifoSrcOverrun = 0x40;
+constexpr std::uint8_t kFifoSrcLevelMask = 0x3F;
+
+constexpr std::size_t kFifoSamples = 32;
+// Little-endian X/Y/Z; accelerometer and gyroscope are read as separate
+// bursts, each rolling over within its own output block.
+constexpr std::size_t kAxisBlockBytes = 6;
+
+// Magnetometer device.
+constexpr std::uint8_t kCtrlReg2M = 0x21;
+constexpr std::uint8_t kOutXLM = 0x28;
+constexpr std::uint8_t kMagFullScaleMask = 0x60;
+
+} // namespace lsm9ds1_reg
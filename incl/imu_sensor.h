@@ -1,12 +1,26 @@
 #pragma once
 
+#include "sample_time.h"
+#include "telemetry_codec.h"
+
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <span>
 #include <string>
+#include <vector>
 
 struct InertialSensor;
+class ImuFifo;
+class RegisterBus;
+class SensorBackend;
 
 struct ImuReading {
   bool valid = false;
+  // Set when a backend had no new sample since the previous read; the
+  // pipelines publish nothing for it.
+  bool stale = false;
+  SampleTime time;
   float ax = 0.0f;
   float ay = 0.0f;
   float az = 0.0f;
@@ -22,16 +36,33 @@ enum class ImuType { Mpu9250, Lsm9ds1 };
 
 class ImuSensor {
 public:
-  explicit ImuSensor(ImuType type);
+  // With a backend, readings come from it instead of the Navio2 driver.
+  explicit ImuSensor(ImuType type, SensorBackend *backend = nullptr);
   ~ImuSensor();
 
   bool available() const;
   const std::string &name() const;
   ImuReading read();
 
+  // Switches to burst reads of the chip's FIFO at the output data rate
+  // closest to odr_hz. Returns false, leaving polled read() in place, if the
+  // IMU is unavailable or the FIFO cannot be programmed.
+  bool enable_fifo(double odr_hz);
+  bool fifo_enabled() const { return static_cast<bool>(fifo_); }
+  const ImuFifo *fifo() const { return fifo_.get(); }
+  // Appends every sample queued since the previous call to out, oldest first.
+  bool read_fifo(std::vector<ImuReading> &out);
+
 private:
+  ImuType type_;
+  SensorBackend *backend_;
   std::string name_;
   std::unique_ptr<InertialSensor> sensor_;
+  std::unique_ptr<RegisterBus> bus_;
+  std::unique_ptr<RegisterBus> mag_bus_;
+  std::unique_ptr<ImuFifo> fifo_;
 };
 
-std::string format_imu(const std::string &name, const ImuReading &data, const std::string &timestamp);
+std::size_t format_imu(std::span<char> out, const std::string &name, const ImuReading &data);
+codec::ImuRecord imu_record(const std::string &name, const ImuReading &data);
+std::size_t encode_imu(const std::string &name, const ImuReading &data, std::span<std::uint8_t> out);
@@ -0,0 +1,5 @@
+#pragma once
+
+// Four float lanes; GCC and Clang lower the arithmetic on it to NEON on the
+// Pi and SSE on x86.
+using Lanes = float __attribute__((vector_size(16)));
@@ -1,14 +1,72 @@
 #pragma once
 
+#include "text_writer.h"
+
+#include <atomic>
+#include <cstddef>
 #include <string>
+#include <string_view>
+
+// Levels below this threshold are compiled out (0 = DEBUG ... 4 = CRITICAL);
+// set through the SENSORS_READ_MIN_LOG_LEVEL CMake cache variable.
+#ifndef SENSORS_READ_MIN_LOG_LEVEL
+#define SENSORS_READ_MIN_LOG_LEVEL 0
+#endif
 
 namespace logging {
 
 enum class Level { Debug = 0, Info, Warning, Error, Critical };
 
+// Longer messages are truncated.
+constexpr std::size_t kMaxMessageSize = 512;
+
+namespace detail {
+extern std::atomic<int> g_level;
+void write(Level level, std::string_view message);
+} // namespace detail
+
 void set_level(Level level);
 Level get_level();
 bool set_level(const std::string &name);
-void log(Level level, const std::string &message);
+
+constexpr bool compiled_in(Level level) {
+  return static_cast<int>(level) >= SENSORS_READ_MIN_LOG_LEVEL;
+}
+
+// Cheap check for hot paths; constant-folds to false for compiled-out levels.
+inline bool enabled(Level level) {
+  return compiled_in(level) &&
+         static_cast<int>(level) >= detail::g_level.load(std::memory_order_relaxed);
+}
+
+// Formats the arguments (strings, characters and numbers) into a stack buffer
+// only when the level is enabled, so pass values rather than pre-built
+// strings: log(Level::Debug, "Accel: ", ax, ' ', ay).
+template <typename... Args>
+void log(Level level, const Args &...args) {
+  if (!enabled(level)) {
+    return;
+  }
+  char buffer[kMaxMessageSize];
+  TextWriter writer(buffer);
+  (writer << ... << args);
+  detail::write(level, std::string_view(buffer, writer.written()));
+}
+
+// Moves output off the calling threads: each thread appends to its own
+// lock-free ring and a background writer drains them to stderr. Messages
+// are dropped (and counted) when a thread's ring is full.
+void start_async();
+// Writes everything still queued and returns to synchronous output.
+void stop_async();
+
+// Keeps asynchronous logging enabled for the lifetime of the object.
+class AsyncLogging {
+public:
+  AsyncLogging() { start_async(); }
+  ~AsyncLogging() { stop_async(); }
+  AsyncLogging(const AsyncLogging &) = delete;
+  AsyncLogging &operator=(const AsyncLogging &) = delete;
+};
 
 } // namespace logging
@@ -11,5 +11,8 @@ const std::string adc_topic = base_topic + "/adc";
 const std::string barometer_topic = base_topic + "/barometer";
 const std::string gps_topic = base_topic + "/gps";
 const std::string rc_topic = base_topic + "/rcinput";
+const std::string attitude_topic = base_topic + "/attitude";
+const std::string imu_fused_topic = base_topic + "/imu/fused";
+const std::string metrics_topic = base_topic + "/metrics";
 
 } // namespace main_const
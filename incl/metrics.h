@@ -0,0 +1,120 @@
+#pragma once
+
+#include "histogram.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+namespace telemetry {
+class TelemetryPublisher;
+}
+
+namespace metrics {
+
+// Duration of one pipeline stage. Count and sum are cumulative; the
+// percentiles cover the window since the previous report, so a device that
+// starts degrading shows up at once instead of being averaged away.
+class DurationMetric {
+public:
+  void record(std::int64_t ns) {
+    const auto value = static_cast<std::uint64_t>(ns > 0 ? ns : 0);
+    window_.record(value);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  std::uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  std::uint64_t sum_ns() const { return sum_ns_.load(std::memory_order_relaxed); }
+  const LatencyHistogram &window() const { return window_; }
+  void reset_window() { window_.reset(); }
+
+private:
+  LatencyHistogram window_;
+  std::atomic<std::uint64_t> count_{0};
+  std::atomic<std::uint64_t> sum_ns_{0};
+};
+
+inline std::int64_t monotonic_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Runs call() and records how long it took.
+template <typename Call>
+auto timed(DurationMetric &metric, Call &&call) {
+  const std::int64_t start = monotonic_ns();
+  if constexpr (std::is_void_v<decltype(call())>) {
+    call();
+    metric.record(monotonic_ns() - start);
+  } else {
+    auto result = call();
+    metric.record(monotonic_ns() - start);
+    return result;
+  }
+}
+
+// Builds a Prometheus text exposition. Declare a family, then add every
+// sample of it before declaring the next one. A null label emits the sample
+// without labels.
+class Exposition {
+public:
+  void family(const std::string &name, const char *type, const char *help);
+  void sample(const std::string &name, const char *label, const std::string &label_value, double value);
+  void counter(const std::string &name, const char *label, const std::string &label_value, std::uint64_t value);
+  // Emits the window percentiles, sum and count of a duration in seconds,
+  // then starts a new window.
+  void summary(const std::string &name, const char *label, const std::string &label_value,
+               DurationMetric &metric);
+
+  std::string str() const { return out_.str(); }
+
+private:
+  std::ostringstream out_;
+};
+
+struct ReporterOptions {
+  std::chrono::seconds interval{10};
+  std::string key;
+  // Prometheus textfile path; empty disables the file.
+  std::string file;
+};
+
+// Periodically collects an exposition, publishes it on a key and optionally
+// replaces a text file with it (written to a temporary file and renamed, as
+// the node_exporter textfile collector expects).
+class MetricsReporter {
+public:
+  using Collect = std::function<void(Exposition &)>;
+
+  MetricsReporter(telemetry::TelemetryPublisher &publisher, ReporterOptions options, Collect collect);
+  ~MetricsReporter();
+
+  MetricsReporter(const MetricsReporter &) = delete;
+  MetricsReporter &operator=(const MetricsReporter &) = delete;
+
+  void start();
+  void stop();
+
+private:
+  void run();
+  void report();
+
+  telemetry::TelemetryPublisher &publisher_;
+  ReporterOptions options_;
+  Collect collect_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool running_ = false;
+  std::thread thread_;
+};
+
+} // namespace metrics
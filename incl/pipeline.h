@@ -0,0 +1,115 @@
+#pragma once
+
+#include "change_filter.h"
+#include "decimator.h"
+#include "logging.h"
+#include "metrics.h"
+#include "publish_queue.h"
+#include "sensor_worker.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class AdcSensor;
+class GpsSensor;
+class ImuFusion;
+class ImuSensor;
+
+namespace telemetry {
+class FlightRecorder;
+class TelemetryPublisher;
+}
+
+// What one acquisition thread runs on every cycle, and how often.
+struct PipelineTask {
+  std::string name;
+  double rate_hz;
+  std::function<void()> run;
+};
+
+// Serializes a reading straight into the channel's queue slot with either
+// its text formatter or its binary encoder, depending on --encoding.
+template <typename Format, typename Encode>
+void publish_reading(telemetry::PublishChannel &channel, const char *label, bool binary, Format &&format_text,
+                     Encode &&encode_binary) {
+  auto serialize = [&](std::span<std::uint8_t> out) -> std::size_t {
+    const std::size_t size =
+        binary ? encode_binary(out) : format_text(std::span<char>(reinterpret_cast<char *>(out.data()), out.size()));
+    if (size == 0) {
+      logging::log(logging::Level::Error, "Failed to serialize ", label, " payload");
+    } else if (logging::enabled(logging::Level::Debug)) {
+      if (binary) {
+        logging::log(logging::Level::Debug, label, " record: ", size, " bytes");
+      } else {
+        logging::log(logging::Level::Debug, label, " payload: ",
+                     std::string_view(reinterpret_cast<const char *>(out.data()), size));
+      }
+    }
+    return size;
+  };
+  if (!channel.push_with(serialize) && logging::enabled(logging::Level::Debug)) {
+    logging::log(logging::Level::Debug, label, " sample dropped");
+  }
+}
+
+// Change-driven publishing of one slow sensor; the filter is null without
+// --heartbeat.
+struct ChangeStage {
+  const char *sensor;
+  const char *topic;
+  std::span<const std::string_view> fields;
+  std::unique_ptr<ChangeFilter> filter;
+};
+
+// False when the reading repeats the last published one within the
+// deadbands and no heartbeat is due.
+template <typename Reading>
+bool changed(ChangeStage &stage, const Reading &reading) {
+  if (!stage.filter) {
+    return true;
+  }
+  std::array<double, ChangeFilter::kMaxFields> fields;
+  const std::size_t count = change_fields(reading, fields);
+  return stage.filter->update(metrics::monotonic_ns(), std::span<const double>(fields.data(), count));
+}
+
+// One producer's --decimate outputs: the filter cascade and, per stage, the
+// channel its samples go out on. No cascade without --decimate.
+struct DecimatedOutputs {
+  std::unique_ptr<DecimationCascade> cascade;
+  std::vector<telemetry::PublishChannel *> channels;
+};
+
+// Time spent in one sensor's read(), labelled with the sensor name.
+struct ReadMetric {
+  const char *sensor;
+  metrics::DurationMetric duration;
+};
+
+// What the statistics dump and the metrics report look at. The IMUs are in
+// ImuFusion device order; recorder and fusion are null when disabled, gps
+// when the GPS is not read from its UBX stream.
+struct Pipeline {
+  const std::vector<std::unique_ptr<SensorWorker>> &workers;
+  const telemetry::PublishQueue &queue;
+  const telemetry::TelemetryPublisher &publisher;
+  std::vector<const ImuSensor *> imus;
+  const telemetry::FlightRecorder *recorder;
+  const ImuFusion *fusion;
+  std::span<const ChangeStage> changes;
+  const GpsSensor *gps;
+  const AdcSensor &adc;
+};
+
+void print_scheduler_stats(const Pipeline &pipeline);
+
+// Fills one metrics report: per-stage durations, publish queue counters and
+// the acquisition workers' scheduling health.
+void collect_metrics(metrics::Exposition &out, std::span<ReadMetric> reads, const Pipeline &pipeline);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "pipeline.h"
+#include "utils.h"
+
+#include <span>
+#include <string>
+#include <vector>
+
+class AdcSensor;
+class ImuFusion;
+
+namespace telemetry {
+class TelemetryPublisher;
+}
+
+// Turn the command-line options into pipeline configuration. Each returns
+// false, after logging why at Critical, on a value the pipeline cannot use.
+
+// Maps a --batch topic name to its key expression; nullptr when unknown.
+const std::string *batch_topic(const std::string &name);
+
+// Sets the publisher's batch policy for every --batch topic.
+bool configure_batching(const utils::ProgramOptions &options, telemetry::TelemetryPublisher &publisher);
+
+// Applies --adc-channels and --adc-sample. Sampled channels go at their own
+// rate, the other enabled ones at the ADC rate, all on the sampler's ticks.
+bool configure_adc_sampling(const utils::ProgramOptions &options, AdcSensor &adc);
+
+// Applies every --imu-rotation to the fusion stage.
+bool configure_imu_rotations(const utils::ProgramOptions &options, ImuFusion &fusion);
+
+// Sorts one sensor's --decimate rates highest first and checks that each is
+// an integer fraction of the one before it, starting from the sensor's own
+// sample rate.
+bool plan_decimation(const std::string &topic, double input_rate_hz, std::vector<double> &rates_hz);
+
+// Splits --decimate into the IMU and ADC rates, highest first, and plans
+// the ADC's against its read rate. The IMU rates are planned per IMU once
+// its real sample rate is known. Both are empty with --once.
+bool decimation_rates(const utils::ProgramOptions &options, std::vector<double> &imu_rates_hz,
+                      std::vector<double> &adc_rates_hz);
+
+// Gives every stage a change filter with --heartbeat and applies --deadband.
+bool configure_change_filters(const utils::ProgramOptions &options, std::span<ChangeStage> stages);
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "flight_recorder.h"
+#include "metrics.h"
+#include "spsc_ring.h"
+#include "telemetry_publisher.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace telemetry {
+
+// Largest payload a queued sample can carry.
+constexpr std::size_t kMaxQueuedPayload = 512;
+
+struct QueuedPayload {
+  std::uint32_t size = 0;
+  // CLOCK_MONOTONIC time the sample was queued, for the flight recorder.
+  std::int64_t monotonic_ns = 0;
+  std::array<std::uint8_t, kMaxQueuedPayload> bytes;
+};
+
+// Producer end of the publish queue owned by one acquisition thread.
+// Serializing into it never touches the network stack, so a slow Zenoh put
+// cannot delay the next hardware read.
+class PublishChannel {
+public:
+  PublishChannel(std::string name, std::string key, std::size_t depth,
+                 OverflowPolicy policy, std::atomic<std::uint32_t> &pending,
+                 std::uint32_t &sequence);
+
+  // Serializes a sample into the next free slot. Returns false when the
+  // sample was dropped or could not be serialized.
+  bool push_with(PayloadWriter write);
+
+  const std::string &name() const;
+  const std::string &key() const;
+  std::uint64_t published() const;
+  std::uint64_t failed() const;
+  std::uint64_t dropped() const;
+  std::size_t queued() const;
+  // Time spent in the serializer passed to push_with() and in the
+  // TelemetryPublisher call that sends a sample.
+  metrics::DurationMetric &serialize_duration();
+  metrics::DurationMetric &publish_duration();
+  std::string summary() const;
+
+private:
+  friend class PublishQueue;
+
+  std::string name_;
+  std::string key_;
+  SpscRing<QueuedPayload> ring_;
+  std::atomic<std::uint32_t> &pending_;
+  // Shared by every channel publishing on the same key; only the publisher
+  // thread touches it and numbered_drops_.
+  std::uint32_t &sequence_;
+  // Ring drops already given a sequence number.
+  std::uint64_t numbered_drops_ = 0;
+  std::atomic<std::uint64_t> published_{0};
+  std::atomic<std::uint64_t> failed_{0};
+  metrics::DurationMetric serialize_duration_;
+  metrics::DurationMetric publish_duration_;
+};
+
+// Drains every channel on a dedicated publisher thread and hands the samples
+// to the TelemetryPublisher, preserving batching and shared memory. As a
+// sample leaves the queue it is stamped with the next sequence number of its
+// key, so a key's numbers go out in order even when two channels share it,
+// and with the time it is handed to the publisher, before any batching: in
+// the binary header, or as trailing seq= and sent_ns= fields of a text
+// payload. Samples a full ring dropped use up numbers of their own.
+class PublishQueue {
+public:
+  PublishQueue(PayloadSink &publisher, std::size_t depth, OverflowPolicy policy);
+  ~PublishQueue();
+
+  PublishQueue(const PublishQueue &) = delete;
+  PublishQueue &operator=(const PublishQueue &) = delete;
+
+  // Channels must be added before start().
+  PublishChannel &add_channel(std::string name, std::string key);
+  const std::vector<std::unique_ptr<PublishChannel>> &channels() const;
+  // Records every sample before it is published; set before start(). The
+  // recorder's channel ids follow the order of add_channel().
+  void set_recorder(FlightRecorder *recorder);
+
+  void start();
+  // Publishes whatever is still queued, then joins the publisher thread.
+  void stop();
+
+private:
+  void run();
+  bool drain();
+  static void stamp_sequence(QueuedPayload &sample, std::uint32_t sequence);
+  static void stamp_sent_time(QueuedPayload &sample);
+
+  PayloadSink &publisher_;
+  std::size_t depth_;
+  OverflowPolicy policy_;
+  FlightRecorder *recorder_ = nullptr;
+  std::vector<std::unique_ptr<PublishChannel>> channels_;
+  std::unordered_map<std::string, std::uint32_t> sequences_;
+  std::atomic<std::uint32_t> pending_{0};
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};
+
+} // namespace telemetry
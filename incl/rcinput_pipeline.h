@@ -0,0 +1,20 @@
+#pragma once
+
+#include "pipeline.h"
+#include "rcinput_sensor.h"
+
+// Publishes the RC channels when they changed.
+class RcInputPipeline {
+public:
+  RcInputPipeline(RcInputSensor &sensor, telemetry::PublishChannel &channel, bool binary,
+                  metrics::DurationMetric &read_duration, ChangeStage &change);
+
+  void read();
+
+private:
+  RcInputSensor &sensor_;
+  telemetry::PublishChannel &channel_;
+  bool binary_;
+  metrics::DurationMetric &read_duration_;
+  ChangeStage &change_;
+};
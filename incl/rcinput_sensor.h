@@ -1,22 +1,43 @@
 #pragma once
 
+#include "sample_time.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <span>
 #include <string>
-#include <vector>
 
 class RCInput;
+class SensorBackend;
+
+constexpr std::size_t kRcMaxChannels = 14;
+
+// Raw pulse widths in microseconds; failed channels hold -1.
+struct RcInputReading {
+  std::size_t count = 0;
+  // Set when a backend had no new sample since the previous read; the
+  // pipelines publish nothing for it.
+  bool stale = false;
+  SampleTime time;
+  std::array<int, kRcMaxChannels> values{};
+};
 
 class RcInputSensor {
 public:
-  explicit RcInputSensor(int channels);
+  // With a backend, readings come from it instead of the Navio2 driver.
+  explicit RcInputSensor(int channels, SensorBackend *backend = nullptr);
   ~RcInputSensor();
 
   bool available() const;
-  std::vector<int> read();
+  RcInputReading read();
 
 private:
   int channels_ = 0;
+  SensorBackend *backend_;
   std::unique_ptr<RCInput> rc_;
 };
 
-std::string format_rcinput(const std::vector<int> &values, const std::string &timestamp);
+std::size_t format_rcinput(std::span<char> out, const RcInputReading &reading);
+std::size_t encode_rcinput(const RcInputReading &reading, std::span<std::uint8_t> out);
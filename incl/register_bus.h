@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Register-level access to one SPI device. Drivers that talk to the chip
+// directly (the IMU FIFO readers) go through this interface so they can run
+// against a register model instead of a Navio2.
+class RegisterBus {
+public:
+  virtual ~RegisterBus() = default;
+
+  // Reads out.size() bytes starting at reg in a single transfer.
+  virtual bool read(std::uint8_t reg, std::span<std::uint8_t> out) = 0;
+  virtual bool write(std::uint8_t reg, std::uint8_t value) = 0;
+
+  bool read_u8(std::uint8_t reg, std::uint8_t &value) {
+    return read(reg, std::span<std::uint8_t>(&value, 1));
+  }
+};
+
+// RegisterBus over a spidev node using the Navio2 SPIdev helper. Transfer
+// buffers are sized once, so reads up to max_read bytes never allocate.
+class SpiRegisterBus : public RegisterBus {
+public:
+  // read_flag is OR-ed into the register address of reads; the LSM9DS1
+  // magnetometer also needs its auto-increment bit (0x40) there.
+  SpiRegisterBus(std::string device, unsigned int speed_hz,
+                 std::uint8_t read_flag = 0x80, std::size_t max_read = 512);
+
+  bool read(std::uint8_t reg, std::span<std::uint8_t> out) override;
+  bool write(std::uint8_t reg, std::uint8_t value) override;
+
+private:
+  std::string device_;
+  unsigned int speed_hz_;
+  std::uint8_t read_flag_;
+  std::vector<unsigned char> tx_;
+  std::vector<unsigned char> rx_;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace telemetry {
+
+// Which samples of a history a query wants, from its Zenoh selector
+// parameters: the newest `last` samples published between since_ns and
+// until_ns (Unix time in nanoseconds, both inclusive).
+struct HistorySelector {
+  std::size_t last = std::numeric_limits<std::size_t>::max();
+  std::int64_t since_ns = std::numeric_limits<std::int64_t>::min();
+  std::int64_t until_ns = std::numeric_limits<std::int64_t>::max();
+};
+
+// Parses `last=<n>`, `since=<t>` and `until=<t>`, separated by ';' or '&'.
+// A time is Unix nanoseconds, or seconds before now_ns when negative (e.g.
+// `since=-10` for the last ten seconds). Other parameters are ignored so
+// Zenoh's own pass through. Returns false on a malformed value.
+bool parse_history_selector(std::string_view parameters, std::int64_t now_ns, HistorySelector &selector);
+
+// Samples copied out of a history, oldest first. Each one is copied with
+// the whole slot it was kept in.
+struct HistorySnapshot {
+  std::vector<std::uint8_t> slots;
+  std::vector<std::size_t> sizes;
+  std::size_t count = 0;
+
+  std::size_t size() const { return count; }
+  std::span<const std::uint8_t> operator[](std::size_t idx) const;
+};
+
+// The last samples published on one key, kept for late joiners. Storage is
+// a ring of capacity fixed-size slots allocated up front, so recording
+// never allocates and the oldest sample is overwritten once it is full.
+// Samples older than max_age (zero keeps them until overwritten) are no
+// longer returned. Recording and snapshots may run on different threads.
+class SampleHistory {
+public:
+  // Matches the publish queue's largest sample; bigger payloads are skipped.
+  static constexpr std::size_t kSlotSize = 512;
+
+  SampleHistory(std::size_t capacity, std::chrono::milliseconds max_age);
+
+  // Returns false when the payload does not fit a slot and was not kept.
+  bool record(std::int64_t time_ns, std::span<const std::uint8_t> payload);
+
+  // Copies the samples the selector picks, leaving out expired ones. out is
+  // sized for the most samples the selector can pick before the lock is
+  // taken, so recording only waits for the copy itself.
+  void snapshot(const HistorySelector &selector, std::int64_t now_ns, HistorySnapshot &out) const;
+
+  std::size_t capacity() const { return entries_.size(); }
+  std::size_t size() const;
+  std::uint64_t skipped() const;
+
+private:
+  struct Entry {
+    std::int64_t time_ns = 0;
+    std::size_t size = 0;
+  };
+
+  std::int64_t max_age_ns_;
+  mutable std::mutex mutex_;
+  std::vector<Entry> entries_;
+  std::vector<std::uint8_t> slots_;
+  // Slot the next sample goes to, and how many slots hold one.
+  std::size_t next_ = 0;
+  std::size_t count_ = 0;
+  std::uint64_t skipped_ = 0;
+};
+
+} // namespace telemetry
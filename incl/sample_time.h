@@ -0,0 +1,51 @@
+#pragma once
+
+#include "text_writer.h"
+
+#include <cstdint>
+#include <ctime>
+
+// Acquisition time of one sample. The CLOCK_MONOTONIC stamp is what rate
+// and interval computations should use; adding the CLOCK_REALTIME offset
+// sampled at the same instant recovers wall-clock time.
+struct SampleTime {
+  std::int64_t monotonic_ns = 0;
+  std::int64_t realtime_offset_ns = 0;
+
+  std::int64_t unix_ns() const { return monotonic_ns + realtime_offset_ns; }
+
+  std::int64_t unix_seconds() const {
+    const std::int64_t ns = unix_ns();
+    return ns >= 0 ? ns / 1000000000 : (ns - 999999999) / 1000000000;
+  }
+
+  static SampleTime now() {
+    timespec monotonic{};
+    timespec realtime{};
+    clock_gettime(CLOCK_MONOTONIC, &monotonic);
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    SampleTime time;
+    time.monotonic_ns = to_ns(monotonic);
+    time.realtime_offset_ns = to_ns(realtime) - time.monotonic_ns;
+    return time;
+  }
+
+private:
+  static std::int64_t to_ns(const timespec &ts) {
+    return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+};
+
+// CLOCK_REALTIME now, in nanoseconds since the Unix epoch.
+inline std::int64_t realtime_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Text payload fields shared by every sensor: the whole-second timestamp
+// kept for existing consumers, followed by the exact acquisition time.
+inline TextWriter &operator<<(TextWriter &writer, const SampleTime &time) {
+  return writer << "timestamp=" << time.unix_seconds() << " mono_ns=" << time.monotonic_ns
+                << " rt_offset_ns=" << time.realtime_offset_ns;
+}
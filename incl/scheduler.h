@@ -0,0 +1,42 @@
+#pragma once
+
+#include "histogram.h"
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+// Paces a periodic task on absolute CLOCK_MONOTONIC deadlines so the sampling
+// period does not drift with the time spent inside the task. Cycles that
+// finish after their next deadline are counted as overruns and the missed
+// slots are skipped to keep the original phase.
+class PeriodicScheduler {
+public:
+  explicit PeriodicScheduler(double rate_hz);
+
+  // Arms the first deadline at the current time.
+  void start();
+  // Sleeps until the next deadline. Returns false if running was cleared
+  // while waiting.
+  bool wait_next(const std::atomic<bool> &running);
+
+  double rate_hz() const;
+  std::uint64_t cycles() const;
+  std::uint64_t overruns() const;
+  std::uint64_t skipped_slots() const;
+  // Absolute deviation of each measured period from the nominal one, in ns.
+  const LatencyHistogram &jitter() const;
+
+  std::string summary() const;
+
+private:
+  double rate_hz_ = 0.0;
+  std::int64_t period_ns_ = 0;
+  std::int64_t next_deadline_ns_ = 0;
+  std::int64_t last_wake_ns_ = 0;
+  std::atomic<std::uint64_t> cycles_{0};
+  std::atomic<std::uint64_t> overruns_{0};
+  std::atomic<std::uint64_t> skipped_slots_{0};
+  LatencyHistogram jitter_;
+};
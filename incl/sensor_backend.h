@@ -0,0 +1,42 @@
+#pragma once
+
+#include "adc_sensor.h"
+#include "barometer_sensor.h"
+#include "gps_sensor.h"
+#include "imu_sensor.h"
+#include "rcinput_sensor.h"
+
+#include <memory>
+#include <string>
+
+// Source of readings for the sensor classes when they do not talk to a
+// Navio2. Each sensor calls only its own method, from its own worker thread,
+// so implementations keep per-sensor state without locking.
+//
+// A method returns false when it has no sample for that sensor, and the
+// sensor reports itself as it would for a missing device. The barometer and
+// GPS methods also return false when nothing new arrived since the previous
+// call; those sensors then repeat their last sample, like the hardware path.
+// The IMU, ADC and RC input methods instead return true with the reading's
+// stale flag set, so nothing is published for that cycle.
+class SensorBackend {
+public:
+  virtual ~SensorBackend() = default;
+
+  virtual const char *name() const = 0;
+  virtual bool read_imu(ImuType type, ImuReading &out) = 0;
+  virtual bool read_adc(AdcReading &out) = 0;
+  virtual bool read_barometer(BarometerReading &out) = 0;
+  virtual bool read_gps(GpsReading &out) = 0;
+  virtual bool read_rcinput(RcInputReading &out) = 0;
+};
+
+// Deterministic synthetic signals: a vibrating, slowly rocking IMU pair, a
+// 3S power module, a drifting barometer, a GPS circling a fixed point and
+// sweeping RC sticks. Every read produces a new sample, so the worker rates
+// set the signal rates.
+std::unique_ptr<SensorBackend> make_sim_backend();
+
+// Replays a capture file (see telemetry_codec.h) with its original timing,
+// looping at the end. Each recorded sample is handed out once, in order. Returns nullptr if the file cannot be loaded.
+std::unique_ptr<SensorBackend> make_replay_backend(const std::string &path);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "scheduler.h"
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Runs one sensor's acquisition task on a dedicated thread at its own rate so
+// that a slow device never delays a fast one.
+class SensorWorker {
+public:
+  SensorWorker(std::string name, double rate_hz, std::function<void()> task);
+  ~SensorWorker();
+
+  SensorWorker(const SensorWorker &) = delete;
+  SensorWorker &operator=(const SensorWorker &) = delete;
+
+  void start();
+  void stop();
+
+  const std::string &name() const;
+  double rate_hz() const;
+  const PeriodicScheduler &scheduler() const;
+
+private:
+  void run();
+
+  std::string name_;
+  std::function<void()> task_;
+  PeriodicScheduler scheduler_;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Latest-value cell for one writer side and any number of readers. Readers
+// copy the value and retry if a store overlapped; they never block writers.
+// Concurrent writers serialize on the odd sequence number. The value lives in
+// relaxed atomic words, so a torn read is detected rather than undefined.
+template <typename T>
+class SeqLock {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+  void store(const T &value) {
+    Words words{};
+    std::memcpy(words.data(), &value, sizeof(T));
+    std::uint64_t seq = seq_.load(std::memory_order_relaxed);
+    while ((seq & 1) != 0 ||
+           !seq_.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+      seq = seq_.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t idx = 0; idx < words.size(); ++idx) {
+      data_[idx].store(words[idx], std::memory_order_relaxed);
+    }
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  T load() const {
+    Words words{};
+    while (true) {
+      const std::uint64_t before = seq_.load(std::memory_order_acquire);
+      if ((before & 1) != 0) {
+        continue;
+      }
+      for (std::size_t idx = 0; idx < words.size(); ++idx) {
+        words[idx] = data_[idx].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) == before) {
+        break;
+      }
+    }
+    T value;
+    std::memcpy(static_cast<void *>(&value), words.data(), sizeof(T));
+    return value;
+  }
+
+private:
+  using Words = std::array<std::uint64_t, (sizeof(T) + 7) / 8>;
+
+  std::atomic<std::uint64_t> seq_{0};
+  std::array<std::atomic<std::uint64_t>, (sizeof(T) + 7) / 8> data_{};
+};
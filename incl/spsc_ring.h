@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+// What a full ring does with a new element: discard it (DropNewest) or make
+// room by discarding the oldest queued one (DropOldest).
+enum class OverflowPolicy { DropNewest, DropOldest };
+
+// Bounded lock-free ring for exactly one producer thread and one consumer
+// thread. Elements are written in place and storage is allocated once, so
+// neither side ever allocates or blocks.
+//
+// Every slot carries the position it is free for, which the consumer sets
+// once it has copied the element out. The producer only writes a slot whose
+// sequence says so. Under DropOldest a full ring has the producer fill the
+// new element aside first, then take the oldest one from the consumer with
+// a CAS on the consumer index; the consumer claims an element with the same
+// CAS before copying it, so a slot is never written and read at once.
+template <typename T>
+class SpscRing {
+  static_assert(std::is_trivially_copyable_v<T>, "ring elements are copied bytewise");
+
+public:
+  // The capacity is rounded up to a power of two.
+  SpscRing(std::size_t capacity, OverflowPolicy policy)
+      : capacity_(std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity)),
+        mask_(capacity_ - 1), slots_(std::make_unique<Slot[]>(capacity_)), policy_(policy) {
+    for (std::size_t idx = 0; idx < capacity_; ++idx) {
+      slots_[idx].sequence.store(idx, std::memory_order_relaxed);
+    }
+  }
+
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  // Producer side. fill(T &) writes the element and returns false to abandon
+  // it, which leaves the queued elements untouched. Returns true when the
+  // element was queued.
+  template <typename Fill>
+  bool push_with(Fill &&fill) {
+    const std::uint64_t head = head_.load(std::memory_order_relaxed);
+    Slot &slot = slots_[head & mask_];
+    if (slot.sequence.load(std::memory_order_acquire) == head) {
+      if (!fill(slot.value)) {
+        return false;
+      }
+      head_.store(head + 1, std::memory_order_release);
+      return true;
+    }
+    // Full, or the consumer is still copying out the slot's last element.
+    if (policy_ == OverflowPolicy::DropNewest) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    T value;
+    if (!fill(value)) {
+      return false;
+    }
+    std::uint64_t oldest = head - capacity_;
+    if (tail_.compare_exchange_strong(oldest, oldest + 1, std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+    } else if (slot.sequence.load(std::memory_order_acquire) != head) {
+      // The consumer claimed the oldest element and has not finished copying
+      // it, so there is no slot to write to yet.
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    slot.value = value;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Copies the oldest element into out; false when empty.
+  bool pop(T &out) {
+    std::uint64_t tail = tail_.load(std::memory_order_acquire);
+    while (true) {
+      const std::uint64_t head = head_.load(std::memory_order_acquire);
+      if (tail == head) {
+        return false;
+      }
+      Slot &slot = slots_[tail & mask_];
+      if (policy_ == OverflowPolicy::DropNewest) {
+        out = slot.value;
+        slot.sequence.store(tail + capacity_, std::memory_order_release);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+      }
+      // A failed CAS means the producer took the element; tail is reloaded.
+      if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+        out = slot.value;
+        slot.sequence.store(tail + capacity_, std::memory_order_release);
+        return true;
+      }
+    }
+  }
+
+  std::size_t capacity() const { return capacity_; }
+  OverflowPolicy policy() const { return policy_; }
+
+  std::size_t size() const {
+    const std::uint64_t tail = tail_.load(std::memory_order_acquire);
+    return static_cast<std::size_t>(head_.load(std::memory_order_acquire) - tail);
+  }
+
+  std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  // Keeps the producer and consumer indices on separate cache lines.
+  static constexpr std::size_t kCacheLine = 64;
+
+  struct Slot {
+    std::atomic<std::uint64_t> sequence{0};
+    T value;
+  };
+
+  const std::size_t capacity_;
+  const std::size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  const OverflowPolicy policy_;
+  alignas(kCacheLine) std::atomic<std::uint64_t> head_{0};
+  alignas(kCacheLine) std::atomic<std::uint64_t> tail_{0};
+  alignas(kCacheLine) std::atomic<std::uint64_t> dropped_{0};
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "sample_time.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace telemetry {
+
+// Samples published on a batched key are accumulated and emitted as one
+// codec::RecordType::Batch message once max_samples are queued or the oldest
+// has waited max_latency (zero disables the time bound).
+struct BatchPolicy {
+  std::size_t max_samples = 1;
+  std::chrono::milliseconds max_latency{0};
+};
+
+// One batched key's pending samples, packed into a batch record as they
+// arrive. The buffer is allocated up front for the policy's samples, so
+// adding never allocates. Not thread-safe; the publisher locks around it.
+class BatchBuffer {
+public:
+  static constexpr std::size_t kMaxSamples = 1000;
+  // Buffer space reserved per sample; larger samples still fit as long as
+  // the batch as a whole has room.
+  static constexpr std::size_t kPayloadCapacity = 512;
+
+  // max_samples is capped at kMaxSamples.
+  explicit BatchBuffer(const BatchPolicy &policy);
+
+  const BatchPolicy &policy() const { return policy_; }
+  std::size_t count() const { return count_; }
+
+  // Whether the payload fits behind the pending samples. One that does not
+  // fit an empty batch has to be published on its own.
+  bool fits(std::size_t payload_size) const;
+  // Appends a payload that fits() and returns true once the batch reached
+  // max_samples or its oldest sample has waited max_latency.
+  bool add(std::chrono::steady_clock::time_point now, std::int64_t timestamp_ns,
+           std::span<const std::uint8_t> payload);
+  // Whether pending samples have waited max_latency.
+  bool expired(std::chrono::steady_clock::time_point now) const;
+  // Completes the batch record and starts a new one. The record stays valid
+  // until the next add(); empty when no samples are pending.
+  std::span<const std::uint8_t> take(const SampleTime &time);
+
+private:
+  BatchPolicy policy_;
+  std::vector<std::uint8_t> buffer_;
+  std::size_t used_;
+  std::uint16_t count_ = 0;
+  std::chrono::steady_clock::time_point first_added_;
+};
+
+} // namespace telemetry
@@ -0,0 +1,830 @@
+#pragma once
+
+// Compact binary payload format shared by sensors_read and sensors_read_test.
+//
+// Every record starts with a fixed 32-byte header:
+//   magic (2 bytes, 0xA5 0x5A) | version (u8) | record type (u8) |
+//   CLOCK_MONOTONIC acquisition time (i64 ns) | CLOCK_REALTIME offset (i64 ns) |
+//   per-topic sequence number (u32) | send time (i64 CLOCK_REALTIME ns)
+// followed by a type-specific body. Encoders leave the sequence number and
+// send time zero; the publish queue stamps both as a sample leaves the
+// queue (see stamp_sequence).
+// Version 2 records stop after the clock offset and version 1 records
+// carried a single i64 Unix timestamp in seconds instead of the two clocks;
+// both still decode.
+// All multi-byte fields are little-endian and floating-point values use
+// IEEE-754 binary32/binary64 layouts. The magic bytes can never start a text
+// payload, so consumers can accept both encodings on the same topic.
+//
+// A batch record (type 16) wraps several samples of one topic in a single
+// message: after the header comes a u16 sample count and, per sample, its
+// enqueue time (i64 Unix nanoseconds), a u16 length and the original text or
+// binary payload bytes.
+//
+// An IMU window record (type 8) packs consecutive valid samples of one IMU
+// into a single message. After the header, whose time is the first
+// sample's, come the device (u8), the sample count (u8) and the
+// accelerometer, gyroscope and magnetometer quantization steps (3 f32).
+// Each sample follows as zigzag LEB128 varints: the change of its time
+// delta from the previous one in ns (absent for the first sample, zero for
+// the second), then its nine axes in steps, as deltas from the previous
+// sample (from zero for the first). Every sample shares the header's clock
+// offset.
+//
+// A capture file, as written by `sensors_read_test --record` and read by the
+// replay backend, is a plain sequence of binary records (batches included),
+// each preceded by its length as a little-endian u16.
+
+#include "sample_time.h"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace codec {
+
+constexpr std::uint8_t kMagic0 = 0xA5;
+constexpr std::uint8_t kMagic1 = 0x5A;
+constexpr std::uint8_t kVersion = 3;
+constexpr std::size_t kHeaderSize = 32;
+constexpr std::size_t kVersion1HeaderSize = 12;
+constexpr std::size_t kVersion2HeaderSize = 20;
+constexpr std::size_t kSequenceOffset = 20;
+constexpr std::size_t kMaxAdcChannels = 16;
+constexpr std::size_t kMaxRcAxes = 16;
+constexpr std::size_t kMaxRecordSize = 160;
+constexpr std::size_t kBatchPrefixSize = kHeaderSize + 2;
+constexpr std::size_t kBatchEntryOverhead = 10;
+// A time varint plus nine 32-bit axis deltas, at worst.
+constexpr std::size_t kMaxImuWindowSampleSize = 10 + 9 * 5;
+constexpr std::size_t kMaxImuWindowSize = 480;
+// Header, device, count and the three quantization steps.
+constexpr std::size_t kImuWindowPrefixSize = kHeaderSize + 2 + 3 * 4;
+// Most samples a window can hold: a 9-byte first sample, then 10-byte ones
+// (no change at all) while a worst-case sample still fits. Noisy axes fill
+// the record sooner.
+constexpr std::size_t kMaxImuWindowSamples =
+    2 + (kMaxImuWindowSize - kMaxImuWindowSampleSize - kImuWindowPrefixSize - 9) / 10;
+static_assert(kMaxImuWindowSamples == 39);
+
+enum class RecordType : std::uint8_t {
+  Imu = 1,
+  Adc = 2,
+  Barometer = 3,
+  Gps = 4,
+  RcInput = 5,
+  Attitude = 6,
+  FusedImu = 7,
+  ImuWindow = 8,
+  Batch = 16,
+};
+
+enum class ImuDevice : std::uint8_t { Unknown = 0, Mpu9250 = 1, Lsm9ds1 = 2 };
+
+struct RecordHeader {
+  std::uint8_t version = kVersion;
+  RecordType type = RecordType::Imu;
+  SampleTime time;
+  // Zero when the record predates version 3 or was never stamped.
+  std::uint32_t sequence = 0;
+  std::int64_t sent_ns = 0;
+};
+
+constexpr std::size_t header_size(std::uint8_t version) {
+  return version == 1 ? kVersion1HeaderSize : version == 2 ? kVersion2HeaderSize : kHeaderSize;
+}
+
+struct ImuRecord {
+  SampleTime time;
+  ImuDevice device = ImuDevice::Unknown;
+  bool valid = false;
+  float ax = 0.0f;
+  float ay = 0.0f;
+  float az = 0.0f;
+  float gx = 0.0f;
+  float gy = 0.0f;
+  float gz = 0.0f;
+  float mx = 0.0f;
+  float my = 0.0f;
+  float mz = 0.0f;
+};
+
+struct AdcRecord {
+  SampleTime time;
+  std::uint8_t count = 0;
+  std::array<float, kMaxAdcChannels> values{};
+};
+
+struct BarometerRecord {
+  SampleTime time;
+  bool valid = false;
+  float temperature_c = 0.0f;
+  float pressure_mbar = 0.0f;
+};
+
+struct GpsRecord {
+  SampleTime time;
+  bool has_position = false;
+  bool has_status = false;
+  bool has_velocity = false;
+  bool fix_ok = false;
+  std::uint8_t fix_type = 0;
+  double latitude_deg = 0.0;
+  double longitude_deg = 0.0;
+  float height_m = 0.0f;
+  float hmsl_m = 0.0f;
+  float horizontal_accuracy_m = 0.0f;
+  float vertical_accuracy_m = 0.0f;
+  float velocity_north_mps = 0.0f;
+  float velocity_east_mps = 0.0f;
+  float velocity_down_mps = 0.0f;
+  float ground_speed_mps = 0.0f;
+  float heading_deg = 0.0f;
+  float speed_accuracy_mps = 0.0f;
+};
+
+// Axis values are the normalised 0-100 stick deflections of the text format.
+struct RcInputRecord {
+  SampleTime time;
+  std::uint8_t count = 0;
+  std::array<std::uint8_t, kMaxRcAxes> axes{};
+};
+
+// Orientation estimated on board from one IMU's readings: the body-to-earth
+// quaternion and the matching roll/pitch/yaw in degrees.
+struct AttitudeRecord {
+  SampleTime time;
+  ImuDevice device = ImuDevice::Unknown;
+  bool valid = false;
+  float qw = 1.0f;
+  float qx = 0.0f;
+  float qy = 0.0f;
+  float qz = 0.0f;
+  float roll_deg = 0.0f;
+  float pitch_deg = 0.0f;
+  float yaw_deg = 0.0f;
+};
+
+inline const char *imu_device_name(ImuDevice device) {
+  switch (device) {
+  case ImuDevice::Mpu9250:
+    return "MPU9250";
+  case ImuDevice::Lsm9ds1:
+    return "LSM9DS1";
+  default:
+    return "unknown";
+  }
+}
+
+// Both IMUs resampled onto one time grid and combined. Bit 0 of sources is
+// the MPU9250, bit 1 the LSM9DS1; the residuals are the per-sensor norms of
+// their remaining difference, NaN when only one contributed.
+struct FusedImuRecord {
+  SampleTime time;
+  std::uint8_t sources = 0;
+  bool valid = false;
+  float ax = 0.0f;
+  float ay = 0.0f;
+  float az = 0.0f;
+  float gx = 0.0f;
+  float gy = 0.0f;
+  float gz = 0.0f;
+  float mx = 0.0f;
+  float my = 0.0f;
+  float mz = 0.0f;
+  float accel_residual = 0.0f;
+  float gyro_residual = 0.0f;
+  float mag_residual = 0.0f;
+};
+
+// Fixed-point resolution of an IMU window: the value of one step of each
+// sensor's axes, in the units of ImuRecord.
+struct ImuQuantization {
+  float accel_step = 0.001f;
+  float gyro_step = 0.001f;
+  float mag_step = 0.001f;
+};
+
+inline ImuDevice imu_device(std::string_view name) {
+  return name == "MPU9250" ? ImuDevice::Mpu9250 : name == "LSM9DS1" ? ImuDevice::Lsm9ds1 : ImuDevice::Unknown;
+}
+
+class Writer {
+public:
+  explicit Writer(std::span<std::uint8_t> out) : out_(out) {}
+
+  void u8(std::uint8_t value) {
+    if (!reserve(1)) {
+      return;
+    }
+    out_[pos_++] = value;
+  }
+
+  void u16(std::uint16_t value) { put_le(value, 2); }
+  void u32(std::uint32_t value) { put_le(value, 4); }
+  void u64(std::uint64_t value) { put_le(value, 8); }
+  void i64(std::int64_t value) { u64(static_cast<std::uint64_t>(value)); }
+  void f32(float value) { u32(std::bit_cast<std::uint32_t>(value)); }
+  void f64(double value) { u64(std::bit_cast<std::uint64_t>(value)); }
+
+  // Unsigned LEB128: seven bits per byte, low bits first.
+  void varint(std::uint64_t value) {
+    while (value >= 0x80) {
+      u8(static_cast<std::uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+    u8(static_cast<std::uint8_t>(value));
+  }
+
+  void header(RecordType type, const SampleTime &time) {
+    u8(kMagic0);
+    u8(kMagic1);
+    u8(kVersion);
+    u8(static_cast<std::uint8_t>(type));
+    i64(time.monotonic_ns);
+    i64(time.realtime_offset_ns);
+    u32(0);
+    i64(0);
+  }
+
+  bool ok() const { return ok_; }
+  // Number of bytes written, or 0 if the output span was too small.
+  std::size_t size() const { return ok_ ? pos_ : 0; }
+
+private:
+  bool reserve(std::size_t bytes) {
+    if (!ok_ || out_.size() - pos_ < bytes) {
+      ok_ = false;
+      return false;
+    }
+    return true;
+  }
+
+  void put_le(std::uint64_t value, std::size_t bytes) {
+    if (!reserve(bytes)) {
+      return;
+    }
+    for (std::size_t idx = 0; idx < bytes; ++idx) {
+      out_[pos_++] = static_cast<std::uint8_t>(value >> (8 * idx));
+    }
+  }
+
+  std::span<std::uint8_t> out_;
+  std::size_t pos_ = 0;
+  bool ok_ = true;
+};
+
+class Reader {
+public:
+  explicit Reader(std::span<const std::uint8_t> in) : in_(in) {}
+
+  std::uint8_t u8() { return static_cast<std::uint8_t>(get_le(1)); }
+  std::uint16_t u16() { return static_cast<std::uint16_t>(get_le(2)); }
+  std::uint32_t u32() { return static_cast<std::uint32_t>(get_le(4)); }
+  std::uint64_t u64() { return get_le(8); }
+  std::int64_t i64() { return static_cast<std::int64_t>(u64()); }
+  float f32() { return std::bit_cast<float>(u32()); }
+  double f64() { return std::bit_cast<double>(u64()); }
+
+  std::uint64_t varint() {
+    std::uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      const std::uint8_t byte = u8();
+      value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+      if (!ok_ || (byte & 0x80) == 0) {
+        return value;
+      }
+    }
+    ok_ = false;
+    return 0;
+  }
+
+  bool ok() const { return ok_; }
+  std::size_t remaining() const { return in_.size() - pos_; }
+
+private:
+  std::uint64_t get_le(std::size_t bytes) {
+    if (!ok_ || in_.size() - pos_ < bytes) {
+      ok_ = false;
+      return 0;
+    }
+    std::uint64_t value = 0;
+    for (std::size_t idx = 0; idx < bytes; ++idx) {
+      value |= static_cast<std::uint64_t>(in_[pos_++]) << (8 * idx);
+    }
+    return value;
+  }
+
+  std::span<const std::uint8_t> in_;
+  std::size_t pos_ = 0;
+  bool ok_ = true;
+};
+
+inline bool is_binary(std::span<const std::uint8_t> payload) {
+  return payload.size() >= kVersion1HeaderSize && payload[0] == kMagic0 && payload[1] == kMagic1;
+}
+
+inline bool decode_header(Reader &reader, RecordHeader &header) {
+  if (reader.u8() != kMagic0 || reader.u8() != kMagic1) {
+    return false;
+  }
+  header.version = reader.u8();
+  header.type = static_cast<RecordType>(reader.u8());
+  if (header.version == 1) {
+    // Whole Unix seconds only; there is no monotonic reading to recover.
+    header.time.monotonic_ns = 0;
+    header.time.realtime_offset_ns = reader.i64() * 1000000000;
+  } else {
+    header.time.monotonic_ns = reader.i64();
+    header.time.realtime_offset_ns = reader.i64();
+  }
+  header.sequence = 0;
+  header.sent_ns = 0;
+  if (header.version >= 3) {
+    header.sequence = reader.u32();
+    header.sent_ns = reader.i64();
+  }
+  return reader.ok() && header.version >= 1 && header.version <= kVersion;
+}
+
+inline bool peek_header(std::span<const std::uint8_t> payload, RecordHeader &header) {
+  Reader reader(payload);
+  return decode_header(reader, header);
+}
+
+// Fill in the sequence number and the send time of an encoded record in
+// place. Return false for records older than version 3, which have no room.
+inline bool stamp_sequence(std::span<std::uint8_t> record, std::uint32_t sequence) {
+  if (record.size() < kHeaderSize || record[0] != kMagic0 || record[1] != kMagic1 || record[2] < 3) {
+    return false;
+  }
+  Writer writer(record.subspan(kSequenceOffset, 4));
+  writer.u32(sequence);
+  return writer.ok();
+}
+
+inline bool stamp_sent_time(std::span<std::uint8_t> record, std::int64_t sent_ns) {
+  if (record.size() < kHeaderSize || record[0] != kMagic0 || record[1] != kMagic1 || record[2] < 3) {
+    return false;
+  }
+  Writer writer(record.subspan(kSequenceOffset + 4, 8));
+  writer.i64(sent_ns);
+  return writer.ok();
+}
+
+inline std::size_t encode(const ImuRecord &record, std::span<std::uint8_t> out) {
+  Writer writer(out);
+  writer.header(RecordType::Imu, record.time);
+  writer.u8(static_cast<std::uint8_t>(record.device));
+  writer.u8(record.valid ? 1 : 0);
+  for (float value : {record.ax, record.ay, record.az, record.gx, record.gy,
+                      record.gz, record.mx, record.my, record.mz}) {
+    writer.f32(value);
+  }
+  return writer.size();
+}
+
+inline std::size_t encode(const AdcRecord &record, std::span<std::uint8_t> out) {
+  Writer writer(out);
+  writer.header(RecordType::Adc, record.time);
+  const std::uint8_t count = record.count < kMaxAdcChannels ? record.count : kMaxAdcChannels;
+  writer.u8(count);
+  for (std::size_t idx = 0; idx < count; ++idx) {
+    writer.f32(record.values[idx]);
+  }
+  return writer.size();
+}
+
+inline std::size_t encode(const BarometerRecord &record, std::span<std::uint8_t> out) {
+  Writer writer(out);
+  writer.header(RecordType::Barometer, record.time);
+  writer.u8(record.valid ? 1 : 0);
+  writer.f32(record.temperature_c);
+  writer.f32(record.pressure_mbar);
+  return writer.size();
+}
+
+inline std::size_t encode(const GpsRecord &record, std::span<std::uint8_t> out) {
+  Writer writer(out);
+  writer.header(RecordType::Gps, record.time);
+  writer.u8(static_cast<std::uint8_t>((record.has_position ? 0x01 : 0) |
+                                      (record.has_status ? 0x02 : 0) |
+                                      (record.fix_ok ? 0x04 : 0) |
+                                      (record.has_velocity ? 0x08 : 0)));
+  writer.u8(record.fix_type);
+  writer.f64(record.latitude_deg);
+  writer.f64(record.longitude_deg);
+  writer.f32(record.height_m);
+  writer.f32(record.hmsl_m);
+  writer.f32(record.horizontal_accuracy_m);
+  writer.f32(record.vertical_accuracy_m);
+  // Only present with the velocity flag, so older records still decode.
+  if (record.has_velocity) {
+    for (float value : {record.velocity_north_mps, record.velocity_east_mps, record.velocity_down_mps,
+                        record.ground_speed_mps, record.heading_deg, record.speed_accuracy_mps}) {
+      writer.f32(value);
+    }
+  }
+  return writer.size();
+}
+
+inline std::size_t encode(const RcInputRecord &record, std::span<std::uint8_t> out) {
+  Writer writer(out);
+  writer.header(RecordType::RcInput, record.time);
+  const std::uint8_t count = record.count < kMaxRcAxes ? record.count : kMaxRcAxes;
+  writer.u8(count);
+  for (std::size_t idx = 0; idx < count; ++idx) {
+    writer.u8(record.axes[idx]);
+  }
+  return writer.size();
+}
+
+inline std::size_t encode(const AttitudeRecord &record, std::span<std::uint8_t> out) {
+  Writer writer(out);
+  writer.header(RecordType::Attitude, record.time);
+  writer.u8(static_cast<std::uint8_t>(record.device));
+  writer.u8(record.valid ? 1 : 0);
+  for (float value : {record.qw, record.qx, record.qy, record.qz, record.roll_deg, record.pitch_deg,
+                      record.yaw_deg}) {
+    writer.f32(value);
+  }
+  return writer.size();
+}
+
+inline std::size_t encode(const FusedImuRecord &record, std::span<std::uint8_t> out) {
+  Writer writer(out);
+  writer.header(RecordType::FusedImu, record.time);
+  writer.u8(record.sources);
+  writer.u8(record.valid ? 1 : 0);
+  for (float value : {record.ax, record.ay, record.az, record.gx, record.gy, record.gz, record.mx, record.my,
+                      record.mz, record.accel_residual, record.gyro_residual, record.mag_residual}) {
+    writer.f32(value);
+  }
+  return writer.size();
+}
+
+inline bool decode(std::span<const std::uint8_t> payload, ImuRecord &record) {
+  Reader reader(payload);
+  RecordHeader header;
+  if (!decode_header(reader, header) || header.type != RecordType::Imu) {
+    return false;
+  }
+  record.time = header.time;
+  record.device = static_cast<ImuDevice>(reader.u8());
+  record.valid = reader.u8() != 0;
+  for (float *value : {&record.ax, &record.ay, &record.az, &record.gx, &record.gy,
+                       &record.gz, &record.mx, &record.my, &record.mz}) {
+    *value = reader.f32();
+  }
+  return reader.ok();
+}
+
+inline bool decode(std::span<const std::uint8_t> payload, AdcRecord &record) {
+  Reader reader(payload);
+  RecordHeader header;
+  if (!decode_header(reader, header) || header.type != RecordType::Adc) {
+    return false;
+  }
+  record.time = header.time;
+  record.count = reader.u8();
+  if (record.count > kMaxAdcChannels) {
+    return false;
+  }
+  for (std::size_t idx = 0; idx < record.count; ++idx) {
+    record.values[idx] = reader.f32();
+  }
+  return reader.ok();
+}
+
+inline bool decode(std::span<const std::uint8_t> payload, BarometerRecord &record) {
+  Reader reader(payload);
+  RecordHeader header;
+  if (!decode_header(reader, header) || header.type != RecordType::Barometer) {
+    return false;
+  }
+  record.time = header.time;
+  record.valid = reader.u8() != 0;
+  record.temperature_c = reader.f32();
+  record.pressure_mbar = reader.f32();
+  return reader.ok();
+}
+
+inline bool decode(std::span<const std::uint8_t> payload, GpsRecord &record) {
+  Reader reader(payload);
+  RecordHeader header;
+  if (!decode_header(reader, header) || header.type != RecordType::Gps) {
+    return false;
+  }
+  record.time = header.time;
+  const std::uint8_t flags = reader.u8();
+  record.has_position = (flags & 0x01) != 0;
+  record.has_status = (flags & 0x02) != 0;
+  record.fix_ok = (flags & 0x04) != 0;
+  record.has_velocity = (flags & 0x08) != 0;
+  record.fix_type = reader.u8();
+  record.latitude_deg = reader.f64();
+  record.longitude_deg = reader.f64();
+  record.height_m = reader.f32();
+  record.hmsl_m = reader.f32();
+  record.horizontal_accuracy_m = reader.f32();
+  record.vertical_accuracy_m = reader.f32();
+  if (record.has_velocity) {
+    for (float *value : {&record.velocity_north_mps, &record.velocity_east_mps, &record.velocity_down_mps,
+                         &record.ground_speed_mps, &record.heading_deg, &record.speed_accuracy_mps}) {
+      *value = reader.f32();
+    }
+  }
+  return reader.ok();
+}
+
+inline bool decode(std::span<const std::uint8_t> payload, RcInputRecord &record) {
+  Reader reader(payload);
+  RecordHeader header;
+  if (!decode_header(reader, header) || header.type != RecordType::RcInput) {
+    return false;
+  }
+  record.time = header.time;
+  record.count = reader.u8();
+  if (record.count > kMaxRcAxes) {
+    return false;
+  }
+  for (std::size_t idx = 0; idx < record.count; ++idx) {
+    record.axes[idx] = reader.u8();
+  }
+  return reader.ok();
+}
+
+inline bool decode(std::span<const std::uint8_t> payload, AttitudeRecord &record) {
+  Reader reader(payload);
+  RecordHeader header;
+  if (!decode_header(reader, header) || header.type != RecordType::Attitude) {
+    return false;
+  }
+  record.time = header.time;
+  record.device = static_cast<ImuDevice>(reader.u8());
+  record.valid = reader.u8() != 0;
+  for (float *value : {&record.qw, &record.qx, &record.qy, &record.qz, &record.roll_deg, &record.pitch_deg,
+                       &record.yaw_deg}) {
+    *value = reader.f32();
+  }
+  return reader.ok();
+}
+
+inline bool decode(std::span<const std::uint8_t> payload, FusedImuRecord &record) {
+  Reader reader(payload);
+  RecordHeader header;
+  if (!decode_header(reader, header) || header.type != RecordType::FusedImu) {
+    return false;
+  }
+  record.time = header.time;
+  record.sources = reader.u8();
+  record.valid = reader.u8() != 0;
+  for (float *value : {&record.ax, &record.ay, &record.az, &record.gx, &record.gy, &record.gz, &record.mx,
+                       &record.my, &record.mz, &record.accel_residual, &record.gyro_residual,
+                       &record.mag_residual}) {
+    *value = reader.f32();
+  }
+  return reader.ok();
+}
+
+// Maps small signed values to small unsigned ones: 0, -1, 1, -2, ...
+inline std::uint64_t zigzag(std::int64_t value) {
+  return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t unzigzag(std::uint64_t value) {
+  return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+// Builds one IMU window record in place, a sample at a time. The record is
+// always complete, so it can be sent after any add().
+class ImuWindowEncoder {
+public:
+  explicit ImuWindowEncoder(const ImuQuantization &steps) : steps_(steps) {}
+
+  // Appends a valid sample. Returns false, leaving the window unchanged,
+  // when it is full or holds another device's samples; send and clear() it,
+  // then add the sample again.
+  bool add(const ImuRecord &sample) {
+    if (count_ == kMaxImuWindowSamples || (count_ > 0 && sample.device != device_) ||
+        kMaxImuWindowSize - size_ < kMaxImuWindowSampleSize) {
+      return false;
+    }
+    if (count_ == 0) {
+      Writer writer(buffer_);
+      writer.header(RecordType::ImuWindow, sample.time);
+      writer.u8(static_cast<std::uint8_t>(sample.device));
+      writer.u8(0);
+      writer.f32(steps_.accel_step);
+      writer.f32(steps_.gyro_step);
+      writer.f32(steps_.mag_step);
+      size_ = writer.size();
+      device_ = sample.device;
+      first_time_ = sample.time;
+      last_.fill(0);
+    }
+    Writer writer(std::span<std::uint8_t>(buffer_).subspan(size_));
+    const std::int64_t time_ns = sample.time.monotonic_ns;
+    if (count_ == 0) {
+      last_delta_ns_ = 0;
+    } else {
+      const std::int64_t delta_ns = time_ns - last_ns_;
+      writer.varint(zigzag(delta_ns - last_delta_ns_));
+      last_delta_ns_ = delta_ns;
+    }
+    last_ns_ = time_ns;
+    const std::array<float, 9> values = {sample.ax, sample.ay, sample.az, sample.gx, sample.gy,
+                                         sample.gz, sample.mx, sample.my, sample.mz};
+    for (std::size_t axis = 0; axis < values.size(); ++axis) {
+      const std::int32_t steps = quantize(values[axis], step(axis));
+      writer.varint(zigzag(static_cast<std::int64_t>(steps) - last_[axis]));
+      last_[axis] = steps;
+    }
+    size_ += writer.size();
+    buffer_[kHeaderSize + 1] = static_cast<std::uint8_t>(++count_);
+    return true;
+  }
+
+  std::size_t count() const { return count_; }
+  // Acquisition time of the first sample; meaningless while empty.
+  const SampleTime &first_time() const { return first_time_; }
+  // The encoded record, empty while the window holds no samples.
+  std::span<const std::uint8_t> record() const {
+    return {buffer_.data(), count_ > 0 ? size_ : 0};
+  }
+  void clear() {
+    count_ = 0;
+    size_ = 0;
+  }
+
+private:
+  float step(std::size_t axis) const {
+    return axis < 3 ? steps_.accel_step : axis < 6 ? steps_.gyro_step : steps_.mag_step;
+  }
+
+  // Rounds to the nearest step, saturating; a non-finite value becomes 0.
+  static std::int32_t quantize(float value, float step) {
+    const double steps = static_cast<double>(value) / static_cast<double>(step);
+    if (!(steps > -2147483647.0 && steps < 2147483647.0)) {
+      return steps > 0.0 ? 2147483647 : steps < 0.0 ? -2147483647 : 0;
+    }
+    return static_cast<std::int32_t>(steps < 0.0 ? steps - 0.5 : steps + 0.5);
+  }
+
+  std::array<std::uint8_t, kMaxImuWindowSize> buffer_{};
+  std::size_t size_ = 0;
+  std::size_t count_ = 0;
+  ImuQuantization steps_;
+  ImuDevice device_ = ImuDevice::Unknown;
+  SampleTime first_time_;
+  std::int64_t last_ns_ = 0;
+  std::int64_t last_delta_ns_ = 0;
+  std::array<std::int64_t, 9> last_{};
+};
+
+// Expands an IMU window record back into valid IMU samples, values rounded
+// to the window's quantization steps.
+class ImuWindowReader {
+public:
+  explicit ImuWindowReader(std::span<const std::uint8_t> payload) : reader_(payload) {
+    if (!decode_header(reader_, header_) || header_.type != RecordType::ImuWindow) {
+      return;
+    }
+    device_ = static_cast<ImuDevice>(reader_.u8());
+    count_ = reader_.u8();
+    const float accel_step = reader_.f32();
+    const float gyro_step = reader_.f32();
+    const float mag_step = reader_.f32();
+    for (std::size_t axis = 0; axis < steps_.size(); ++axis) {
+      steps_[axis] = axis < 3 ? accel_step : axis < 6 ? gyro_step : mag_step;
+    }
+    valid_ = reader_.ok();
+  }
+
+  bool valid() const { return valid_; }
+  std::size_t count() const { return count_; }
+  ImuDevice device() const { return device_; }
+  const RecordHeader &header() const { return header_; }
+
+  bool next(ImuRecord &sample) {
+    if (!valid_ || read_ >= count_) {
+      return false;
+    }
+    if (read_ == 0) {
+      time_ns_ = header_.time.monotonic_ns;
+    } else {
+      delta_ns_ += unzigzag(reader_.varint());
+      time_ns_ += delta_ns_;
+    }
+    for (std::int64_t &value : last_) {
+      value += unzigzag(reader_.varint());
+    }
+    if (!reader_.ok()) {
+      valid_ = false;
+      return false;
+    }
+    sample.time.monotonic_ns = time_ns_;
+    sample.time.realtime_offset_ns = header_.time.realtime_offset_ns;
+    sample.device = device_;
+    sample.valid = true;
+    std::array<float, 9> values;
+    for (std::size_t axis = 0; axis < values.size(); ++axis) {
+      values[axis] = static_cast<float>(static_cast<double>(last_[axis]) * steps_[axis]);
+    }
+    sample.ax = values[0];
+    sample.ay = values[1];
+    sample.az = values[2];
+    sample.gx = values[3];
+    sample.gy = values[4];
+    sample.gz = values[5];
+    sample.mx = values[6];
+    sample.my = values[7];
+    sample.mz = values[8];
+    ++read_;
+    return true;
+  }
+
+private:
+  Reader reader_;
+  RecordHeader header_;
+  ImuDevice device_ = ImuDevice::Unknown;
+  std::array<float, 9> steps_{};
+  std::array<std::int64_t, 9> last_{};
+  std::int64_t time_ns_ = 0;
+  std::int64_t delta_ns_ = 0;
+  std::size_t count_ = 0;
+  std::size_t read_ = 0;
+  bool valid_ = false;
+};
+
+// Writes the batch header and sample count at the start of out, which must
+// hold at least kBatchPrefixSize bytes.
+inline std::size_t encode_batch_prefix(std::span<std::uint8_t> out, const SampleTime &time,
+                                       std::uint16_t count) {
+  Writer writer(out);
+  writer.header(RecordType::Batch, time);
+  writer.u16(count);
+  return writer.size();
+}
+
+// Appends one sample to a batch body. Returns the bytes written, or 0 if the
+// sample does not fit.
+inline std::size_t encode_batch_entry(std::span<std::uint8_t> out, std::int64_t timestamp_ns,
+                                      std::span<const std::uint8_t> payload) {
+  if (payload.size() > 0xFFFF || out.size() < kBatchEntryOverhead + payload.size()) {
+    return 0;
+  }
+  Writer writer(out);
+  writer.i64(timestamp_ns);
+  writer.u16(static_cast<std::uint16_t>(payload.size()));
+  for (std::size_t idx = 0; idx < payload.size(); ++idx) {
+    out[kBatchEntryOverhead + idx] = payload[idx];
+  }
+  return kBatchEntryOverhead + payload.size();
+}
+
+class BatchReader {
+public:
+  explicit BatchReader(std::span<const std::uint8_t> payload) : payload_(payload) {
+    Reader reader(payload);
+    RecordHeader header;
+    if (!decode_header(reader, header) || header.type != RecordType::Batch) {
+      return;
+    }
+    count_ = reader.u16();
+    valid_ = reader.ok();
+    pos_ = header_size(header.version) + 2;
+  }
+
+  bool valid() const { return valid_; }
+  std::uint16_t count() const { return count_; }
+
+  bool next(std::int64_t &timestamp_ns, std::span<const std::uint8_t> &sample) {
+    if (!valid_ || read_ >= count_) {
+      return false;
+    }
+    Reader reader(payload_.subspan(pos_));
+    timestamp_ns = reader.i64();
+    const std::uint16_t length = reader.u16();
+    if (!reader.ok() || reader.remaining() < length) {
+      valid_ = false;
+      return false;
+    }
+    sample = payload_.subspan(pos_ + kBatchEntryOverhead, length);
+    pos_ += kBatchEntryOverhead + length;
+    ++read_;
+    return true;
+  }
+
+private:
+  std::span<const std::uint8_t> payload_;
+  std::size_t pos_ = 0;
+  std::uint16_t count_ = 0;
+  std::uint16_t read_ = 0;
+  bool valid_ = false;
+};
+
+} // namespace codec
@@ -1,14 +1,63 @@
 #pragma once
 
+#include "telemetry_batch.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <span>
 #include <string>
 
 namespace telemetry {
 
-class TelemetryPublisher {
+struct PublisherOptions {
+  // Allocate payloads from a Zenoh shared-memory pool so that subscribers on
+  // the same host receive them without copies. Remote subscribers and
+  // exhausted pools transparently fall back to the regular path.
+  bool shared_memory = false;
+  std::size_t shared_memory_size = 1 << 20;
+  // Samples kept for subscribers that join late on every key passed to
+  // keep_history(), served by a Zenoh queryable on the key, e.g.
+  // `telemetry/sensors/imu?last=500` (see SampleHistory). history_age drops
+  // older ones; zero samples disables it.
+  std::size_t history_samples = 0;
+  std::chrono::milliseconds history_age{0};
+};
+
+// Non-owning reference to a serializer callable with the signature
+// std::size_t(std::span<std::uint8_t>). It writes the payload into the given
+// buffer and returns the number of bytes used, or 0 on failure.
+class PayloadWriter {
 public:
-  TelemetryPublisher();
-  ~TelemetryPublisher();
+  template <typename Write>
+  PayloadWriter(Write &write)
+      : object_(&write), call_([](void *object, std::span<std::uint8_t> out) {
+          return static_cast<std::size_t>((*static_cast<Write *>(object))(out));
+        }) {}
+
+  std::size_t operator()(std::span<std::uint8_t> out) const {
+    return call_(object_, out);
+  }
+
+private:
+  void *object_;
+  std::size_t (*call_)(void *, std::span<std::uint8_t>);
+};
+
+// Where the publish queue hands its samples: the TelemetryPublisher, or a
+// stand-in in the tests. Returns false when the sample was not sent.
+class PayloadSink {
+public:
+  virtual ~PayloadSink() = default;
+  virtual bool publish_with(const std::string &key_expression, std::size_t capacity,
+                            PayloadWriter write) = 0;
+};
+
+class TelemetryPublisher : public PayloadSink {
+public:
+  explicit TelemetryPublisher(const PublisherOptions &options = {});
+  ~TelemetryPublisher() override;
 
   TelemetryPublisher(const TelemetryPublisher &) = delete;
   TelemetryPublisher &operator=(const TelemetryPublisher &) = delete;
@@ -16,7 +65,26 @@ public:
   TelemetryPublisher &operator=(TelemetryPublisher &&) = delete;
 
   bool ready() const;
+  bool shared_memory_active() const;
+  // With shared memory active: samples sent from a shared-memory buffer, and
+  // samples published the regular way because the pool had none free.
+  std::uint64_t shared_memory_published() const;
+  std::uint64_t shared_memory_fallbacks() const;
   bool publish(const std::string &key_expression, const std::string &message);
+  bool publish(const std::string &key_expression,
+               std::span<const std::uint8_t> payload);
+  // Lets the serializer write straight into the outgoing payload buffer (the
+  // shared-memory segment when enabled) of at most capacity bytes.
+  bool publish_with(const std::string &key_expression, std::size_t capacity,
+                    PayloadWriter write) override;
+
+  // Configure before publishing starts; max_samples <= 1 disables batching.
+  void set_batch_policy(const std::string &key_expression, const BatchPolicy &policy);
+  // Configure before publishing starts: allocates the key's history and
+  // declares its queryable. Does nothing when histories are disabled.
+  void keep_history(const std::string &key_expression);
+  // Emits every pending batch immediately.
+  void flush();
 
 private:
   class Impl;
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+// Stream-like formatter that writes into a caller-provided buffer with
+// std::to_chars and never allocates. Floating-point values use the same
+// six-significant-digit general notation as std::ostream defaults, so text
+// payloads are byte-for-byte identical to the former ostringstream output.
+class TextWriter {
+public:
+  explicit TextWriter(std::span<char> out) : out_(out) {}
+
+  TextWriter &operator<<(std::string_view text) {
+    if (!reserve(text.size())) {
+      return *this;
+    }
+    for (char ch : text) {
+      out_[pos_++] = ch;
+    }
+    return *this;
+  }
+
+  TextWriter &operator<<(const char *text) { return *this << std::string_view(text); }
+
+  TextWriter &operator<<(char ch) {
+    if (reserve(1)) {
+      out_[pos_++] = ch;
+    }
+    return *this;
+  }
+
+  // Booleans print as 1 or 0, like std::ostream.
+  TextWriter &operator<<(bool value) { return *this << (value ? '1' : '0'); }
+
+  template <std::integral T>
+  TextWriter &operator<<(T value) {
+    return convert([value](char *first, char *last) { return std::to_chars(first, last, value); });
+  }
+
+  template <std::floating_point T>
+  TextWriter &operator<<(T value) {
+    return convert([value](char *first, char *last) {
+      return std::to_chars(first, last, value, std::chars_format::general, 6);
+    });
+  }
+
+  bool ok() const { return ok_; }
+  // Number of characters written, or 0 if the buffer was too small.
+  std::size_t size() const { return ok_ ? pos_ : 0; }
+  std::string_view view() const { return {out_.data(), size()}; }
+  // Characters written before the buffer ran out, for callers that accept
+  // truncated output.
+  std::size_t written() const { return pos_; }
+
+private:
+  bool reserve(std::size_t count) {
+    if (!ok_ || out_.size() - pos_ < count) {
+      ok_ = false;
+      return false;
+    }
+    return true;
+  }
+
+  template <typename Convert>
+  TextWriter &convert(Convert &&to_chars) {
+    if (!ok_) {
+      return *this;
+    }
+    char *first = out_.data() + pos_;
+    char *last = out_.data() + out_.size();
+    const std::to_chars_result result = to_chars(first, last);
+    if (result.ec != std::errc()) {
+      ok_ = false;
+      return *this;
+    }
+    pos_ += static_cast<std::size_t>(result.ptr - first);
+    return *this;
+  }
+
+  std::span<char> out_;
+  std::size_t pos_ = 0;
+  bool ok_ = true;
+};
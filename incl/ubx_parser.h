@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+// One checked UBX frame. The payload points into the parser and is only
+// valid during the visit.
+struct UbxMessage {
+  std::uint8_t msg_class = 0;
+  std::uint8_t id = 0;
+  std::span<const std::uint8_t> payload;
+};
+
+// UBX message classes and ids sensors_read decodes.
+constexpr std::uint8_t kUbxClassNav = 0x01;
+constexpr std::uint8_t kUbxNavPosllh = 0x02;
+constexpr std::uint8_t kUbxNavStatus = 0x03;
+constexpr std::uint8_t kUbxNavPvt = 0x07;
+constexpr std::uint8_t kUbxNavVelned = 0x12;
+
+// Incremental UBX framing: sync chars 0xB5 0x62, class, id, u16 length,
+// payload and the 8-bit Fletcher checksum over class to payload. Bytes can
+// arrive in chunks of any size, so no message is lost to a chunk boundary,
+// and NMEA or idle (0xFF) bytes between frames are skipped. A frame with a
+// bad checksum or a payload over kMaxPayload is dropped and its bytes after
+// the first sync char are scanned again, so a corrupt length cannot swallow
+// the good frames behind it. Nothing allocates.
+class UbxParser {
+public:
+  static constexpr std::size_t kMaxPayload = 512;
+  static constexpr std::size_t kMaxFrame = kMaxPayload + 8;
+
+  // Calls visit(const UbxMessage &) for every checked frame the bytes
+  // complete, in stream order.
+  template <typename Visit>
+  void feed(std::span<const std::uint8_t> bytes, Visit &&visit) {
+    for (std::uint8_t byte : bytes) {
+      if (step(byte)) {
+        visit(message());
+      }
+      while (replay_next_ < replay_size_) {
+        if (step(replay_[replay_next_++])) {
+          visit(message());
+        }
+      }
+    }
+  }
+
+  void reset();
+
+  std::uint64_t frames() const { return frames_.load(std::memory_order_relaxed); }
+  std::uint64_t checksum_errors() const { return checksum_errors_.load(std::memory_order_relaxed); }
+  std::uint64_t oversized() const { return oversized_.load(std::memory_order_relaxed); }
+  std::string summary() const;
+
+private:
+  enum class State : std::uint8_t { Sync1, Sync2, Class, Id, Length1, Length2, Payload, ChecksumA, ChecksumB };
+
+  // Returns true when byte completes a checked frame.
+  bool step(std::uint8_t byte);
+  // Drops the frame being assembled and queues its bytes after the first
+  // sync char to be scanned again, ahead of anything still queued.
+  void reject();
+  UbxMessage message() const;
+
+  State state_ = State::Sync1;
+  std::uint16_t length_ = 0;
+  std::uint8_t checksum_a_ = 0;
+  std::uint8_t checksum_b_ = 0;
+  // Every byte of the frame being assembled, sync chars included.
+  std::array<std::uint8_t, kMaxFrame> frame_{};
+  std::size_t frame_size_ = 0;
+  // Bytes of rejected frames still to scan. A frame assembled from queued
+  // bytes is shorter than the queue was, so kMaxFrame always holds it.
+  std::array<std::uint8_t, kMaxFrame> replay_{};
+  std::size_t replay_next_ = 0;
+  std::size_t replay_size_ = 0;
+  std::atomic<std::uint64_t> frames_{0};
+  std::atomic<std::uint64_t> checksum_errors_{0};
+  std::atomic<std::uint64_t> oversized_{0};
+};
@@ -1,18 +1,125 @@
 #pragma once
 
+#include "spsc_ring.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace utils {
 
+enum class PayloadEncoding { Text, Binary };
+
+// Where sensor readings come from: the Navio2 drivers, synthetic signals or
+// a replayed capture file.
+enum class BackendKind { Navio2, Sim, Replay };
+
+// On-board attitude estimation: off, gyroscope and accelerometer only, or
+// also fusing the magnetometer for an absolute heading.
+enum class AttitudeMode { Off, Imu, Marg };
+
+// One --batch <topic>=<samples>[:<milliseconds>] option.
+struct BatchOption {
+  std::string topic;
+  std::size_t max_samples = 1;
+  int max_latency_ms = 0;
+};
+
+// One --decimate <topic>=<hz>[,<hz>...] option, resolved in main.
+struct DecimateOption {
+  std::string topic;
+  std::vector<int> rates_hz;
+};
+
+// One --deadband <topic>[.<field>]=<value> option, resolved in main; an
+// empty field covers every field of the topic.
+struct DeadbandOption {
+  std::string topic;
+  std::string field;
+  double deadband = 0.0;
+};
+
+// One --adc-sample <channel>=<hz>[:<n>[:mean|median]] option, resolved in
+// main.
+struct AdcSampleOption {
+  std::size_t channel = 0;
+  double rate_hz = 0.0;
+  std::size_t oversample = 1;
+  bool median = false;
+};
+
+// One --imu-rotation <device>=<rotation> option, resolved in main.
+struct ImuRotationOption {
+  std::string device;
+  std::string rotation;
+};
+
 struct ProgramOptions {
   double interval = 1.0;
   int rc_channels = 4;
   bool once = false;
+  // Per-sensor acquisition rates in Hz; zero falls back to 1 / interval.
+  double imu_rate = 0.0;
+  double adc_rate = 0.0;
+  double baro_rate = 0.0;
+  double gps_rate = 0.0;
+  double rc_rate = 0.0;
+  int baro_oversampling = 4096;
+  int baro_temperature_every = 1;
+  PayloadEncoding encoding = PayloadEncoding::Text;
+  bool shared_memory = false;
+  std::size_t shared_memory_size = 1 << 20;
+  std::vector<BatchOption> batches;
+  std::size_t queue_depth = 64;
+  OverflowPolicy overflow = OverflowPolicy::DropOldest;
+  // IMU FIFO output data rate in Hz; zero keeps polled IMU reads.
+  double imu_fifo_odr = 0.0;
+  BackendKind backend = BackendKind::Navio2;
+  std::string replay_file;
+  // Flight recorder directory; empty disables local recording.
+  std::string record_dir;
+  std::size_t record_segment_mb = 64;
+  // Seconds per flight log segment; zero rotates on size only.
+  int record_segment_s = 0;
+  // Seconds between metrics reports; zero disables them.
+  int metrics_interval_s = 10;
+  // Prometheus textfile written with every metrics report; empty disables it.
+  std::string metrics_file;
+  AttitudeMode attitude = AttitudeMode::Off;
+  // Madgwick filter gain: how fast the estimate is pulled towards gravity
+  // (and north) against the integrated gyroscope.
+  double attitude_beta = 0.1;
+  // Fuse both IMUs into imu/fused; fusion_rate zero follows the IMU rate.
+  bool fusion = false;
+  double fusion_rate = 0.0;
+  std::vector<ImuRotationOption> imu_rotations;
+  std::vector<DecimateOption> decimations;
+  // Heartbeat of change-driven ADC, barometer, GPS and RC publishing in
+  // seconds; zero publishes every sample.
+  double heartbeat_s = 0.0;
+  std::vector<DeadbandOption> deadbands;
+  // Samples per compressed IMU window record and the longest a window is
+  // held in milliseconds; zero samples publishes every IMU reading alone.
+  std::size_t imu_window = 0;
+  int imu_window_ms = 100;
+  // IMU window quantization steps: accelerometer (m/s²), gyroscope (rad/s)
+  // and magnetometer (µT), each at or below the finest sensor LSB.
+  std::array<double, 3> imu_resolution = {0.001, 0.0001, 0.01};
+  // Samples kept per topic for history queries and their longest age in
+  // seconds; zero samples disables the history, zero seconds the age limit.
+  std::size_t history = 0;
+  int history_s = 0;
+  // ADC channels read, one bit per channel, and the ones sampled in the
+  // background at their own rates.
+  std::uint16_t adc_channels = 0xFFFF;
+  std::vector<AdcSampleOption> adc_samples;
 };
 
 void print_usage(const char *prog);
 bool parse_options(int argc, char *argv[], ProgramOptions &opts,
                    bool &show_help);
-std::string current_timestamp();
+double sensor_rate(double rate_hz, const ProgramOptions &opts);
 
 } // namespace utils
@@ -0,0 +1,193 @@
+#include "acquisition.h"
+
+#include "logging.h"
+#include "main.h"
+#include "pipeline_options.h"
+#include "telemetry_publisher.h"
+
+#include <chrono>
+#include <cstdint>
+#include <unistd.h>
+
+Acquisition::Acquisition(const utils::ProgramOptions &options, SensorBackend *backend,
+                         telemetry::TelemetryPublisher &publisher)
+    : options_(options), publisher_(publisher), binary_(options.encoding == utils::PayloadEncoding::Binary),
+      mpu_sensor_(ImuType::Mpu9250, backend), lsm_sensor_(ImuType::Lsm9ds1, backend), adc_sensor_(backend),
+      barometer_sensor_(options.baro_oversampling, options.baro_temperature_every, backend), gps_sensor_(backend),
+      rc_sensor_(options.rc_channels, backend), queue_(publisher, options.queue_depth, options.overflow),
+      mpu_(mpu_sensor_, queue_.add_channel("MPU9250", main_const::imu_topic), binary_, reads_[0].duration),
+      lsm_(lsm_sensor_, queue_.add_channel("LSM9DS1", main_const::imu_topic), binary_, reads_[1].duration),
+      adc_(adc_sensor_, queue_.add_channel("ADC", main_const::adc_topic), binary_, reads_[2].duration, changes_[0]),
+      barometer_(barometer_sensor_, queue_.add_channel("Barometer", main_const::barometer_topic), binary_,
+                 reads_[3].duration, changes_[1]),
+      gps_(gps_sensor_, queue_.add_channel("GPS", main_const::gps_topic), binary_, reads_[4].duration, changes_[2]),
+      rc_(rc_sensor_, queue_.add_channel("RCInput", main_const::rc_topic), binary_, reads_[5].duration,
+          changes_[3]) {}
+
+bool Acquisition::init() {
+  if (!configure_adc_sampling(options_, adc_sensor_)) {
+    return false;
+  }
+
+  // Each IMU's attitude is estimated on its own acquisition thread right
+  // after the reading is queued, so the filter sees every sample.
+  if (options_.attitude != utils::AttitudeMode::Off) {
+    const AttitudeFilter filter(static_cast<float>(options_.attitude_beta),
+                                options_.attitude == utils::AttitudeMode::Marg);
+    mpu_.set_attitude(filter, queue_.add_channel("MPU9250/attitude", main_const::attitude_topic));
+    lsm_.set_attitude(filter, queue_.add_channel("LSM9DS1/attitude", main_const::attitude_topic));
+  }
+
+  // Both IMUs also feed the fusion stage, which resamples them onto one
+  // grid on its own thread. It needs a stream of readings, so --once skips it.
+  if (options_.fusion && !options_.once) {
+    // Rate the IMU samples arrive at, in FIFO or polled mode.
+    const double imu_rate_hz =
+        options_.imu_fifo_odr > 0.0 ? options_.imu_fifo_odr : utils::sensor_rate(options_.imu_rate, options_);
+    FusionOptions fusion_options;
+    fusion_options.rate_hz = options_.fusion_rate > 0.0 ? options_.fusion_rate : imu_rate_hz;
+    fusion_ = std::make_unique<ImuFusion>(fusion_options);
+    if (!configure_imu_rotations(options_, *fusion_)) {
+      return false;
+    }
+    fused_ = std::make_unique<FusedImuPipeline>(
+        *fusion_, queue_.add_channel("IMU fused", main_const::imu_fused_topic), binary_);
+    mpu_.set_fusion(*fusion_, 0);
+    lsm_.set_fusion(*fusion_, 1);
+    logging::log(logging::Level::Info, "Fusing both IMUs at ", fusion_options.rate_hz, " Hz");
+  }
+
+  // --decimate: anti-aliased lower-rate copies of the IMU and ADC streams,
+  // filtered on the acquisition thread that produced the samples. Every
+  // rate has its own key; both IMUs share it like they share the IMU key.
+  // The IMU cascades are built with the tasks, once each IMU's real sample
+  // rate is known.
+  std::vector<double> adc_decimation;
+  if (!decimation_rates(options_, imu_decimation_, adc_decimation)) {
+    return false;
+  }
+  mpu_.set_decimation(decimated_channels("MPU9250", main_const::imu_topic, imu_decimation_));
+  lsm_.set_decimation(decimated_channels("LSM9DS1", main_const::imu_topic, imu_decimation_));
+  DecimatedOutputs adc_decimated = decimated_channels("ADC", main_const::adc_topic, adc_decimation);
+  if (!adc_decimation.empty()) {
+    adc_decimated.cascade = std::make_unique<DecimationCascade>(
+        kAdcMaxChannels, utils::sensor_rate(options_.adc_rate, options_), adc_decimation);
+  }
+  adc_.set_decimation(std::move(adc_decimated));
+
+  if (!configure_change_filters(options_, changes_)) {
+    return false;
+  }
+
+  // --imu-window replaces the per-reading IMU records; a single snapshot has
+  // nothing to pack.
+  if (options_.imu_window > 0 && !options_.once) {
+    const codec::ImuQuantization steps{static_cast<float>(options_.imu_resolution[0]),
+                                       static_cast<float>(options_.imu_resolution[1]),
+                                       static_cast<float>(options_.imu_resolution[2])};
+    const std::int64_t latency_ns = static_cast<std::int64_t>(options_.imu_window_ms) * 1000000;
+    mpu_.set_window(steps, options_.imu_window, latency_ns);
+    lsm_.set_window(steps, options_.imu_window, latency_ns);
+  }
+
+  if (!options_.once && !make_tasks()) {
+    return false;
+  }
+
+  // The publisher thread copies every sample into the flight log before
+  // publishing it, so acquisition never waits on the SD card.
+  if (!options_.record_dir.empty()) {
+    telemetry::RecorderOptions recorder_options;
+    recorder_options.directory = options_.record_dir;
+    recorder_options.segment_bytes = options_.record_segment_mb << 20;
+    recorder_options.segment_duration = std::chrono::seconds(options_.record_segment_s);
+    recorder_ = std::make_unique<telemetry::FlightRecorder>(recorder_options);
+    std::vector<std::string> channel_names;
+    for (const auto &channel : queue_.channels()) {
+      channel_names.push_back(channel->name());
+    }
+    if (!recorder_->open(channel_names)) {
+      logging::log(logging::Level::Critical, "Cannot start the flight recorder. Aborting.");
+      return false;
+    }
+    queue_.set_recorder(recorder_.get());
+  }
+
+  // Histories are set up once, before anything is published on their keys.
+  for (const auto &channel : queue_.channels()) {
+    publisher_.keep_history(channel->key());
+  }
+  return true;
+}
+
+DecimatedOutputs Acquisition::decimated_channels(const std::string &producer, const std::string &topic,
+                                                 const std::vector<double> &rates_hz) {
+  DecimatedOutputs outputs;
+  for (double rate_hz : rates_hz) {
+    const std::string suffix = "/" + std::to_string(static_cast<int>(rate_hz)) + "hz";
+    outputs.channels.push_back(&queue_.add_channel(producer + suffix, topic + suffix));
+  }
+  return outputs;
+}
+
+bool Acquisition::make_tasks() {
+  for (ImuPipeline *imu : {&mpu_, &lsm_}) {
+    PipelineTask task;
+    if (!imu->make_task(options_, imu_decimation_, task)) {
+      return false;
+    }
+    tasks_.push_back(std::move(task));
+  }
+  if (fused_) {
+    tasks_.push_back({"Fusion", fusion_->rate_hz(), [this] { fused_->run(); }});
+  }
+  if (adc_sensor_.sampling()) {
+    tasks_.push_back({"ADC sampler", adc_sensor_.sampler_rate_hz(), [this] { adc_sensor_.sample(); }});
+  }
+  tasks_.push_back({"ADC", utils::sensor_rate(options_.adc_rate, options_), [this] { adc_.read(); }});
+  tasks_.push_back({"Barometer", utils::sensor_rate(options_.baro_rate, options_), [this] { barometer_.read(); }});
+  if (gps_sensor_.streaming()) {
+    tasks_.push_back({"GPS UBX", GpsSensor::kDrainRateHz, [this] { gps_sensor_.drain(); }});
+  }
+  tasks_.push_back({"GPS", utils::sensor_rate(options_.gps_rate, options_), [this] { gps_.read(); }});
+  tasks_.push_back({"RCInput", utils::sensor_rate(options_.rc_rate, options_), [this] { rc_.read(); }});
+  return true;
+}
+
+void Acquisition::snapshot() {
+  queue_.start();
+  mpu_.read();
+  lsm_.read();
+  // Let the ADC sampler fill every channel's first block.
+  for (int waited_ms = 0; adc_sensor_.sampling() && !adc_sensor_.sample() && waited_ms < 1000; ++waited_ms) {
+    usleep(1000);
+  }
+  adc_.read();
+  // A replay without barometer records never completes a sample.
+  for (int waited_ms = 0; !barometer_.read() && waited_ms < 1000; ++waited_ms) {
+    usleep(1000);
+  }
+  // Wait for the receiver's next NAV message, as for the barometer.
+  for (int waited_ms = 0; gps_sensor_.streaming() && !gps_sensor_.drain() && waited_ms < 1000; waited_ms += 10) {
+    usleep(10000);
+  }
+  gps_.read();
+  rc_.read();
+  queue_.stop();
+}
+
+void Acquisition::start() { queue_.start(); }
+
+void Acquisition::finish() {
+  mpu_.flush_window();
+  lsm_.flush_window();
+  queue_.stop();
+  if (recorder_) {
+    recorder_->close();
+  }
+}
+
+Pipeline Acquisition::pipeline(const std::vector<std::unique_ptr<SensorWorker>> &workers) const {
+  return Pipeline{workers, queue_, publisher_, {&mpu_sensor_, &lsm_sensor_}, recorder_.get(), fusion_.get(), changes_,
+                  gps_sensor_.streaming() ? &gps_sensor_ : nullptr, adc_sensor_};
+}
@@ -0,0 +1,49 @@
+#include "adc_pipeline.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+AdcPipeline::AdcPipeline(AdcSensor &sensor, telemetry::PublishChannel &channel, bool binary,
+                         metrics::DurationMetric &read_duration, ChangeStage &change)
+    : sensor_(sensor), channel_(channel), binary_(binary), read_duration_(read_duration), change_(change) {}
+
+void AdcPipeline::set_decimation(DecimatedOutputs outputs) { decimated_ = std::move(outputs); }
+
+void AdcPipeline::read() {
+  const AdcReading reading = metrics::timed(read_duration_, [&] { return sensor_.read(); });
+  if (reading.stale) {
+    return;
+  }
+  if (changed(change_, reading)) {
+    publish_reading(
+        channel_, "ADC", binary_,
+        [&](std::span<char> out) { return format_adc(out, reading); },
+        [&](std::span<std::uint8_t> out) { return encode_adc(reading, out); });
+  }
+  // The decimation filters need every sample, changed or not.
+  decimate(reading);
+}
+
+void AdcPipeline::decimate(const AdcReading &reading) {
+  if (!decimated_.cascade || reading.count == 0) {
+    return;
+  }
+  float voltages[kAdcMaxChannels] = {};
+  for (std::size_t idx = 0; idx < reading.count; ++idx) {
+    voltages[idx] = static_cast<float>(reading.values[idx]);
+  }
+  auto publish = [&](std::size_t stage, const SampleTime &time, std::span<const float> out) {
+    AdcReading decimated;
+    decimated.count = reading.count;
+    decimated.time = time;
+    decimated.mask = reading.mask;
+    std::copy(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(reading.count), decimated.values.begin());
+    telemetry::PublishChannel &channel = *decimated_.channels[stage];
+    publish_reading(
+        channel, channel.name().c_str(), binary_,
+        [&](std::span<char> payload) { return format_adc(payload, decimated); },
+        [&](std::span<std::uint8_t> payload) { return encode_adc(decimated, payload); });
+  };
+  decimated_.cascade->push(reading.time, voltages, publish);
+}
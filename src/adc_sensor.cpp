@@ -1,11 +1,17 @@
 #include "adc_sensor.h"
 
+#include "sensor_backend.h"
+#include "telemetry_codec.h"
+#include "text_writer.h"
+
 #include <Common/Util.h>
 #include <Navio2/ADC_Navio2.h>
 
+#include <algorithm>
+#include <bit>
 #include <cmath>
-#include <iomanip>
 #include <limits>
+#include <numeric>
 #include <sstream>
 
 namespace {
@@ -14,7 +20,11 @@ constexpr int kReadFailed = -1;
 
 #include "logging.h"
 
-AdcSensor::AdcSensor() {
+AdcSensor::AdcSensor(SensorBackend *backend) : backend_(backend) {
+  if (backend_) {
+    logging::log(logging::Level::Info, "ADC sensor reads from the ", backend_->name(), " backend");
+    return;
+  }
   logging::log(logging::Level::Info, "Initializing ADC sensor");
   adc_ = std::unique_ptr<ADC>(new ADC_Navio2());
 
@@ -30,39 +40,195 @@ AdcSensor::~AdcSensor() {
   logging::log(logging::Level::Info, "Closing ADC sensor");
 }
 
-bool AdcSensor::available() const { return static_cast<bool>(adc_); }
+bool AdcSensor::available() const { return backend_ || adc_; }
 
-std::vector<double> AdcSensor::read() {
+AdcReading AdcSensor::read() {
   logging::log(logging::Level::Debug, "Reading ADC sensor");
-  std::vector<double> values;
+  if (sampling()) {
+    return latest_.load();
+  }
+  AdcReading reading;
+  if (backend_) {
+    if (!backend_->read_adc(reading)) {
+      return AdcReading{};
+    }
+    if (reading.stale) {
+      return reading;
+    }
+    reading.count = reported(reading.count);
+    reading.mask = mask_;
+    for (std::size_t idx = 0; idx < reading.count; ++idx) {
+      if (!enabled(idx)) {
+        reading.values[idx] = std::numeric_limits<double>::quiet_NaN();
+      }
+    }
+    reported_count_.store(reading.count, std::memory_order_relaxed);
+    return reading;
+  }
   if (!adc_) {
     logging::log(logging::Level::Warning, "ADC sensor not available");
-    return values;
+    return reading;
   }
+  reading.time = SampleTime::now();
   const int channels = adc_->get_channel_count();
-  values.reserve(channels);
-  for (int idx = 0; idx < channels; ++idx) {
-    int raw = adc_->read(idx);
-    if (raw == kReadFailed) {
-      logging::log(logging::Level::Warning, "Failed to read ADC channel " + std::to_string(idx));
-      values.push_back(std::numeric_limits<double>::quiet_NaN());
-    } else {
-      double value = static_cast<double>(raw) / 1000.0;
-      logging::log(logging::Level::Debug, "ADC channel " + std::to_string(idx) + ": " + std::to_string(value));
-      values.push_back(value);
+  reading.count = reported(channels > 0 ? static_cast<std::size_t>(channels) : 0);
+  reading.mask = mask_;
+  for (std::size_t idx = 0; idx < reading.count; ++idx) {
+    double value = std::numeric_limits<double>::quiet_NaN();
+    if (enabled(idx) && read_channel(idx, value)) {
+      logging::log(logging::Level::Debug, "ADC channel ", idx, ": ", value);
     }
+    reading.values[idx] = value;
   }
-  return values;
+  reported_count_.store(reading.count, std::memory_order_relaxed);
+  return reading;
 }
 
-std::string format_adc(const std::vector<double> &values, const std::string &timestamp) {
-  if (values.empty()) {
-    return "ADC: unavailable";
+void AdcSensor::set_channel_mask(std::uint16_t mask) { mask_ = mask; }
+
+void AdcSensor::set_sampling(std::size_t channel, const AdcSampling &sampling) {
+  if (channel >= kAdcMaxChannels || !(sampling.rate_hz > 0.0)) {
+    return;
   }
-  std::ostringstream out;
-  out << "timestamp=" << timestamp;
-  for (std::size_t idx = 0; idx < values.size(); ++idx) {
-    out << " a" << idx << "=" << values[idx];
+  Channel &target = channels_[channel];
+  target.sampling = sampling;
+  target.sampling.oversample = std::clamp<std::size_t>(sampling.oversample, 1, AdcSampling::kMaxOversample);
+  sampler_rate_hz_ = std::max(sampler_rate_hz_, sampling.rate_hz);
+  // Every channel is read on the ticks of the fastest one.
+  for (Channel &entry : channels_) {
+    entry.divider = entry.sampling.rate_hz > 0.0
+                        ? static_cast<std::size_t>(std::max(1.0, std::round(sampler_rate_hz_ / entry.sampling.rate_hz)))
+                        : 1;
+  }
+  state_.values.fill(std::numeric_limits<double>::quiet_NaN());
+}
+
+double AdcSensor::channel_rate_hz(std::size_t channel) const {
+  return channel < kAdcMaxChannels ? sampler_rate_hz_ / static_cast<double>(channels_[channel].divider) : 0.0;
+}
+
+bool AdcSensor::sample() {
+  std::size_t available = 0;
+  if (backend_) {
+    available = backend_->read_adc(backend_reading_) ? backend_reading_.count : 0;
+  } else if (adc_) {
+    const int channels = adc_->get_channel_count();
+    available = channels > 0 ? static_cast<std::size_t>(channels) : 0;
+  }
+  const std::size_t count = reported(available);
+  bool updated = false;
+  bool complete = count > 0;
+  for (std::size_t idx = 0; idx < count; ++idx) {
+    if (!enabled(idx)) {
+      continue;
+    }
+    Channel &channel = channels_[idx];
+    if (++channel.phase >= channel.divider) {
+      channel.phase = 0;
+      double value = 0.0;
+      if (read_channel(idx, value)) {
+        channel.block[channel.good++] = value;
+      }
+      if (++channel.attempts >= channel.sampling.oversample) {
+        state_.values[idx] = reduce(channel);
+        channel.has_value = true;
+        updated = true;
+      }
+    }
+    complete = complete && channel.has_value;
+  }
+  if (updated) {
+    state_.count = count;
+    state_.time = SampleTime::now();
+    state_.mask = mask_;
+    latest_.store(state_);
+    reported_count_.store(count, std::memory_order_relaxed);
+  }
+  return complete;
+}
+
+std::uint64_t AdcSensor::failures(std::size_t channel) const {
+  return channel < kAdcMaxChannels ? failures_[channel].load(std::memory_order_relaxed) : 0;
+}
+
+std::string AdcSensor::summary() const {
+  std::uint64_t total = 0;
+  std::ostringstream channels;
+  for (std::size_t idx = 0; idx < kAdcMaxChannels; ++idx) {
+    if (const std::uint64_t failed = failures(idx)) {
+      channels << " a" << idx << "=" << failed;
+      total += failed;
+    }
   }
+  std::ostringstream out;
+  out << "failed_reads=" << total << channels.str();
   return out.str();
 }
+
+std::size_t AdcSensor::reported(std::size_t available) const {
+  return std::min<std::size_t>({available, kAdcMaxChannels, static_cast<std::size_t>(std::bit_width(mask_))});
+}
+
+bool AdcSensor::read_channel(std::size_t channel, double &value) {
+  if (backend_) {
+    // The sampler's tick already read every channel of the backend at once.
+    value = backend_reading_.values[channel];
+    return true;
+  }
+  const int raw = adc_->read(static_cast<int>(channel));
+  if (raw == kReadFailed) {
+    failures_[channel].fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  value = static_cast<double>(raw) / 1000.0;
+  return true;
+}
+
+double AdcSensor::reduce(Channel &channel) {
+  const std::size_t good = channel.good;
+  channel.attempts = 0;
+  channel.good = 0;
+  return reduce_adc_block(std::span<double>(channel.block.data(), good), channel.sampling.median);
+}
+
+double reduce_adc_block(std::span<double> block, bool median) {
+  if (block.empty()) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  if (!median) {
+    return std::accumulate(block.begin(), block.end(), 0.0) / static_cast<double>(block.size());
+  }
+  const auto middle = block.begin() + static_cast<std::ptrdiff_t>(block.size() / 2);
+  std::nth_element(block.begin(), middle, block.end());
+  if (block.size() % 2 != 0) {
+    return *middle;
+  }
+  return 0.5 * (*std::max_element(block.begin(), middle) + *middle);
+}
+
+std::size_t format_adc(std::span<char> out, const AdcReading &reading) {
+  TextWriter writer(out);
+  if (reading.count == 0) {
+    writer << "ADC: unavailable";
+    return writer.size();
+  }
+  writer << reading.time;
+  for (std::size_t idx = 0; idx < reading.count; ++idx) {
+    if (((reading.mask >> idx) & 1u) == 0) {
+      continue;
+    }
+    writer << " a" << idx << "=" << reading.values[idx];
+  }
+  return writer.size();
+}
+
+std::size_t encode_adc(const AdcReading &reading, std::span<std::uint8_t> out) {
+  codec::AdcRecord record;
+  record.time = reading.time;
+  const std::size_t count = reading.count < codec::kMaxAdcChannels ? reading.count : codec::kMaxAdcChannels;
+  record.count = static_cast<std::uint8_t>(count);
+  for (std::size_t idx = 0; idx < count; ++idx) {
+    record.values[idx] = static_cast<float>(reading.values[idx]);
+  }
+  return codec::encode(record, out);
+}
@@ -0,0 +1,198 @@
+#include "attitude_filter.h"
+
+#include "telemetry_codec.h"
+#include "text_writer.h"
+
+#include <cmath>
+
+namespace {
+
+constexpr float kRadToDeg = 57.29577951308232f;
+
+// Scales v to unit length; returns false, leaving it alone, if it is zero.
+template <std::size_t N>
+bool normalize(std::array<float, N> &v) {
+  float norm = 0.0f;
+  for (float value : v) {
+    norm += value * value;
+  }
+  if (!(norm > 0.0f) || !std::isfinite(norm)) {
+    return false;
+  }
+  const float scale = 1.0f / std::sqrt(norm);
+  for (float &value : v) {
+    value *= scale;
+  }
+  return true;
+}
+
+std::array<float, 4> from_euler(float roll, float pitch, float yaw) {
+  const float cr = std::cos(roll * 0.5f);
+  const float sr = std::sin(roll * 0.5f);
+  const float cp = std::cos(pitch * 0.5f);
+  const float sp = std::sin(pitch * 0.5f);
+  const float cy = std::cos(yaw * 0.5f);
+  const float sy = std::sin(yaw * 0.5f);
+  return {cr * cp * cy + sr * sp * sy, sr * cp * cy - cr * sp * sy, cr * sp * cy + sr * cp * sy,
+          cr * cp * sy - sr * sp * cy};
+}
+
+// Gradient of the error between the gravity direction predicted by q and
+// the measured one (a, normalized).
+std::array<float, 4> gravity_gradient(const std::array<float, 4> &q, const std::array<float, 3> &a) {
+  const auto [q0, q1, q2, q3] = q;
+  const float f0 = 2.0f * (q1 * q3 - q0 * q2) - a[0];
+  const float f1 = 2.0f * (q0 * q1 + q2 * q3) - a[1];
+  const float f2 = 2.0f * (0.5f - q1 * q1 - q2 * q2) - a[2];
+  return {-2.0f * q2 * f0 + 2.0f * q1 * f1, 2.0f * q3 * f0 + 2.0f * q0 * f1 - 4.0f * q1 * f2,
+          -2.0f * q0 * f0 + 2.0f * q3 * f1 - 4.0f * q2 * f2, 2.0f * q1 * f0 + 2.0f * q2 * f1};
+}
+
+// Gradient of the error between the earth field predicted by q and the
+// measured one (m, normalized). The reference field is the measurement
+// rotated into the earth frame with its horizontal part put on the x axis,
+// so only heading is corrected.
+std::array<float, 4> field_gradient(const std::array<float, 4> &q, const std::array<float, 3> &m) {
+  const auto [q0, q1, q2, q3] = q;
+  const float hx = 2.0f * (m[0] * (0.5f - q2 * q2 - q3 * q3) + m[1] * (q1 * q2 - q0 * q3) + m[2] * (q1 * q3 + q0 * q2));
+  const float hy = 2.0f * (m[0] * (q1 * q2 + q0 * q3) + m[1] * (0.5f - q1 * q1 - q3 * q3) + m[2] * (q2 * q3 - q0 * q1));
+  const float bx = std::sqrt(hx * hx + hy * hy);
+  const float bz = 2.0f * (m[0] * (q1 * q3 - q0 * q2) + m[1] * (q2 * q3 + q0 * q1) + m[2] * (0.5f - q1 * q1 - q2 * q2));
+  const float f0 = 2.0f * bx * (0.5f - q2 * q2 - q3 * q3) + 2.0f * bz * (q1 * q3 - q0 * q2) - m[0];
+  const float f1 = 2.0f * bx * (q1 * q2 - q0 * q3) + 2.0f * bz * (q0 * q1 + q2 * q3) - m[1];
+  const float f2 = 2.0f * bx * (q0 * q2 + q1 * q3) + 2.0f * bz * (0.5f - q1 * q1 - q2 * q2) - m[2];
+  return {-2.0f * bz * q2 * f0 + (-2.0f * bx * q3 + 2.0f * bz * q1) * f1 + 2.0f * bx * q2 * f2,
+          2.0f * bz * q3 * f0 + (2.0f * bx * q2 + 2.0f * bz * q0) * f1 + (2.0f * bx * q3 - 4.0f * bz * q1) * f2,
+          (-4.0f * bx * q2 - 2.0f * bz * q0) * f0 + (2.0f * bx * q1 + 2.0f * bz * q3) * f1 +
+              (2.0f * bx * q0 - 4.0f * bz * q2) * f2,
+          (-4.0f * bx * q3 + 2.0f * bz * q1) * f0 + (-2.0f * bx * q0 + 2.0f * bz * q2) * f1 + 2.0f * bx * q1 * f2};
+}
+
+} // namespace
+
+void madgwick_step(std::array<float, 4> &q, const std::array<float, 3> &gyro, const std::array<float, 3> &accel,
+                   const std::array<float, 3> *mag, float beta, float dt) {
+  const auto [q0, q1, q2, q3] = q;
+  const auto [gx, gy, gz] = gyro;
+  // Rate of change of q from the gyroscope alone.
+  std::array<float, 4> q_dot = {0.5f * (-q1 * gx - q2 * gy - q3 * gz), 0.5f * (q0 * gx + q2 * gz - q3 * gy),
+                                0.5f * (q0 * gy - q1 * gz + q3 * gx), 0.5f * (q0 * gz + q1 * gy - q2 * gx)};
+
+  std::array<float, 3> a = accel;
+  if (normalize(a)) {
+    std::array<float, 4> step = gravity_gradient(q, a);
+    std::array<float, 3> m = mag ? *mag : std::array<float, 3>{};
+    if (normalize(m)) {
+      const std::array<float, 4> field = field_gradient(q, m);
+      for (std::size_t idx = 0; idx < 4; ++idx) {
+        step[idx] += field[idx];
+      }
+    }
+    if (normalize(step)) {
+      for (std::size_t idx = 0; idx < 4; ++idx) {
+        q_dot[idx] -= beta * step[idx];
+      }
+    }
+  }
+
+  for (std::size_t idx = 0; idx < 4; ++idx) {
+    q[idx] += q_dot[idx] * dt;
+  }
+  if (!normalize(q)) {
+    q = {1.0f, 0.0f, 0.0f, 0.0f};
+  }
+}
+
+AttitudeFilter::AttitudeFilter(float beta, bool use_magnetometer)
+    : beta_(beta), use_magnetometer_(use_magnetometer) {}
+
+bool AttitudeFilter::update(const ImuReading &reading, AttitudeReading &out) {
+  if (!reading.valid) {
+    return false;
+  }
+  const std::int64_t now_ns = reading.time.monotonic_ns;
+  if (!seeded_ || now_ns - last_ns_ > kMaxStepNs) {
+    if (seeded_) {
+      ++reseeds_;
+    }
+    if (!seed(reading)) {
+      return false;
+    }
+  } else {
+    if (now_ns <= last_ns_) {
+      return false;
+    }
+    const std::array<float, 3> mag = {reading.mx, reading.my, reading.mz};
+    madgwick_step(q_, {reading.gx_rad, reading.gy_rad, reading.gz_rad}, {reading.ax, reading.ay, reading.az},
+                  use_magnetometer_ ? &mag : nullptr, beta_, static_cast<float>(now_ns - last_ns_) * 1e-9f);
+  }
+  last_ns_ = now_ns;
+  ++updates_;
+  estimate(reading, out);
+  return true;
+}
+
+void AttitudeFilter::reset() {
+  q_ = {1.0f, 0.0f, 0.0f, 0.0f};
+  seeded_ = false;
+}
+
+// Roll and pitch from gravity and, with the magnetometer, the tilt
+// compensated heading, so the filter starts near the answer instead of
+// converging from level at beta's pace.
+bool AttitudeFilter::seed(const ImuReading &reading) {
+  std::array<float, 3> a = {reading.ax, reading.ay, reading.az};
+  if (!normalize(a)) {
+    return false;
+  }
+  const float roll = std::atan2(a[1], a[2]);
+  const float pitch = std::atan2(-a[0], std::sqrt(a[1] * a[1] + a[2] * a[2]));
+  float yaw = 0.0f;
+  std::array<float, 3> m = {reading.mx, reading.my, reading.mz};
+  if (use_magnetometer_ && normalize(m)) {
+    const float level_x = m[0] * std::cos(pitch) + (m[1] * std::sin(roll) + m[2] * std::cos(roll)) * std::sin(pitch);
+    const float level_y = m[1] * std::cos(roll) - m[2] * std::sin(roll);
+    yaw = std::atan2(-level_y, level_x);
+  }
+  q_ = from_euler(roll, pitch, yaw);
+  seeded_ = true;
+  return true;
+}
+
+void AttitudeFilter::estimate(const ImuReading &reading, AttitudeReading &out) const {
+  const auto [q0, q1, q2, q3] = q_;
+  out.valid = true;
+  out.time = reading.time;
+  out.q = q_;
+  const float sin_pitch = -2.0f * (q1 * q3 - q0 * q2);
+  out.roll_deg = std::atan2(q0 * q1 + q2 * q3, 0.5f - q1 * q1 - q2 * q2) * kRadToDeg;
+  out.pitch_deg = std::asin(sin_pitch > 1.0f ? 1.0f : sin_pitch < -1.0f ? -1.0f : sin_pitch) * kRadToDeg;
+  out.yaw_deg = std::atan2(q1 * q2 + q0 * q3, 0.5f - q2 * q2 - q3 * q3) * kRadToDeg;
+}
+
+std::size_t format_attitude(std::span<char> out, const std::string &name, const AttitudeReading &data) {
+  TextWriter writer(out);
+  if (!data.valid) {
+    writer << "Attitude " << name << ": unavailable";
+    return writer.size();
+  }
+  writer << data.time << " name=" << name << " qw=" << data.q[0] << " qx=" << data.q[1] << " qy=" << data.q[2]
+         << " qz=" << data.q[3] << " roll=" << data.roll_deg << " pitch=" << data.pitch_deg
+         << " yaw=" << data.yaw_deg;
+  return writer.size();
+}
+
+std::size_t encode_attitude(const std::string &name, const AttitudeReading &data, std::span<std::uint8_t> out) {
+  codec::AttitudeRecord record;
+  record.time = data.time;
+  record.device = codec::imu_device(name);
+  record.valid = data.valid;
+  record.qw = data.q[0];
+  record.qx = data.q[1];
+  record.qy = data.q[2];
+  record.qz = data.q[3];
+  record.roll_deg = data.roll_deg;
+  record.pitch_deg = data.pitch_deg;
+  record.yaw_deg = data.yaw_deg;
+  return codec::encode(record, out);
+}
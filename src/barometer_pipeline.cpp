@@ -0,0 +1,19 @@
+#include "barometer_pipeline.h"
+
+BarometerPipeline::BarometerPipeline(BarometerSensor &sensor, telemetry::PublishChannel &channel, bool binary,
+                                     metrics::DurationMetric &read_duration, ChangeStage &change)
+    : sensor_(sensor), channel_(channel), binary_(binary), read_duration_(read_duration), change_(change) {}
+
+bool BarometerPipeline::read() {
+  const BarometerReading reading = metrics::timed(read_duration_, [&] { return sensor_.read(); });
+  if (sensor_.available() && !reading.fresh) {
+    return false;
+  }
+  if (changed(change_, reading)) {
+    publish_reading(
+        channel_, "Barometer", binary_,
+        [&](std::span<char> out) { return format_barometer(out, reading); },
+        [&](std::span<std::uint8_t> out) { return encode_barometer(reading, out); });
+  }
+  return true;
+}
@@ -1,20 +1,65 @@
 #include "barometer_sensor.h"
 
 #include "logging.h"
+#include "sensor_backend.h"
+#include "telemetry_codec.h"
+#include "text_writer.h"
 
-#include <iomanip>
-#include <sstream>
-#include <unistd.h>
+#include <array>
 
-BarometerSensor::BarometerSensor() {
+namespace {
+
+struct OversamplingMode {
+  int ratio;
+  std::uint8_t pressure_command;
+  std::uint8_t temperature_command;
+  std::chrono::microseconds conversion_time;
+};
+
+// Maximum ADC conversion times from the MS5611 datasheet.
+constexpr std::array<OversamplingMode, 5> kOversamplingModes = {{
+    {256, MS5611_RA_D1_OSR_256, MS5611_RA_D2_OSR_256, std::chrono::microseconds(600)},
+    {512, MS5611_RA_D1_OSR_512, MS5611_RA_D2_OSR_512, std::chrono::microseconds(1170)},
+    {1024, MS5611_RA_D1_OSR_1024, MS5611_RA_D2_OSR_1024, std::chrono::microseconds(2280)},
+    {2048, MS5611_RA_D1_OSR_2048, MS5611_RA_D2_OSR_2048, std::chrono::microseconds(4540)},
+    {4096, MS5611_RA_D1_OSR_4096, MS5611_RA_D2_OSR_4096, std::chrono::microseconds(9040)},
+}};
+
+const OversamplingMode *find_mode(int oversampling) {
+  for (const auto &mode : kOversamplingModes) {
+    if (mode.ratio == oversampling) {
+      return &mode;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace
+
+BarometerSensor::BarometerSensor(int oversampling, int temperature_every, SensorBackend *backend)
+    : backend_(backend), temperature_every_(temperature_every > 0 ? temperature_every : 1) {
+  if (backend_) {
+    ready_ = true;
+    logging::log(logging::Level::Info, "Barometer sensor reads from the ", backend_->name(), " backend");
+    return;
+  }
   logging::log(logging::Level::Info, "Initializing barometer sensor");
+  const OversamplingMode *mode = find_mode(oversampling);
+  if (!mode) {
+    logging::log(logging::Level::Warning, "Unsupported barometer oversampling ", oversampling, ", using 4096");
+    mode = find_mode(4096);
+  }
+  pressure_command_ = mode->pressure_command;
+  temperature_command_ = mode->temperature_command;
+  conversion_time_ = mode->conversion_time;
+
   barometer_.initialize();
   if (!barometer_.testConnection()) {
     logging::log(logging::Level::Warning, "Barometer connection test failed");
     return;
   }
   ready_ = true;
-  logging::log(logging::Level::Info, "Barometer sensor initialized");
+  logging::log(logging::Level::Info, "Barometer sensor initialized (OSR ", mode->ratio, ", temperature every ", temperature_every_, " samples)");
 }
 
 BarometerSensor::~BarometerSensor() {
@@ -23,32 +68,89 @@ BarometerSensor::~BarometerSensor() {
 
 bool BarometerSensor::available() const { return ready_; }
 
+bool BarometerSensor::valid_oversampling(int oversampling) {
+  return find_mode(oversampling) != nullptr;
+}
+
 BarometerReading BarometerSensor::read() {
-  logging::log(logging::Level::Debug, "Reading barometer sensor");
-  BarometerReading reading;
+  const bool debug = logging::enabled(logging::Level::Debug);
+  if (debug) {
+    logging::log(logging::Level::Debug, "Reading barometer sensor");
+  }
   if (!ready_) {
     logging::log(logging::Level::Warning, "Barometer sensor not available");
-    return reading;
-  }
-  barometer_.refreshPressure();
-  usleep(10000);
-  barometer_.readPressure();
-  barometer_.refreshTemperature();
-  usleep(10000);
-  barometer_.readTemperature();
-  barometer_.calculatePressureAndTemperature();
-  reading.temperature_c = barometer_.getTemperature();
-  reading.pressure_mbar = barometer_.getPressure();
-  logging::log(logging::Level::Debug, "Barometer: " + std::to_string(reading.temperature_c) + " C, " + std::to_string(reading.pressure_mbar) + " mbar");
-  reading.valid = true;
-  return reading;
-}
-
-std::string format_barometer(const BarometerReading &reading, const std::string &timestamp) {
+    return BarometerReading{};
+  }
+  if (backend_) {
+    BarometerReading next;
+    latest_.fresh = backend_->read_barometer(next);
+    if (latest_.fresh) {
+      latest_ = next;
+      latest_.fresh = true;
+    }
+    return latest_;
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  latest_.fresh = false;
+  if (phase_ != Phase::Idle && now < conversion_done_) {
+    if (debug) {
+      logging::log(logging::Level::Debug, "Barometer conversion still in progress");
+    }
+    return latest_;
+  }
+
+  if (phase_ == Phase::ConvertingTemperature) {
+    barometer_.readTemperature();
+    have_temperature_ = true;
+    pressure_samples_since_temperature_ = 0;
+  } else if (phase_ == Phase::ConvertingPressure) {
+    barometer_.readPressure();
+    const SampleTime collected = SampleTime::now();
+    ++pressure_samples_since_temperature_;
+    if (have_temperature_) {
+      barometer_.calculatePressureAndTemperature();
+      latest_.temperature_c = barometer_.getTemperature();
+      latest_.pressure_mbar = barometer_.getPressure();
+      latest_.valid = true;
+      latest_.fresh = true;
+      latest_.time = collected;
+      if (debug) {
+        logging::log(logging::Level::Debug, "Barometer: ", latest_.temperature_c, " C, ", latest_.pressure_mbar, " mbar");
+      }
+    }
+  }
+
+  start_conversion(now);
+  return latest_;
+}
+
+void BarometerSensor::start_conversion(std::chrono::steady_clock::time_point now) {
+  if (!have_temperature_ || pressure_samples_since_temperature_ >= temperature_every_) {
+    barometer_.refreshTemperature(temperature_command_);
+    phase_ = Phase::ConvertingTemperature;
+  } else {
+    barometer_.refreshPressure(pressure_command_);
+    phase_ = Phase::ConvertingPressure;
+  }
+  conversion_done_ = now + conversion_time_;
+}
+
+std::size_t format_barometer(std::span<char> out, const BarometerReading &reading) {
+  TextWriter writer(out);
   if (!reading.valid) {
-    return "Barometer: unavailable";
+    writer << "Barometer: unavailable";
+    return writer.size();
   }
-  std::ostringstream out;
-  out << "timestamp=" << timestamp << " temperature=" << reading.temperature_c << " pressure=" << reading.pressure_mbar;
-  return out.str();
+  writer << reading.time << " temperature=" << reading.temperature_c << " pressure=" << reading.pressure_mbar;
+  return writer.size();
+}
+
+std::size_t encode_barometer(const BarometerReading &reading, std::span<std::uint8_t> out) {
+  codec::BarometerRecord record;
+  record.time = reading.time;
+  record.valid = reading.valid;
+  record.temperature_c = static_cast<float>(reading.temperature_c);
+  record.pressure_mbar = static_cast<float>(reading.pressure_mbar);
+  return codec::encode(record, out);
 }
@@ -0,0 +1,105 @@
+#include "change_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+bool moved(double last, double value, double deadband) {
+  if (std::isnan(last) || std::isnan(value)) {
+    return std::isnan(last) != std::isnan(value);
+  }
+  return std::abs(value - last) > deadband;
+}
+
+template <std::size_t N>
+std::size_t copy_fields(const std::array<double, N> &fields, std::span<double> out) {
+  const std::size_t count = std::min(N, out.size());
+  std::copy_n(fields.begin(), count, out.begin());
+  return count;
+}
+
+} // namespace
+
+const std::array<std::string_view, kAdcMaxChannels> kAdcChangeFields = {
+    "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7", "a8", "a9", "a10", "a11", "a12", "a13", "a14", "a15"};
+const std::array<std::string_view, 2> kBarometerChangeFields = {"temperature", "pressure"};
+const std::array<std::string_view, 13> kGpsChangeFields = {
+    "fix_type", "fix_ok", "lat", "lon", "height", "hmsl", "h_acc", "v_acc", "vel_n", "vel_e", "vel_d", "speed", "heading"};
+const std::array<std::string_view, 4> kRcInputChangeFields = {"roll", "pitch", "throttle", "yaw"};
+
+ChangeFilter::ChangeFilter(std::span<const std::string_view> names, std::int64_t heartbeat_ns)
+    : names_(names.first(std::min(names.size(), kMaxFields))), heartbeat_ns_(heartbeat_ns) {}
+
+bool ChangeFilter::set_deadband(std::string_view field, double deadband) {
+  if (field.empty()) {
+    deadbands_.fill(deadband);
+    return true;
+  }
+  for (std::size_t idx = 0; idx < names_.size(); ++idx) {
+    if (names_[idx] == field) {
+      deadbands_[idx] = deadband;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ChangeFilter::update(std::int64_t now_ns, std::span<const double> fields) {
+  const std::size_t count = std::min(fields.size(), kMaxFields);
+  bool changed = !published_ || count != last_count_ || now_ns - last_ns_ >= heartbeat_ns_;
+  for (std::size_t idx = 0; idx < count && !changed; ++idx) {
+    changed = moved(last_[idx], fields[idx], deadbands_[idx]);
+  }
+  if (!changed) {
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  std::copy_n(fields.begin(), count, last_.begin());
+  last_count_ = count;
+  last_ns_ = now_ns;
+  published_ = true;
+  passed_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+std::string ChangeFilter::summary() const {
+  std::ostringstream out;
+  out << "published=" << passed() << " suppressed=" << suppressed();
+  return out.str();
+}
+
+std::size_t change_fields(const AdcReading &reading, std::span<double> out) {
+  const std::size_t count = std::min(reading.count, out.size());
+  std::copy_n(reading.values.begin(), count, out.begin());
+  return count;
+}
+
+std::size_t change_fields(const BarometerReading &reading, std::span<double> out) {
+  if (!reading.valid) {
+    return 0;
+  }
+  return copy_fields(std::array<double, 2>{reading.temperature_c, reading.pressure_mbar}, out);
+}
+
+std::size_t change_fields(const GpsReading &reading, std::span<double> out) {
+  if (!reading.has_position && !reading.has_status) {
+    return 0;
+  }
+  return copy_fields(std::array<double, 13>{static_cast<double>(reading.fix_type), reading.fix_ok ? 1.0 : 0.0,
+                                            reading.latitude_deg, reading.longitude_deg, reading.height_m,
+                                            reading.hmsl_m, reading.horizontal_accuracy_m,
+                                            reading.vertical_accuracy_m, reading.velocity_north_mps,
+                                            reading.velocity_east_mps, reading.velocity_down_mps,
+                                            reading.ground_speed_mps, reading.heading_deg},
+                     out);
+}
+
+std::size_t change_fields(const RcInputReading &reading, std::span<double> out) {
+  const std::size_t count = std::min({reading.count, kRcInputChangeFields.size(), out.size()});
+  for (std::size_t idx = 0; idx < count; ++idx) {
+    out[idx] = static_cast<double>(reading.values[idx]);
+  }
+  return count;
+}
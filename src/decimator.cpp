@@ -0,0 +1,117 @@
+#include "decimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace {
+
+constexpr std::size_t kLanes = 4;
+
+// Blackman-windowed sinc low-pass with unity DC gain, cut off at half the
+// output rate (0.5 / factor cycles per input sample).
+std::vector<float> design_low_pass(std::size_t factor) {
+  const std::size_t count = Decimator::kTapsPerFactor * factor + 1;
+  const double centre = static_cast<double>(count - 1) / 2.0;
+  const double cutoff = 0.5 / static_cast<double>(factor);
+  std::vector<double> taps(count);
+  double sum = 0.0;
+  for (std::size_t idx = 0; idx < count; ++idx) {
+    const double offset = static_cast<double>(idx) - centre;
+    const double sinc = offset == 0.0 ? 2.0 * cutoff
+                                      : std::sin(2.0 * std::numbers::pi * cutoff * offset) / (std::numbers::pi * offset);
+    const double phase = 2.0 * std::numbers::pi * static_cast<double>(idx) / static_cast<double>(count - 1);
+    const double window = 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+    taps[idx] = sinc * window;
+    sum += taps[idx];
+  }
+  std::vector<float> normalized(count);
+  for (std::size_t idx = 0; idx < count; ++idx) {
+    normalized[idx] = static_cast<float>(taps[idx] / sum);
+  }
+  return normalized;
+}
+
+} // namespace
+
+Decimator::Decimator(std::size_t channels, std::size_t factor)
+    : channels_(channels),
+      blocks_((channels + kLanes - 1) / kLanes),
+      factor_(factor),
+      taps_(design_low_pass(factor)),
+      history_(2 * taps_.size() * blocks_),
+      times_(taps_.size()),
+      sum_(blocks_) {}
+
+bool Decimator::push(const SampleTime &time, std::span<const float> in, SampleTime &out_time, std::span<float> out) {
+  const std::size_t count = taps_.size();
+  Lanes *slot = &history_[next_ * blocks_];
+  for (std::size_t block = 0; block < blocks_; ++block) {
+    Lanes value = {};
+    for (std::size_t lane = 0; lane < kLanes; ++lane) {
+      const std::size_t channel = block * kLanes + lane;
+      if (channel < in.size() && channel < channels_) {
+        value[lane] = in[channel];
+      }
+    }
+    slot[block] = value;
+    slot[count * blocks_ + block] = value;
+  }
+  times_[next_] = time;
+  next_ = next_ + 1 == count ? 0 : next_ + 1;
+  filled_ = std::min(filled_ + 1, count);
+  if (++phase_ < factor_) {
+    return false;
+  }
+  phase_ = 0;
+  if (filled_ < count) {
+    return false;
+  }
+
+  // The oldest sample is at next_; its copy makes the window contiguous.
+  const Lanes *window = &history_[next_ * blocks_];
+  std::fill(sum_.begin(), sum_.end(), Lanes{});
+  for (std::size_t tap = 0; tap < count; ++tap) {
+    const float weight = taps_[tap];
+    const Lanes *sample = window + tap * blocks_;
+    for (std::size_t block = 0; block < blocks_; ++block) {
+      sum_[block] += weight * sample[block];
+    }
+  }
+  const std::size_t limit = std::min(out.size(), channels_);
+  for (std::size_t channel = 0; channel < limit; ++channel) {
+    out[channel] = sum_[channel / kLanes][channel % kLanes];
+  }
+  out_time = times_[(next_ + (count - 1) / 2) % count];
+  return true;
+}
+
+void Decimator::reset() {
+  std::fill(history_.begin(), history_.end(), Lanes{});
+  next_ = 0;
+  filled_ = 0;
+  phase_ = 0;
+}
+
+std::size_t decimation_factor(double from_hz, double to_hz) {
+  if (!(from_hz > 0.0) || !(to_hz > 0.0)) {
+    return 0;
+  }
+  const double ratio = from_hz / to_hz;
+  const double factor = std::round(ratio);
+  if (factor < 2.0 || std::abs(ratio - factor) > 1e-6 * factor) {
+    return 0;
+  }
+  return static_cast<std::size_t>(factor);
+}
+
+DecimationCascade::DecimationCascade(std::size_t channels, double input_rate_hz, std::span<const double> rates_hz)
+    : rates_hz_(rates_hz.begin(), rates_hz.end()) {
+  double from_hz = input_rate_hz;
+  stages_.reserve(rates_hz.size());
+  for (double rate_hz : rates_hz) {
+    stages_.emplace_back(channels, decimation_factor(from_hz, rate_hz));
+    outputs_.emplace_back(channels);
+    from_hz = rate_hz;
+  }
+}
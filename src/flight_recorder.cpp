@@ -0,0 +1,188 @@
+#include "flight_recorder.h"
+
+#include "flight_log.h"
+#include "logging.h"
+#include "sample_time.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace telemetry {
+
+namespace {
+
+// Written data is handed to writeback and dropped from the mapping in
+// chunks of this size, so the recorder's resident set stays small.
+constexpr std::size_t kReleaseBytes = 1u << 20;
+
+std::size_t page_size() {
+  static const std::size_t size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+} // namespace
+
+FlightRecorder::FlightRecorder(RecorderOptions options) : options_(std::move(options)) {}
+
+FlightRecorder::~FlightRecorder() { close(); }
+
+bool FlightRecorder::open(std::vector<std::string> channel_names) {
+  if (channel_names.size() > flight_log::kMaxChannels) {
+    logging::log(logging::Level::Error, "Flight recorder supports at most ", flight_log::kMaxChannels, " channels");
+    return false;
+  }
+  if (options_.segment_bytes < flight_log::kSegmentHeaderSize + flight_log::record_size(0)) {
+    logging::log(logging::Level::Error, "Flight recorder segment size is too small");
+    return false;
+  }
+  if (::mkdir(options_.directory.c_str(), 0755) != 0 && errno != EEXIST) {
+    logging::log(logging::Level::Error, "Cannot create recording directory ", options_.directory, ": ", std::strerror(errno));
+    return false;
+  }
+  channels_ = std::move(channel_names);
+  if (!open_segment(SampleTime::now().monotonic_ns)) {
+    return false;
+  }
+  active_ = true;
+  return true;
+}
+
+bool FlightRecorder::append(std::uint16_t channel, std::int64_t monotonic_ns,
+                            std::span<const std::uint8_t> payload) {
+  if (!active_) {
+    return false;
+  }
+  const std::size_t size = flight_log::record_size(payload.size());
+  if (channel == 0 || channel > channels_.size() ||
+      flight_log::kSegmentHeaderSize + size > options_.segment_bytes) {
+    failed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  const bool full = used_ + size > options_.segment_bytes;
+  const bool expired = options_.segment_duration.count() > 0 &&
+                       monotonic_ns - segment_start_ns_ >=
+                           std::chrono::nanoseconds(options_.segment_duration).count();
+  if (full || expired) {
+    finish_segment();
+    if (!open_segment(monotonic_ns)) {
+      // Retrying on every sample would put syscalls back on the hot path.
+      logging::log(logging::Level::Error, "Flight recorder stopped");
+      active_ = false;
+      failed_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  }
+
+  // The channel id goes in last: until then the record still reads as the
+  // zero end marker, so a crash mid-append leaves a clean segment.
+  std::uint8_t *record = map_ + used_;
+  codec::Writer writer(std::span<std::uint8_t>(record + 2, flight_log::kRecordHeaderSize - 2));
+  writer.u16(0);
+  writer.u32(static_cast<std::uint32_t>(payload.size()));
+  writer.i64(monotonic_ns);
+  std::memcpy(record + flight_log::kRecordHeaderSize, payload.data(), payload.size());
+  codec::Writer(std::span<std::uint8_t>(record, 2)).u16(channel);
+  used_ += size;
+
+  records_.fetch_add(1, std::memory_order_relaxed);
+  bytes_.fetch_add(size, std::memory_order_relaxed);
+  if (used_ - released_ >= kReleaseBytes) {
+    release_written();
+  }
+  return true;
+}
+
+void FlightRecorder::close() {
+  if (map_) {
+    finish_segment();
+  }
+  active_ = false;
+}
+
+std::string FlightRecorder::summary() const {
+  std::ostringstream out;
+  out << "segments=" << segments_.load(std::memory_order_relaxed) << " records=" << records()
+      << " bytes=" << bytes_.load(std::memory_order_relaxed) << " failed=" << failed();
+  return out.str();
+}
+
+bool FlightRecorder::open_segment(std::int64_t monotonic_ns) {
+  const SampleTime now = SampleTime::now();
+  std::ostringstream name;
+  name << options_.directory << "/sensors_read_" << now.unix_seconds() << '_' << sequence_ << ".srlog";
+  path_ = name.str();
+
+  fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    logging::log(logging::Level::Error, "Cannot create flight log ", path_, ": ", std::strerror(errno));
+    return false;
+  }
+  // Reserving the blocks up front turns a full card into an error here
+  // instead of a SIGBUS when a store into the mapping cannot be backed.
+  const int reserved = posix_fallocate(fd_, 0, static_cast<off_t>(options_.segment_bytes));
+  if (reserved != 0) {
+    logging::log(logging::Level::Error, "Cannot reserve ", options_.segment_bytes, " bytes for ", path_, ": ", std::strerror(reserved));
+    ::close(fd_);
+    ::unlink(path_.c_str());
+    fd_ = -1;
+    return false;
+  }
+  void *map = mmap(nullptr, options_.segment_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (map == MAP_FAILED) {
+    logging::log(logging::Level::Error, "Cannot map flight log ", path_, ": ", std::strerror(errno));
+    ::close(fd_);
+    ::unlink(path_.c_str());
+    fd_ = -1;
+    return false;
+  }
+  map_ = static_cast<std::uint8_t *>(map);
+  madvise(map_, options_.segment_bytes, MADV_SEQUENTIAL);
+
+  flight_log::SegmentHeader header;
+  header.start_monotonic_ns = monotonic_ns;
+  header.realtime_offset_ns = now.realtime_offset_ns;
+  header.sequence = sequence_++;
+  header.channels = channels_;
+  flight_log::encode_segment_header(header, std::span<std::uint8_t>(map_, flight_log::kSegmentHeaderSize));
+  used_ = flight_log::kSegmentHeaderSize;
+  released_ = 0;
+  segment_start_ns_ = monotonic_ns;
+  segments_.fetch_add(1, std::memory_order_relaxed);
+  logging::log(logging::Level::Info, "Recording to ", path_);
+  return true;
+}
+
+void FlightRecorder::finish_segment() {
+  msync(map_, used_, MS_ASYNC);
+  munmap(map_, options_.segment_bytes);
+  map_ = nullptr;
+  // Give back the preallocated tail; readers stop at the end of the file.
+  if (ftruncate(fd_, static_cast<off_t>(used_)) != 0) {
+    logging::log(logging::Level::Warning, "Cannot truncate flight log ", path_, ": ", std::strerror(errno));
+  }
+  ::close(fd_);
+  fd_ = -1;
+  logging::log(logging::Level::Info, "Closed flight log ", path_, " (", used_, " bytes)");
+}
+
+// Starts writeback of the whole pages written since the last call and
+// unmaps them. msync(MS_ASYNC) only queues the pages, and the dirty data
+// stays in the page cache after MADV_DONTNEED, so neither call waits for the
+// card.
+void FlightRecorder::release_written() {
+  const std::size_t end = used_ / page_size() * page_size();
+  if (end <= released_) {
+    return;
+  }
+  msync(map_ + released_, end - released_, MS_ASYNC);
+  madvise(map_ + released_, end - released_, MADV_DONTNEED);
+  released_ = end;
+}
+
+} // namespace telemetry
@@ -0,0 +1,18 @@
+#include "gps_pipeline.h"
+
+GpsPipeline::GpsPipeline(GpsSensor &sensor, telemetry::PublishChannel &channel, bool binary,
+                         metrics::DurationMetric &read_duration, ChangeStage &change)
+    : sensor_(sensor), channel_(channel), binary_(binary), read_duration_(read_duration), change_(change) {}
+
+void GpsPipeline::read() {
+  const GpsReading reading = metrics::timed(read_duration_, [&] { return sensor_.read(); });
+  // Between NAV messages read() repeats the last decoded state, which the
+  // change filter drops.
+  if (!changed(change_, reading)) {
+    return;
+  }
+  publish_reading(
+      channel_, "GPS", binary_,
+      [&](std::span<char> out) { return format_gps(out, reading); },
+      [&](std::span<std::uint8_t> out) { return encode_gps(reading, out); });
+}
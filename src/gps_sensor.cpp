@@ -1,13 +1,34 @@
 #include "gps_sensor.h"
 
 #include "logging.h"
+#include "sensor_backend.h"
+#include "telemetry_codec.h"
+#include "text_writer.h"
 
-#include <iomanip>
-#include <sstream>
+#include <Common/SPIdev.h>
+
+#include <algorithm>
 #include <vector>
 
 namespace {
 
+constexpr const char *kGpsDevice = "/dev/spidev0.0";
+// SPI clock of the Navio2 Ublox driver.
+constexpr unsigned int kUbxSpiSpeedHz = 200000;
+// Bytes per SPI transfer, and the most one drain() reads: enough for a
+// second of NAV output should the worker fall behind.
+constexpr std::size_t kTransferBytes = 128;
+constexpr std::size_t kMaxDrainBytes = 4096;
+// Sent to, and clocked out by, a receiver with nothing to say.
+constexpr unsigned char kIdleByte = 0xFF;
+
+constexpr std::size_t kPosllhSize = 28;
+constexpr std::size_t kStatusSize = 16;
+constexpr std::size_t kPvtSize = 92;
+constexpr std::size_t kVelnedSize = 36;
+
+std::int32_t i32(codec::Reader &reader) { return static_cast<std::int32_t>(reader.u32()); }
+
 const char *fix_description(int fix_type) {
   switch (fix_type) {
   case 0:
@@ -29,15 +50,22 @@ const char *fix_description(int fix_type) {
 
 } // namespace
 
-GpsSensor::GpsSensor() {
+GpsSensor::GpsSensor(SensorBackend *backend) : backend_(backend) {
+  latest_.store(state_);
+  if (backend_) {
+    logging::log(logging::Level::Info, "GPS sensor reads from the ", backend_->name(), " backend");
+    return;
+  }
   logging::log(logging::Level::Info, "Initializing GPS sensor");
-  gps_ = std::unique_ptr<Ublox>(new Ublox("/dev/spidev0.0"));
+  gps_ = std::unique_ptr<Ublox>(new Ublox(kGpsDevice));
   if (!gps_->testConnection()) {
     logging::log(logging::Level::Warning, "GPS test failed");
     gps_.reset();
     return;
   }
   gps_->configureSolutionRate(200);
+  tx_.assign(kTransferBytes, kIdleByte);
+  rx_.assign(kTransferBytes, 0);
   logging::log(logging::Level::Info, "GPS sensor initialized");
 }
 
@@ -45,47 +73,176 @@ GpsSensor::~GpsSensor() {
   logging::log(logging::Level::Info, "Closing GPS sensor");
 }
 
-bool GpsSensor::available() const { return static_cast<bool>(gps_); }
+bool GpsSensor::available() const { return backend_ || gps_; }
 
 GpsReading GpsSensor::read() {
-  logging::log(logging::Level::Debug, "Reading GPS sensor");
+  if (logging::enabled(logging::Level::Debug)) {
+    logging::log(logging::Level::Debug, "Reading GPS sensor");
+  }
+  if (backend_) {
+    // Keeps the previous state when nothing new arrived, as decoding does.
+    GpsReading next;
+    if (backend_->read_gps(next)) {
+      state_ = next;
+    }
+    return state_;
+  }
   if (!gps_) {
     logging::log(logging::Level::Warning, "GPS sensor not available");
-    return state_;
   }
+  return latest_.load();
+}
 
-  std::vector<double> data;
-  if (gps_->decodeSingleMessage(Ublox::NAV_POSLLH, data) == 1 &&
-      data.size() >= 7) {
-    logging::log(logging::Level::Debug, "GPS position updated");
-    state_.has_position = true;
-    state_.time_of_week_s = data[0] / 1000.0;
-    state_.longitude_deg = data[1] / 1e7;
-    state_.latitude_deg = data[2] / 1e7;
-    state_.height_m = data[3] / 1000.0;
-    state_.hmsl_m = data[4] / 1000.0;
-    state_.horizontal_accuracy_m = data[5] / 1000.0;
-    state_.vertical_accuracy_m = data[6] / 1000.0;
-    logging::log(logging::Level::Debug, "GPS Pos: " + std::to_string(state_.latitude_deg) + " " + std::to_string(state_.longitude_deg) + " " + std::to_string(state_.height_m));
+bool GpsSensor::drain() {
+  if (!gps_) {
+    return false;
+  }
+  bool updated = false;
+  for (std::size_t total = 0; total < kMaxDrainBytes; total += rx_.size()) {
+    if (SPIdev::transfer(kGpsDevice, tx_.data(), rx_.data(), static_cast<unsigned int>(rx_.size()), kUbxSpiSpeedHz) < 0) {
+      logging::log(logging::Level::Warning, "SPI transfer failed on ", kGpsDevice);
+      break;
+    }
+    updated = feed(rx_) || updated;
+    if (std::all_of(rx_.begin(), rx_.end(), [](unsigned char byte) { return byte == kIdleByte; })) {
+      break;
+    }
   }
+  return updated;
+}
 
-  if (gps_->decodeSingleMessage(Ublox::NAV_STATUS, data) == 1 &&
-      data.size() >= 2) {
-    logging::log(logging::Level::Debug, "GPS status updated");
-    state_.has_status = true;
-    state_.fix_type = static_cast<int>(data[0]);
-    state_.fix_ok = (static_cast<int>(data[1]) & 0x01) != 0;
-    logging::log(logging::Level::Debug, "GPS Status: " + std::to_string(state_.fix_type) + " " + std::to_string(state_.fix_ok));
+bool GpsSensor::feed(std::span<const std::uint8_t> bytes) {
+  const SampleTime now = SampleTime::now();
+  bool updated = false;
+  parser_.feed(bytes, [&](const UbxMessage &message) {
+    if (!apply_ubx(message, now, state_)) {
+      return;
+    }
+    updated = true;
+    if (logging::enabled(logging::Level::Debug)) {
+      logging::log(logging::Level::Debug, "GPS NAV 0x", static_cast<int>(message.id), ": fix ", state_.fix_type, " ",
+                   state_.latitude_deg, " ", state_.longitude_deg, " ", state_.height_m);
+    }
+  });
+  if (updated) {
+    latest_.store(state_);
   }
+  return updated;
+}
 
-  return state_;
+bool apply_ubx(const UbxMessage &message, const SampleTime &time, GpsReading &state) {
+  if (message.msg_class != kUbxClassNav) {
+    return false;
+  }
+  codec::Reader reader(message.payload);
+  switch (message.id) {
+  case kUbxNavPosllh:
+    if (message.payload.size() < kPosllhSize) {
+      return false;
+    }
+    state.has_position = true;
+    state.time_of_week_s = reader.u32() / 1000.0;
+    state.longitude_deg = i32(reader) / 1e7;
+    state.latitude_deg = i32(reader) / 1e7;
+    state.height_m = i32(reader) / 1000.0;
+    state.hmsl_m = i32(reader) / 1000.0;
+    state.horizontal_accuracy_m = reader.u32() / 1000.0;
+    state.vertical_accuracy_m = reader.u32() / 1000.0;
+    break;
+  case kUbxNavStatus:
+    if (message.payload.size() < kStatusSize) {
+      return false;
+    }
+    state.has_status = true;
+    state.time_of_week_s = reader.u32() / 1000.0;
+    state.fix_type = reader.u8();
+    state.fix_ok = (reader.u8() & 0x01) != 0;
+    break;
+  case kUbxNavPvt: {
+    if (message.payload.size() < kPvtSize) {
+      return false;
+    }
+    // iTOW, date and time, time accuracy and nanoseconds come first.
+    state.has_position = true;
+    state.has_status = true;
+    state.time_of_week_s = reader.u32() / 1000.0;
+    codec::Reader fix(message.payload.subspan(20));
+    state.fix_type = fix.u8();
+    state.fix_ok = (fix.u8() & 0x01) != 0;
+    fix.u8();
+    fix.u8();
+    state.longitude_deg = i32(fix) / 1e7;
+    state.latitude_deg = i32(fix) / 1e7;
+    state.height_m = i32(fix) / 1000.0;
+    state.hmsl_m = i32(fix) / 1000.0;
+    state.horizontal_accuracy_m = fix.u32() / 1000.0;
+    state.vertical_accuracy_m = fix.u32() / 1000.0;
+    // Velocities in mm/s and the heading of motion in 1e-5 degrees.
+    state.has_velocity = true;
+    state.velocity_north_mps = i32(fix) / 1000.0;
+    state.velocity_east_mps = i32(fix) / 1000.0;
+    state.velocity_down_mps = i32(fix) / 1000.0;
+    state.ground_speed_mps = i32(fix) / 1000.0;
+    state.heading_deg = i32(fix) / 1e5;
+    state.speed_accuracy_mps = fix.u32() / 1000.0;
+    break;
+  }
+  case kUbxNavVelned:
+    if (message.payload.size() < kVelnedSize) {
+      return false;
+    }
+    // Same fields as NAV-PVT's, in cm/s, plus the 3D speed.
+    state.has_velocity = true;
+    state.time_of_week_s = reader.u32() / 1000.0;
+    state.velocity_north_mps = i32(reader) / 100.0;
+    state.velocity_east_mps = i32(reader) / 100.0;
+    state.velocity_down_mps = i32(reader) / 100.0;
+    reader.u32();
+    state.ground_speed_mps = reader.u32() / 100.0;
+    state.heading_deg = i32(reader) / 1e5;
+    state.speed_accuracy_mps = reader.u32() / 100.0;
+    break;
+  default:
+    return false;
+  }
+  state.time = time;
+  return true;
 }
 
-std::string format_gps(const GpsReading &state, const std::string &timestamp) {
+std::size_t format_gps(std::span<char> out, const GpsReading &state) {
+  TextWriter writer(out);
   if (!state.has_position && !state.has_status) {
-    return "GPS: unavailable";
+    writer << "GPS: unavailable";
+    return writer.size();
+  }
+  writer << state.time << " fix_type=" << state.fix_type << " lat=" << state.latitude_deg << " lon=" << state.longitude_deg << " height=" << state.height_m;
+  if (state.has_velocity) {
+    writer << " vel_n=" << state.velocity_north_mps << " vel_e=" << state.velocity_east_mps
+           << " vel_d=" << state.velocity_down_mps << " speed=" << state.ground_speed_mps
+           << " heading=" << state.heading_deg;
   }
-  std::ostringstream out;
-  out << "timestamp=" << timestamp << " fix_type=" << state.fix_type << " lat=" << state.latitude_deg << " lon=" << state.longitude_deg << " height=" << state.height_m;
-  return out.str();
+  return writer.size();
+}
+
+std::size_t encode_gps(const GpsReading &state, std::span<std::uint8_t> out) {
+  codec::GpsRecord record;
+  record.time = state.time;
+  record.has_position = state.has_position;
+  record.has_status = state.has_status;
+  record.has_velocity = state.has_velocity;
+  record.fix_ok = state.fix_ok;
+  record.fix_type = static_cast<std::uint8_t>(state.fix_type);
+  record.latitude_deg = state.latitude_deg;
+  record.longitude_deg = state.longitude_deg;
+  record.height_m = static_cast<float>(state.height_m);
+  record.hmsl_m = static_cast<float>(state.hmsl_m);
+  record.horizontal_accuracy_m = static_cast<float>(state.horizontal_accuracy_m);
+  record.vertical_accuracy_m = static_cast<float>(state.vertical_accuracy_m);
+  record.velocity_north_mps = static_cast<float>(state.velocity_north_mps);
+  record.velocity_east_mps = static_cast<float>(state.velocity_east_mps);
+  record.velocity_down_mps = static_cast<float>(state.velocity_down_mps);
+  record.ground_speed_mps = static_cast<float>(state.ground_speed_mps);
+  record.heading_deg = static_cast<float>(state.heading_deg);
+  record.speed_accuracy_mps = static_cast<float>(state.speed_accuracy_mps);
+  return codec::encode(record, out);
 }
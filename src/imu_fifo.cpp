@@ -0,0 +1,234 @@
+#include "imu_fifo.h"
+
+#include "logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+constexpr float kGravity = 9.80665f;
+constexpr float kDegToRad = 3.14159265358979323846f / 180.0f;
+
+// LSM9DS1 gyroscope output data rates selectable through ODR_G, in Hz.
+constexpr double kLsmOdrHz[] = {14.9, 59.5, 119.0, 238.0, 476.0, 952.0};
+
+std::int16_t big_endian16(const std::uint8_t *bytes) {
+  return static_cast<std::int16_t>((bytes[0] << 8) | bytes[1]);
+}
+
+std::int16_t little_endian16(const std::uint8_t *bytes) {
+  return static_cast<std::int16_t>((bytes[1] << 8) | bytes[0]);
+}
+
+} // namespace
+
+std::string ImuFifo::summary() const {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1) << "odr=" << odr_hz_ << "Hz"
+      << " samples=" << samples_ << " drains=" << drains_ << " overflows=" << overflows_;
+  return out.str();
+}
+
+void ImuFifo::stamp(std::vector<ImuReading> &out, std::size_t first) const {
+  const SampleTime now = SampleTime::now();
+  const auto period_ns = static_cast<std::int64_t>(std::llround(1e9 / odr_hz_));
+  const std::size_t count = out.size() - first;
+  for (std::size_t idx = 0; idx < count; ++idx) {
+    ImuReading &reading = out[first + idx];
+    reading.time = now;
+    reading.time.monotonic_ns -= static_cast<std::int64_t>(count - 1 - idx) * period_ns;
+  }
+}
+
+Mpu9250Fifo::Mpu9250Fifo(RegisterBus &bus) : bus_(bus) {}
+
+std::size_t Mpu9250Fifo::capacity() const {
+  return mpu9250_reg::kFifoBytes / mpu9250_reg::kFifoFrameBytes;
+}
+
+bool Mpu9250Fifo::configure(double odr_hz) {
+  using namespace mpu9250_reg;
+  // SMPLRT_DIV divides the 1 kHz internal rate, which needs the DLPF on.
+  const double divider = std::clamp(std::round(kInternalRateHz / std::max(odr_hz, 1.0)) - 1.0, 0.0, 255.0);
+  odr_hz_ = kInternalRateHz / (divider + 1.0);
+
+  std::uint8_t config = 0;
+  std::uint8_t accel_config = 0;
+  std::uint8_t gyro_config = 0;
+  if (!bus_.read_u8(kConfig, config) || !bus_.read_u8(kAccelConfig, accel_config) ||
+      !bus_.read_u8(kGyroConfig, gyro_config)) {
+    return false;
+  }
+  std::uint8_t dlpf = config & kConfigDlpfMask;
+  if (dlpf == 0 || dlpf == 7) {
+    dlpf = 1;
+  }
+  if (!bus_.write(kConfig, static_cast<std::uint8_t>((config & 0x38) | kConfigFifoMode | dlpf)) ||
+      !bus_.write(kSmplrtDiv, static_cast<std::uint8_t>(divider)) ||
+      !bus_.write(kFifoEnable, kFifoEnableAccelGyro)) {
+    return false;
+  }
+  // Full-scale ranges as left by the driver: 16384 LSB/g and 131 LSB/(deg/s)
+  // halve with every range step.
+  accel_scale_ = kGravity / static_cast<float>(16384 >> ((accel_config >> 3) & 0x03));
+  gyro_scale_ = kDegToRad / (131.0f / static_cast<float>(1 << ((gyro_config >> 3) & 0x03)));
+  logging::log(logging::Level::Info, "MPU9250 FIFO enabled at ", odr_hz_, " Hz");
+  return reset();
+}
+
+bool Mpu9250Fifo::reset() {
+  using namespace mpu9250_reg;
+  std::uint8_t user_ctrl = 0;
+  std::uint8_t status = 0;
+  if (!bus_.read_u8(kUserCtrl, user_ctrl)) {
+    return false;
+  }
+  // Keep the I2C master bits the driver uses for the magnetometer.
+  const auto disabled = static_cast<std::uint8_t>(user_ctrl & ~kUserCtrlFifoEnable);
+  return bus_.write(kUserCtrl, static_cast<std::uint8_t>(disabled | kUserCtrlFifoReset)) &&
+         bus_.write(kUserCtrl, static_cast<std::uint8_t>(disabled | kUserCtrlFifoEnable)) &&
+         bus_.read_u8(kIntStatus, status);
+}
+
+bool Mpu9250Fifo::drain(std::vector<ImuReading> &out) {
+  using namespace mpu9250_reg;
+  ++drains_;
+  std::uint8_t status = 0;
+  std::array<std::uint8_t, 2> count{};
+  if (!bus_.read_u8(kIntStatus, status) || !bus_.read(kFifoCountH, count)) {
+    return false;
+  }
+  const std::size_t bytes = std::min<std::size_t>(((count[0] & 0x1F) << 8) | count[1], kFifoBytes);
+  const std::size_t frames = bytes / kFifoFrameBytes;
+  if (frames > 0) {
+    if (!bus_.read(kFifoRw, std::span<std::uint8_t>(buffer_.data(), frames * kFifoFrameBytes))) {
+      return false;
+    }
+    const std::size_t first = out.size();
+    for (std::size_t frame = 0; frame < frames; ++frame) {
+      const std::uint8_t *data = buffer_.data() + frame * kFifoFrameBytes;
+      ImuReading reading;
+      reading.valid = true;
+      reading.ax = big_endian16(data) * accel_scale_;
+      reading.ay = big_endian16(data + 2) * accel_scale_;
+      reading.az = big_endian16(data + 4) * accel_scale_;
+      reading.gx_rad = big_endian16(data + 6) * gyro_scale_;
+      reading.gy_rad = big_endian16(data + 8) * gyro_scale_;
+      reading.gz_rad = big_endian16(data + 10) * gyro_scale_;
+      out.push_back(reading);
+    }
+    stamp(out, first);
+    samples_ += frames;
+  }
+  if ((status & kIntStatusFifoOverflow) != 0) {
+    ++overflows_;
+    logging::log(logging::Level::Warning, "MPU9250 FIFO overflow, samples lost");
+    return reset();
+  }
+  return true;
+}
+
+Lsm9ds1Fifo::Lsm9ds1Fifo(RegisterBus &accel_gyro, RegisterBus *magnetometer)
+    : bus_(accel_gyro), magnetometer_(magnetometer) {}
+
+std::size_t Lsm9ds1Fifo::capacity() const { return lsm9ds1_reg::kFifoSamples; }
+
+bool Lsm9ds1Fifo::configure(double odr_hz) {
+  using namespace lsm9ds1_reg;
+  // The slowest rate at or above the request; accelerometer follows ODR_G.
+  std::size_t code = std::size(kLsmOdrHz) - 1;
+  for (std::size_t idx = 0; idx < std::size(kLsmOdrHz); ++idx) {
+    if (kLsmOdrHz[idx] >= odr_hz) {
+      code = idx;
+      break;
+    }
+  }
+  odr_hz_ = kLsmOdrHz[code];
+
+  std::uint8_t ctrl1_g = 0;
+  std::uint8_t ctrl6_xl = 0;
+  std::uint8_t ctrl9 = 0;
+  if (!bus_.read_u8(kCtrlReg1G, ctrl1_g) || !bus_.read_u8(kCtrlReg6XL, ctrl6_xl) ||
+      !bus_.read_u8(kCtrlReg9, ctrl9)) {
+    return false;
+  }
+  const auto odr_bits = static_cast<std::uint8_t>((code + 1) << 5);
+  if (!bus_.write(kCtrlReg1G, static_cast<std::uint8_t>((ctrl1_g & ~kOdrMask) | odr_bits)) ||
+      !bus_.write(kCtrlReg9, static_cast<std::uint8_t>(ctrl9 | kCtrlReg9FifoEnable))) {
+    return false;
+  }
+
+  // Sensitivities per full-scale code, from the LSM9DS1 datasheet.
+  static constexpr float kGyroMdps[] = {8.75f, 17.5f, 70.0f, 70.0f};
+  static constexpr float kAccelMg[] = {0.061f, 0.732f, 0.122f, 0.244f};
+  static constexpr float kMagMgauss[] = {0.14f, 0.29f, 0.43f, 0.58f};
+  gyro_scale_ = kGyroMdps[(ctrl1_g & kFullScaleMask) >> 3] / 1000.0f * kDegToRad;
+  accel_scale_ = kAccelMg[(ctrl6_xl & kFullScaleMask) >> 3] / 1000.0f * kGravity;
+  if (magnetometer_) {
+    std::uint8_t ctrl2_m = 0;
+    if (!magnetometer_->read_u8(kCtrlReg2M, ctrl2_m)) {
+      return false;
+    }
+    // Microtesla, like the Navio2 driver: 1 mgauss = 0.1 uT.
+    mag_scale_ = kMagMgauss[(ctrl2_m & kMagFullScaleMask) >> 5] * 0.1f;
+  }
+  logging::log(logging::Level::Info, "LSM9DS1 FIFO enabled at ", odr_hz_, " Hz");
+  return reset();
+}
+
+bool Lsm9ds1Fifo::reset() {
+  using namespace lsm9ds1_reg;
+  // Passing through bypass mode empties the FIFO and clears the overrun flag.
+  return bus_.write(kFifoCtrl, kFifoModeBypass) && bus_.write(kFifoCtrl, kFifoModeStopWhenFull);
+}
+
+bool Lsm9ds1Fifo::drain(std::vector<ImuReading> &out) {
+  using namespace lsm9ds1_reg;
+  ++drains_;
+  std::uint8_t source = 0;
+  if (!bus_.read_u8(kFifoSrc, source)) {
+    return false;
+  }
+  const std::size_t count = std::min<std::size_t>(source & kFifoSrcLevelMask, kFifoSamples);
+  if (count > 0) {
+    // In FIFO mode each output block rolls over onto the next queued sample,
+    // so one burst per block reads every sample.
+    const std::size_t bytes = count * kAxisBlockBytes;
+    if (!bus_.read(kOutXLXL, std::span<std::uint8_t>(accel_buffer_.data(), bytes)) ||
+        !bus_.read(kOutXLG, std::span<std::uint8_t>(gyro_buffer_.data(), bytes))) {
+      return false;
+    }
+    std::array<std::uint8_t, kAxisBlockBytes> mag{};
+    const bool have_mag = magnetometer_ && magnetometer_->read(kOutXLM, mag);
+    const std::size_t first = out.size();
+    for (std::size_t sample = 0; sample < count; ++sample) {
+      const std::uint8_t *accel = accel_buffer_.data() + sample * kAxisBlockBytes;
+      const std::uint8_t *gyro = gyro_buffer_.data() + sample * kAxisBlockBytes;
+      ImuReading reading;
+      reading.valid = true;
+      reading.ax = little_endian16(accel) * accel_scale_;
+      reading.ay = little_endian16(accel + 2) * accel_scale_;
+      reading.az = little_endian16(accel + 4) * accel_scale_;
+      reading.gx_rad = little_endian16(gyro) * gyro_scale_;
+      reading.gy_rad = little_endian16(gyro + 2) * gyro_scale_;
+      reading.gz_rad = little_endian16(gyro + 4) * gyro_scale_;
+      if (have_mag) {
+        reading.mx = little_endian16(mag.data()) * mag_scale_;
+        reading.my = little_endian16(mag.data() + 2) * mag_scale_;
+        reading.mz = little_endian16(mag.data() + 4) * mag_scale_;
+      }
+      out.push_back(reading);
+    }
+    stamp(out, first);
+    samples_ += count;
+  }
+  if ((source & kFifoSrcOverrun) != 0) {
+    ++overflows_;
+    logging::log(logging::Level::Warning, "LSM9DS1 FIFO overrun, samples lost");
+    return reset();
+  }
+  return true;
+}
@@ -0,0 +1,381 @@
+#include "imu_fusion.h"
+
+#include "telemetry_codec.h"
+#include "text_writer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+namespace {
+
+const char *const kDeviceNames[ImuFusion::kDevices] = {"MPU9250", "LSM9DS1"};
+
+float norm3(Lanes v) {
+  const Lanes squared = v * v;
+  return std::sqrt(squared[0] + squared[1] + squared[2]);
+}
+
+// The Lanes of a rotation column, from the image of one device axis.
+constexpr Lanes column(float x, float y, float z) { return Lanes{x, y, z, 0.0f}; }
+
+const char *health_name(ImuFusion::Health health) {
+  switch (health) {
+  case ImuFusion::Health::Healthy:
+    return "healthy";
+  case ImuFusion::Health::Stuck:
+    return "stuck";
+  case ImuFusion::Health::Outlier:
+    return "outlier";
+  case ImuFusion::Health::Stale:
+    return "stale";
+  }
+  return "unknown";
+}
+
+} // namespace
+
+bool axis_rotation(std::string_view name, AxisRotation &rotation) {
+  if (name == "none") {
+    rotation = {column(1, 0, 0), column(0, 1, 0), column(0, 0, 1)};
+  } else if (name == "roll180") {
+    rotation = {column(1, 0, 0), column(0, -1, 0), column(0, 0, -1)};
+  } else if (name == "pitch180") {
+    rotation = {column(-1, 0, 0), column(0, 1, 0), column(0, 0, -1)};
+  } else if (name == "yaw90") {
+    rotation = {column(0, 1, 0), column(-1, 0, 0), column(0, 0, 1)};
+  } else if (name == "yaw180") {
+    rotation = {column(-1, 0, 0), column(0, -1, 0), column(0, 0, 1)};
+  } else if (name == "yaw270") {
+    rotation = {column(0, -1, 0), column(1, 0, 0), column(0, 0, 1)};
+  } else {
+    return false;
+  }
+  return true;
+}
+
+ImuFusion::ImuFusion(const FusionOptions &options)
+    : options_(options),
+      period_ns_(static_cast<std::int64_t>(1e9 / options.rate_hz)),
+      stale_ns_(std::max(kStaleMinNs, 3 * period_ns_)),
+      bias_gain_(static_cast<float>(std::min(1.0, 1.0 / (options.rate_hz * options.bias_time_constant_s)))) {
+  for (Device &device : devices_) {
+    device.input = std::make_unique<SpscRing<ImuReading>>(options.input_depth, OverflowPolicy::DropOldest);
+    axis_rotation("none", device.rotation);
+  }
+}
+
+void ImuFusion::set_rotation(std::size_t device, const AxisRotation &rotation) {
+  devices_[device].rotation = rotation;
+}
+
+void ImuFusion::push(std::size_t device, const ImuReading &reading) {
+  if (!reading.valid) {
+    return;
+  }
+  devices_[device].input->push_with([&reading](ImuReading &slot) {
+    slot = reading;
+    return true;
+  });
+}
+
+ImuFusion::Health ImuFusion::health(std::size_t device) const {
+  return devices_[device].health.load(std::memory_order_relaxed);
+}
+
+std::uint64_t ImuFusion::stuck_events(std::size_t device) const {
+  return devices_[device].stuck_events.load(std::memory_order_relaxed);
+}
+
+std::uint64_t ImuFusion::outlier_events(std::size_t device) const {
+  return devices_[device].outlier_events.load(std::memory_order_relaxed);
+}
+
+std::uint64_t ImuFusion::stale_events(std::size_t device) const {
+  return devices_[device].stale_events.load(std::memory_order_relaxed);
+}
+
+std::string ImuFusion::summary() const {
+  std::ostringstream out;
+  out << "fused=" << fused();
+  for (std::size_t idx = 0; idx < kDevices; ++idx) {
+    out << ' ' << kDeviceNames[idx] << '=' << health_name(health(idx)) << " (stuck=" << stuck_events(idx)
+        << " outlier=" << outlier_events(idx) << " stale=" << stale_events(idx) << ')';
+  }
+  return out.str();
+}
+
+void ImuFusion::drain(Device &device) {
+  ImuReading reading;
+  while (device.input->pop(reading)) {
+    const std::array<float, 9> raw = {reading.ax,     reading.ay,     reading.az, reading.gx_rad, reading.gy_rad,
+                                      reading.gz_rad, reading.mx,     reading.my, reading.mz};
+    if (!std::all_of(raw.begin(), raw.end(), [](float value) { return std::isfinite(value); })) {
+      continue;
+    }
+    // A live sensor always has some noise; a frozen bus or driver repeats
+    // the same bits.
+    if (std::memcmp(raw.data(), device.last_raw.data(), sizeof(raw)) == 0) {
+      if (++device.identical == kStuckReadings) {
+        device.stuck_events.fetch_add(1, std::memory_order_relaxed);
+      }
+    } else {
+      device.identical = 0;
+      device.last_raw = raw;
+    }
+    realtime_offset_ns_ = reading.time.realtime_offset_ns;
+
+    ImuBlock block;
+    for (std::size_t sensor = 0; sensor < 3; ++sensor) {
+      const float *axes = raw.data() + 3 * sensor;
+      block.sensor[sensor] =
+          device.rotation[0] * axes[0] + device.rotation[1] * axes[1] + device.rotation[2] * axes[2];
+    }
+    append(device, reading.time.monotonic_ns, block);
+  }
+}
+
+void ImuFusion::append(Device &device, std::int64_t time_ns, const ImuBlock &block) {
+  if (device.count > 0 && time_ns <= newest_ns(device)) {
+    return;
+  }
+  if (device.count == kHistory) {
+    device.first = (device.first + 1) % kHistory;
+    --device.count;
+  }
+  device.history[(device.first + device.count) % kHistory] = {time_ns, block};
+  ++device.count;
+}
+
+std::int64_t ImuFusion::newest_ns(const Device &device) const {
+  return device.history[(device.first + device.count - 1) % kHistory].time_ns;
+}
+
+bool ImuFusion::interpolate(Device &device, std::int64_t time_ns, ImuBlock &out) {
+  // Readings no longer needed for this or any later grid instant.
+  while (device.count >= 2 && device.history[(device.first + 1) % kHistory].time_ns <= time_ns) {
+    device.first = (device.first + 1) % kHistory;
+    --device.count;
+  }
+  if (device.count == 0) {
+    return false;
+  }
+  const Sample &before = device.history[device.first];
+  if (before.time_ns > time_ns) {
+    return false;
+  }
+  if (before.time_ns == time_ns) {
+    out = before.block;
+    return true;
+  }
+  if (device.count < 2) {
+    return false;
+  }
+  const Sample &after = device.history[(device.first + 1) % kHistory];
+  const float weight =
+      static_cast<float>(time_ns - before.time_ns) / static_cast<float>(after.time_ns - before.time_ns);
+  for (std::size_t sensor = 0; sensor < 3; ++sensor) {
+    out.sensor[sensor] = before.block.sensor[sensor] + (after.block.sensor[sensor] - before.block.sensor[sensor]) * weight;
+  }
+  return true;
+}
+
+void ImuFusion::update_health(Device &device) {
+  const Health health = device.identical >= kStuckReadings ? Health::Stuck
+                        : device.stale                     ? Health::Stale
+                        : device.outlier                   ? Health::Outlier
+                                                           : Health::Healthy;
+  device.health.store(health, std::memory_order_relaxed);
+}
+
+// With two devices a disagreement alone cannot say which one is wrong; the
+// one whose value jumped further since the previous grid instant takes the
+// blame. The magnetometers are left out: the two chips sit in different
+// spots of the board's own field.
+void ImuFusion::check_agreement(const std::array<ImuBlock, kDevices> &values, const ImuBlock &residual) {
+  const bool agree = norm3(residual.sensor[0]) <= options_.accel_tolerance &&
+                     norm3(residual.sensor[1]) <= options_.gyro_tolerance;
+  if (agree) {
+    for (Device &device : devices_) {
+      device.disagreements = 0;
+      if (device.outlier && ++device.agreements >= kRecoverPoints) {
+        device.outlier = false;
+      }
+    }
+    return;
+  }
+  for (Device &device : devices_) {
+    device.agreements = 0;
+  }
+  if (devices_[0].outlier || devices_[1].outlier) {
+    return;
+  }
+  std::array<float, kDevices> jump{};
+  for (std::size_t idx = 0; idx < kDevices; ++idx) {
+    const Device &device = devices_[idx];
+    if (device.has_previous) {
+      jump[idx] = norm3(values[idx].sensor[0] - device.previous.sensor[0]) / options_.accel_tolerance +
+                  norm3(values[idx].sensor[1] - device.previous.sensor[1]) / options_.gyro_tolerance;
+    }
+  }
+  Device &blamed = devices_[jump[1] > jump[0] ? 1 : 0];
+  devices_[jump[1] > jump[0] ? 0 : 1].disagreements = 0;
+  if (++blamed.disagreements >= kOutlierPoints) {
+    blamed.outlier = true;
+    blamed.agreements = 0;
+    blamed.outlier_events.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+bool ImuFusion::next(FusedImuReading &out) {
+  for (Device &device : devices_) {
+    drain(device);
+  }
+
+  std::array<ImuBlock, kDevices> values;
+  std::array<bool, kDevices> have{};
+  while (true) {
+    std::int64_t newest = std::numeric_limits<std::int64_t>::min();
+    std::int64_t oldest = std::numeric_limits<std::int64_t>::max();
+    for (const Device &device : devices_) {
+      if (device.count > 0) {
+        newest = std::max(newest, newest_ns(device));
+        oldest = std::min(oldest, device.history[device.first].time_ns);
+      }
+    }
+    if (newest == std::numeric_limits<std::int64_t>::min()) {
+      return false;
+    }
+    // Starts the grid, or moves it past a gap in both devices, at the first
+    // instant a reading covers.
+    if (next_ns_ == 0 || oldest > next_ns_ + stale_ns_) {
+      next_ns_ = (oldest + period_ns_ - 1) / period_ns_ * period_ns_;
+    }
+
+    // Waits for a device lagging behind the grid unless the other one is
+    // so far ahead that the lagging one counts as stale.
+    for (Device &device : devices_) {
+      const bool caught_up = device.count > 0 && newest_ns(device) >= next_ns_;
+      if (caught_up) {
+        device.stale = false;
+      } else if (device.identical < kStuckReadings && !device.stale) {
+        if (newest < next_ns_ + stale_ns_) {
+          return false;
+        }
+        device.stale = true;
+        device.stale_events.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    bool any = false;
+    for (std::size_t idx = 0; idx < kDevices; ++idx) {
+      Device &device = devices_[idx];
+      have[idx] = !device.stale && device.identical < kStuckReadings && interpolate(device, next_ns_, values[idx]);
+      any = any || have[idx];
+    }
+    if (any) {
+      break;
+    }
+    // Nothing brackets this instant yet (start-up, or both just resumed).
+    if (newest < next_ns_) {
+      return false;
+    }
+    next_ns_ += period_ns_;
+  }
+
+  out = {};
+  out.valid = true;
+  out.time.monotonic_ns = next_ns_;
+  out.time.realtime_offset_ns = realtime_offset_ns_;
+  out.accel_residual = out.gyro_residual = out.mag_residual = std::numeric_limits<float>::quiet_NaN();
+
+  // Device 1 on device 0's scale.
+  ImuBlock aligned;
+  if (have[1]) {
+    for (std::size_t sensor = 0; sensor < 3; ++sensor) {
+      aligned.sensor[sensor] = values[1].sensor[sensor] - bias_.sensor[sensor];
+    }
+  }
+  if (have[0] && have[1]) {
+    ImuBlock residual;
+    for (std::size_t sensor = 0; sensor < 3; ++sensor) {
+      residual.sensor[sensor] = values[0].sensor[sensor] - aligned.sensor[sensor];
+    }
+    out.accel_residual = norm3(residual.sensor[0]);
+    out.gyro_residual = norm3(residual.sensor[1]);
+    out.mag_residual = norm3(residual.sensor[2]);
+    check_agreement(values, residual);
+  }
+
+  const bool use0 = have[0] && (!devices_[0].outlier || !have[1] || devices_[1].outlier);
+  const bool use1 = have[1] && (!devices_[1].outlier || !have[0] || devices_[0].outlier);
+  ImuBlock fused;
+  if (use0 && use1) {
+    for (std::size_t sensor = 0; sensor < 3; ++sensor) {
+      // Tracks the offset only while both are trusted; it is frozen during
+      // a failover so the stream does not step when a device drops out.
+      bias_.sensor[sensor] += ((values[1].sensor[sensor] - values[0].sensor[sensor]) - bias_.sensor[sensor]) * bias_gain_;
+      fused.sensor[sensor] = (values[0].sensor[sensor] + aligned.sensor[sensor]) * 0.5f;
+    }
+  } else {
+    fused = use0 ? values[0] : aligned;
+  }
+  out.sources = static_cast<std::uint8_t>((use0 ? 0x01 : 0) | (use1 ? 0x02 : 0));
+  out.ax = fused.sensor[0][0];
+  out.ay = fused.sensor[0][1];
+  out.az = fused.sensor[0][2];
+  out.gx_rad = fused.sensor[1][0];
+  out.gy_rad = fused.sensor[1][1];
+  out.gz_rad = fused.sensor[1][2];
+  out.mx = fused.sensor[2][0];
+  out.my = fused.sensor[2][1];
+  out.mz = fused.sensor[2][2];
+
+  for (std::size_t idx = 0; idx < kDevices; ++idx) {
+    devices_[idx].has_previous = have[idx];
+    if (have[idx]) {
+      devices_[idx].previous = values[idx];
+    }
+    update_health(devices_[idx]);
+  }
+  next_ns_ += period_ns_;
+  fused_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+std::size_t format_fused_imu(std::span<char> out, const FusedImuReading &data) {
+  TextWriter writer(out);
+  if (!data.valid) {
+    writer << "IMU fused: unavailable";
+    return writer.size();
+  }
+  const char *source = data.sources == 0x03 ? "both" : data.sources == 0x01 ? kDeviceNames[0] : kDeviceNames[1];
+  writer << data.time << " source=" << source
+         << " ax=" << data.ax << " ay=" << data.ay << " az=" << data.az
+         << " gx=" << data.gx_rad << " gy=" << data.gy_rad << " gz=" << data.gz_rad
+         << " mx=" << data.mx << " my=" << data.my << " mz=" << data.mz
+         << " res_a=" << data.accel_residual << " res_g=" << data.gyro_residual << " res_m=" << data.mag_residual;
+  return writer.size();
+}
+
+std::size_t encode_fused_imu(const FusedImuReading &data, std::span<std::uint8_t> out) {
+  codec::FusedImuRecord record;
+  record.time = data.time;
+  record.valid = data.valid;
+  record.sources = data.sources;
+  record.ax = data.ax;
+  record.ay = data.ay;
+  record.az = data.az;
+  record.gx = data.gx_rad;
+  record.gy = data.gy_rad;
+  record.gz = data.gz_rad;
+  record.mx = data.mx;
+  record.my = data.my;
+  record.mz = data.mz;
+  record.accel_residual = data.accel_residual;
+  record.gyro_residual = data.gyro_residual;
+  record.mag_residual = data.mag_residual;
+  return codec::encode(record, out);
+}
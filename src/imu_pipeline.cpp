@@ -0,0 +1,188 @@
+#include "imu_pipeline.h"
+
+#include "imu_fifo.h"
+#include "imu_fusion.h"
+#include "logging.h"
+#include "pipeline_options.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Filtered per IMU sample: accelerometer, gyroscope and magnetometer axes.
+constexpr std::size_t kImuAxes = 9;
+
+// Drain rate that keeps an IMU FIFO at most half full between reads.
+double fifo_drain_rate(const ImuFifo &fifo) {
+  return std::max(10.0, 2.0 * fifo.odr_hz() / static_cast<double>(fifo.capacity()));
+}
+
+} // namespace
+
+ImuPipeline::ImuPipeline(ImuSensor &sensor, telemetry::PublishChannel &channel, bool binary,
+                         metrics::DurationMetric &read_duration)
+    : sensor_(sensor), channel_(channel), binary_(binary), label_("IMU " + sensor.name()),
+      read_duration_(read_duration) {}
+
+void ImuPipeline::set_attitude(const AttitudeFilter &filter, telemetry::PublishChannel &channel) {
+  attitude_.emplace(filter);
+  attitude_channel_ = &channel;
+  attitude_label_ = "Attitude " + sensor_.name();
+}
+
+void ImuPipeline::set_decimation(DecimatedOutputs outputs) { decimated_ = std::move(outputs); }
+
+void ImuPipeline::set_window(const codec::ImuQuantization &steps, std::size_t max_samples,
+                             std::int64_t max_latency_ns) {
+  window_.emplace(Window{codec::ImuWindowEncoder(steps), max_samples, max_latency_ns});
+}
+
+void ImuPipeline::set_fusion(ImuFusion &fusion, std::size_t input) {
+  fusion_ = &fusion;
+  fusion_input_ = input;
+}
+
+bool ImuPipeline::make_task(const utils::ProgramOptions &options, std::vector<double> decimation_hz,
+                            PipelineTask &task) {
+  const bool fifo_mode = options.imu_fifo_odr > 0.0 && sensor_.enable_fifo(options.imu_fifo_odr);
+  if (!decimation_hz.empty()) {
+    // The FIFO runs at the closest rate the chip supports, not the one asked for.
+    const double sample_rate = fifo_mode ? sensor_.fifo()->odr_hz() : utils::sensor_rate(options.imu_rate, options);
+    if (!plan_decimation("imu (" + sensor_.name() + ")", sample_rate, decimation_hz)) {
+      return false;
+    }
+    decimated_.cascade = std::make_unique<DecimationCascade>(kImuAxes, sample_rate, decimation_hz);
+  }
+  task.name = sensor_.name();
+  if (!fifo_mode) {
+    task.rate_hz = utils::sensor_rate(options.imu_rate, options);
+    task.run = [this] { read(); };
+    return true;
+  }
+  // Without --imu-rate the FIFO is drained often enough to stay half empty.
+  const ImuFifo &fifo = *sensor_.fifo();
+  task.rate_hz = options.imu_rate > 0.0 ? options.imu_rate : fifo_drain_rate(fifo);
+  if (task.rate_hz * static_cast<double>(fifo.capacity()) < fifo.odr_hz()) {
+    logging::log(logging::Level::Warning, sensor_.name(), " FIFO fills between reads at ", task.rate_hz,
+                 " Hz; samples will be lost");
+  }
+  samples_.reserve(64);
+  task.run = [this] { drain(); };
+  return true;
+}
+
+void ImuPipeline::read() {
+  const ImuReading reading = metrics::timed(read_duration_, [&] { return sensor_.read(); });
+  if (!reading.stale) {
+    publish(reading);
+  }
+}
+
+void ImuPipeline::drain() {
+  samples_.clear();
+  if (!metrics::timed(read_duration_, [&] { return sensor_.read_fifo(samples_); })) {
+    return;
+  }
+  for (const ImuReading &reading : samples_) {
+    publish(reading);
+  }
+}
+
+void ImuPipeline::flush_window() {
+  if (!window_) {
+    return;
+  }
+  const std::span<const std::uint8_t> record = window_->encoder.record();
+  if (record.empty()) {
+    return;
+  }
+  auto copy = [&](std::span<std::uint8_t> out) -> std::size_t {
+    if (out.size() < record.size()) {
+      logging::log(logging::Level::Error, "Failed to serialize ", label_, " window");
+      return 0;
+    }
+    std::copy(record.begin(), record.end(), out.begin());
+    return record.size();
+  };
+  if (!channel_.push_with(copy) && logging::enabled(logging::Level::Debug)) {
+    logging::log(logging::Level::Debug, label_, " window dropped");
+  }
+  window_->encoder.clear();
+}
+
+void ImuPipeline::publish(const ImuReading &reading) {
+  if (window_ && reading.valid) {
+    const codec::ImuRecord record = imu_record(sensor_.name(), reading);
+    if (!window_->encoder.add(record)) {
+      flush_window();
+      window_->encoder.add(record);
+    }
+    const std::int64_t held_ns = reading.time.monotonic_ns - window_->encoder.first_time().monotonic_ns;
+    if (window_->encoder.count() >= window_->max_samples ||
+        (window_->max_latency_ns > 0 && held_ns >= window_->max_latency_ns)) {
+      flush_window();
+    }
+  } else {
+    // An unavailable IMU goes out on its own, after the samples before it.
+    flush_window();
+    publish_reading(
+        channel_, label_.c_str(), binary_,
+        [&](std::span<char> out) { return format_imu(out, sensor_.name(), reading); },
+        [&](std::span<std::uint8_t> out) { return encode_imu(sensor_.name(), reading, out); });
+  }
+  publish_attitude(reading);
+  decimate(reading);
+  if (fusion_) {
+    fusion_->push(fusion_input_, reading);
+  }
+}
+
+void ImuPipeline::publish_attitude(const ImuReading &reading) {
+  AttitudeReading estimate;
+  if (!attitude_ || !attitude_->update(reading, estimate)) {
+    return;
+  }
+  publish_reading(
+      *attitude_channel_, attitude_label_.c_str(), binary_,
+      [&](std::span<char> out) { return format_attitude(out, sensor_.name(), estimate); },
+      [&](std::span<std::uint8_t> out) { return encode_attitude(sensor_.name(), estimate, out); });
+}
+
+void ImuPipeline::decimate(const ImuReading &reading) {
+  if (!decimated_.cascade || !reading.valid) {
+    return;
+  }
+  const float axes[kImuAxes] = {reading.ax,     reading.ay,     reading.az, reading.gx_rad, reading.gy_rad,
+                                reading.gz_rad, reading.mx,     reading.my, reading.mz};
+  auto publish = [&](std::size_t stage, const SampleTime &time, std::span<const float> out) {
+    ImuReading decimated;
+    decimated.valid = true;
+    decimated.time = time;
+    float *const fields[kImuAxes] = {&decimated.ax,     &decimated.ay,     &decimated.az,
+                                     &decimated.gx_rad, &decimated.gy_rad, &decimated.gz_rad,
+                                     &decimated.mx,     &decimated.my,     &decimated.mz};
+    for (std::size_t idx = 0; idx < kImuAxes; ++idx) {
+      *fields[idx] = out[idx];
+    }
+    telemetry::PublishChannel &channel = *decimated_.channels[stage];
+    publish_reading(
+        channel, channel.name().c_str(), binary_,
+        [&](std::span<char> payload) { return format_imu(payload, sensor_.name(), decimated); },
+        [&](std::span<std::uint8_t> payload) { return encode_imu(sensor_.name(), decimated, payload); });
+  };
+  decimated_.cascade->push(reading.time, axes, publish);
+}
+
+FusedImuPipeline::FusedImuPipeline(ImuFusion &fusion, telemetry::PublishChannel &channel, bool binary)
+    : fusion_(fusion), channel_(channel), binary_(binary) {}
+
+void FusedImuPipeline::run() {
+  FusedImuReading fused;
+  while (fusion_.next(fused)) {
+    publish_reading(
+        channel_, "IMU fused", binary_,
+        [&](std::span<char> out) { return format_fused_imu(out, fused); },
+        [&](std::span<std::uint8_t> out) { return encode_fused_imu(fused, out); });
+  }
+}
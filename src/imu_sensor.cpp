@@ -1,6 +1,11 @@
 #include "imu_sensor.h"
 
+#include "imu_fifo.h"
 #include "logging.h"
+#include "register_bus.h"
+#include "sensor_backend.h"
+#include "telemetry_codec.h"
+#include "text_writer.h"
 
 #include <Common/InertialSensor.h>
 #include <Common/MPU9250.h>
@@ -9,13 +14,17 @@
 #include <unistd.h>
 
 #include <cmath>
-#include <iomanip>
-#include <sstream>
 
 namespace {
 
 constexpr double kPi = 3.14159265358979323846;
 
+// spidev nodes of the Navio2 IMUs, as used by the Navio2 drivers.
+constexpr const char *kMpuDevice = "/dev/spidev0.1";
+constexpr const char *kLsmAccelGyroDevice = "/dev/spidev0.3";
+constexpr const char *kLsmMagnetometerDevice = "/dev/spidev0.2";
+constexpr unsigned int kFifoSpiSpeedHz = 1000000;
+
 std::unique_ptr<InertialSensor> create_mpu() {
   return std::unique_ptr<InertialSensor>(new MPU9250());
 }
@@ -26,71 +35,163 @@ std::unique_ptr<InertialSensor> create_lsm() {
 
 } // namespace
 
-ImuSensor::ImuSensor(ImuType type) {
+ImuSensor::ImuSensor(ImuType type, SensorBackend *backend) : type_(type), backend_(backend) {
+  name_ = type == ImuType::Mpu9250 ? "MPU9250" : "LSM9DS1";
+  if (backend_) {
+    logging::log(logging::Level::Info, "IMU ", name_, " reads from the ", backend_->name(), " backend");
+    return;
+  }
   switch (type) {
   case ImuType::Mpu9250:
-    name_ = "MPU9250";
     sensor_ = create_mpu();
     break;
   case ImuType::Lsm9ds1:
-    name_ = "LSM9DS1";
     sensor_ = create_lsm();
     break;
   }
 
   if (!sensor_) {
-    logging::log(logging::Level::Error,
-                 std::string("Failed to allocate IMU ") + name_);
+    logging::log(logging::Level::Error, "Failed to allocate IMU ", name_);
     return;
   }
   if (!sensor_->probe()) {
-    logging::log(logging::Level::Warning,
-                 std::string("IMU ") + name_ + " probe failed");
+    logging::log(logging::Level::Warning, "IMU ", name_, " probe failed");
     sensor_.reset();
     return;
   }
   sensor_->initialize();
-  logging::log(logging::Level::Info, std::string("Initialized IMU ") + name_);
+  logging::log(logging::Level::Info, "Initialized IMU ", name_);
   usleep(100000);
 }
 
 ImuSensor::~ImuSensor() {
-  logging::log(logging::Level::Info, std::string("Closing IMU ") + name_);
+  logging::log(logging::Level::Info, "Closing IMU ", name_);
 }
 
-bool ImuSensor::available() const { return static_cast<bool>(sensor_); }
+bool ImuSensor::available() const { return backend_ || sensor_; }
 
 const std::string &ImuSensor::name() const { return name_; }
 
 ImuReading ImuSensor::read() {
-  logging::log(logging::Level::Debug, std::string("Reading IMU ") + name_);
+  const bool debug = logging::enabled(logging::Level::Debug);
+  if (debug) {
+    logging::log(logging::Level::Debug, "Reading IMU ", name_);
+  }
   ImuReading result;
+  if (backend_) {
+    if (!backend_->read_imu(type_, result)) {
+      result = ImuReading{};
+    }
+    return result;
+  }
   if (!sensor_) {
-    logging::log(logging::Level::Warning, std::string("IMU not available: ") + name_);
+    logging::log(logging::Level::Warning, "IMU not available: ", name_);
     return result;
   }
   sensor_->update();
+  result.time = SampleTime::now();
   sensor_->read_accelerometer(&result.ax, &result.ay, &result.az);
-  logging::log(logging::Level::Debug, name_ + " Accel: " + std::to_string(result.ax) + " " + std::to_string(result.ay) + " " + std::to_string(result.az));
   sensor_->read_gyroscope(&result.gx_rad, &result.gy_rad, &result.gz_rad);
-  logging::log(logging::Level::Debug, name_ + " Gyro: " + std::to_string(result.gx_rad) + " " + std::to_string(result.gy_rad) + " " + std::to_string(result.gz_rad));
   sensor_->read_magnetometer(&result.mx, &result.my, &result.mz);
-  logging::log(logging::Level::Debug, name_ + " Mag: " + std::to_string(result.mx) + " " + std::to_string(result.my) + " " + std::to_string(result.mz));
+  if (debug) {
+    logging::log(logging::Level::Debug, name_, " Accel: ", result.ax, " ", result.ay, " ", result.az);
+    logging::log(logging::Level::Debug, name_, " Gyro: ", result.gx_rad, " ", result.gy_rad, " ", result.gz_rad);
+    logging::log(logging::Level::Debug, name_, " Mag: ", result.mx, " ", result.my, " ", result.mz);
+  }
   result.valid = true;
   return result;
 }
 
-std::string format_imu(const std::string &name, const ImuReading &data, const std::string &timestamp) {
+bool ImuSensor::enable_fifo(double odr_hz) {
+  if (backend_) {
+    logging::log(logging::Level::Warning, "IMU FIFO needs the Navio2 backend, polling ", name_);
+    return false;
+  }
+  if (!sensor_) {
+    logging::log(logging::Level::Warning, "IMU not available: ", name_);
+    return false;
+  }
+  switch (type_) {
+  case ImuType::Mpu9250:
+    bus_ = std::make_unique<SpiRegisterBus>(kMpuDevice, kFifoSpiSpeedHz);
+    fifo_ = std::make_unique<Mpu9250Fifo>(*bus_);
+    break;
+  case ImuType::Lsm9ds1:
+    bus_ = std::make_unique<SpiRegisterBus>(kLsmAccelGyroDevice, kFifoSpiSpeedHz);
+    mag_bus_ = std::make_unique<SpiRegisterBus>(kLsmMagnetometerDevice, kFifoSpiSpeedHz, 0xC0);
+    fifo_ = std::make_unique<Lsm9ds1Fifo>(*bus_, mag_bus_.get());
+    break;
+  }
+  if (!fifo_->configure(odr_hz)) {
+    logging::log(logging::Level::Error, "Failed to enable FIFO on IMU ", name_);
+    fifo_.reset();
+    mag_bus_.reset();
+    bus_.reset();
+    return false;
+  }
+  return true;
+}
+
+bool ImuSensor::read_fifo(std::vector<ImuReading> &out) {
+  if (!fifo_) {
+    return false;
+  }
+  const std::size_t first = out.size();
+  if (!fifo_->drain(out)) {
+    logging::log(logging::Level::Warning, "FIFO read failed on IMU ", name_);
+    return false;
+  }
+  if (type_ == ImuType::Mpu9250 && out.size() > first) {
+    // The MPU9250 FIFO holds no magnetometer data; the driver's update() reads
+    // it from the external sensor registers without touching the FIFO.
+    float mx = 0.0f;
+    float my = 0.0f;
+    float mz = 0.0f;
+    sensor_->update();
+    sensor_->read_magnetometer(&mx, &my, &mz);
+    for (std::size_t idx = first; idx < out.size(); ++idx) {
+      out[idx].mx = mx;
+      out[idx].my = my;
+      out[idx].mz = mz;
+    }
+  }
+  return true;
+}
+
+std::size_t format_imu(std::span<char> out, const std::string &name, const ImuReading &data) {
+  TextWriter writer(out);
   if (!data.valid) {
     if (name.empty()) {
-      return "IMU: unavailable";
+      writer << "IMU: unavailable";
+    } else {
+      writer << "IMU " << name << ": unavailable";
     }
-    return std::string("IMU ") + name + ": unavailable";
-  }
-  std::ostringstream out;
-  out << "timestamp=" << timestamp << " name=" << name
-      << " ax=" << data.ax << " ay=" << data.ay << " az=" << data.az
-      << " gx=" << data.gx_rad << " gy=" << data.gy_rad << " gz=" << data.gz_rad
-      << " mx=" << data.mx << " my=" << data.my << " mz=" << data.mz;
-  return out.str();
+    return writer.size();
+  }
+  writer << data.time << " name=" << name
+         << " ax=" << data.ax << " ay=" << data.ay << " az=" << data.az
+         << " gx=" << data.gx_rad << " gy=" << data.gy_rad << " gz=" << data.gz_rad
+         << " mx=" << data.mx << " my=" << data.my << " mz=" << data.mz;
+  return writer.size();
+}
+
+codec::ImuRecord imu_record(const std::string &name, const ImuReading &data) {
+  codec::ImuRecord record;
+  record.time = data.time;
+  record.device = codec::imu_device(name);
+  record.valid = data.valid;
+  record.ax = data.ax;
+  record.ay = data.ay;
+  record.az = data.az;
+  record.gx = data.gx_rad;
+  record.gy = data.gy_rad;
+  record.gz = data.gz_rad;
+  record.mx = data.mx;
+  record.my = data.my;
+  record.mz = data.mz;
+  return record;
+}
+
+std::size_t encode_imu(const std::string &name, const ImuReading &data, std::span<std::uint8_t> out) {
+  return codec::encode(imu_record(name, data), out);
 }
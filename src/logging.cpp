@@ -1,15 +1,50 @@
 #include "logging.h"
 
+#include "spsc_ring.h"
+
+#include <array>
 #include <atomic>
 #include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 namespace logging {
 
-namespace {
+namespace detail {
 std::atomic<int> g_level{static_cast<int>(Level::Warning)};
+} // namespace detail
+
+namespace {
+// Per-thread ring depth and the writer's idle poll period. Polling keeps the
+// logging threads free of wake-up syscalls.
+constexpr std::size_t kRingDepth = 256;
+constexpr auto kWriterPollPeriod = std::chrono::milliseconds(2);
+
+struct Record {
+  Level level;
+  std::uint16_t size;
+  std::array<char, kMaxMessageSize> text;
+};
+
+using RecordRing = SpscRing<Record>;
+
 std::mutex g_output_mutex;
+// Registered thread rings; a ring outlives its thread until drained.
+std::mutex g_rings_mutex;
+std::vector<std::shared_ptr<RecordRing>> g_rings;
+// Drops of the rings already released, and drops reported so far; guarded
+// by g_rings_mutex.
+std::uint64_t g_released_drops = 0;
+std::uint64_t g_reported_drops = 0;
+std::atomic<bool> g_async{false};
+std::atomic<bool> g_writer_running{false};
+std::thread g_writer;
 
 const char *to_cstr(Level level) {
   switch (level) {
@@ -59,19 +94,116 @@ Level parse_level_name(const std::string &name, bool &ok) {
   return Level::Warning;
 }
 
+void emit(Level level, std::string_view message) {
+  std::cerr << '[' << to_cstr(level) << "] " << message << '\n';
+}
+
+RecordRing &thread_ring() {
+  thread_local std::shared_ptr<RecordRing> ring = [] {
+    auto created = std::make_shared<RecordRing>(kRingDepth, OverflowPolicy::DropNewest);
+    std::lock_guard<std::mutex> lock(g_rings_mutex);
+    g_rings.push_back(created);
+    return created;
+  }();
+  return *ring;
+}
+
+// Writes every queued record. Rings whose thread has exited are released once
+// empty. Returns the number of records written.
+std::size_t drain_rings() {
+  std::size_t written = 0;
+  Record record;
+  std::lock_guard<std::mutex> rings_lock(g_rings_mutex);
+  std::lock_guard<std::mutex> output_lock(g_output_mutex);
+  std::uint64_t drops = g_released_drops;
+  for (auto it = g_rings.begin(); it != g_rings.end();) {
+    RecordRing &ring = **it;
+    while (ring.pop(record)) {
+      emit(record.level, std::string_view(record.text.data(), record.size));
+      ++written;
+    }
+    drops += ring.dropped();
+    // The exited thread can no longer drop anything, so its count is kept
+    // in the released total the next sums start from.
+    if (it->use_count() == 1) {
+      g_released_drops += ring.dropped();
+      it = g_rings.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (drops > g_reported_drops) {
+    emit(Level::Warning, "Dropped " + std::to_string(drops - g_reported_drops) + " log messages");
+    g_reported_drops = drops;
+  }
+  if (written > 0) {
+    std::cerr.flush();
+  }
+  return written;
+}
+
+void run_writer() {
+  while (g_writer_running.load(std::memory_order_acquire)) {
+    if (drain_rings() == 0) {
+      std::this_thread::sleep_for(kWriterPollPeriod);
+    }
+  }
+  drain_rings();
+}
+
 } // namespace
 
+namespace detail {
+
+void write(Level level, std::string_view message) {
+  if (g_async.load(std::memory_order_acquire)) {
+    thread_ring().push_with([level, message](Record &record) {
+      record.level = level;
+      record.size = static_cast<std::uint16_t>(message.size());
+      std::memcpy(record.text.data(), message.data(), message.size());
+      return true;
+    });
+    return;
+  }
+  std::lock_guard<std::mutex> lock(g_output_mutex);
+  emit(level, message);
+}
+
+} // namespace detail
+
+void start_async() {
+  if (g_writer_running.exchange(true)) {
+    return;
+  }
+  g_writer = std::thread(run_writer);
+  g_async.store(true, std::memory_order_release);
+}
+
+void stop_async() {
+  if (!g_writer_running.load()) {
+    return;
+  }
+  g_async.store(false, std::memory_order_release);
+  g_writer_running.store(false, std::memory_order_release);
+  if (g_writer.joinable()) {
+    g_writer.join();
+  }
+}
+
 void set_level(Level level) {
-  log(Level::Debug, "Setting log level to " + std::string(to_cstr(level)));
-  g_level.store(static_cast<int>(level), std::memory_order_relaxed);
+  log(Level::Debug, "Setting log level to ", to_cstr(level));
+  if (!compiled_in(level)) {
+    log(Level::Warning, to_cstr(level), " messages are compiled out of this build");
+  }
+  detail::g_level.store(static_cast<int>(level), std::memory_order_relaxed);
 }
 
 Level get_level() {
-  return static_cast<Level>(g_level.load(std::memory_order_relaxed));
+  return static_cast<Level>(detail::g_level.load(std::memory_order_relaxed));
 }
 
 bool set_level(const std::string &name) {
-  log(Level::Debug, "Setting log level to " + name);
+  log(Level::Debug, "Setting log level to ", name);
   bool ok = false;
   Level level = parse_level_name(name, ok);
   if (ok) {
@@ -80,12 +212,5 @@ bool set_level(const std::string &name) {
   return ok;
 }
 
-void log(Level level, const std::string &message) {
-  if (static_cast<int>(level) < g_level.load(std::memory_order_relaxed)) {
-    return;
-  }
-  std::lock_guard<std::mutex> lock(g_output_mutex);
-  std::cerr << '[' << to_cstr(level) << "] " << message << '\n';
-}
 
 } // namespace logging
@@ -1,9 +1,10 @@
-#include "adc_sensor.h"
-#include "barometer_sensor.h"
-#include "gps_sensor.h"
-#include "imu_sensor.h"
+#include "acquisition.h"
 #include "logging.h"
-#include "rcinput_sensor.h"
+#include "metrics.h"
+#include "pipeline.h"
+#include "pipeline_options.h"
+#include "sensor_backend.h"
+#include "sensor_worker.h"
 #include "telemetry_publisher.h"
 #include "utils.h"
 
@@ -11,12 +12,42 @@
 
 #include <Common/Util.h>
 
+#include <chrono>
+#include <csignal>
 #include <cstdlib>
-#include <iostream>
-#include <string>
-#include <unistd.h>
+#include <memory>
+#include <pthread.h>
 #include <vector>
 
+namespace {
+
+sigset_t control_signals() {
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGUSR1);
+  return signals;
+}
+
+// Blocks until SIGINT or SIGTERM; SIGUSR1 dumps the scheduler statistics.
+void wait_for_termination(const sigset_t &signals, const Pipeline &pipeline) {
+  int signal_number = 0;
+  while (true) {
+    if (sigwait(&signals, &signal_number) != 0) {
+      continue;
+    }
+    if (signal_number == SIGUSR1) {
+      print_scheduler_stats(pipeline);
+      continue;
+    }
+    break;
+  }
+  logging::log(logging::Level::Info, "Received signal ", signal_number, ", stopping");
+}
+
+} // namespace
+
 int main(int argc, char *argv[]) {
   logging::log(logging::Level::Info, "Starting sensors_read");
   utils::ProgramOptions options;
@@ -27,75 +58,102 @@ int main(int argc, char *argv[]) {
   if (show_help) {
     return EXIT_SUCCESS;
   }
-
-  logging::log(logging::Level::Info, "Options: interval=" + std::to_string(options.interval) + "s, rc_channels=" + std::to_string(options.rc_channels) + ", once=" + (options.once ? "true" : "false"));
-
-  if (check_apm()) {
-    return EXIT_FAILURE;
+  // Log lines are queued per thread and written by a background thread, so
+  // DEBUG output does not stall acquisition.
+  logging::AsyncLogging async_logging;
+
+  logging::log(logging::Level::Info, "Options: interval=", options.interval, "s, imu_rate=", utils::sensor_rate(options.imu_rate, options), "Hz, adc_rate=", utils::sensor_rate(options.adc_rate, options), "Hz, baro_rate=", utils::sensor_rate(options.baro_rate, options), "Hz, gps_rate=", utils::sensor_rate(options.gps_rate, options), "Hz, rc_rate=", utils::sensor_rate(options.rc_rate, options), "Hz, rc_channels=", options.rc_channels, ", once=", (options.once ? "true" : "false"), ", encoding=", (options.encoding == utils::PayloadEncoding::Binary ? "binary" : "text"));
+
+  // The simulated and replayed backends never touch the board, so they can
+  // run next to ArduPilot or on a machine without a Navio2.
+  std::unique_ptr<SensorBackend> backend;
+  switch (options.backend) {
+  case utils::BackendKind::Navio2:
+    if (check_apm()) {
+      return EXIT_FAILURE;
+    }
+    break;
+  case utils::BackendKind::Sim:
+    backend = make_sim_backend();
+    break;
+  case utils::BackendKind::Replay:
+    backend = make_replay_backend(options.replay_file);
+    if (!backend) {
+      return EXIT_FAILURE;
+    }
+    break;
   }
 
-  ImuSensor mpu_sensor(ImuType::Mpu9250);
-  ImuSensor lsm_sensor(ImuType::Lsm9ds1);
-  AdcSensor adc_sensor;
-  BarometerSensor barometer_sensor;
-  GpsSensor gps_sensor;
-  RcInputSensor rc_sensor(options.rc_channels);
-  telemetry::TelemetryPublisher publisher;
+  telemetry::PublisherOptions publisher_options;
+  publisher_options.shared_memory = options.shared_memory;
+  publisher_options.shared_memory_size = options.shared_memory_size;
+  publisher_options.history_samples = options.history;
+  publisher_options.history_age = std::chrono::seconds(options.history_s);
+  telemetry::TelemetryPublisher publisher(publisher_options);
 
   if (!publisher.ready()) {
     logging::log(logging::Level::Critical, "Zenoh publisher is not ready. Aborting.");
     return EXIT_FAILURE;
   }
-  logging::log(logging::Level::Info, "Zenoh publisher is ready");
+  if (!configure_batching(options, publisher)) {
+    return EXIT_FAILURE;
+  }
+  logging::log(logging::Level::Info, "Zenoh publisher is ready", (publisher.shared_memory_active() ? " (shared memory)" : ""));
 
-  auto publish_or_warn = [&publisher](const std::string &topic,
-                                      const std::string &payload) {
-    if (!publisher.publish(topic, payload)) {
-      logging::log(logging::Level::Warning,
-                   std::string("Failed to publish to ") + topic);
-    }
-  };
-
-  logging::log(logging::Level::Info, "Starting main loop");
-  do {
-    const std::string timestamp = utils::current_timestamp();
-    logging::log(logging::Level::Debug, "Timestamp: " + timestamp);
-
-    const ImuReading mpu_reading = mpu_sensor.read();
-    const std::string mpu_payload = format_imu(mpu_sensor.name(), mpu_reading, timestamp);
-    logging::log(logging::Level::Debug, "IMU MPU9250 payload: " + mpu_payload);
-    publish_or_warn(main_const::imu_topic, mpu_payload);
-
-    const ImuReading lsm_reading = lsm_sensor.read();
-    const std::string lsm_payload = format_imu(lsm_sensor.name(), lsm_reading, timestamp);
-    logging::log(logging::Level::Debug, "IMU LSM9DS1 payload: " + lsm_payload);
-    publish_or_warn(main_const::imu_topic, lsm_payload);
-
-    const std::vector<double> adc_values = adc_sensor.read();
-    const std::string adc_payload = format_adc(adc_values, timestamp);
-    logging::log(logging::Level::Debug, "ADC payload: " + adc_payload);
-    publish_or_warn(main_const::adc_topic, adc_payload);
-
-    const BarometerReading baro_reading = barometer_sensor.read();
-    const std::string baro_payload = format_barometer(baro_reading, timestamp);
-    logging::log(logging::Level::Debug, "Barometer payload: " + baro_payload);
-    publish_or_warn(main_const::barometer_topic, baro_payload);
-
-    const GpsReading gps_reading = gps_sensor.read();
-    const std::string gps_payload = format_gps(gps_reading, timestamp);
-    logging::log(logging::Level::Debug, "GPS payload: " + gps_payload);
-    publish_or_warn(main_const::gps_topic, gps_payload);
-
-    const std::vector<int> rc_values = rc_sensor.read();
-    const std::string rc_payload = format_rcinput(rc_values, timestamp);
-    logging::log(logging::Level::Debug, "RCInput payload: " + rc_payload);
-    publish_or_warn(main_const::rc_topic, rc_payload);
-
-    logging::log(logging::Level::Debug, "Sleeping for " + std::to_string(options.interval) + "s");
-    const unsigned int sleep_usecs = static_cast<unsigned int>(options.interval * 1000000.0);
-    usleep(sleep_usecs);
-  } while (!options.once);
-
-  logging::log(logging::Level::Info, "Main loop finished. Exiting.");
+  Acquisition acquisition(options, backend.get(), publisher);
+  if (!acquisition.init()) {
+    return EXIT_FAILURE;
+  }
+
+  if (options.once) {
+    logging::log(logging::Level::Info, "Taking a single snapshot");
+    acquisition.snapshot();
+    logging::log(logging::Level::Info, "Snapshot finished. Exiting.");
+    return EXIT_SUCCESS;
+  }
+
+  // Block the control signals before spawning workers so that only the main
+  // thread receives them through sigwait().
+  sigset_t signals = control_signals();
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  std::vector<std::unique_ptr<SensorWorker>> workers;
+  for (const PipelineTask &task : acquisition.tasks()) {
+    workers.push_back(std::make_unique<SensorWorker>(task.name, task.rate_hz, task.run));
+  }
+  const Pipeline pipeline = acquisition.pipeline(workers);
+
+  acquisition.start();
+  logging::log(logging::Level::Info, "Starting acquisition workers");
+  for (auto &worker : workers) {
+    worker->start();
+  }
+
+  // Reports go out on their own key and thread, next to the sensor data.
+  std::unique_ptr<metrics::MetricsReporter> reporter;
+  if (options.metrics_interval_s > 0) {
+    metrics::ReporterOptions reporter_options;
+    reporter_options.interval = std::chrono::seconds(options.metrics_interval_s);
+    reporter_options.key = main_const::metrics_topic;
+    reporter_options.file = options.metrics_file;
+    reporter = std::make_unique<metrics::MetricsReporter>(
+        publisher, reporter_options, [&](metrics::Exposition &out) {
+          collect_metrics(out, acquisition.reads(), pipeline);
+        });
+    reporter->start();
+  }
+
+  wait_for_termination(signals, pipeline);
+
+  if (reporter) {
+    reporter->stop();
+  }
+  for (auto &worker : workers) {
+    worker->stop();
+  }
+  acquisition.finish();
+  print_scheduler_stats(pipeline);
+
+  logging::log(logging::Level::Info, "Acquisition workers finished. Exiting.");
   return EXIT_SUCCESS;
 }
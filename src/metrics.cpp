@@ -0,0 +1,124 @@
+#include "metrics.h"
+
+#include "logging.h"
+#include "telemetry_publisher.h"
+
+#include <cstdio>
+#include <fstream>
+#include <utility>
+
+namespace metrics {
+
+namespace {
+
+constexpr std::pair<const char *, double> kQuantiles[] = {{"0.5", 50.0}, {"0.9", 90.0}, {"0.99", 99.0}};
+
+double seconds(std::uint64_t ns) { return static_cast<double>(ns) * 1e-9; }
+
+// A sample's label set; metrics without a label pass nullptr.
+std::string labels(const char *label, const std::string &value, const char *quantile = nullptr) {
+  if (!label && !quantile) {
+    return "";
+  }
+  std::string out = "{";
+  if (label) {
+    out += std::string(label) + "=\"" + value + "\"";
+  }
+  if (quantile) {
+    out += std::string(label ? "," : "") + "quantile=\"" + quantile + "\"";
+  }
+  return out + "}";
+}
+
+} // namespace
+
+void Exposition::family(const std::string &name, const char *type, const char *help) {
+  out_ << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+}
+
+void Exposition::sample(const std::string &name, const char *label, const std::string &label_value,
+                        double value) {
+  out_ << name << labels(label, label_value) << ' ' << value << '\n';
+}
+
+void Exposition::counter(const std::string &name, const char *label, const std::string &label_value,
+                         std::uint64_t value) {
+  out_ << name << labels(label, label_value) << ' ' << value << '\n';
+}
+
+void Exposition::summary(const std::string &name, const char *label, const std::string &label_value,
+                         DurationMetric &metric) {
+  const LatencyHistogram &window = metric.window();
+  for (const auto &[quantile, percent] : kQuantiles) {
+    out_ << name << labels(label, label_value, quantile) << ' ' << seconds(window.percentile(percent)) << '\n';
+  }
+  out_ << name << labels(label, label_value, "1") << ' ' << seconds(window.max()) << '\n';
+  out_ << name << "_sum" << labels(label, label_value) << ' ' << seconds(metric.sum_ns()) << '\n';
+  out_ << name << "_count" << labels(label, label_value) << ' ' << metric.count() << '\n';
+  metric.reset_window();
+}
+
+MetricsReporter::MetricsReporter(telemetry::TelemetryPublisher &publisher, ReporterOptions options,
+                                 Collect collect)
+    : publisher_(publisher), options_(std::move(options)), collect_(std::move(collect)) {}
+
+MetricsReporter::~MetricsReporter() { stop(); }
+
+void MetricsReporter::start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_) {
+    return;
+  }
+  running_ = true;
+  logging::log(logging::Level::Info, "Publishing metrics on ", options_.key, " every ", options_.interval.count(), " s");
+  thread_ = std::thread(&MetricsReporter::run, this);
+}
+
+void MetricsReporter::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  wake_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void MetricsReporter::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!wake_.wait_for(lock, options_.interval, [this] { return !running_; })) {
+    lock.unlock();
+    report();
+    lock.lock();
+  }
+}
+
+void MetricsReporter::report() {
+  Exposition exposition;
+  collect_(exposition);
+  const std::string text = exposition.str();
+  if (!publisher_.publish(options_.key, text)) {
+    logging::log(logging::Level::Warning, "Failed to publish metrics to ", options_.key);
+  }
+  if (options_.file.empty()) {
+    return;
+  }
+  const std::string temporary = options_.file + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::trunc);
+    file << text;
+    if (!file) {
+      logging::log(logging::Level::Warning, "Cannot write metrics file ", temporary);
+      return;
+    }
+  }
+  if (std::rename(temporary.c_str(), options_.file.c_str()) != 0) {
+    logging::log(logging::Level::Warning, "Cannot replace metrics file ", options_.file);
+  }
+}
+
+} // namespace metrics
@@ -0,0 +1,151 @@
+#include "pipeline.h"
+
+#include "adc_sensor.h"
+#include "flight_recorder.h"
+#include "gps_sensor.h"
+#include "imu_fifo.h"
+#include "imu_fusion.h"
+#include "imu_sensor.h"
+#include "telemetry_publisher.h"
+
+#include <iostream>
+
+void print_scheduler_stats(const Pipeline &pipeline) {
+  std::cout << "===== Scheduler statistics =====\n";
+  for (const auto &worker : pipeline.workers) {
+    std::cout << worker->name() << ": " << worker->scheduler().summary() << '\n';
+  }
+  for (const ImuSensor *imu : pipeline.imus) {
+    if (imu->fifo()) {
+      std::cout << imu->name() << " FIFO: " << imu->fifo()->summary() << '\n';
+    }
+  }
+  if (pipeline.fusion) {
+    std::cout << "IMU fusion: " << pipeline.fusion->summary() << '\n';
+  }
+  if (pipeline.gps) {
+    std::cout << "GPS UBX stream: " << pipeline.gps->parser().summary() << '\n';
+  }
+  std::cout << "ADC: " << pipeline.adc.summary() << '\n';
+  for (const ChangeStage &stage : pipeline.changes) {
+    if (stage.filter) {
+      std::cout << stage.sensor << " change filter: " << stage.filter->summary() << '\n';
+    }
+  }
+  std::cout << "===== Publish queue statistics =====\n";
+  for (const auto &channel : pipeline.queue.channels()) {
+    std::cout << channel->name() << ": " << channel->summary() << '\n';
+  }
+  if (pipeline.publisher.shared_memory_active()) {
+    std::cout << "Shared memory: published=" << pipeline.publisher.shared_memory_published()
+              << " fallbacks=" << pipeline.publisher.shared_memory_fallbacks() << '\n';
+  }
+  if (pipeline.recorder) {
+    std::cout << "Flight recorder: " << pipeline.recorder->summary() << '\n';
+  }
+  std::cout << std::flush;
+}
+
+void collect_metrics(metrics::Exposition &out, std::span<ReadMetric> reads, const Pipeline &pipeline) {
+  const auto &[workers, queue, publisher, imus, recorder, fusion, changes, gps, adc] = pipeline;
+  out.family("sensors_read_read_duration_seconds", "summary", "Time spent reading a sensor");
+  for (ReadMetric &read : reads) {
+    out.summary("sensors_read_read_duration_seconds", "sensor", read.sensor, read.duration);
+  }
+  out.family("sensors_read_serialize_duration_seconds", "summary", "Time spent serializing a sample");
+  for (const auto &channel : queue.channels()) {
+    out.summary("sensors_read_serialize_duration_seconds", "channel", channel->name(), channel->serialize_duration());
+  }
+  out.family("sensors_read_publish_duration_seconds", "summary", "Time spent in the Zenoh put of a sample");
+  for (const auto &channel : queue.channels()) {
+    out.summary("sensors_read_publish_duration_seconds", "channel", channel->name(), channel->publish_duration());
+  }
+  out.family("sensors_read_published_total", "counter", "Samples published");
+  for (const auto &channel : queue.channels()) {
+    out.counter("sensors_read_published_total", "channel", channel->name(), channel->published());
+  }
+  out.family("sensors_read_publish_failed_total", "counter", "Samples the publisher failed to send");
+  for (const auto &channel : queue.channels()) {
+    out.counter("sensors_read_publish_failed_total", "channel", channel->name(), channel->failed());
+  }
+  if (publisher.shared_memory_active()) {
+    out.family("sensors_read_shm_published_total", "counter", "Samples sent from a shared-memory buffer");
+    out.counter("sensors_read_shm_published_total", nullptr, "", publisher.shared_memory_published());
+    out.family("sensors_read_shm_fallbacks_total", "counter",
+               "Samples published the regular way because the shared-memory pool was exhausted");
+    out.counter("sensors_read_shm_fallbacks_total", nullptr, "", publisher.shared_memory_fallbacks());
+  }
+  out.family("sensors_read_queue_dropped_total", "counter", "Samples dropped by a full publish queue");
+  for (const auto &channel : queue.channels()) {
+    out.counter("sensors_read_queue_dropped_total", "channel", channel->name(), channel->dropped());
+  }
+  out.family("sensors_read_queue_depth", "gauge", "Samples waiting in the publish queue");
+  for (const auto &channel : queue.channels()) {
+    out.sample("sensors_read_queue_depth", "channel", channel->name(), static_cast<double>(channel->queued()));
+  }
+  out.family("sensors_read_cycles_total", "counter", "Acquisition cycles run");
+  for (const auto &worker : workers) {
+    out.counter("sensors_read_cycles_total", "worker", worker->name(), worker->scheduler().cycles());
+  }
+  out.family("sensors_read_overruns_total", "counter", "Acquisition cycles that missed their deadline");
+  for (const auto &worker : workers) {
+    out.counter("sensors_read_overruns_total", "worker", worker->name(), worker->scheduler().overruns());
+  }
+  out.family("sensors_read_skipped_slots_total", "counter", "Acquisition slots skipped after an overrun");
+  for (const auto &worker : workers) {
+    out.counter("sensors_read_skipped_slots_total", "worker", worker->name(), worker->scheduler().skipped_slots());
+  }
+  out.family("sensors_read_fifo_overflows_total", "counter", "IMU FIFO overflows");
+  for (const ImuSensor *imu : imus) {
+    if (imu->fifo()) {
+      out.counter("sensors_read_fifo_overflows_total", "sensor", imu->name(), imu->fifo()->overflows());
+    }
+  }
+  if (recorder) {
+    out.family("sensors_read_recorder_records_total", "counter", "Samples written to the flight log");
+    out.counter("sensors_read_recorder_records_total", nullptr, "", recorder->records());
+    out.family("sensors_read_recorder_failed_total", "counter", "Samples the flight recorder could not write");
+    out.counter("sensors_read_recorder_failed_total", nullptr, "", recorder->failed());
+  }
+  if (gps) {
+    out.family("sensors_read_ubx_frames_total", "counter", "UBX frames received from the GPS");
+    out.counter("sensors_read_ubx_frames_total", nullptr, "", gps->parser().frames());
+    out.family("sensors_read_ubx_rejected_total", "counter", "UBX frames dropped as corrupt");
+    out.counter("sensors_read_ubx_rejected_total", "reason", "checksum", gps->parser().checksum_errors());
+    out.counter("sensors_read_ubx_rejected_total", "reason", "oversized", gps->parser().oversized());
+  }
+  out.family("sensors_read_adc_read_failed_total", "counter", "ADC channel reads that failed");
+  for (std::size_t idx = 0; idx < adc.channel_count(); ++idx) {
+    if ((adc.channel_mask() >> idx) & 1u) {
+      out.counter("sensors_read_adc_read_failed_total", "channel", "a" + std::to_string(idx), adc.failures(idx));
+    }
+  }
+  // With --heartbeat every slow sensor has a change filter.
+  if (!changes.empty() && changes.front().filter) {
+    out.family("sensors_read_change_suppressed_total", "counter", "Samples not published because nothing changed");
+    for (const ChangeStage &stage : changes) {
+      out.counter("sensors_read_change_suppressed_total", "sensor", stage.sensor, stage.filter->suppressed());
+    }
+  }
+  if (fusion) {
+    out.family("sensors_read_fused_total", "counter", "Fused IMU samples produced");
+    out.counter("sensors_read_fused_total", nullptr, "", fusion->fused());
+    out.family("sensors_read_fusion_healthy", "gauge", "1 while the IMU contributes to the fused stream");
+    for (std::size_t idx = 0; idx < imus.size(); ++idx) {
+      out.sample("sensors_read_fusion_healthy", "sensor", imus[idx]->name(),
+                 fusion->health(idx) == ImuFusion::Health::Healthy ? 1.0 : 0.0);
+    }
+    out.family("sensors_read_fusion_stuck_total", "counter", "Times the IMU was excluded as stuck");
+    for (std::size_t idx = 0; idx < imus.size(); ++idx) {
+      out.counter("sensors_read_fusion_stuck_total", "sensor", imus[idx]->name(), fusion->stuck_events(idx));
+    }
+    out.family("sensors_read_fusion_outlier_total", "counter", "Times the IMU was excluded as an outlier");
+    for (std::size_t idx = 0; idx < imus.size(); ++idx) {
+      out.counter("sensors_read_fusion_outlier_total", "sensor", imus[idx]->name(), fusion->outlier_events(idx));
+    }
+    out.family("sensors_read_fusion_stale_total", "counter", "Times the IMU was excluded as stale");
+    for (std::size_t idx = 0; idx < imus.size(); ++idx) {
+      out.counter("sensors_read_fusion_stale_total", "sensor", imus[idx]->name(), fusion->stale_events(idx));
+    }
+  }
+}
@@ -0,0 +1,143 @@
+#include "pipeline_options.h"
+
+#include "adc_sensor.h"
+#include "decimator.h"
+#include "imu_fusion.h"
+#include "logging.h"
+#include "main.h"
+#include "telemetry_publisher.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+const std::string *batch_topic(const std::string &name) {
+  static const std::string *const kTopics[] = {
+      &main_const::imu_topic, &main_const::adc_topic, &main_const::barometer_topic,
+      &main_const::gps_topic, &main_const::rc_topic, &main_const::attitude_topic,
+      &main_const::imu_fused_topic};
+  for (const std::string *topic : kTopics) {
+    if (*topic == main_const::base_topic + "/" + name) {
+      return topic;
+    }
+  }
+  return nullptr;
+}
+
+bool configure_batching(const utils::ProgramOptions &options, telemetry::TelemetryPublisher &publisher) {
+  for (const auto &batch : options.batches) {
+    const std::string *topic = batch_topic(batch.topic);
+    if (!topic) {
+      logging::log(logging::Level::Critical, "Unknown --batch topic ", batch.topic);
+      return false;
+    }
+    telemetry::BatchPolicy policy;
+    policy.max_samples = batch.max_samples;
+    policy.max_latency = std::chrono::milliseconds(batch.max_latency_ms);
+    publisher.set_batch_policy(*topic, policy);
+  }
+  return true;
+}
+
+bool configure_adc_sampling(const utils::ProgramOptions &options, AdcSensor &adc) {
+  adc.set_channel_mask(options.adc_channels);
+  if (options.adc_samples.empty()) {
+    return true;
+  }
+  std::array<bool, kAdcMaxChannels> configured{};
+  for (const auto &sample : options.adc_samples) {
+    if (((options.adc_channels >> sample.channel) & 1u) == 0) {
+      logging::log(logging::Level::Critical, "--adc-sample channel ", sample.channel, " is not in --adc-channels");
+      return false;
+    }
+    adc.set_sampling(sample.channel, {sample.rate_hz, sample.oversample, sample.median});
+    configured[sample.channel] = true;
+  }
+  for (std::size_t idx = 0; idx < kAdcMaxChannels; ++idx) {
+    if (((options.adc_channels >> idx) & 1u) != 0 && !configured[idx]) {
+      adc.set_sampling(idx, {utils::sensor_rate(options.adc_rate, options), 1, false});
+    }
+  }
+  for (const auto &sample : options.adc_samples) {
+    logging::log(logging::Level::Info, "Sampling ADC channel ", sample.channel, " at ", adc.channel_rate_hz(sample.channel),
+                 " Hz, ", (sample.median ? "median" : "mean"), " of ", sample.oversample);
+  }
+  return true;
+}
+
+bool configure_imu_rotations(const utils::ProgramOptions &options, ImuFusion &fusion) {
+  for (const auto &rotation_option : options.imu_rotations) {
+    AxisRotation rotation;
+    const std::size_t device = rotation_option.device == "MPU9250" ? 0 : rotation_option.device == "LSM9DS1" ? 1 : 2;
+    if (device == 2 || !axis_rotation(rotation_option.rotation, rotation)) {
+      logging::log(logging::Level::Critical, "Unknown --imu-rotation ", rotation_option.device, "=", rotation_option.rotation);
+      return false;
+    }
+    fusion.set_rotation(device, rotation);
+  }
+  return true;
+}
+
+bool plan_decimation(const std::string &topic, double input_rate_hz, std::vector<double> &rates_hz) {
+  std::sort(rates_hz.begin(), rates_hz.end(), std::greater<>());
+  rates_hz.erase(std::unique(rates_hz.begin(), rates_hz.end()), rates_hz.end());
+  double from_hz = input_rate_hz;
+  for (double rate_hz : rates_hz) {
+    if (decimation_factor(from_hz, rate_hz) == 0) {
+      logging::log(logging::Level::Critical, "--decimate rate ", rate_hz, " Hz for ", topic,
+                   " is not an integer fraction of ", from_hz, " Hz");
+      return false;
+    }
+    from_hz = rate_hz;
+  }
+  return true;
+}
+
+bool decimation_rates(const utils::ProgramOptions &options, std::vector<double> &imu_rates_hz,
+                      std::vector<double> &adc_rates_hz) {
+  imu_rates_hz.clear();
+  adc_rates_hz.clear();
+  for (const auto &decimate : options.decimations) {
+    std::vector<double> *rates = decimate.topic == "imu"   ? &imu_rates_hz
+                                 : decimate.topic == "adc" ? &adc_rates_hz
+                                                           : nullptr;
+    if (!rates) {
+      logging::log(logging::Level::Critical, "Unknown --decimate topic ", decimate.topic);
+      return false;
+    }
+    rates->insert(rates->end(), decimate.rates_hz.begin(), decimate.rates_hz.end());
+  }
+  if (options.once) {
+    imu_rates_hz.clear();
+    adc_rates_hz.clear();
+  }
+  std::sort(imu_rates_hz.begin(), imu_rates_hz.end(), std::greater<>());
+  imu_rates_hz.erase(std::unique(imu_rates_hz.begin(), imu_rates_hz.end()), imu_rates_hz.end());
+  return plan_decimation("adc", utils::sensor_rate(options.adc_rate, options), adc_rates_hz);
+}
+
+bool configure_change_filters(const utils::ProgramOptions &options, std::span<ChangeStage> stages) {
+  if (options.heartbeat_s > 0.0) {
+    const auto heartbeat_ns = static_cast<std::int64_t>(options.heartbeat_s * 1e9);
+    for (ChangeStage &stage : stages) {
+      stage.filter = std::make_unique<ChangeFilter>(stage.fields, heartbeat_ns);
+    }
+  } else if (!options.deadbands.empty()) {
+    logging::log(logging::Level::Warning, "--deadband has no effect without --heartbeat");
+  }
+  for (const auto &deadband : options.deadbands) {
+    auto stage = std::find_if(stages.begin(), stages.end(),
+                              [&](const ChangeStage &candidate) { return deadband.topic == candidate.topic; });
+    if (stage == stages.end()) {
+      logging::log(logging::Level::Critical, "Unknown --deadband topic ", deadband.topic);
+      return false;
+    }
+    if (stage->filter && !stage->filter->set_deadband(deadband.field, deadband.deadband)) {
+      logging::log(logging::Level::Critical, "Unknown --deadband field ", deadband.topic, ".", deadband.field);
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,189 @@
+#include "publish_queue.h"
+
+#include "logging.h"
+#include "telemetry_codec.h"
+#include "text_writer.h"
+
+#include <cstring>
+#include <sstream>
+#include <utility>
+
+namespace telemetry {
+
+PublishChannel::PublishChannel(std::string name, std::string key, std::size_t depth,
+                               OverflowPolicy policy, std::atomic<std::uint32_t> &pending,
+                               std::uint32_t &sequence)
+    : name_(std::move(name)), key_(std::move(key)), ring_(depth, policy), pending_(pending),
+      sequence_(sequence) {}
+
+bool PublishChannel::push_with(PayloadWriter write) {
+  const bool queued = ring_.push_with([this, &write](QueuedPayload &slot) {
+    const std::size_t size =
+        metrics::timed(serialize_duration_, [&] { return write(std::span<std::uint8_t>(slot.bytes)); });
+    slot.size = static_cast<std::uint32_t>(size);
+    slot.monotonic_ns = metrics::monotonic_ns();
+    return size > 0;
+  });
+  if (!queued) {
+    return false;
+  }
+  // Wakes the publisher thread; never blocks the caller.
+  pending_.fetch_add(1, std::memory_order_release);
+  pending_.notify_one();
+  return true;
+}
+
+const std::string &PublishChannel::name() const { return name_; }
+
+const std::string &PublishChannel::key() const { return key_; }
+
+std::uint64_t PublishChannel::published() const {
+  return published_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t PublishChannel::failed() const {
+  return failed_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t PublishChannel::dropped() const { return ring_.dropped(); }
+
+std::size_t PublishChannel::queued() const { return ring_.size(); }
+
+metrics::DurationMetric &PublishChannel::serialize_duration() { return serialize_duration_; }
+
+metrics::DurationMetric &PublishChannel::publish_duration() { return publish_duration_; }
+
+std::string PublishChannel::summary() const {
+  std::ostringstream out;
+  out << "depth=" << ring_.capacity()
+      << " policy=" << (ring_.policy() == OverflowPolicy::DropOldest ? "drop-oldest" : "drop-newest")
+      << " queued=" << ring_.size() << " published=" << published()
+      << " dropped=" << dropped() << " failed=" << failed();
+  return out.str();
+}
+
+PublishQueue::PublishQueue(PayloadSink &publisher, std::size_t depth,
+                           OverflowPolicy policy)
+    : publisher_(publisher), depth_(depth), policy_(policy) {}
+
+PublishQueue::~PublishQueue() { stop(); }
+
+PublishChannel &PublishQueue::add_channel(std::string name, std::string key) {
+  std::uint32_t &sequence = sequences_[key];
+  channels_.push_back(std::make_unique<PublishChannel>(std::move(name), std::move(key),
+                                                       depth_, policy_, pending_, sequence));
+  return *channels_.back();
+}
+
+const std::vector<std::unique_ptr<PublishChannel>> &PublishQueue::channels() const {
+  return channels_;
+}
+
+void PublishQueue::set_recorder(FlightRecorder *recorder) { recorder_ = recorder; }
+
+void PublishQueue::start() {
+  if (running_.exchange(true)) {
+    return;
+  }
+  logging::log(logging::Level::Info, "Starting publisher thread for ", channels_.size(), " channels");
+  thread_ = std::thread(&PublishQueue::run, this);
+}
+
+void PublishQueue::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  pending_.fetch_add(1, std::memory_order_release);
+  pending_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  logging::log(logging::Level::Info, "Stopped publisher thread");
+}
+
+void PublishQueue::run() {
+  while (true) {
+    const std::uint32_t seen = pending_.load(std::memory_order_acquire);
+    const bool published = drain();
+    if (!running_.load(std::memory_order_acquire)) {
+      while (drain()) {
+      }
+      return;
+    }
+    if (!published) {
+      pending_.wait(seen, std::memory_order_acquire);
+    }
+  }
+}
+
+// Publishes at most one ring's worth from each channel so that a busy
+// producer cannot starve the others. Returns true if anything was published.
+bool PublishQueue::drain() {
+  bool any = false;
+  QueuedPayload sample;
+  for (std::size_t idx = 0; idx < channels_.size(); ++idx) {
+    auto &channel = channels_[idx];
+    // Numbers for the samples the ring dropped since the last drain, so that
+    // subscribers see them as a gap; under DropOldest they are older than
+    // the samples still queued.
+    const std::uint64_t dropped = channel->ring_.dropped();
+    channel->sequence_ += static_cast<std::uint32_t>(dropped - channel->numbered_drops_);
+    channel->numbered_drops_ = dropped;
+    for (std::size_t count = 0; count < channel->ring_.capacity() && channel->ring_.pop(sample); ++count) {
+      any = true;
+      stamp_sequence(sample, channel->sequence_++);
+      stamp_sent_time(sample);
+      // Recorded first so that a failing network never costs the local copy.
+      if (recorder_) {
+        recorder_->append(static_cast<std::uint16_t>(idx + 1), sample.monotonic_ns,
+                          std::span<const std::uint8_t>(sample.bytes.data(), sample.size));
+      }
+      auto copy = [&sample](std::span<std::uint8_t> out) -> std::size_t {
+        std::memcpy(out.data(), sample.bytes.data(), sample.size);
+        return sample.size;
+      };
+      const bool published = metrics::timed(channel->publish_duration_, [&] {
+        return publisher_.publish_with(channel->key_, sample.size, copy);
+      });
+      if (published) {
+        channel->published_.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        channel->failed_.fetch_add(1, std::memory_order_relaxed);
+        logging::log(logging::Level::Warning, "Failed to publish to ", channel->key_);
+      }
+    }
+  }
+  return any;
+}
+
+void PublishQueue::stamp_sequence(QueuedPayload &sample, std::uint32_t sequence) {
+  const std::span<std::uint8_t> bytes(sample.bytes.data(), sample.size);
+  if (codec::is_binary(bytes)) {
+    codec::stamp_sequence(bytes, sequence);
+    return;
+  }
+  // A text payload that fills its slot goes out unstamped.
+  TextWriter writer(std::span<char>(reinterpret_cast<char *>(sample.bytes.data()) + sample.size,
+                                    sample.bytes.size() - sample.size));
+  writer << " seq=" << sequence;
+  if (writer.ok()) {
+    sample.size += static_cast<std::uint32_t>(writer.size());
+  }
+}
+
+void PublishQueue::stamp_sent_time(QueuedPayload &sample) {
+  const std::span<std::uint8_t> bytes(sample.bytes.data(), sample.size);
+  const std::int64_t sent_ns = realtime_ns();
+  if (codec::is_binary(bytes)) {
+    codec::stamp_sent_time(bytes, sent_ns);
+    return;
+  }
+  TextWriter writer(std::span<char>(reinterpret_cast<char *>(sample.bytes.data()) + sample.size,
+                                    sample.bytes.size() - sample.size));
+  writer << " sent_ns=" << sent_ns;
+  if (writer.ok()) {
+    sample.size += static_cast<std::uint32_t>(writer.size());
+  }
+}
+
+} // namespace telemetry
@@ -0,0 +1,16 @@
+#include "rcinput_pipeline.h"
+
+RcInputPipeline::RcInputPipeline(RcInputSensor &sensor, telemetry::PublishChannel &channel, bool binary,
+                                 metrics::DurationMetric &read_duration, ChangeStage &change)
+    : sensor_(sensor), channel_(channel), binary_(binary), read_duration_(read_duration), change_(change) {}
+
+void RcInputPipeline::read() {
+  const RcInputReading reading = metrics::timed(read_duration_, [&] { return sensor_.read(); });
+  if (reading.stale || !changed(change_, reading)) {
+    return;
+  }
+  publish_reading(
+      channel_, "RCInput", binary_,
+      [&](std::span<char> out) { return format_rcinput(out, reading); },
+      [&](std::span<std::uint8_t> out) { return encode_rcinput(reading, out); });
+}
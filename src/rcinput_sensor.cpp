@@ -1,13 +1,16 @@
 #include "rcinput_sensor.h"
 
 #include "logging.h"
+#include "sensor_backend.h"
+#include "telemetry_codec.h"
+#include "text_writer.h"
 
 #include <Common/Util.h>
 #include <Navio2/RCInput_Navio2.h>
 
+#include <algorithm>
 #include <array>
 #include <cmath>
-#include <sstream>
 
 namespace {
 constexpr int kReadFailed = -1;
@@ -41,20 +44,23 @@ int normalize_pwm(int raw_value) {
   return static_cast<int>(std::lround(normalized));
 }
 
-int normalized_axis_value(const std::vector<int> &values, std::size_t channel) {
-  if (channel >= values.size()) {
-    logging::log(logging::Level::Warning,
-                 "RCInput channel " + std::to_string(channel) + " not available for normalization");
+int normalized_axis_value(const RcInputReading &reading, std::size_t channel) {
+  if (channel >= reading.count) {
+    logging::log(logging::Level::Warning, "RCInput channel ", channel, " not available for normalization");
     return 0;
   }
-  return normalize_pwm(values[channel]);
+  return normalize_pwm(reading.values[channel]);
 }
 } // namespace
 
 #include "logging.h"
 
-RcInputSensor::RcInputSensor(int channels)
-    : channels_(channels > 0 ? channels : 0) {
+RcInputSensor::RcInputSensor(int channels, SensorBackend *backend)
+    : channels_(channels > 0 ? channels : 0), backend_(backend) {
+  if (backend_) {
+    logging::log(logging::Level::Info, "RCInput sensor reads from the ", backend_->name(), " backend");
+    return;
+  }
   logging::log(logging::Level::Info, "Initializing RCInput sensor");
   rc_ = std::unique_ptr<RCInput>(new RCInput_Navio2());
 
@@ -70,38 +76,61 @@ RcInputSensor::~RcInputSensor() {
   logging::log(logging::Level::Info, "Closing RCInput sensor");
 }
 
-bool RcInputSensor::available() const { return rc_ && channels_ > 0; }
+bool RcInputSensor::available() const { return (backend_ || rc_) && channels_ > 0; }
 
-std::vector<int> RcInputSensor::read() {
+RcInputReading RcInputSensor::read() {
   logging::log(logging::Level::Debug, "Reading RCInput sensor");
-  std::vector<int> values;
+  RcInputReading reading;
   if (!available()) {
     logging::log(logging::Level::Warning, "RCInput sensor not available");
-    return values;
+    return reading;
+  }
+  if (backend_) {
+    if (!backend_->read_rcinput(reading)) {
+      return RcInputReading{};
+    }
+    reading.count = std::min(reading.count, static_cast<std::size_t>(channels_));
+    return reading;
   }
-  values.reserve(channels_);
-  for (int idx = 0; idx < channels_; ++idx) {
-    int value = rc_->read(idx);
+  reading.time = SampleTime::now();
+  reading.count = static_cast<std::size_t>(channels_) < kRcMaxChannels ? static_cast<std::size_t>(channels_) : kRcMaxChannels;
+  for (std::size_t idx = 0; idx < reading.count; ++idx) {
+    int value = rc_->read(static_cast<int>(idx));
     if (value == kReadFailed || value <= 0) {
-      logging::log(logging::Level::Warning, "Failed to read RCInput channel " + std::to_string(idx));
-      values.push_back(-1);
+      logging::log(logging::Level::Warning, "Failed to read RCInput channel ", idx);
+      reading.values[idx] = -1;
     } else {
-      logging::log(logging::Level::Debug, "RCInput channel " + std::to_string(idx) + ": " + std::to_string(value));
-      values.push_back(value);
+      logging::log(logging::Level::Debug, "RCInput channel ", idx, ": ", value);
+      reading.values[idx] = value;
     }
   }
-  return values;
+  return reading;
 }
 
-std::string format_rcinput(const std::vector<int> &values, const std::string &timestamp) {
-  if (values.empty()) {
-    return "RC Input: unavailable";
+std::size_t format_rcinput(std::span<char> out, const RcInputReading &reading) {
+  TextWriter writer(out);
+  if (reading.count == 0) {
+    writer << "RC Input: unavailable";
+    return writer.size();
   }
-  std::ostringstream out;
-  out << "timestamp=" << timestamp;
+  writer << reading.time;
   for (const auto &axis : kAxes) {
-    const int normalized_value = normalized_axis_value(values, axis.channel);
-    out << " " << axis.name << "=" << normalized_value;
+    const int normalized_value = normalized_axis_value(reading, axis.channel);
+    writer << " " << axis.name << "=" << normalized_value;
+  }
+  return writer.size();
+}
+
+// The binary record carries the same normalised axes as the text payload, in
+// kAxes order. An empty record marks the sensor as unavailable.
+std::size_t encode_rcinput(const RcInputReading &reading, std::span<std::uint8_t> out) {
+  codec::RcInputRecord record;
+  record.time = reading.time;
+  if (reading.count > 0) {
+    record.count = static_cast<std::uint8_t>(kAxes.size());
+    for (std::size_t idx = 0; idx < kAxes.size(); ++idx) {
+      record.axes[idx] = static_cast<std::uint8_t>(normalized_axis_value(reading, kAxes[idx].channel));
+    }
   }
-  return out.str();
+  return codec::encode(record, out);
 }
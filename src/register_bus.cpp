@@ -0,0 +1,40 @@
+#include "register_bus.h"
+
+#include "logging.h"
+
+#include <Common/SPIdev.h>
+
+#include <algorithm>
+#include <utility>
+
+SpiRegisterBus::SpiRegisterBus(std::string device, unsigned int speed_hz,
+                               std::uint8_t read_flag, std::size_t max_read)
+    : device_(std::move(device)), speed_hz_(speed_hz), read_flag_(read_flag),
+      tx_(max_read + 1), rx_(max_read + 1) {}
+
+bool SpiRegisterBus::read(std::uint8_t reg, std::span<std::uint8_t> out) {
+  const std::size_t length = out.size() + 1;
+  if (length > tx_.size()) {
+    logging::log(logging::Level::Error, "SPI read of ", out.size(), " bytes exceeds buffer on ", device_);
+    return false;
+  }
+  tx_[0] = static_cast<unsigned char>(reg | read_flag_);
+  std::fill(tx_.begin() + 1, tx_.begin() + static_cast<std::ptrdiff_t>(length), 0);
+  if (SPIdev::transfer(device_.c_str(), tx_.data(), rx_.data(),
+                       static_cast<unsigned int>(length), speed_hz_) < 0) {
+    logging::log(logging::Level::Warning, "SPI transfer failed on ", device_);
+    return false;
+  }
+  std::copy(rx_.begin() + 1, rx_.begin() + static_cast<std::ptrdiff_t>(length), out.begin());
+  return true;
+}
+
+bool SpiRegisterBus::write(std::uint8_t reg, std::uint8_t value) {
+  unsigned char tx[2] = {static_cast<unsigned char>(reg & 0x7F), value};
+  unsigned char rx[2] = {0, 0};
+  if (SPIdev::transfer(device_.c_str(), tx, rx, 2, speed_hz_) < 0) {
+    logging::log(logging::Level::Warning, "SPI transfer failed on ", device_);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,328 @@
+#include "sensor_backend.h"
+
+#include "logging.h"
+#include "telemetry_codec.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace {
+
+constexpr double kPwmMin = 1000.0;
+constexpr double kPwmRange = 1000.0;
+
+// One sensor's recorded readings, ordered by their offset from the start of
+// the capture.
+template <typename Reading>
+class ReplayStream {
+public:
+  struct Item {
+    std::int64_t offset_ns;
+    Reading reading;
+  };
+
+  void add(std::int64_t offset_ns, const Reading &reading) { items_.push_back({offset_ns, reading}); }
+
+  void sort() {
+    std::stable_sort(items_.begin(), items_.end(),
+                     [](const Item &lhs, const Item &rhs) { return lhs.offset_ns < rhs.offset_ns; });
+  }
+
+  std::size_t size() const { return items_.size(); }
+
+  // Hands out the next reading due elapsed_ns into the replay, each one
+  // exactly once and in capture order, and sets pass to the pass through the
+  // capture it belongs to. A worker polled slower than the capture catches up
+  // over the following calls; one that falls more than a whole pass behind
+  // skips those passes. Returns nullptr while nothing new is due.
+  const Item *next(std::int64_t elapsed_ns, std::int64_t pass_ns, std::int64_t &pass) {
+    if (items_.empty()) {
+      return nullptr;
+    }
+    const std::int64_t behind_ns = elapsed_ns - (pass_ * pass_ns + items_[next_].offset_ns);
+    if (behind_ns < 0) {
+      return nullptr;
+    }
+    if (behind_ns >= pass_ns) {
+      const std::int64_t skipped = behind_ns / pass_ns;
+      pass_ += skipped;
+      logging::log(logging::Level::Warning, "Replay fell behind, skipping ",
+                   static_cast<std::uint64_t>(skipped) * items_.size(), " readings");
+    }
+    pass = pass_;
+    const Item *item = &items_[next_];
+    if (++next_ == items_.size()) {
+      next_ = 0;
+      ++pass_;
+    }
+    return item;
+  }
+
+private:
+  std::vector<Item> items_;
+  std::size_t next_ = 0;
+  std::int64_t pass_ = 0;
+};
+
+class ReplayBackend : public SensorBackend {
+public:
+  bool load(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      logging::log(logging::Level::Error, "Cannot open replay file ", path);
+      return false;
+    }
+    const std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::span<const std::uint8_t> rest(bytes);
+
+    // Unframe every record first: the earliest acquisition time in the file
+    // becomes replay offset zero.
+    std::vector<std::span<const std::uint8_t>> records;
+    while (rest.size() >= 2) {
+      const std::size_t length = static_cast<std::size_t>(rest[0] | (rest[1] << 8));
+      if (rest.size() < 2 + length) {
+        logging::log(logging::Level::Warning, "Replay file ", path, " ends with a truncated record");
+        break;
+      }
+      collect(rest.subspan(2, length), records);
+      rest = rest.subspan(2 + length);
+    }
+    first_ns_ = std::numeric_limits<std::int64_t>::max();
+    std::int64_t last_ns = std::numeric_limits<std::int64_t>::min();
+    for (const auto &record : records) {
+      codec::RecordHeader header;
+      codec::peek_header(record, header);
+      first_ns_ = std::min(first_ns_, header.time.unix_ns());
+      last_ns = std::max(last_ns, last_unix_ns(record, header));
+    }
+    for (const auto &record : records) {
+      add(record);
+    }
+    const std::size_t total = mpu_.size() + lsm_.size() + adc_.size() + barometer_.size() + gps_.size() + rc_.size();
+    if (total == 0) {
+      logging::log(logging::Level::Error, "Replay file ", path, " holds no sensor records");
+      return false;
+    }
+    mpu_.sort();
+    lsm_.sort();
+    adc_.sort();
+    barometer_.sort();
+    gps_.sort();
+    rc_.sort();
+    // One extra millisecond keeps the last and first records of consecutive
+    // passes apart.
+    pass_ns_ = last_ns - first_ns_ + 1000000;
+    start_ = SampleTime::now();
+    logging::log(logging::Level::Info, "Replaying ", total, " records (", static_cast<double>(pass_ns_) * 1e-9, " s) from ", path);
+    return true;
+  }
+
+  const char *name() const override { return "replay"; }
+
+  bool read_imu(ImuType type, ImuReading &out) override {
+    return replay_stale(type == ImuType::Mpu9250 ? mpu_ : lsm_, out);
+  }
+  bool read_adc(AdcReading &out) override { return replay_stale(adc_, out); }
+  bool read_barometer(BarometerReading &out) override { return replay(barometer_, out); }
+  bool read_gps(GpsReading &out) override { return replay(gps_, out); }
+  bool read_rcinput(RcInputReading &out) override { return replay_stale(rc_, out); }
+
+private:
+  // Valid records, with batches unpacked into their binary samples.
+  static void collect(std::span<const std::uint8_t> record, std::vector<std::span<const std::uint8_t>> &out) {
+    codec::RecordHeader header;
+    if (!codec::is_binary(record) || !codec::peek_header(record, header)) {
+      return;
+    }
+    if (header.type != codec::RecordType::Batch) {
+      out.push_back(record);
+      return;
+    }
+    codec::BatchReader batch(record);
+    std::int64_t timestamp_ns = 0;
+    std::span<const std::uint8_t> sample;
+    while (batch.next(timestamp_ns, sample)) {
+      collect(sample, out);
+    }
+  }
+
+  // Acquisition time of the record's last sample.
+  static std::int64_t last_unix_ns(std::span<const std::uint8_t> record, const codec::RecordHeader &header) {
+    if (header.type != codec::RecordType::ImuWindow) {
+      return header.time.unix_ns();
+    }
+    codec::ImuWindowReader window(record);
+    codec::ImuRecord sample;
+    std::int64_t last_ns = header.time.unix_ns();
+    while (window.next(sample)) {
+      last_ns = sample.time.unix_ns();
+    }
+    return last_ns;
+  }
+
+  void add_imu(std::int64_t offset_ns, const codec::ImuRecord &record) {
+    if (record.device == codec::ImuDevice::Unknown) {
+      return;
+    }
+    ImuReading reading;
+    reading.valid = record.valid;
+    reading.ax = record.ax;
+    reading.ay = record.ay;
+    reading.az = record.az;
+    reading.gx_rad = record.gx;
+    reading.gy_rad = record.gy;
+    reading.gz_rad = record.gz;
+    reading.mx = record.mx;
+    reading.my = record.my;
+    reading.mz = record.mz;
+    (record.device == codec::ImuDevice::Mpu9250 ? mpu_ : lsm_).add(offset_ns, reading);
+  }
+
+  void add(std::span<const std::uint8_t> payload) {
+    codec::RecordHeader header;
+    codec::peek_header(payload, header);
+    const std::int64_t offset_ns = header.time.unix_ns() - first_ns_;
+    switch (header.type) {
+    case codec::RecordType::Imu: {
+      codec::ImuRecord record;
+      if (codec::decode(payload, record)) {
+        add_imu(offset_ns, record);
+      }
+      break;
+    }
+    case codec::RecordType::ImuWindow: {
+      codec::ImuWindowReader window(payload);
+      codec::ImuRecord record;
+      while (window.next(record)) {
+        add_imu(record.time.unix_ns() - first_ns_, record);
+      }
+      break;
+    }
+    case codec::RecordType::Adc: {
+      codec::AdcRecord record;
+      if (!codec::decode(payload, record)) {
+        return;
+      }
+      AdcReading reading;
+      reading.count = std::min<std::size_t>(record.count, kAdcMaxChannels);
+      for (std::size_t idx = 0; idx < reading.count; ++idx) {
+        reading.values[idx] = record.values[idx];
+      }
+      adc_.add(offset_ns, reading);
+      break;
+    }
+    case codec::RecordType::Barometer: {
+      codec::BarometerRecord record;
+      if (!codec::decode(payload, record)) {
+        return;
+      }
+      BarometerReading reading;
+      reading.valid = record.valid;
+      reading.temperature_c = record.temperature_c;
+      reading.pressure_mbar = record.pressure_mbar;
+      barometer_.add(offset_ns, reading);
+      break;
+    }
+    case codec::RecordType::Gps: {
+      codec::GpsRecord record;
+      if (!codec::decode(payload, record)) {
+        return;
+      }
+      GpsReading reading;
+      reading.has_position = record.has_position;
+      reading.has_status = record.has_status;
+      reading.fix_ok = record.fix_ok;
+      reading.fix_type = record.fix_type;
+      reading.latitude_deg = record.latitude_deg;
+      reading.longitude_deg = record.longitude_deg;
+      reading.height_m = record.height_m;
+      reading.hmsl_m = record.hmsl_m;
+      reading.horizontal_accuracy_m = record.horizontal_accuracy_m;
+      reading.vertical_accuracy_m = record.vertical_accuracy_m;
+      if (record.has_velocity) {
+        reading.has_velocity = true;
+        reading.velocity_north_mps = record.velocity_north_mps;
+        reading.velocity_east_mps = record.velocity_east_mps;
+        reading.velocity_down_mps = record.velocity_down_mps;
+        reading.ground_speed_mps = record.ground_speed_mps;
+        reading.heading_deg = record.heading_deg;
+        reading.speed_accuracy_mps = record.speed_accuracy_mps;
+      }
+      gps_.add(offset_ns, reading);
+      break;
+    }
+    case codec::RecordType::RcInput: {
+      codec::RcInputRecord record;
+      if (!codec::decode(payload, record)) {
+        return;
+      }
+      // Records hold the normalised roll/pitch/throttle/yaw axes, which map
+      // back onto pulse widths of the first channels.
+      RcInputReading reading;
+      reading.count = std::min<std::size_t>(record.count, kRcMaxChannels);
+      for (std::size_t idx = 0; idx < reading.count; ++idx) {
+        reading.values[idx] = static_cast<int>(kPwmMin + record.axes[idx] * kPwmRange / 100.0);
+      }
+      rc_.add(offset_ns, reading);
+      break;
+    }
+    // Estimates are recomputed from the replayed IMU records.
+    case codec::RecordType::Attitude:
+    case codec::RecordType::FusedImu:
+    case codec::RecordType::Batch:
+      break;
+    }
+  }
+
+  // Copies the next reading due, stamped with the time it replays at: the
+  // original spacing shifted onto this run's clock.
+  template <typename Reading>
+  bool replay(ReplayStream<Reading> &stream, Reading &out) {
+    const SampleTime now = SampleTime::now();
+    std::int64_t pass = 0;
+    const auto *item = stream.next(now.monotonic_ns - start_.monotonic_ns, pass_ns_, pass);
+    if (!item) {
+      return false;
+    }
+    out = item->reading;
+    out.time.monotonic_ns = start_.monotonic_ns + pass * pass_ns_ + item->offset_ns;
+    out.time.realtime_offset_ns = now.realtime_offset_ns;
+    return true;
+  }
+
+  // Like replay(), but a stream with nothing due yet marks out stale instead
+  // of failing, unless the capture holds none of its readings at all.
+  template <typename Reading>
+  bool replay_stale(ReplayStream<Reading> &stream, Reading &out) {
+    if (stream.size() == 0) {
+      return false;
+    }
+    out.stale = !replay(stream, out);
+    return true;
+  }
+
+  SampleTime start_;
+  std::int64_t first_ns_ = 0;
+  std::int64_t pass_ns_ = 1;
+  ReplayStream<ImuReading> mpu_;
+  ReplayStream<ImuReading> lsm_;
+  ReplayStream<AdcReading> adc_;
+  ReplayStream<BarometerReading> barometer_;
+  ReplayStream<GpsReading> gps_;
+  ReplayStream<RcInputReading> rc_;
+};
+
+} // namespace
+
+std::unique_ptr<SensorBackend> make_replay_backend(const std::string &path) {
+  auto backend = std::make_unique<ReplayBackend>();
+  if (!backend->load(path)) {
+    return nullptr;
+  }
+  return backend;
+}
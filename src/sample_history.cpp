@@ -0,0 +1,127 @@
+#include "sample_history.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace telemetry {
+
+namespace {
+
+bool parse_count(std::string_view value, std::size_t &count) {
+  const auto result = std::from_chars(value.data(), value.data() + value.size(), count);
+  return result.ec == std::errc() && result.ptr == value.data() + value.size();
+}
+
+bool parse_time(std::string_view value, std::int64_t now_ns, std::int64_t &time_ns) {
+  if (!value.empty() && value.front() == '-') {
+    double seconds = 0.0;
+    const auto result = std::from_chars(value.data(), value.data() + value.size(), seconds);
+    if (result.ec != std::errc() || result.ptr != value.data() + value.size() || !std::isfinite(seconds)) {
+      return false;
+    }
+    time_ns = now_ns + static_cast<std::int64_t>(std::max(seconds, -1e9) * 1e9);
+    return true;
+  }
+  const auto result = std::from_chars(value.data(), value.data() + value.size(), time_ns);
+  return result.ec == std::errc() && result.ptr == value.data() + value.size();
+}
+
+} // namespace
+
+bool parse_history_selector(std::string_view parameters, std::int64_t now_ns, HistorySelector &selector) {
+  while (!parameters.empty()) {
+    const std::size_t end = std::min(parameters.find(';'), parameters.find('&'));
+    const std::string_view parameter = parameters.substr(0, end);
+    parameters = end == std::string_view::npos ? std::string_view() : parameters.substr(end + 1);
+    const std::size_t equals = parameter.find('=');
+    const std::string_view name = parameter.substr(0, equals);
+    const std::string_view value = equals == std::string_view::npos ? std::string_view() : parameter.substr(equals + 1);
+    if (name == "last") {
+      if (!parse_count(value, selector.last)) {
+        return false;
+      }
+    } else if (name == "since") {
+      if (!parse_time(value, now_ns, selector.since_ns)) {
+        return false;
+      }
+    } else if (name == "until") {
+      if (!parse_time(value, now_ns, selector.until_ns)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+std::span<const std::uint8_t> HistorySnapshot::operator[](std::size_t idx) const {
+  return std::span<const std::uint8_t>(slots).subspan(idx * SampleHistory::kSlotSize, sizes[idx]);
+}
+
+SampleHistory::SampleHistory(std::size_t capacity, std::chrono::milliseconds max_age)
+    : max_age_ns_(std::chrono::duration_cast<std::chrono::nanoseconds>(max_age).count()),
+      entries_(capacity), slots_(capacity * kSlotSize) {}
+
+bool SampleHistory::record(std::int64_t time_ns, std::span<const std::uint8_t> payload) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (payload.size() > kSlotSize || entries_.empty()) {
+    ++skipped_;
+    return false;
+  }
+  std::memcpy(slots_.data() + next_ * kSlotSize, payload.data(), payload.size());
+  entries_[next_] = Entry{time_ns, payload.size()};
+  next_ = (next_ + 1) % entries_.size();
+  count_ = std::min(count_ + 1, entries_.size());
+  return true;
+}
+
+void SampleHistory::snapshot(const HistorySelector &selector, std::int64_t now_ns, HistorySnapshot &out) const {
+  std::int64_t since_ns = selector.since_ns;
+  if (max_age_ns_ > 0) {
+    since_ns = std::max(since_ns, now_ns - max_age_ns_);
+  }
+  // The capacity never changes, so this needs no lock.
+  const std::size_t capacity = entries_.size();
+  const std::size_t most = std::min(selector.last, capacity);
+  out.slots.resize(most * kSlotSize);
+  out.sizes.resize(most);
+  out.count = 0;
+  if (most == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Walk back from the newest sample: past the ones after until_ns, then
+  // over the ones to return. Samples are in publishing order.
+  std::size_t skipped = 0;
+  while (skipped < count_ && entries_[(next_ + capacity - 1 - skipped) % capacity].time_ns > selector.until_ns) {
+    ++skipped;
+  }
+  std::size_t selected = 0;
+  while (skipped + selected < count_ && selected < most &&
+         entries_[(next_ + capacity - 1 - skipped - selected) % capacity].time_ns >= since_ns) {
+    ++selected;
+  }
+  // The selected slots are one run up to the end of the ring and possibly a
+  // second one from its start.
+  const std::size_t first = (next_ + capacity - skipped - selected) % capacity;
+  const std::size_t run = std::min(selected, capacity - first);
+  std::memcpy(out.slots.data(), slots_.data() + first * kSlotSize, run * kSlotSize);
+  std::memcpy(out.slots.data() + run * kSlotSize, slots_.data(), (selected - run) * kSlotSize);
+  for (std::size_t idx = 0; idx < selected; ++idx) {
+    out.sizes[idx] = entries_[(first + idx) % capacity].size;
+  }
+  out.count = selected;
+}
+
+std::size_t SampleHistory::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return count_;
+}
+
+std::uint64_t SampleHistory::skipped() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return skipped_;
+}
+
+} // namespace telemetry
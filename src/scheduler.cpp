@@ -0,0 +1,106 @@
+#include "scheduler.h"
+
+#include "logging.h"
+
+#include <cerrno>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+constexpr std::int64_t kNanosPerSecond = 1000000000;
+// Upper bound on a single sleep so that stop requests are noticed promptly
+// even at very low rates.
+constexpr std::int64_t kMaxSleepSliceNs = 100000000;
+
+std::int64_t monotonic_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<std::int64_t>(ts.tv_sec) * kNanosPerSecond + ts.tv_nsec;
+}
+
+timespec to_timespec(std::int64_t ns) {
+  timespec ts{};
+  ts.tv_sec = static_cast<time_t>(ns / kNanosPerSecond);
+  ts.tv_nsec = static_cast<long>(ns % kNanosPerSecond);
+  return ts;
+}
+
+double to_micros(std::uint64_t ns) { return static_cast<double>(ns) / 1000.0; }
+
+} // namespace
+
+PeriodicScheduler::PeriodicScheduler(double rate_hz)
+    : rate_hz_(rate_hz > 0.0 ? rate_hz : 0.0),
+      period_ns_(rate_hz > 0.0 ? static_cast<std::int64_t>(kNanosPerSecond / rate_hz) : 0) {}
+
+void PeriodicScheduler::start() {
+  next_deadline_ns_ = monotonic_ns();
+  last_wake_ns_ = next_deadline_ns_;
+}
+
+bool PeriodicScheduler::wait_next(const std::atomic<bool> &running) {
+  cycles_.fetch_add(1, std::memory_order_relaxed);
+  if (period_ns_ <= 0) {
+    return running.load(std::memory_order_relaxed);
+  }
+
+  next_deadline_ns_ += period_ns_;
+  const std::int64_t now = monotonic_ns();
+  if (now > next_deadline_ns_) {
+    const std::int64_t missed = (now - next_deadline_ns_) / period_ns_ + 1;
+    overruns_.fetch_add(1, std::memory_order_relaxed);
+    skipped_slots_.fetch_add(static_cast<std::uint64_t>(missed), std::memory_order_relaxed);
+    next_deadline_ns_ += missed * period_ns_;
+  }
+
+  while (running.load(std::memory_order_relaxed)) {
+    const std::int64_t remaining = next_deadline_ns_ - monotonic_ns();
+    if (remaining <= 0) {
+      break;
+    }
+    const std::int64_t wake_at =
+        remaining > kMaxSleepSliceNs ? monotonic_ns() + kMaxSleepSliceNs : next_deadline_ns_;
+    const timespec deadline = to_timespec(wake_at);
+    const int rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr);
+    if (rc != 0 && rc != EINTR) {
+      logging::log(logging::Level::Error, "clock_nanosleep failed with error ", rc);
+      return false;
+    }
+  }
+  if (!running.load(std::memory_order_relaxed)) {
+    return false;
+  }
+
+  const std::int64_t wake = monotonic_ns();
+  const std::int64_t deviation = (wake - last_wake_ns_) - period_ns_;
+  jitter_.record(static_cast<std::uint64_t>(deviation < 0 ? -deviation : deviation));
+  last_wake_ns_ = wake;
+  return true;
+}
+
+double PeriodicScheduler::rate_hz() const { return rate_hz_; }
+
+std::uint64_t PeriodicScheduler::cycles() const {
+  return cycles_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t PeriodicScheduler::overruns() const {
+  return overruns_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t PeriodicScheduler::skipped_slots() const {
+  return skipped_slots_.load(std::memory_order_relaxed);
+}
+
+const LatencyHistogram &PeriodicScheduler::jitter() const { return jitter_; }
+
+std::string PeriodicScheduler::summary() const {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1) << "rate=" << rate_hz_ << "Hz"
+      << " cycles=" << cycles() << " overruns=" << overruns()
+      << " skipped=" << skipped_slots() << " jitter_p50=" << to_micros(jitter_.percentile(50.0))
+      << "us jitter_p99=" << to_micros(jitter_.percentile(99.0))
+      << "us jitter_max=" << to_micros(jitter_.max()) << "us";
+  return out.str();
+}
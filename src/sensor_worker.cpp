@@ -0,0 +1,43 @@
+#include "sensor_worker.h"
+
+#include "logging.h"
+
+#include <utility>
+
+SensorWorker::SensorWorker(std::string name, double rate_hz,
+                           std::function<void()> task)
+    : name_(std::move(name)), task_(std::move(task)), scheduler_(rate_hz) {}
+
+SensorWorker::~SensorWorker() { stop(); }
+
+void SensorWorker::start() {
+  if (running_.exchange(true)) {
+    return;
+  }
+  logging::log(logging::Level::Info, "Starting ", name_, " worker at ", scheduler_.rate_hz(), " Hz");
+  thread_ = std::thread(&SensorWorker::run, this);
+}
+
+void SensorWorker::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  logging::log(logging::Level::Info, "Stopped ", name_, " worker");
+}
+
+const std::string &SensorWorker::name() const { return name_; }
+
+double SensorWorker::rate_hz() const { return scheduler_.rate_hz(); }
+
+const PeriodicScheduler &SensorWorker::scheduler() const { return scheduler_; }
+
+void SensorWorker::run() {
+  // A rate of zero means free-running, mirroring the old --interval 0.
+  scheduler_.start();
+  do {
+    task_();
+  } while (scheduler_.wait_next(running_));
+}
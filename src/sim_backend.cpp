@@ -0,0 +1,154 @@
+#include "sensor_backend.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kGravity = 9.80665;
+
+// Reference point for the simulated GPS track (Vigo, Spain).
+constexpr double kHomeLatitudeDeg = 42.1697;
+constexpr double kHomeLongitudeDeg = -8.6876;
+constexpr double kEarthRadiusM = 6371000.0;
+
+// Fixed-seed xorshift generator; each sensor owns one so streams are
+// reproducible run to run.
+class Noise {
+public:
+  explicit Noise(std::uint64_t seed) : state_(seed) {}
+
+  // Roughly Gaussian: the sum of four uniforms, scaled to unit variance.
+  double gaussian(double sigma) {
+    double sum = 0.0;
+    for (int idx = 0; idx < 4; ++idx) {
+      sum += uniform() - 0.5;
+    }
+    return sum * std::sqrt(3.0) * sigma;
+  }
+
+private:
+  double uniform() {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 7;
+    state_ ^= state_ << 17;
+    return static_cast<double>(state_ >> 11) * 0x1.0p-53;
+  }
+
+  std::uint64_t state_;
+};
+
+double seconds(const SampleTime &time) { return static_cast<double>(time.monotonic_ns) * 1e-9; }
+
+double wave(double t, double hz, double phase = 0.0) { return std::sin(2.0 * kPi * hz * t + phase); }
+
+class SimBackend : public SensorBackend {
+public:
+  const char *name() const override { return "sim"; }
+
+  bool read_imu(ImuType type, ImuReading &out) override {
+    const bool mpu = type == ImuType::Mpu9250;
+    Noise &noise = mpu ? mpu_noise_ : lsm_noise_;
+    out.time = SampleTime::now();
+    const double t = seconds(out.time);
+    // Slow rocking motion plus a 45 Hz propeller-like vibration.
+    const double roll = 0.2 * wave(t, 0.1);
+    const double pitch = 0.15 * wave(t, 0.07, 1.0);
+    const double yaw = 2.0 * kPi * 0.01 * t;
+    const double vibration = 0.3 * wave(t, 45.0);
+    const double bias = mpu ? 0.02 : -0.03;
+    out.ax = static_cast<float>(-kGravity * std::sin(pitch) + vibration + bias + noise.gaussian(0.05));
+    out.ay = static_cast<float>(kGravity * std::sin(roll) * std::cos(pitch) + noise.gaussian(0.05));
+    out.az = static_cast<float>(kGravity * std::cos(roll) * std::cos(pitch) + vibration + noise.gaussian(0.05));
+    out.gx_rad = static_cast<float>(0.2 * 2.0 * kPi * 0.1 * wave(t, 0.1, kPi / 2.0) + noise.gaussian(0.005));
+    out.gy_rad = static_cast<float>(0.15 * 2.0 * kPi * 0.07 * wave(t, 0.07, 1.0 + kPi / 2.0) + noise.gaussian(0.005));
+    out.gz_rad = static_cast<float>(2.0 * kPi * 0.01 + noise.gaussian(0.005));
+    // 22 uT horizontal, 40 uT down, seen from the rotating body.
+    out.mx = static_cast<float>(22.0 * std::cos(yaw) + noise.gaussian(0.3));
+    out.my = static_cast<float>(-22.0 * std::sin(yaw) + noise.gaussian(0.3));
+    out.mz = static_cast<float>(40.0 + noise.gaussian(0.3));
+    out.valid = true;
+    return true;
+  }
+
+  bool read_adc(AdcReading &out) override {
+    out.time = SampleTime::now();
+    const double t = seconds(out.time);
+    // Board 5 V, servo rail, 3S battery discharging, battery current, spare inputs.
+    const std::array<double, 6> volts = {
+        5.0 + adc_noise_.gaussian(0.01),
+        5.1 + 0.05 * wave(t, 0.5) + adc_noise_.gaussian(0.01),
+        12.6 - 0.001 * std::fmod(t, 1800.0) + adc_noise_.gaussian(0.02),
+        0.8 + 0.2 * wave(t, 0.2) + adc_noise_.gaussian(0.01),
+        adc_noise_.gaussian(0.002),
+        adc_noise_.gaussian(0.002)};
+    out.count = volts.size();
+    for (std::size_t idx = 0; idx < volts.size(); ++idx) {
+      out.values[idx] = volts[idx];
+    }
+    return true;
+  }
+
+  bool read_barometer(BarometerReading &out) override {
+    out.time = SampleTime::now();
+    const double t = seconds(out.time);
+    out.temperature_c = 25.0 + 0.5 * wave(t, 1.0 / 300.0) + barometer_noise_.gaussian(0.01);
+    out.pressure_mbar = 1013.25 - 0.05 * wave(t, 1.0 / 60.0) + barometer_noise_.gaussian(0.012);
+    out.valid = true;
+    return true;
+  }
+
+  bool read_gps(GpsReading &out) override {
+    out.time = SampleTime::now();
+    const double t = seconds(out.time);
+    // 20 m circle around the home point every two minutes.
+    const double angle = 2.0 * kPi * t / 120.0;
+    const double north_m = 20.0 * std::cos(angle) + gps_noise_.gaussian(0.5);
+    const double east_m = 20.0 * std::sin(angle) + gps_noise_.gaussian(0.5);
+    out.has_position = true;
+    out.has_status = true;
+    out.time_of_week_s = std::fmod(static_cast<double>(out.time.unix_ns()) * 1e-9, 7.0 * 86400.0);
+    out.latitude_deg = kHomeLatitudeDeg + north_m / kEarthRadiusM * 180.0 / kPi;
+    out.longitude_deg = kHomeLongitudeDeg +
+                        east_m / (kEarthRadiusM * std::cos(kHomeLatitudeDeg * kPi / 180.0)) * 180.0 / kPi;
+    out.height_m = 450.0 + gps_noise_.gaussian(1.0);
+    out.hmsl_m = 400.0 + gps_noise_.gaussian(1.0);
+    out.horizontal_accuracy_m = 1.5;
+    out.vertical_accuracy_m = 2.5;
+    // Derivative of the circle, without the noise.
+    const double rate = 2.0 * kPi / 120.0;
+    out.has_velocity = true;
+    out.velocity_north_mps = -20.0 * rate * std::sin(angle);
+    out.velocity_east_mps = 20.0 * rate * std::cos(angle);
+    out.velocity_down_mps = 0.0;
+    out.ground_speed_mps = 20.0 * rate;
+    out.heading_deg = std::fmod(std::atan2(out.velocity_east_mps, out.velocity_north_mps) * 180.0 / kPi + 360.0, 360.0);
+    out.speed_accuracy_mps = 0.3;
+    out.fix_type = 3;
+    out.fix_ok = true;
+    return true;
+  }
+
+  bool read_rcinput(RcInputReading &out) override {
+    out.time = SampleTime::now();
+    const double t = seconds(out.time);
+    out.count = kRcMaxChannels;
+    for (std::size_t idx = 0; idx < kRcMaxChannels; ++idx) {
+      out.values[idx] = static_cast<int>(std::lround(1500.0 + 400.0 * wave(t, 0.1, static_cast<double>(idx))));
+    }
+    return true;
+  }
+
+private:
+  Noise mpu_noise_{0x9E3779B97F4A7C15ULL};
+  Noise lsm_noise_{0xD1B54A32D192ED03ULL};
+  Noise adc_noise_{0x94D049BB133111EBULL};
+  Noise barometer_noise_{0xBF58476D1CE4E5B9ULL};
+  Noise gps_noise_{0x2545F4914F6CDD1DULL};
+};
+
+} // namespace
+
+std::unique_ptr<SensorBackend> make_sim_backend() { return std::make_unique<SimBackend>(); }
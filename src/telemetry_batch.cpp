@@ -0,0 +1,43 @@
+#include "telemetry_batch.h"
+
+#include "telemetry_codec.h"
+
+#include <algorithm>
+
+namespace telemetry {
+
+BatchBuffer::BatchBuffer(const BatchPolicy &policy)
+    : policy_{std::min(policy.max_samples, kMaxSamples), policy.max_latency},
+      buffer_(codec::kBatchPrefixSize + policy_.max_samples * (codec::kBatchEntryOverhead + kPayloadCapacity)),
+      used_(codec::kBatchPrefixSize) {}
+
+bool BatchBuffer::fits(std::size_t payload_size) const {
+  return payload_size <= 0xFFFF && used_ + codec::kBatchEntryOverhead + payload_size <= buffer_.size();
+}
+
+bool BatchBuffer::add(std::chrono::steady_clock::time_point now, std::int64_t timestamp_ns,
+                      std::span<const std::uint8_t> payload) {
+  if (count_ == 0) {
+    first_added_ = now;
+  }
+  used_ += codec::encode_batch_entry(std::span<std::uint8_t>(buffer_).subspan(used_), timestamp_ns, payload);
+  ++count_;
+  return count_ >= policy_.max_samples || expired(now);
+}
+
+bool BatchBuffer::expired(std::chrono::steady_clock::time_point now) const {
+  return count_ > 0 && policy_.max_latency.count() > 0 && now - first_added_ >= policy_.max_latency;
+}
+
+std::span<const std::uint8_t> BatchBuffer::take(const SampleTime &time) {
+  if (count_ == 0) {
+    return {};
+  }
+  codec::encode_batch_prefix(std::span<std::uint8_t>(buffer_), time, count_);
+  const std::size_t size = used_;
+  used_ = codec::kBatchPrefixSize;
+  count_ = 0;
+  return std::span<const std::uint8_t>(buffer_.data(), size);
+}
+
+} // namespace telemetry
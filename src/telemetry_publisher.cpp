@@ -1,13 +1,23 @@
 #include "telemetry_publisher.h"
 
 #include "logging.h"
+#include "sample_history.h"
 
 #include <zenoh.hxx>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <mutex>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace telemetry {
 
@@ -15,30 +25,301 @@ namespace {
 constexpr const char *kDefaultLogLevel = "error";
 } // namespace
 
+// Shared memory needs zenoh-c built with its shared-memory feature, which the
+// SENSORS_READ_SHM CMake option asserts.
+#if defined(ZENOHCXX_ZENOHC) && defined(SENSORS_READ_SHM)
+#define TELEMETRY_HAVE_SHM 1
+#endif
+
 class TelemetryPublisher::Impl {
 public:
-  Impl() {
+  explicit Impl(const PublisherOptions &options)
+      : history_samples_(options.history_samples), history_age_(options.history_age) {
     logging::log(logging::Level::Info, "Initializing telemetry publisher");
 #ifdef ZENOHCXX_ZENOHC
     zenoh::init_logger();
 #endif
-    auto session_or_error = zenoh::open(z_config_default());
+    zenoh::Config config(z_config_default());
+#ifdef TELEMETRY_HAVE_SHM
+    if (options.shared_memory) {
+      config.insert_json(Z_CONFIG_SHARED_MEMORY_KEY, "true");
+    }
+#endif
+    auto session_or_error = zenoh::open(std::move(config));
     if (auto *session = std::get_if<zenoh::Session>(&session_or_error)) {
       session_ = std::make_unique<zenoh::Session>(std::move(*session));
       logging::log(logging::Level::Info, "Zenoh session initialized");
     } else {
       logging::log(logging::Level::Critical, "Failed to initialize zenoh session");
+      return;
+    }
+    if (options.shared_memory) {
+      init_shared_memory(options.shared_memory_size);
+    }
+    if (history_samples_ > 0) {
+      logging::log(logging::Level::Info, "Keeping the last ", history_samples_, " samples per key",
+                   (history_age_.count() > 0 ? " up to " + std::to_string(history_age_.count()) + " ms old" : ""));
     }
   }
 
   ~Impl() {
       logging::log(logging::Level::Info, "Closing telemetry publisher");
+      flusher_running_ = false;
+      if (flusher_.joinable()) {
+        flusher_.join();
+      }
+      if (session_) {
+        flush();
+      }
   }
 
   bool ready() const { return static_cast<bool>(session_); }
 
-  bool publish(const std::string &key, const std::string &message) {
-    logging::log(logging::Level::Debug, "Publishing to " + key);
+  std::uint64_t shared_memory_published() const { return shm_published_.load(std::memory_order_relaxed); }
+  std::uint64_t shared_memory_fallbacks() const { return shm_fallbacks_.load(std::memory_order_relaxed); }
+
+  bool shared_memory_active() const {
+#ifdef TELEMETRY_HAVE_SHM
+    return static_cast<bool>(shm_manager_);
+#else
+    return false;
+#endif
+  }
+
+  bool publish(const std::string &key, std::span<const std::uint8_t> payload) {
+    if (SampleHistory *history = find_history(key)) {
+      record(key, *history, payload);
+    }
+    if (Batch *batch = find_batch(key)) {
+      return enqueue(key, *batch, payload);
+    }
+    return put_raw(key, payload);
+  }
+
+  bool publish_with(const std::string &key, std::size_t capacity, PayloadWriter write) {
+    if (Batch *batch = find_batch(key)) {
+      const std::span<const std::uint8_t> payload = serialize_to_scratch(capacity, write);
+      if (payload.empty()) {
+        return false;
+      }
+      if (SampleHistory *history = find_history(key)) {
+        record(key, *history, payload);
+      }
+      return enqueue(key, *batch, payload);
+    }
+    if (SampleHistory *history = find_history(key)) {
+      // Keeps a copy of whatever the serializer wrote, wherever it wrote it.
+      auto recorded = [&](std::span<std::uint8_t> out) -> std::size_t {
+        const std::size_t size = write(out);
+        if (size > 0) {
+          record(key, *history, out.first(size));
+        }
+        return size;
+      };
+      return put_with(key, capacity, recorded);
+    }
+    return put_with(key, capacity, write);
+  }
+
+  void set_batch_policy(const std::string &key, const BatchPolicy &policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (policy.max_samples <= 1) {
+      batches_.erase(key);
+      return;
+    }
+    auto batch = std::make_unique<Batch>(policy);
+    const BatchPolicy &applied = batch->pending.policy();
+    logging::log(logging::Level::Info, "Batching ", key, ": up to ", applied.max_samples, " samples or ", applied.max_latency.count(), " ms");
+    batches_[key] = std::move(batch);
+    if (policy.max_latency.count() > 0) {
+      start_flusher(policy.max_latency);
+    }
+  }
+
+  void keep_history(const std::string &key) {
+    if (history_samples_ == 0 || key.empty() || !session_ || histories_.count(key) > 0) {
+      return;
+    }
+    auto history = std::make_unique<SampleHistory>(history_samples_, history_age_);
+    const SampleHistory *kept = history.get();
+    histories_.emplace(key, std::move(history));
+    auto on_query = [key, kept](const zenoh::Query &query) { reply_history(key, *kept, query); };
+    auto queryable_or_error = session_->declare_queryable(key.c_str(), on_query);
+    if (auto *queryable = std::get_if<zenoh::Queryable>(&queryable_or_error)) {
+      queryables_.push_back(std::move(*queryable));
+      logging::log(logging::Level::Info, "Declared history queryable for ", key);
+    } else {
+      logging::log(logging::Level::Error, "Failed to declare history queryable for ", key);
+    }
+  }
+
+  void flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &entry : batches_) {
+      std::lock_guard<std::mutex> batch_lock(entry.second->mutex);
+      flush_locked(entry.first, *entry.second);
+    }
+  }
+
+private:
+  struct Batch {
+    explicit Batch(const BatchPolicy &policy) : pending(policy) {}
+
+    std::mutex mutex;
+    BatchBuffer pending;
+  };
+
+  // Serializes into a per-thread scratch buffer, which only allocates the
+  // first time a thread publishes. Returns an empty span on failure.
+  static std::span<const std::uint8_t> serialize_to_scratch(std::size_t capacity, PayloadWriter &write) {
+    thread_local std::vector<std::uint8_t> scratch;
+    if (scratch.size() < capacity) {
+      scratch.resize(capacity);
+    }
+    const std::size_t size = write(std::span<std::uint8_t>(scratch.data(), capacity));
+    if (size == 0) {
+      logging::log(logging::Level::Error, "Cannot publish, payload serialization failed");
+      return {};
+    }
+    return std::span<const std::uint8_t>(scratch.data(), size);
+  }
+
+  // Batch policies are configured before publishing starts, so the map itself
+  // is only read on the hot path.
+  Batch *find_batch(const std::string &key) {
+    if (batches_.empty()) {
+      return nullptr;
+    }
+    auto it = batches_.find(key);
+    return it != batches_.end() ? it->second.get() : nullptr;
+  }
+
+  bool enqueue(const std::string &key, Batch &batch, std::span<const std::uint8_t> payload) {
+    std::lock_guard<std::mutex> lock(batch.mutex);
+    bool ok = true;
+    if (!batch.pending.fits(payload.size())) {
+      ok = flush_locked(key, batch);
+      if (!batch.pending.fits(payload.size())) {
+        return put_raw(key, payload) && ok;
+      }
+    }
+    if (batch.pending.add(std::chrono::steady_clock::now(), realtime_ns(), payload)) {
+      ok = flush_locked(key, batch) && ok;
+    }
+    return ok;
+  }
+
+  bool flush_locked(const std::string &key, Batch &batch) {
+    const std::span<const std::uint8_t> record = batch.pending.take(SampleTime::now());
+    if (record.empty()) {
+      return true;
+    }
+    if (!shared_memory_active()) {
+      return put_raw(key, record);
+    }
+    auto copy = [record](std::span<std::uint8_t> out) -> std::size_t {
+      std::memcpy(out.data(), record.data(), record.size());
+      return record.size();
+    };
+    return put_with(key, record.size(), copy);
+  }
+
+  void start_flusher(std::chrono::milliseconds latency) {
+    // Poll at a quarter of the tightest latency bound, but no faster than 1 ms.
+    const auto tick = std::max(std::chrono::milliseconds(1), latency / 4);
+    if (flusher_.joinable()) {
+      if (tick < flush_tick_) {
+        flush_tick_ = tick;
+      }
+      return;
+    }
+    flush_tick_ = tick;
+    flusher_running_ = true;
+    flusher_ = std::thread(&Impl::run_flusher, this);
+  }
+
+  void run_flusher() {
+    while (flusher_running_.load(std::memory_order_relaxed)) {
+      std::this_thread::sleep_for(flush_tick_);
+      const auto now = std::chrono::steady_clock::now();
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto &entry : batches_) {
+        Batch &batch = *entry.second;
+        std::lock_guard<std::mutex> batch_lock(batch.mutex);
+        if (batch.pending.expired(now)) {
+          flush_locked(entry.first, batch);
+        }
+      }
+    }
+  }
+
+  // The history map is only changed before publishing starts, so lookups
+  // take no lock.
+  SampleHistory *find_history(const std::string &key) {
+    if (histories_.empty()) {
+      return nullptr;
+    }
+    auto it = histories_.find(key);
+    return it != histories_.end() ? it->second.get() : nullptr;
+  }
+
+  static void record(const std::string &key, SampleHistory &history, std::span<const std::uint8_t> payload) {
+    if (!history.record(realtime_ns(), payload) && history.skipped() == 1) {
+      logging::log(logging::Level::Warning, "Samples over ", SampleHistory::kSlotSize, " bytes on ", key,
+                   " are not kept in its history");
+    }
+  }
+
+  // Runs on a Zenoh thread. The samples are copied out first so that the
+  // replies never hold up recording.
+  static void reply_history(const std::string &key, const SampleHistory &history, const zenoh::Query &query) {
+    const std::int64_t now_ns = realtime_ns();
+    HistorySelector selector;
+    const std::string_view parameters = query.get_parameters().as_string_view();
+    if (!parse_history_selector(parameters, now_ns, selector)) {
+      logging::log(logging::Level::Warning, "Ignoring history query on ", key, " with invalid parameters '",
+                   parameters, "', expected last=<n>, since=<t> and until=<t>");
+      return;
+    }
+    HistorySnapshot snapshot;
+    history.snapshot(selector, now_ns, snapshot);
+    for (std::size_t idx = 0; idx < snapshot.size(); ++idx) {
+      const std::span<const std::uint8_t> payload = snapshot[idx];
+      query.reply(key.c_str(), zenoh::BytesView(payload.data(), payload.size()));
+    }
+    logging::log(logging::Level::Debug, "Answered history query on ", key, " with ", snapshot.size(), " samples");
+  }
+
+  // Publishes without batching, serializing into shared memory when enabled.
+  bool put_with(const std::string &key, std::size_t capacity, PayloadWriter write) {
+#ifdef TELEMETRY_HAVE_SHM
+    if (shm_manager_) {
+      switch (publish_shared(key, capacity, write)) {
+      case SharedPut::Sent:
+        shm_published_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      case SharedPut::Failed:
+        return false;
+      case SharedPut::Unavailable:
+        shm_fallbacks_.fetch_add(1, std::memory_order_relaxed);
+        break;
+      }
+    }
+#endif
+    // Regular path: serialize into a per-thread scratch buffer, which only
+    // allocates the first time a thread publishes.
+    const std::span<const std::uint8_t> payload = serialize_to_scratch(capacity, write);
+    if (payload.empty()) {
+      return false;
+    }
+    return put_raw(key, payload);
+  }
+
+  bool put_raw(const std::string &key, std::span<const std::uint8_t> payload) {
+    const bool debug = logging::enabled(logging::Level::Debug);
+    if (debug) {
+      logging::log(logging::Level::Debug, "Publishing to ", key);
+    }
     if (!session_) {
       logging::log(logging::Level::Error, "Cannot publish, no zenoh session");
       return false;
@@ -50,48 +331,165 @@ public:
 
     zenoh::Publisher *publisher = find_or_create_publisher(key);
     if (!publisher) {
-      logging::log(logging::Level::Error, "Failed to find or create publisher for " + key);
+      logging::log(logging::Level::Error, "Failed to find or create publisher for ", key);
       return false;
     }
-    publisher->put(message);
-    logging::log(logging::Level::Debug, "Published to " + key);
+    if (!publisher->put(zenoh::BytesView(payload.data(), payload.size()))) {
+      logging::log(logging::Level::Warning, "Zenoh put failed on ", key);
+      return false;
+    }
+    if (debug) {
+      logging::log(logging::Level::Debug, "Published to ", key);
+    }
     return true;
   }
 
-private:
+  void init_shared_memory(std::size_t size) {
+#ifdef TELEMETRY_HAVE_SHM
+    const std::string id = "sensors_read_" + std::to_string(getpid());
+    auto manager_or_error = zenoh::shm_manager_new(*session_, id.c_str(), size);
+    if (auto *manager = std::get_if<zenoh::ShmManager>(&manager_or_error)) {
+      shm_manager_ = std::make_unique<zenoh::ShmManager>(std::move(*manager));
+      logging::log(logging::Level::Info, "Zenoh shared-memory publishing enabled (", size, " bytes)");
+    } else {
+      logging::log(logging::Level::Warning, "Failed to create zenoh shared-memory manager, using regular publishing");
+    }
+#else
+    (void)size;
+    logging::log(logging::Level::Warning, "Shared-memory publishing not compiled in (SENSORS_READ_SHM), using regular publishing");
+#endif
+  }
+
+#ifdef TELEMETRY_HAVE_SHM
+  // Unavailable leaves the sample to the regular path. Once the serializer
+  // has run, whatever it did (e.g. recording the sample in its history) is
+  // not repeated, so a failure after that is final.
+  enum class SharedPut { Sent, Failed, Unavailable };
+
+  // Serializes straight into a shared-memory buffer; Unavailable when there
+  // is no publisher for the key or the pool is exhausted.
+  SharedPut publish_shared(const std::string &key, std::size_t capacity, PayloadWriter &write) {
+    if (key.empty()) {
+      return SharedPut::Unavailable;
+    }
+    zenoh::Publisher *publisher = find_or_create_publisher(key);
+    if (!publisher) {
+      return SharedPut::Unavailable;
+    }
+    std::unique_lock<std::mutex> lock(shm_mutex_);
+    auto buffer_or_error = shm_manager_->alloc(capacity);
+    auto *buffer = std::get_if<zenoh::Shmbuf>(&buffer_or_error);
+    if (!buffer) {
+      // Reclaim buffers released by subscribers for the next sample; this one
+      // takes the regular path.
+      shm_manager_->gc();
+      return SharedPut::Unavailable;
+    }
+    lock.unlock();
+    const std::size_t size = write(std::span<std::uint8_t>(buffer->ptr(), capacity));
+    if (size == 0) {
+      logging::log(logging::Level::Error, "Cannot publish, payload serialization failed");
+      return SharedPut::Failed;
+    }
+    buffer->set_length(size);
+    if (!publisher->put_owned(buffer->into_payload(), zenoh::PublisherPutOptions())) {
+      logging::log(logging::Level::Warning, "Zenoh shared-memory put failed on ", key);
+      return SharedPut::Failed;
+    }
+    return SharedPut::Sent;
+  }
+#endif
+
   zenoh::Publisher *find_or_create_publisher(const std::string &key) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(publishers_mutex_);
     auto it = publishers_.find(key);
     if (it != publishers_.end()) {
       return &it->second;
     }
 
-    logging::log(logging::Level::Debug, "Declaring publisher for " + key);
+    logging::log(logging::Level::Debug, "Declaring publisher for ", key);
     auto publisher_or_error = session_->declare_publisher(key.c_str());
     if (auto *publisher = std::get_if<zenoh::Publisher>(&publisher_or_error)) {
       auto result = publishers_.emplace(key, std::move(*publisher));
-      logging::log(logging::Level::Info, "Declared publisher for " + key);
+      logging::log(logging::Level::Info, "Declared publisher for ", key);
       return &result.first->second;
     } else {
-      logging::log(logging::Level::Error,
-                   std::string("Failed to declare publisher for ") + key);
+      logging::log(logging::Level::Error, "Failed to declare publisher for ", key);
     }
     return nullptr;
   }
 
   std::unique_ptr<zenoh::Session> session_;
   std::unordered_map<std::string, zenoh::Publisher> publishers_;
-  mutable std::mutex mutex_;
+  mutable std::mutex publishers_mutex_;
+  // Guards batches_ against the flusher thread and reconfiguration.
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::unique_ptr<Batch>> batches_;
+  std::thread flusher_;
+  std::atomic<bool> flusher_running_{false};
+  std::chrono::milliseconds flush_tick_{1};
+#ifdef TELEMETRY_HAVE_SHM
+  std::unique_ptr<zenoh::ShmManager> shm_manager_;
+  std::mutex shm_mutex_;
+#endif
+  // Samples sent from shared memory, and samples that took the regular path
+  // because no shared-memory buffer was free.
+  std::atomic<std::uint64_t> shm_published_{0};
+  std::atomic<std::uint64_t> shm_fallbacks_{0};
+  std::size_t history_samples_;
+  std::chrono::milliseconds history_age_;
+  std::unordered_map<std::string, std::unique_ptr<SampleHistory>> histories_;
+  // Declared last so they are undeclared, and stop calling back into the
+  // histories, before anything else is torn down.
+  std::vector<zenoh::Queryable> queryables_;
 };
 
-TelemetryPublisher::TelemetryPublisher() : impl_(new Impl()) {}
+TelemetryPublisher::TelemetryPublisher(const PublisherOptions &options)
+    : impl_(new Impl(options)) {}
 TelemetryPublisher::~TelemetryPublisher() = default;
 
 bool TelemetryPublisher::ready() const { return impl_->ready(); }
 
+bool TelemetryPublisher::shared_memory_active() const {
+  return impl_->shared_memory_active();
+}
+
+std::uint64_t TelemetryPublisher::shared_memory_published() const {
+  return impl_->shared_memory_published();
+}
+
+std::uint64_t TelemetryPublisher::shared_memory_fallbacks() const {
+  return impl_->shared_memory_fallbacks();
+}
+
+bool TelemetryPublisher::publish_with(const std::string &key_expression,
+                                      std::size_t capacity,
+                                      PayloadWriter write) {
+  return impl_->publish_with(key_expression, capacity, write);
+}
+
 bool TelemetryPublisher::publish(const std::string &key_expression,
                                  const std::string &message) {
-  return impl_->publish(key_expression, message);
+  return impl_->publish(key_expression,
+                        std::span<const std::uint8_t>(
+                            reinterpret_cast<const std::uint8_t *>(message.data()),
+                            message.size()));
+}
+
+bool TelemetryPublisher::publish(const std::string &key_expression,
+                                 std::span<const std::uint8_t> payload) {
+  return impl_->publish(key_expression, payload);
+}
+
+void TelemetryPublisher::set_batch_policy(const std::string &key_expression,
+                                          const BatchPolicy &policy) {
+  impl_->set_batch_policy(key_expression, policy);
 }
 
+void TelemetryPublisher::keep_history(const std::string &key_expression) {
+  impl_->keep_history(key_expression);
+}
+
+void TelemetryPublisher::flush() { impl_->flush(); }
+
 } // namespace telemetry
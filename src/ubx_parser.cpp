@@ -0,0 +1,107 @@
+#include "ubx_parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+constexpr std::uint8_t kSync1 = 0xB5;
+constexpr std::uint8_t kSync2 = 0x62;
+// Sync chars, class, id and length.
+constexpr std::size_t kFrameHeader = 6;
+
+} // namespace
+
+void UbxParser::reset() {
+  state_ = State::Sync1;
+  frame_size_ = 0;
+  replay_next_ = 0;
+  replay_size_ = 0;
+}
+
+std::string UbxParser::summary() const {
+  std::ostringstream out;
+  out << "frames=" << frames() << " checksum_errors=" << checksum_errors() << " oversized=" << oversized();
+  return out.str();
+}
+
+UbxMessage UbxParser::message() const {
+  return {frame_[2], frame_[3], std::span<const std::uint8_t>(frame_).subspan(kFrameHeader, length_)};
+}
+
+bool UbxParser::step(std::uint8_t byte) {
+  switch (state_) {
+  case State::Sync1:
+    if (byte == kSync1) {
+      frame_[0] = byte;
+      frame_size_ = 1;
+      state_ = State::Sync2;
+    }
+    return false;
+  case State::Sync2:
+    if (byte == kSync2) {
+      frame_[frame_size_++] = byte;
+      checksum_a_ = 0;
+      checksum_b_ = 0;
+      state_ = State::Class;
+    } else if (byte != kSync1) {
+      state_ = State::Sync1;
+    }
+    return false;
+  case State::Class:
+  case State::Id:
+  case State::Length1:
+    frame_[frame_size_++] = byte;
+    checksum_a_ = static_cast<std::uint8_t>(checksum_a_ + byte);
+    checksum_b_ = static_cast<std::uint8_t>(checksum_b_ + checksum_a_);
+    state_ = state_ == State::Class ? State::Id : state_ == State::Id ? State::Length1 : State::Length2;
+    return false;
+  case State::Length2:
+    frame_[frame_size_++] = byte;
+    checksum_a_ = static_cast<std::uint8_t>(checksum_a_ + byte);
+    checksum_b_ = static_cast<std::uint8_t>(checksum_b_ + checksum_a_);
+    length_ = static_cast<std::uint16_t>(frame_[4] | (frame_[5] << 8));
+    if (length_ > kMaxPayload) {
+      oversized_.fetch_add(1, std::memory_order_relaxed);
+      reject();
+      return false;
+    }
+    state_ = length_ > 0 ? State::Payload : State::ChecksumA;
+    return false;
+  case State::Payload:
+    frame_[frame_size_++] = byte;
+    checksum_a_ = static_cast<std::uint8_t>(checksum_a_ + byte);
+    checksum_b_ = static_cast<std::uint8_t>(checksum_b_ + checksum_a_);
+    if (frame_size_ == kFrameHeader + length_) {
+      state_ = State::ChecksumA;
+    }
+    return false;
+  case State::ChecksumA:
+    frame_[frame_size_++] = byte;
+    state_ = State::ChecksumB;
+    return false;
+  case State::ChecksumB:
+    frame_[frame_size_++] = byte;
+    if (frame_[frame_size_ - 2] != checksum_a_ || byte != checksum_b_) {
+      checksum_errors_.fetch_add(1, std::memory_order_relaxed);
+      reject();
+      return false;
+    }
+    frames_.fetch_add(1, std::memory_order_relaxed);
+    state_ = State::Sync1;
+    return true;
+  }
+  return false;
+}
+
+void UbxParser::reject() {
+  const std::size_t queued = replay_size_ - replay_next_;
+  const std::size_t rescan = frame_size_ - 1;
+  std::memmove(replay_.data() + rescan, replay_.data() + replay_next_, queued);
+  std::copy_n(frame_.begin() + 1, rescan, replay_.begin());
+  replay_next_ = 0;
+  replay_size_ = rescan + queued;
+  frame_size_ = 0;
+  state_ = State::Sync1;
+}
@@ -1,9 +1,10 @@
 #include "utils.h"
 
+#include "barometer_sensor.h"
 #include "logging.h"
+#include "telemetry_codec.h"
 
 #include <cstdlib>
-#include <ctime>
 #include <getopt.h>
 #include <iostream>
 #include <string>
@@ -11,12 +12,325 @@
 
 namespace utils {
 
+namespace {
+
+enum LongOnlyOption {
+  kOptImuRate = 256,
+  kOptAdcRate,
+  kOptBaroRate,
+  kOptGpsRate,
+  kOptRcRate,
+  kOptBaroOversampling,
+  kOptBaroTemperatureEvery,
+  kOptEncoding,
+  kOptSharedMemory,
+  kOptSharedMemorySize,
+  kOptBatch,
+  kOptQueueDepth,
+  kOptOverflow,
+  kOptImuFifo,
+  kOptBackend,
+  kOptRecordDir,
+  kOptRecordSegmentMb,
+  kOptRecordSegmentS,
+  kOptMetricsInterval,
+  kOptMetricsFile,
+  kOptAttitude,
+  kOptAttitudeBeta,
+  kOptFusionRate,
+  kOptImuRotation,
+  kOptDecimate,
+  kOptHeartbeat,
+  kOptDeadband,
+  kOptImuWindow,
+  kOptImuResolution,
+  kOptHistory,
+  kOptAdcChannels,
+  kOptAdcSample,
+};
+
+bool parse_rate(const char *name, const char *arg, double &rate) {
+  if (!arg) {
+    logging::log(logging::Level::Error, "Missing argument for --", name);
+    return false;
+  }
+  char *end = nullptr;
+  double value = std::strtod(arg, &end);
+  if (!end || *end != '\0' || value <= 0.0) {
+    logging::log(logging::Level::Error, "Invalid rate for --", name);
+    return false;
+  }
+  rate = value;
+  logging::log(logging::Level::Debug, name, " set to ", value, " Hz");
+  return true;
+}
+
+// Parses <topic>=<samples>[:<milliseconds>].
+bool parse_batch(const char *arg, BatchOption &batch) {
+  if (!arg) {
+    logging::log(logging::Level::Error, "Missing argument for --batch");
+    return false;
+  }
+  const std::string value(arg);
+  const std::size_t equals = value.find('=');
+  if (equals == std::string::npos || equals == 0) {
+    logging::log(logging::Level::Error, "Invalid --batch value, expected <topic>=<samples>[:<ms>]");
+    return false;
+  }
+  batch.topic = value.substr(0, equals);
+  const std::string limits = value.substr(equals + 1);
+  char *end = nullptr;
+  long samples = std::strtol(limits.c_str(), &end, 10);
+  if (!end || end == limits.c_str() || samples < 1 || samples > 1000) {
+    logging::log(logging::Level::Error, "Invalid batch size for ", batch.topic, " (1-1000)");
+    return false;
+  }
+  batch.max_samples = static_cast<std::size_t>(samples);
+  batch.max_latency_ms = 0;
+  if (*end == ':') {
+    const char *latency_start = end + 1;
+    long latency = std::strtol(latency_start, &end, 10);
+    if (end == latency_start || latency < 0 || latency > 60000) {
+      logging::log(logging::Level::Error, "Invalid batch latency for ", batch.topic, " (0-60000 ms)");
+      return false;
+    }
+    batch.max_latency_ms = static_cast<int>(latency);
+  }
+  if (*end != '\0') {
+    logging::log(logging::Level::Error, "Invalid --batch value, expected <topic>=<samples>[:<ms>]");
+    return false;
+  }
+  return true;
+}
+
+// Parses <topic>=<hz>[,<hz>...].
+bool parse_decimate(const char *arg, DecimateOption &decimate) {
+  const std::string value = arg ? arg : "";
+  const std::size_t equals = value.find('=');
+  if (equals == std::string::npos || equals == 0 || equals + 1 == value.size()) {
+    logging::log(logging::Level::Error, "Invalid --decimate value, expected <topic>=<hz>[,<hz>...]");
+    return false;
+  }
+  decimate.topic = value.substr(0, equals);
+  const char *cursor = value.c_str() + equals + 1;
+  while (true) {
+    char *end = nullptr;
+    long rate = std::strtol(cursor, &end, 10);
+    if (end == cursor || rate < 1 || rate > 10000 || (*end != ',' && *end != '\0')) {
+      logging::log(logging::Level::Error, "Invalid --decimate rate for ", decimate.topic, " (1-10000 Hz)");
+      return false;
+    }
+    decimate.rates_hz.push_back(static_cast<int>(rate));
+    if (*end == '\0') {
+      return true;
+    }
+    cursor = end + 1;
+  }
+}
+
+// Parses <topic>[.<field>]=<value>.
+bool parse_deadband(const char *arg, DeadbandOption &deadband) {
+  const std::string value = arg ? arg : "";
+  const std::size_t equals = value.find('=');
+  if (equals == std::string::npos || equals == 0) {
+    logging::log(logging::Level::Error, "Invalid --deadband value, expected <topic>[.<field>]=<value>");
+    return false;
+  }
+  const std::string name = value.substr(0, equals);
+  const std::size_t dot = name.find('.');
+  deadband.topic = name.substr(0, dot);
+  deadband.field = dot == std::string::npos ? "" : name.substr(dot + 1);
+  const std::string number = value.substr(equals + 1);
+  char *end = nullptr;
+  deadband.deadband = std::strtod(number.c_str(), &end);
+  if (number.empty() || *end != '\0' || !(deadband.deadband >= 0.0)) {
+    logging::log(logging::Level::Error, "Invalid deadband for ", name, ", expected a value >= 0");
+    return false;
+  }
+  return true;
+}
+
+// Parses <samples>[:<milliseconds>].
+bool parse_imu_window(const char *arg, ProgramOptions &opts) {
+  const char *start = arg ? arg : "";
+  char *end = nullptr;
+  long samples = std::strtol(start, &end, 10);
+  if (end == start || samples < 2 || samples > static_cast<long>(codec::kMaxImuWindowSamples)) {
+    logging::log(logging::Level::Error, "Invalid --imu-window size (2-", codec::kMaxImuWindowSamples,
+                 ", what fits in one record)");
+    return false;
+  }
+  opts.imu_window = static_cast<std::size_t>(samples);
+  if (*end == ':') {
+    const char *latency_start = end + 1;
+    long latency = std::strtol(latency_start, &end, 10);
+    if (end == latency_start || latency < 0 || latency > 60000) {
+      logging::log(logging::Level::Error, "Invalid --imu-window latency (0-60000 ms)");
+      return false;
+    }
+    opts.imu_window_ms = static_cast<int>(latency);
+  }
+  if (*end != '\0') {
+    logging::log(logging::Level::Error, "Invalid --imu-window value, expected <samples>[:<ms>]");
+    return false;
+  }
+  return true;
+}
+
+// Parses <samples>[:<seconds>].
+bool parse_history(const char *arg, ProgramOptions &opts) {
+  const char *start = arg ? arg : "";
+  char *end = nullptr;
+  long samples = std::strtol(start, &end, 10);
+  if (end == start || samples < 1 || samples > 65536) {
+    logging::log(logging::Level::Error, "Invalid --history size (1-65536)");
+    return false;
+  }
+  opts.history = static_cast<std::size_t>(samples);
+  if (*end == ':') {
+    const char *age_start = end + 1;
+    long age = std::strtol(age_start, &end, 10);
+    if (end == age_start || age < 0 || age > 86400) {
+      logging::log(logging::Level::Error, "Invalid --history age (0-86400 s)");
+      return false;
+    }
+    opts.history_s = static_cast<int>(age);
+  }
+  if (*end != '\0') {
+    logging::log(logging::Level::Error, "Invalid --history value, expected <samples>[:<s>]");
+    return false;
+  }
+  return true;
+}
+
+// Parses <channel>[,<channel>...].
+bool parse_adc_channels(const char *arg, std::uint16_t &mask) {
+  const char *cursor = arg ? arg : "";
+  mask = 0;
+  while (true) {
+    char *end = nullptr;
+    long channel = std::strtol(cursor, &end, 10);
+    if (end == cursor || channel < 0 || channel > 15 || (*end != ',' && *end != '\0')) {
+      logging::log(logging::Level::Error, "Invalid --adc-channels value, expected channels 0-15 separated by commas");
+      return false;
+    }
+    mask = static_cast<std::uint16_t>(mask | (1u << channel));
+    if (*end == '\0') {
+      return true;
+    }
+    cursor = end + 1;
+  }
+}
+
+// Parses <channel>=<hz>[:<n>[:mean|median]].
+bool parse_adc_sample(const char *arg, AdcSampleOption &sample) {
+  const char *start = arg ? arg : "";
+  char *end = nullptr;
+  long channel = std::strtol(start, &end, 10);
+  if (end == start || channel < 0 || channel > 15 || *end != '=') {
+    logging::log(logging::Level::Error, "Invalid --adc-sample value, expected <channel>=<hz>[:<n>[:mean|median]]");
+    return false;
+  }
+  sample.channel = static_cast<std::size_t>(channel);
+  const char *rate_start = end + 1;
+  sample.rate_hz = std::strtod(rate_start, &end);
+  if (end == rate_start || !(sample.rate_hz > 0.0 && sample.rate_hz <= 10000.0)) {
+    logging::log(logging::Level::Error, "Invalid --adc-sample rate for channel ", channel, " (up to 10000 Hz)");
+    return false;
+  }
+  if (*end == ':') {
+    const char *count_start = end + 1;
+    long count = std::strtol(count_start, &end, 10);
+    if (end == count_start || count < 1 || count > 64) {
+      logging::log(logging::Level::Error, "Invalid --adc-sample oversampling for channel ", channel, " (1-64)");
+      return false;
+    }
+    sample.oversample = static_cast<std::size_t>(count);
+    if (*end == ':') {
+      const std::string mode(end + 1);
+      if (mode != "mean" && mode != "median") {
+        logging::log(logging::Level::Error, "Invalid --adc-sample mode for channel ", channel, ", expected mean or median");
+        return false;
+      }
+      sample.median = mode == "median";
+      end += 1 + mode.size();
+    }
+  }
+  if (*end != '\0') {
+    logging::log(logging::Level::Error, "Invalid --adc-sample value, expected <channel>=<hz>[:<n>[:mean|median]]");
+    return false;
+  }
+  return true;
+}
+
+// Parses <accel>,<gyro>,<mag>.
+bool parse_imu_resolution(const char *arg, ProgramOptions &opts) {
+  const char *cursor = arg ? arg : "";
+  for (std::size_t idx = 0; idx < opts.imu_resolution.size(); ++idx) {
+    char *end = nullptr;
+    double step = std::strtod(cursor, &end);
+    const char separator = idx + 1 < opts.imu_resolution.size() ? ',' : '\0';
+    if (end == cursor || *end != separator || !(step > 0.0 && step <= 1000.0)) {
+      logging::log(logging::Level::Error, "Invalid --imu-resolution value, expected <accel>,<gyro>,<mag> steps > 0");
+      return false;
+    }
+    opts.imu_resolution[idx] = step;
+    cursor = end + 1;
+  }
+  return true;
+}
+
+} // namespace
+
 void print_usage(const char *prog) {
   std::cout << "Usage: " << prog << " [options]\n"
             << "  --interval <seconds>     Sampling interval (default: 1.0)\n"
             << "  --rc-channels <count>    Number of RC channels (default: 4)\n"
             << "  --once                   Read sensors only once\n"
-
+            << "  --imu-rate <hz>          IMU sampling rate (default: 1/interval)\n"
+            << "  --adc-rate <hz>          ADC sampling rate (default: 1/interval)\n"
+            << "  --baro-rate <hz>         Barometer sampling rate (default: 1/interval)\n"
+            << "  --gps-rate <hz>          GPS sampling rate (default: 1/interval)\n"
+            << "  --rc-rate <hz>           RC input sampling rate (default: 1/interval)\n"
+            << "  --baro-osr <ratio>       Barometer oversampling 256/512/1024/2048/4096 "
+               "(default: 4096)\n"
+            << "  --baro-temp-every <n>    Pressure samples per temperature conversion "
+               "(default: 1)\n"
+            << "  --encoding <text|binary> Payload encoding (default: text)\n"
+            << "  --shm                    Publish through zenoh shared memory\n"
+            << "  --shm-size <bytes>       Shared-memory pool size (default: 1048576)\n"
+            << "  --batch <topic>=<n>[:<ms>]  Batch up to n samples or ms milliseconds "
+               "per topic (imu/adc/barometer/gps/rcinput/attitude/imu/fused), repeatable\n"
+            << "  --queue-depth <n>        Samples buffered per sensor for the publisher thread (default: 64)\n"
+            << "  --overflow <policy>      drop-oldest (default) or drop-newest when a queue is full\n"
+            << "  --imu-fifo <hz>          Sample the IMUs into their hardware FIFOs at this rate "
+               "and burst-read them\n"
+            << "  --backend <source>       navio2 (default), sim or replay:<file>\n"
+            << "  --record-dir <dir>       Record every sample to flight log segments in dir\n"
+            << "  --record-segment-mb <n>  Flight log segment size in MiB (default: 64)\n"
+            << "  --record-segment-s <s>   Also start a new segment every s seconds (default: off)\n"
+            << "  --metrics-interval <s>   Seconds between pipeline metrics reports, 0 disables (default: 10)\n"
+            << "  --metrics-file <path>    Also write each metrics report as a Prometheus text file\n"
+            << "  --attitude <mode>        On-board attitude estimate: off (default), imu or marg\n"
+            << "  --attitude-beta <gain>   Attitude filter gain (default: 0.1)\n"
+            << "  --fusion-rate <hz|imu|off>  Fuse both IMUs on a grid at hz or at the IMU rate (default: off)\n"
+            << "  --imu-rotation <imu>=<r> Mounting rotation of MPU9250 or LSM9DS1: none, roll180, "
+               "pitch180, yaw90, yaw180 or yaw270, repeatable\n"
+            << "  --decimate <topic>=<hz>[,<hz>...]  Anti-aliased lower-rate copies of imu or adc, "
+               "each on <topic>/<hz>hz, repeatable\n"
+            << "  --heartbeat <s>          Publish ADC, barometer, GPS and RC samples only on change, "
+               "and at least every s seconds (default: 0, every sample)\n"
+            << "  --deadband <topic>[.<field>]=<v>  Change below v does not count, for adc, barometer, "
+               "gps or rcinput, repeatable\n"
+            << "  --imu-window <n>[:<ms>]  Publish IMU readings as compressed windows of up to n samples "
+               "(2-39), held at most ms milliseconds (default: 100)\n"
+            << "  --imu-resolution <a>,<g>,<m>  IMU window steps in m/s², rad/s and µT "
+               "(default: 0.001,0.0001,0.01)\n"
+            << "  --history <n>[:<s>]      Keep the last n samples per topic, at most s seconds old, "
+               "for history queries (default: off)\n"
+            << "  --adc-channels <ch>[,<ch>...]  ADC channels to read (default: all)\n"
+            << "  --adc-sample <ch>=<hz>[:<n>[:mean|median]]  Sample an ADC channel in the background at hz, "
+               "reducing every n reads to their mean (default) or median, repeatable\n"
             << "  --log-level <level>      Log verbosity "
                "(DEBUG/INFO/WARNING/ERROR/CRITICAL)\n"
             << "  --help                   Show this message\n";
@@ -31,6 +345,38 @@ bool parse_options(int argc, char *argv[], ProgramOptions &opts,
       {"interval", required_argument, nullptr, 't'},
       {"rc-channels", required_argument, nullptr, 'c'},
       {"once", no_argument, nullptr, 'o'},
+      {"imu-rate", required_argument, nullptr, kOptImuRate},
+      {"adc-rate", required_argument, nullptr, kOptAdcRate},
+      {"baro-rate", required_argument, nullptr, kOptBaroRate},
+      {"gps-rate", required_argument, nullptr, kOptGpsRate},
+      {"rc-rate", required_argument, nullptr, kOptRcRate},
+      {"baro-osr", required_argument, nullptr, kOptBaroOversampling},
+      {"baro-temp-every", required_argument, nullptr, kOptBaroTemperatureEvery},
+      {"encoding", required_argument, nullptr, kOptEncoding},
+      {"shm", no_argument, nullptr, kOptSharedMemory},
+      {"shm-size", required_argument, nullptr, kOptSharedMemorySize},
+      {"batch", required_argument, nullptr, kOptBatch},
+      {"queue-depth", required_argument, nullptr, kOptQueueDepth},
+      {"overflow", required_argument, nullptr, kOptOverflow},
+      {"imu-fifo", required_argument, nullptr, kOptImuFifo},
+      {"backend", required_argument, nullptr, kOptBackend},
+      {"record-dir", required_argument, nullptr, kOptRecordDir},
+      {"record-segment-mb", required_argument, nullptr, kOptRecordSegmentMb},
+      {"record-segment-s", required_argument, nullptr, kOptRecordSegmentS},
+      {"metrics-interval", required_argument, nullptr, kOptMetricsInterval},
+      {"metrics-file", required_argument, nullptr, kOptMetricsFile},
+      {"attitude", required_argument, nullptr, kOptAttitude},
+      {"attitude-beta", required_argument, nullptr, kOptAttitudeBeta},
+      {"fusion-rate", required_argument, nullptr, kOptFusionRate},
+      {"imu-rotation", required_argument, nullptr, kOptImuRotation},
+      {"decimate", required_argument, nullptr, kOptDecimate},
+      {"heartbeat", required_argument, nullptr, kOptHeartbeat},
+      {"deadband", required_argument, nullptr, kOptDeadband},
+      {"imu-window", required_argument, nullptr, kOptImuWindow},
+      {"imu-resolution", required_argument, nullptr, kOptImuResolution},
+      {"history", required_argument, nullptr, kOptHistory},
+      {"adc-channels", required_argument, nullptr, kOptAdcChannels},
+      {"adc-sample", required_argument, nullptr, kOptAdcSample},
       {"log-level", required_argument, nullptr, 'l'},
       {"help", no_argument, nullptr, 'h'},
       {nullptr, 0, nullptr, 0}};
@@ -52,7 +398,7 @@ bool parse_options(int argc, char *argv[], ProgramOptions &opts,
         return false;
       }
       opts.interval = value;
-      logging::log(logging::Level::Debug, "Interval set to " + std::to_string(value));
+      logging::log(logging::Level::Debug, "Interval set to ", value);
       break;
     }
 
@@ -69,7 +415,7 @@ bool parse_options(int argc, char *argv[], ProgramOptions &opts,
         return false;
       }
       opts.rc_channels = static_cast<int>(value);
-      logging::log(logging::Level::Debug, "RC channels set to " + std::to_string(value));
+      logging::log(logging::Level::Debug, "RC channels set to ", value);
       break;
     }
 
@@ -78,6 +424,348 @@ bool parse_options(int argc, char *argv[], ProgramOptions &opts,
       logging::log(logging::Level::Debug, "Once option set to true");
       break;
 
+    case kOptImuRate:
+      if (!parse_rate("imu-rate", optarg, opts.imu_rate)) {
+        return false;
+      }
+      break;
+
+    case kOptAdcRate:
+      if (!parse_rate("adc-rate", optarg, opts.adc_rate)) {
+        return false;
+      }
+      break;
+
+    case kOptBaroRate:
+      if (!parse_rate("baro-rate", optarg, opts.baro_rate)) {
+        return false;
+      }
+      break;
+
+    case kOptGpsRate:
+      if (!parse_rate("gps-rate", optarg, opts.gps_rate)) {
+        return false;
+      }
+      break;
+
+    case kOptRcRate:
+      if (!parse_rate("rc-rate", optarg, opts.rc_rate)) {
+        return false;
+      }
+      break;
+
+    case kOptBaroOversampling: {
+      if (!optarg) {
+        logging::log(logging::Level::Error, "Missing argument for --baro-osr");
+        return false;
+      }
+      char *end = nullptr;
+      long value = std::strtol(optarg, &end, 10);
+      if (!end || *end != '\0' ||
+          !BarometerSensor::valid_oversampling(static_cast<int>(value))) {
+        logging::log(logging::Level::Error, "Invalid barometer oversampling ratio");
+        return false;
+      }
+      opts.baro_oversampling = static_cast<int>(value);
+      logging::log(logging::Level::Debug, "Barometer oversampling set to ", value);
+      break;
+    }
+
+    case kOptBaroTemperatureEvery: {
+      if (!optarg) {
+        logging::log(logging::Level::Error, "Missing argument for --baro-temp-every");
+        return false;
+      }
+      char *end = nullptr;
+      long value = std::strtol(optarg, &end, 10);
+      if (!end || *end != '\0' || value <= 0 || value > 1000) {
+        logging::log(logging::Level::Error, "Invalid barometer temperature reuse count");
+        return false;
+      }
+      opts.baro_temperature_every = static_cast<int>(value);
+      logging::log(logging::Level::Debug, "Barometer temperature reuse set to ", value);
+      break;
+    }
+
+    case kOptEncoding: {
+      const std::string value = optarg ? optarg : "";
+      if (value == "text") {
+        opts.encoding = PayloadEncoding::Text;
+      } else if (value == "binary") {
+        opts.encoding = PayloadEncoding::Binary;
+      } else {
+        logging::log(logging::Level::Error, "Invalid encoding, expected text or binary");
+        return false;
+      }
+      logging::log(logging::Level::Debug, "Encoding set to ", value);
+      break;
+    }
+
+    case kOptSharedMemory:
+      opts.shared_memory = true;
+      logging::log(logging::Level::Debug, "Shared-memory publishing enabled");
+      break;
+
+    case kOptSharedMemorySize: {
+      if (!optarg) {
+        logging::log(logging::Level::Error, "Missing argument for --shm-size");
+        return false;
+      }
+      char *end = nullptr;
+      unsigned long long value = std::strtoull(optarg, &end, 10);
+      if (!end || *end != '\0' || value < 4096) {
+        logging::log(logging::Level::Error, "Invalid shared-memory size (minimum 4096 bytes)");
+        return false;
+      }
+      opts.shared_memory_size = static_cast<std::size_t>(value);
+      logging::log(logging::Level::Debug, "Shared-memory size set to ", value);
+      break;
+    }
+
+    case kOptBatch: {
+      BatchOption batch;
+      if (!parse_batch(optarg, batch)) {
+        return false;
+      }
+      logging::log(logging::Level::Debug, "Batching ", batch.topic, " up to ", batch.max_samples, " samples / ", batch.max_latency_ms, " ms");
+      opts.batches.push_back(batch);
+      break;
+    }
+
+    case kOptQueueDepth: {
+      char *end = nullptr;
+      long depth = optarg ? std::strtol(optarg, &end, 10) : 0;
+      if (!end || *end != '\0' || depth < 1 || depth > 65536) {
+        logging::log(logging::Level::Error, "Invalid queue depth, expected 1-65536");
+        return false;
+      }
+      opts.queue_depth = static_cast<std::size_t>(depth);
+      logging::log(logging::Level::Debug, "Queue depth set to ", opts.queue_depth);
+      break;
+    }
+
+    case kOptOverflow: {
+      const std::string value = optarg ? optarg : "";
+      if (value == "drop-oldest") {
+        opts.overflow = OverflowPolicy::DropOldest;
+      } else if (value == "drop-newest") {
+        opts.overflow = OverflowPolicy::DropNewest;
+      } else {
+        logging::log(logging::Level::Error, "Invalid overflow policy, expected drop-oldest or drop-newest");
+        return false;
+      }
+      logging::log(logging::Level::Debug, "Overflow policy set to ", value);
+      break;
+    }
+
+    case kOptImuFifo:
+      if (!parse_rate("imu-fifo", optarg, opts.imu_fifo_odr)) {
+        return false;
+      }
+      break;
+
+    case kOptBackend: {
+      const std::string value = optarg ? optarg : "";
+      const std::string replay_prefix = "replay:";
+      if (value == "navio2") {
+        opts.backend = BackendKind::Navio2;
+      } else if (value == "sim") {
+        opts.backend = BackendKind::Sim;
+      } else if (value.compare(0, replay_prefix.size(), replay_prefix) == 0 &&
+                 value.size() > replay_prefix.size()) {
+        opts.backend = BackendKind::Replay;
+        opts.replay_file = value.substr(replay_prefix.size());
+      } else {
+        logging::log(logging::Level::Error, "Invalid backend, expected navio2, sim or replay:<file>");
+        return false;
+      }
+      logging::log(logging::Level::Debug, "Backend set to ", value);
+      break;
+    }
+
+    case kOptRecordDir:
+      if (!optarg || *optarg == '\0') {
+        logging::log(logging::Level::Error, "Missing argument for --record-dir");
+        return false;
+      }
+      opts.record_dir = optarg;
+      logging::log(logging::Level::Debug, "Recording to ", opts.record_dir);
+      break;
+
+    case kOptRecordSegmentMb: {
+      char *end = nullptr;
+      long size = optarg ? std::strtol(optarg, &end, 10) : 0;
+      if (!end || *end != '\0' || size < 1 || size > 4096) {
+        logging::log(logging::Level::Error, "Invalid flight log segment size, expected 1-4096 MiB");
+        return false;
+      }
+      opts.record_segment_mb = static_cast<std::size_t>(size);
+      logging::log(logging::Level::Debug, "Flight log segment size set to ", size, " MiB");
+      break;
+    }
+
+    case kOptRecordSegmentS: {
+      char *end = nullptr;
+      long seconds = optarg ? std::strtol(optarg, &end, 10) : 0;
+      if (!end || *end != '\0' || seconds < 0 || seconds > 86400) {
+        logging::log(logging::Level::Error, "Invalid flight log segment duration, expected 0-86400 s");
+        return false;
+      }
+      opts.record_segment_s = static_cast<int>(seconds);
+      logging::log(logging::Level::Debug, "Flight log segment duration set to ", seconds, " s");
+      break;
+    }
+
+    case kOptMetricsInterval: {
+      char *end = nullptr;
+      long seconds = optarg ? std::strtol(optarg, &end, 10) : 0;
+      if (!end || *end != '\0' || seconds < 0 || seconds > 3600) {
+        logging::log(logging::Level::Error, "Invalid metrics interval, expected 0-3600 s");
+        return false;
+      }
+      opts.metrics_interval_s = static_cast<int>(seconds);
+      logging::log(logging::Level::Debug, "Metrics interval set to ", seconds, " s");
+      break;
+    }
+
+    case kOptMetricsFile:
+      if (!optarg || *optarg == '\0') {
+        logging::log(logging::Level::Error, "Missing argument for --metrics-file");
+        return false;
+      }
+      opts.metrics_file = optarg;
+      logging::log(logging::Level::Debug, "Metrics file set to ", opts.metrics_file);
+      break;
+
+    case kOptAttitude: {
+      const std::string value = optarg ? optarg : "";
+      if (value == "off") {
+        opts.attitude = AttitudeMode::Off;
+      } else if (value == "imu") {
+        opts.attitude = AttitudeMode::Imu;
+      } else if (value == "marg") {
+        opts.attitude = AttitudeMode::Marg;
+      } else {
+        logging::log(logging::Level::Error, "Invalid attitude mode, expected off, imu or marg");
+        return false;
+      }
+      logging::log(logging::Level::Debug, "Attitude mode set to ", value);
+      break;
+    }
+
+    case kOptAttitudeBeta: {
+      char *end = nullptr;
+      double beta = optarg ? std::strtod(optarg, &end) : -1.0;
+      if (!end || *end != '\0' || !(beta >= 0.0 && beta <= 1.0)) {
+        logging::log(logging::Level::Error, "Invalid attitude filter gain, expected 0-1");
+        return false;
+      }
+      opts.attitude_beta = beta;
+      logging::log(logging::Level::Debug, "Attitude filter gain set to ", beta);
+      break;
+    }
+
+    case kOptFusionRate:
+      if (optarg && std::string(optarg) == "off") {
+        opts.fusion = false;
+        logging::log(logging::Level::Debug, "IMU fusion disabled");
+        break;
+      }
+      if (optarg && std::string(optarg) == "imu") {
+        opts.fusion = true;
+        opts.fusion_rate = 0.0;
+        logging::log(logging::Level::Debug, "IMU fusion at the IMU rate");
+        break;
+      }
+      if (!parse_rate("fusion-rate", optarg, opts.fusion_rate)) {
+        return false;
+      }
+      opts.fusion = true;
+      break;
+
+    case kOptImuRotation: {
+      const std::string value = optarg ? optarg : "";
+      const std::size_t equals = value.find('=');
+      if (equals == std::string::npos || equals == 0 || equals + 1 == value.size()) {
+        logging::log(logging::Level::Error, "Invalid --imu-rotation value, expected <imu>=<rotation>");
+        return false;
+      }
+      opts.imu_rotations.push_back({value.substr(0, equals), value.substr(equals + 1)});
+      logging::log(logging::Level::Debug, "IMU rotation ", value);
+      break;
+    }
+
+    case kOptDecimate: {
+      DecimateOption decimate;
+      if (!parse_decimate(optarg, decimate)) {
+        return false;
+      }
+      logging::log(logging::Level::Debug, "Decimating ", decimate.topic, " to ", decimate.rates_hz.size(), " rates");
+      opts.decimations.push_back(decimate);
+      break;
+    }
+
+    case kOptHeartbeat: {
+      char *end = nullptr;
+      double seconds = optarg ? std::strtod(optarg, &end) : -1.0;
+      if (!end || *end != '\0' || !(seconds >= 0.0 && seconds <= 3600.0)) {
+        logging::log(logging::Level::Error, "Invalid heartbeat, expected 0-3600 s");
+        return false;
+      }
+      opts.heartbeat_s = seconds;
+      logging::log(logging::Level::Debug, "Heartbeat set to ", seconds, " s");
+      break;
+    }
+
+    case kOptDeadband: {
+      DeadbandOption deadband;
+      if (!parse_deadband(optarg, deadband)) {
+        return false;
+      }
+      logging::log(logging::Level::Debug, "Deadband of ", deadband.topic, (deadband.field.empty() ? "" : "."),
+                   deadband.field, " set to ", deadband.deadband);
+      opts.deadbands.push_back(deadband);
+      break;
+    }
+
+    case kOptImuWindow:
+      if (!parse_imu_window(optarg, opts)) {
+        return false;
+      }
+      logging::log(logging::Level::Debug, "IMU windows of ", opts.imu_window, " samples / ", opts.imu_window_ms, " ms");
+      break;
+
+    case kOptImuResolution:
+      if (!parse_imu_resolution(optarg, opts)) {
+        return false;
+      }
+      logging::log(logging::Level::Debug, "IMU window resolution set");
+      break;
+
+    case kOptHistory:
+      if (!parse_history(optarg, opts)) {
+        return false;
+      }
+      logging::log(logging::Level::Debug, "History of ", opts.history, " samples / ", opts.history_s, " s");
+      break;
+
+    case kOptAdcChannels:
+      if (!parse_adc_channels(optarg, opts.adc_channels)) {
+        return false;
+      }
+      logging::log(logging::Level::Debug, "ADC channel mask set to ", opts.adc_channels);
+      break;
+
+    case kOptAdcSample: {
+      AdcSampleOption sample;
+      if (!parse_adc_sample(optarg, sample)) {
+        return false;
+      }
+      logging::log(logging::Level::Debug, "ADC channel ", sample.channel, " sampled at ", sample.rate_hz, " Hz");
+      opts.adc_samples.push_back(sample);
+      break;
+    }
+
     case 'l':
       if (!optarg || !logging::set_level(optarg)) {
         logging::log(logging::Level::Error, "Invalid log level");
@@ -101,12 +789,11 @@ bool parse_options(int argc, char *argv[], ProgramOptions &opts,
   return true;
 }
 
-std::string current_timestamp() {
-  logging::log(logging::Level::Debug, "Getting current timestamp");
-  std::time_t now = std::time(nullptr);
-  std::string timestamp = std::to_string(static_cast<long long>(now));
-  logging::log(logging::Level::Debug, "Timestamp: " + timestamp);
-  return timestamp;
+double sensor_rate(double rate_hz, const ProgramOptions &opts) {
+  if (rate_hz > 0.0) {
+    return rate_hz;
+  }
+  return opts.interval > 0.0 ? 1.0 / opts.interval : 0.0;
 }
 
 } // namespace utils
@@ -0,0 +1,126 @@
+#include "acquisition.h"
+#include "logging.h"
+#include "pipeline_options.h"
+#include "sensor_backend.h"
+#include "telemetry_publisher.h"
+#include "utils.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+// sensors_read_alloc_test: builds the acquisition pipelines on the simulated
+// backend and fails if running their tasks allocates once every task has
+// run once. The arguments are sensors_read options, so each CTest entry can
+// cover a different set of stages (--encoding, --imu-window, --decimate...).
+
+namespace {
+
+std::atomic<std::uint64_t> g_allocations{0};
+
+// Only the thread running the tasks counts, as one acquisition worker
+// would: the publisher thread and the Zenoh session allocate on their own
+// schedule.
+thread_local bool t_counting = false;
+
+void *counted_alloc(std::size_t size) {
+    if (t_counting) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *counted_aligned_alloc(std::size_t size, std::align_val_t align) {
+    if (t_counting) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    const auto alignment = static_cast<std::size_t>(align);
+    // aligned_alloc wants the size to be a multiple of the alignment.
+    const std::size_t rounded = (size + alignment - 1) / alignment * alignment;
+    if (void *ptr = std::aligned_alloc(alignment, rounded ? rounded : alignment)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+// Cycles run after the warm-up; enough to wrap every publish ring.
+constexpr int kCycles = 1000;
+
+} // namespace
+
+void *operator new(std::size_t size) { return counted_alloc(size); }
+void *operator new[](std::size_t size) { return counted_alloc(size); }
+void *operator new(std::size_t size, std::align_val_t align) { return counted_aligned_alloc(size, align); }
+void *operator new[](std::size_t size, std::align_val_t align) { return counted_aligned_alloc(size, align); }
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+int main(int argc, char *argv[]) {
+    std::vector<char *> args(argv, argv + argc);
+    char backend_option[] = "--backend";
+    char backend_name[] = "sim";
+    args.insert(args.begin() + 1, {backend_option, backend_name});
+    utils::ProgramOptions options;
+    bool show_help = false;
+    if (!utils::parse_options(static_cast<int>(args.size()), args.data(), options, show_help) || show_help) {
+        return EXIT_FAILURE;
+    }
+    if (options.once) {
+        std::fprintf(stderr, "--once runs no acquisition tasks\n");
+        return EXIT_FAILURE;
+    }
+    logging::set_level(logging::Level::Warning);
+
+    std::unique_ptr<SensorBackend> backend = make_sim_backend();
+    telemetry::PublisherOptions publisher_options;
+    publisher_options.history_samples = options.history;
+    publisher_options.history_age = std::chrono::seconds(options.history_s);
+    telemetry::TelemetryPublisher publisher(publisher_options);
+    if (!publisher.ready() || !configure_batching(options, publisher)) {
+        return EXIT_FAILURE;
+    }
+    Acquisition acquisition(options, backend.get(), publisher);
+    if (!acquisition.init()) {
+        return EXIT_FAILURE;
+    }
+    const std::vector<PipelineTask> &tasks = acquisition.tasks();
+    acquisition.start();
+
+    // The first cycle sizes every buffer that grows to its working capacity.
+    for (const PipelineTask &task : tasks) {
+        task.run();
+    }
+    std::vector<std::uint64_t> allocations(tasks.size(), 0);
+    for (int cycle = 0; cycle < kCycles; ++cycle) {
+        for (std::size_t idx = 0; idx < tasks.size(); ++idx) {
+            const std::uint64_t before = g_allocations.load(std::memory_order_relaxed);
+            t_counting = true;
+            tasks[idx].run();
+            t_counting = false;
+            allocations[idx] += g_allocations.load(std::memory_order_relaxed) - before;
+        }
+    }
+    acquisition.finish();
+
+    bool failed = false;
+    for (std::size_t idx = 0; idx < tasks.size(); ++idx) {
+        std::printf("%-12s %8llu allocations in %d cycles\n", tasks[idx].name.c_str(),
+                    static_cast<unsigned long long>(allocations[idx]), kCycles);
+        failed = failed || allocations[idx] != 0;
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
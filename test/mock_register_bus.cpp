@@ -0,0 +1,205 @@
+#include "mock_register_bus.h"
+
+#include "imu_registers.h"
+
+namespace {
+
+void put_big_endian(std::deque<std::uint8_t> &out, std::int16_t value) {
+    out.push_back(static_cast<std::uint8_t>(static_cast<std::uint16_t>(value) >> 8));
+    out.push_back(static_cast<std::uint8_t>(value & 0xFF));
+}
+
+std::array<std::uint8_t, 6> little_endian_block(const std::array<std::int16_t, 3> &axes) {
+    std::array<std::uint8_t, 6> block{};
+    for (std::size_t idx = 0; idx < axes.size(); ++idx) {
+        const auto value = static_cast<std::uint16_t>(axes[idx]);
+        block[2 * idx] = static_cast<std::uint8_t>(value & 0xFF);
+        block[2 * idx + 1] = static_cast<std::uint8_t>(value >> 8);
+    }
+    return block;
+}
+
+} // namespace
+
+bool MockRegisterBus::read(std::uint8_t reg, std::span<std::uint8_t> out) {
+    ++transfers_;
+    std::uint8_t address = reg & 0x7F;
+    for (std::uint8_t &byte : out) {
+        byte = on_read(address);
+        address = next_address(address);
+    }
+    return true;
+}
+
+bool MockRegisterBus::write(std::uint8_t reg, std::uint8_t value) {
+    ++transfers_;
+    on_write(reg & 0x7F, value);
+    return true;
+}
+
+void MockRegisterBus::set_register(std::uint8_t reg, std::uint8_t value) {
+    registers_[reg & 0x7F] = value;
+}
+
+std::uint8_t MockRegisterBus::register_value(std::uint8_t reg) const {
+    return registers_[reg & 0x7F];
+}
+
+std::uint8_t MockRegisterBus::on_read(std::uint8_t reg) { return registers_[reg]; }
+
+void MockRegisterBus::on_write(std::uint8_t reg, std::uint8_t value) {
+    registers_[reg] = value;
+}
+
+std::uint8_t MockRegisterBus::next_address(std::uint8_t reg) const {
+    return static_cast<std::uint8_t>((reg + 1) & 0x7F);
+}
+
+bool MockMpu9250Bus::fifo_enabled() const {
+    using namespace mpu9250_reg;
+    return (registers_[kUserCtrl] & kUserCtrlFifoEnable) != 0 &&
+           registers_[kFifoEnable] == kFifoEnableAccelGyro;
+}
+
+void MockMpu9250Bus::push_sample(const std::array<std::int16_t, 3> &accel,
+                                 const std::array<std::int16_t, 3> &gyro) {
+    using namespace mpu9250_reg;
+    if (!fifo_enabled()) {
+        return;
+    }
+    if (fifo_.size() + kFifoFrameBytes > kFifoBytes) {
+        registers_[kIntStatus] |= kIntStatusFifoOverflow;
+        if ((registers_[kConfig] & kConfigFifoMode) != 0) {
+            return;
+        }
+        fifo_.erase(fifo_.begin(), fifo_.begin() + kFifoFrameBytes);
+    }
+    for (std::int16_t value : accel) {
+        put_big_endian(fifo_, value);
+    }
+    for (std::int16_t value : gyro) {
+        put_big_endian(fifo_, value);
+    }
+}
+
+std::uint8_t MockMpu9250Bus::on_read(std::uint8_t reg) {
+    using namespace mpu9250_reg;
+    switch (reg) {
+    case kFifoCountH:
+        return static_cast<std::uint8_t>((fifo_.size() >> 8) & 0x1F);
+    case kFifoCountL:
+        return static_cast<std::uint8_t>(fifo_.size() & 0xFF);
+    case kFifoRw: {
+        if (fifo_.empty()) {
+            return 0;
+        }
+        const std::uint8_t byte = fifo_.front();
+        fifo_.pop_front();
+        return byte;
+    }
+    case kIntStatus: {
+        // Interrupt status bits clear on read.
+        const std::uint8_t status = registers_[kIntStatus];
+        registers_[kIntStatus] = 0;
+        return status;
+    }
+    default:
+        return registers_[reg];
+    }
+}
+
+void MockMpu9250Bus::on_write(std::uint8_t reg, std::uint8_t value) {
+    using namespace mpu9250_reg;
+    if (reg == kUserCtrl && (value & kUserCtrlFifoReset) != 0) {
+        fifo_.clear();
+        value = static_cast<std::uint8_t>(value & ~kUserCtrlFifoReset);
+    }
+    registers_[reg] = value;
+}
+
+std::uint8_t MockMpu9250Bus::next_address(std::uint8_t reg) const {
+    // Bursts on FIFO_R_W keep reading the FIFO.
+    return reg == mpu9250_reg::kFifoRw ? reg : MockRegisterBus::next_address(reg);
+}
+
+bool MockLsm9ds1Bus::fifo_enabled() const {
+    using namespace lsm9ds1_reg;
+    return (registers_[kCtrlReg9] & kCtrlReg9FifoEnable) != 0 &&
+           (registers_[kFifoCtrl] & 0xE0) == kFifoModeStopWhenFull;
+}
+
+std::size_t MockLsm9ds1Bus::fifo_samples() const {
+    return accel_.size() > gyro_.size() ? accel_.size() : gyro_.size();
+}
+
+void MockLsm9ds1Bus::push_sample(const std::array<std::int16_t, 3> &accel,
+                                 const std::array<std::int16_t, 3> &gyro) {
+    using namespace lsm9ds1_reg;
+    const Block accel_block = little_endian_block(accel);
+    const Block gyro_block = little_endian_block(gyro);
+    if (!fifo_enabled()) {
+        // Without the FIFO the output registers hold the latest sample.
+        for (std::size_t idx = 0; idx < kAxisBlockBytes; ++idx) {
+            registers_[kOutXLXL + idx] = accel_block[idx];
+            registers_[kOutXLG + idx] = gyro_block[idx];
+        }
+        return;
+    }
+    if (fifo_samples() >= kFifoSamples) {
+        overrun_ = true;
+        return;
+    }
+    accel_.push_back(accel_block);
+    gyro_.push_back(gyro_block);
+}
+
+std::uint8_t MockLsm9ds1Bus::read_block(std::deque<Block> &queue, std::size_t index) {
+    if (queue.empty()) {
+        return 0;
+    }
+    const std::uint8_t byte = queue.front()[index];
+    if (index + 1 == queue.front().size()) {
+        queue.pop_front();
+    }
+    return byte;
+}
+
+std::uint8_t MockLsm9ds1Bus::on_read(std::uint8_t reg) {
+    using namespace lsm9ds1_reg;
+    if (reg == kFifoSrc) {
+        return static_cast<std::uint8_t>((overrun_ ? kFifoSrcOverrun : 0) |
+                                         (fifo_samples() & kFifoSrcLevelMask));
+    }
+    if (fifo_enabled()) {
+        if (reg >= kOutXLXL && reg < kOutXLXL + kAxisBlockBytes) {
+            return read_block(accel_, reg - kOutXLXL);
+        }
+        if (reg >= kOutXLG && reg < kOutXLG + kAxisBlockBytes) {
+            return read_block(gyro_, reg - kOutXLG);
+        }
+    }
+    return registers_[reg];
+}
+
+void MockLsm9ds1Bus::on_write(std::uint8_t reg, std::uint8_t value) {
+    using namespace lsm9ds1_reg;
+    if (reg == kFifoCtrl && (value & 0xE0) == kFifoModeBypass) {
+        accel_.clear();
+        gyro_.clear();
+        overrun_ = false;
+    }
+    registers_[reg] = value;
+}
+
+std::uint8_t MockLsm9ds1Bus::next_address(std::uint8_t reg) const {
+    using namespace lsm9ds1_reg;
+    if (fifo_enabled()) {
+        if (reg == kOutXLXL + kAxisBlockBytes - 1) {
+            return kOutXLXL;
+        }
+        if (reg == kOutXLG + kAxisBlockBytes - 1) {
+            return kOutXLG;
+        }
+    }
+    return MockRegisterBus::next_address(reg);
+}
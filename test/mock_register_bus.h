@@ -0,0 +1,77 @@
+#pragma once
+
+#include "register_bus.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Register models standing in for spidev, so register-level drivers can be
+// exercised without a Navio2. Every read() or write() counts as one
+// transfer.
+class MockRegisterBus : public RegisterBus {
+public:
+    bool read(std::uint8_t reg, std::span<std::uint8_t> out) override;
+    bool write(std::uint8_t reg, std::uint8_t value) override;
+
+    void set_register(std::uint8_t reg, std::uint8_t value);
+    std::uint8_t register_value(std::uint8_t reg) const;
+    std::size_t transfers() const { return transfers_; }
+
+protected:
+    // Hooks for device models; the defaults behave as plain registers with
+    // address auto-increment.
+    virtual std::uint8_t on_read(std::uint8_t reg);
+    virtual void on_write(std::uint8_t reg, std::uint8_t value);
+    virtual std::uint8_t next_address(std::uint8_t reg) const;
+
+    std::array<std::uint8_t, 128> registers_{};
+
+private:
+    std::size_t transfers_ = 0;
+};
+
+// MPU9250 FIFO model: 512 bytes of 12-byte accel/gyro frames, drained
+// through FIFO_R_W, in stop-when-full mode.
+class MockMpu9250Bus : public MockRegisterBus {
+public:
+    // Raw big-endian register values as the chip would sample them. Ignored
+    // while the FIFO is disabled.
+    void push_sample(const std::array<std::int16_t, 3> &accel, const std::array<std::int16_t, 3> &gyro);
+    std::size_t fifo_bytes() const { return fifo_.size(); }
+
+protected:
+    std::uint8_t on_read(std::uint8_t reg) override;
+    void on_write(std::uint8_t reg, std::uint8_t value) override;
+    std::uint8_t next_address(std::uint8_t reg) const override;
+
+private:
+    bool fifo_enabled() const;
+
+    std::deque<std::uint8_t> fifo_;
+};
+
+// LSM9DS1 accelerometer/gyroscope FIFO model: 32 samples, with the accel
+// and gyro output blocks each rolling over onto the next queued sample.
+class MockLsm9ds1Bus : public MockRegisterBus {
+public:
+    void push_sample(const std::array<std::int16_t, 3> &accel, const std::array<std::int16_t, 3> &gyro);
+    std::size_t fifo_samples() const;
+
+protected:
+    std::uint8_t on_read(std::uint8_t reg) override;
+    void on_write(std::uint8_t reg, std::uint8_t value) override;
+    std::uint8_t next_address(std::uint8_t reg) const override;
+
+private:
+    using Block = std::array<std::uint8_t, 6>;
+
+    bool fifo_enabled() const;
+    // Returns a byte of the oldest queued block, popping it after its last byte.
+    static std::uint8_t read_block(std::deque<Block> &queue, std::size_t index);
+
+    std::deque<Block> accel_;
+    std::deque<Block> gyro_;
+    bool overrun_ = false;
+};
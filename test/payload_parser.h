@@ -0,0 +1,254 @@
+#pragma once
+
+#include "telemetry_codec.h"
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <system_error>
+
+// Typed decode of the text payloads into the binary codec records, shared by
+// the subscriber and the benchmarks. Everything works on string_views into
+// the received payload and numbers are parsed with std::from_chars, so
+// decoding never copies or allocates.
+
+enum class Topic { Imu, Adc, Barometer, Gps, RcInput, Attitude, FusedImu, Unknown };
+
+constexpr std::string_view kSensorsTopicPrefix = "telemetry/sensors/";
+
+// Maps a sample's key expression to the sensor it carries.
+inline Topic topic_of(std::string_view key) {
+    if (key.substr(0, kSensorsTopicPrefix.size()) != kSensorsTopicPrefix) {
+        return Topic::Unknown;
+    }
+    const std::string_view name = key.substr(kSensorsTopicPrefix.size());
+    if (name == "imu") {
+        return Topic::Imu;
+    }
+    if (name == "adc") {
+        return Topic::Adc;
+    }
+    if (name == "barometer") {
+        return Topic::Barometer;
+    }
+    if (name == "gps") {
+        return Topic::Gps;
+    }
+    if (name == "rcinput") {
+        return Topic::RcInput;
+    }
+    if (name == "attitude") {
+        return Topic::Attitude;
+    }
+    if (name == "imu/fused") {
+        return Topic::FusedImu;
+    }
+    return Topic::Unknown;
+}
+
+// Calls visit(key, value) for every key=value field of a text payload.
+template <typename Visit>
+void for_each_field(std::string_view payload, Visit&& visit) {
+    while (!payload.empty()) {
+        const std::size_t end = payload.find(' ');
+        const std::string_view item = payload.substr(0, end);
+        const std::size_t equals = item.find('=');
+        if (equals != std::string_view::npos) {
+            visit(item.substr(0, equals), item.substr(equals + 1));
+        }
+        if (end == std::string_view::npos) {
+            break;
+        }
+        payload.remove_prefix(end + 1);
+    }
+}
+
+template <typename T>
+bool parse_number(std::string_view text, T& value) {
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+// Handles the time fields that lead every payload. Publishers older than the
+// nanosecond stamps only send whole seconds.
+inline bool parse_time_field(std::string_view key, std::string_view value, SampleTime& time) {
+    std::int64_t number = 0;
+    if (key == "timestamp") {
+        if (time.monotonic_ns == 0 && time.realtime_offset_ns == 0 && parse_number(value, number)) {
+            time.realtime_offset_ns = number * 1000000000;
+        }
+        return true;
+    }
+    if (key == "mono_ns") {
+        const std::int64_t unix_ns = time.unix_ns();
+        if (parse_number(value, number)) {
+            time.monotonic_ns = number;
+            time.realtime_offset_ns = unix_ns - number;
+        }
+        return true;
+    }
+    if (key == "rt_offset_ns") {
+        if (parse_number(value, number)) {
+            time.realtime_offset_ns = number;
+        }
+        return true;
+    }
+    return false;
+}
+
+inline bool parse_text(std::string_view payload, codec::ImuRecord& record) {
+    record = {};
+    for_each_field(payload, [&record](std::string_view key, std::string_view value) {
+        if (parse_time_field(key, value, record.time)) {
+            return;
+        }
+        if (key == "name") {
+            record.device = value == "MPU9250"   ? codec::ImuDevice::Mpu9250
+                            : value == "LSM9DS1" ? codec::ImuDevice::Lsm9ds1
+                                                 : codec::ImuDevice::Unknown;
+            return;
+        }
+        static constexpr std::string_view kVectors = "agm";
+        static constexpr std::string_view kAxes = "xyz";
+        const std::size_t vector = key.size() == 2 ? kVectors.find(key[0]) : std::string_view::npos;
+        const std::size_t axis = key.size() == 2 ? kAxes.find(key[1]) : std::string_view::npos;
+        if (vector == std::string_view::npos || axis == std::string_view::npos) {
+            return;
+        }
+        float* const fields[3][3] = {{&record.ax, &record.ay, &record.az},
+                                     {&record.gx, &record.gy, &record.gz},
+                                     {&record.mx, &record.my, &record.mz}};
+        if (parse_number(value, *fields[vector][axis])) {
+            record.valid = true;
+        }
+    });
+    return record.valid && record.device != codec::ImuDevice::Unknown;
+}
+
+inline bool parse_text(std::string_view payload, codec::AdcRecord& record) {
+    record = {};
+    for_each_field(payload, [&record](std::string_view key, std::string_view value) {
+        std::size_t channel = 0;
+        if (parse_time_field(key, value, record.time) || key.size() < 2 || key[0] != 'a' ||
+            !parse_number(key.substr(1), channel) || channel >= codec::kMaxAdcChannels) {
+            return;
+        }
+        if (parse_number(value, record.values[channel]) && channel >= record.count) {
+            record.count = static_cast<std::uint8_t>(channel + 1);
+        }
+    });
+    return record.count > 0;
+}
+
+inline bool parse_text(std::string_view payload, codec::BarometerRecord& record) {
+    record = {};
+    bool temperature = false;
+    bool pressure = false;
+    for_each_field(payload, [&](std::string_view key, std::string_view value) {
+        if (parse_time_field(key, value, record.time)) {
+            return;
+        }
+        if (key == "temperature") {
+            temperature = parse_number(value, record.temperature_c);
+        } else if (key == "pressure") {
+            pressure = parse_number(value, record.pressure_mbar);
+        }
+    });
+    record.valid = temperature && pressure;
+    return record.valid;
+}
+
+inline bool parse_text(std::string_view payload, codec::GpsRecord& record) {
+    record = {};
+    for_each_field(payload, [&record](std::string_view key, std::string_view value) {
+        if (parse_time_field(key, value, record.time)) {
+            return;
+        }
+        if (key == "fix_type") {
+            record.has_status = parse_number(value, record.fix_type);
+        } else if (key == "lat") {
+            record.has_position = parse_number(value, record.latitude_deg);
+        } else if (key == "lon") {
+            parse_number(value, record.longitude_deg);
+        } else if (key == "height") {
+            parse_number(value, record.height_m);
+        } else if (key == "vel_n") {
+            record.has_velocity = parse_number(value, record.velocity_north_mps);
+        } else if (key == "vel_e") {
+            parse_number(value, record.velocity_east_mps);
+        } else if (key == "vel_d") {
+            parse_number(value, record.velocity_down_mps);
+        } else if (key == "speed") {
+            parse_number(value, record.ground_speed_mps);
+        } else if (key == "heading") {
+            parse_number(value, record.heading_deg);
+        }
+    });
+    return record.has_position || record.has_status;
+}
+
+inline bool parse_text(std::string_view payload, codec::AttitudeRecord& record) {
+    record = {};
+    for_each_field(payload, [&record](std::string_view key, std::string_view value) {
+        if (parse_time_field(key, value, record.time)) {
+            return;
+        }
+        if (key == "name") {
+            record.device = codec::imu_device(value);
+            return;
+        }
+        static constexpr std::string_view kKeys[] = {"qw", "qx", "qy", "qz", "roll", "pitch", "yaw"};
+        float* const fields[] = {&record.qw, &record.qx, &record.qy, &record.qz,
+                                 &record.roll_deg, &record.pitch_deg, &record.yaw_deg};
+        for (std::size_t idx = 0; idx < std::size(kKeys); ++idx) {
+            if (key == kKeys[idx] && parse_number(value, *fields[idx])) {
+                record.valid = true;
+            }
+        }
+    });
+    return record.valid && record.device != codec::ImuDevice::Unknown;
+}
+
+inline bool parse_text(std::string_view payload, codec::FusedImuRecord& record) {
+    record = {};
+    for_each_field(payload, [&record](std::string_view key, std::string_view value) {
+        if (parse_time_field(key, value, record.time)) {
+            return;
+        }
+        if (key == "source") {
+            record.sources = value == "both" ? 0x03 : value == "MPU9250" ? 0x01 : value == "LSM9DS1" ? 0x02 : 0x00;
+            return;
+        }
+        static constexpr std::string_view kKeys[] = {"ax", "ay", "az", "gx", "gy", "gz", "mx", "my", "mz",
+                                                     "res_a", "res_g", "res_m"};
+        float* const fields[] = {&record.ax, &record.ay, &record.az, &record.gx, &record.gy, &record.gz,
+                                 &record.mx, &record.my, &record.mz, &record.accel_residual,
+                                 &record.gyro_residual, &record.mag_residual};
+        for (std::size_t idx = 0; idx < std::size(kKeys); ++idx) {
+            if (key == kKeys[idx] && parse_number(value, *fields[idx])) {
+                record.valid = true;
+            }
+        }
+    });
+    return record.valid && record.sources != 0;
+}
+
+// Stick axes of the text format, in RcInputRecord order.
+constexpr std::string_view kRcAxisNames[] = {"roll", "pitch", "throttle", "yaw"};
+
+inline bool parse_text(std::string_view payload, codec::RcInputRecord& record) {
+    record = {};
+    for_each_field(payload, [&record](std::string_view key, std::string_view value) {
+        if (parse_time_field(key, value, record.time)) {
+            return;
+        }
+        for (std::size_t idx = 0; idx < std::size(kRcAxisNames); ++idx) {
+            if (key == kRcAxisNames[idx] && parse_number(value, record.axes[idx]) && idx >= record.count) {
+                record.count = static_cast<std::uint8_t>(idx + 1);
+            }
+        }
+    });
+    return record.count > 0;
+}
@@ -1,97 +1,337 @@
 #include <iostream>
-#include <map>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <chrono>
 #include <ctime>
 #include <cstring>
-#include <sstream>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <span>
 #include <vector>
 #include <zenoh.hxx>
 
-// A struct to hold the latest sensor readings
+#include "payload_parser.h"
+#include "seqlock.h"
+#include "telemetry_codec.h"
+#include "topic_stats.h"
+
+// Latest decoded sample of one sensor; present is false until a usable
+// sample arrived or after the sensor reported itself unavailable.
+template <typename Record>
+struct LatestSample {
+    bool present = false;
+    Record record;
+};
+
+// Each sensor's latest sample is published through its own seqlock: the
+// Zenoh callbacks overwrite it in place and the render loop copies it out,
+// so neither side ever waits on the other.
 struct SensorReadings {
-    std::map<std::string, std::string> imu_mpu9250;
-    std::map<std::string, std::string> imu_lsm9ds1;
-    std::map<std::string, std::string> adc;
-    std::map<std::string, std::string> barometer;
-    std::map<std::string, std::string> gps;
-    std::map<std::string, std::string> rcinput;
+    SeqLock<LatestSample<codec::ImuRecord>> imu_mpu9250;
+    SeqLock<LatestSample<codec::ImuRecord>> imu_lsm9ds1;
+    SeqLock<LatestSample<codec::AdcRecord>> adc;
+    SeqLock<LatestSample<codec::BarometerRecord>> barometer;
+    SeqLock<LatestSample<codec::GpsRecord>> gps;
+    SeqLock<LatestSample<codec::RcInputRecord>> rcinput;
+    SeqLock<LatestSample<codec::AttitudeRecord>> attitude_mpu9250;
+    SeqLock<LatestSample<codec::AttitudeRecord>> attitude_lsm9ds1;
+    SeqLock<LatestSample<codec::FusedImuRecord>> imu_fused;
 };
 
 SensorReadings g_sensor_readings;
-std::mutex g_readings_mutex;
+
+// --record <file>: every binary payload, framed as a capture file that
+// `sensors_read --backend replay:<file>` can play back.
+std::ofstream g_capture;
+std::mutex g_capture_mutex;
+
+void record_payload(std::span<const std::uint8_t> bytes) {
+    if (bytes.size() > 0xFFFF) {
+        return;
+    }
+    const char length[2] = {static_cast<char>(bytes.size() & 0xFF), static_cast<char>(bytes.size() >> 8)};
+    std::lock_guard<std::mutex> lock(g_capture_mutex);
+    g_capture.write(length, sizeof(length));
+    g_capture.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+// Mirrors the time fields that lead every text payload.
+void print_time(const SampleTime& time) {
+    std::cout << "timestamp=" << time.unix_seconds() << " mono_ns=" << time.monotonic_ns
+              << " rt_offset_ns=" << time.realtime_offset_ns << " ";
+}
+
+void print_sample(const codec::ImuRecord& record) {
+    print_time(record.time);
+    std::cout << "name=" << codec::imu_device_name(record.device) << " ax=" << record.ax << " ay=" << record.ay
+              << " az=" << record.az << " gx=" << record.gx << " gy=" << record.gy << " gz=" << record.gz
+              << " mx=" << record.mx << " my=" << record.my << " mz=" << record.mz << " ";
+}
+
+void print_sample(const codec::AdcRecord& record) {
+    print_time(record.time);
+    for (std::size_t idx = 0; idx < record.count; ++idx) {
+        std::cout << "a" << idx << "=" << record.values[idx] << " ";
+    }
+}
+
+void print_sample(const codec::BarometerRecord& record) {
+    print_time(record.time);
+    std::cout << "temperature=" << record.temperature_c << " pressure=" << record.pressure_mbar << " ";
+}
+
+void print_sample(const codec::GpsRecord& record) {
+    print_time(record.time);
+    std::cout << "fix_type=" << static_cast<int>(record.fix_type) << " lat=" << record.latitude_deg
+              << " lon=" << record.longitude_deg << " height=" << record.height_m << " ";
+    if (record.has_velocity) {
+        std::cout << "speed=" << record.ground_speed_mps << " heading=" << record.heading_deg << " ";
+    }
+}
+
+void print_sample(const codec::RcInputRecord& record) {
+    print_time(record.time);
+    for (std::size_t idx = 0; idx < record.count && idx < std::size(kRcAxisNames); ++idx) {
+        std::cout << kRcAxisNames[idx] << "=" << static_cast<int>(record.axes[idx]) << " ";
+    }
+}
+
+void print_sample(const codec::AttitudeRecord& record) {
+    print_time(record.time);
+    std::cout << "qw=" << record.qw << " qx=" << record.qx << " qy=" << record.qy << " qz=" << record.qz
+              << " roll=" << record.roll_deg << " pitch=" << record.pitch_deg << " yaw=" << record.yaw_deg << " ";
+}
+
+void print_sample(const codec::FusedImuRecord& record) {
+    print_time(record.time);
+    const char* source = record.sources == 0x03 ? "both" : record.sources == 0x01 ? "MPU9250" : "LSM9DS1";
+    std::cout << "source=" << source << " ax=" << record.ax << " ay=" << record.ay << " az=" << record.az
+              << " gx=" << record.gx << " gy=" << record.gy << " gz=" << record.gz
+              << " mx=" << record.mx << " my=" << record.my << " mz=" << record.mz
+              << " res_a=" << record.accel_residual << " res_g=" << record.gyro_residual
+              << " res_m=" << record.mag_residual << " ";
+}
+
+template <typename Record>
+void print_latest(const char* name, const SeqLock<LatestSample<Record>>& cell) {
+    const LatestSample<Record> latest = cell.load();
+    if (!latest.present) {
+        return;
+    }
+    std::cout << name << ": ";
+    print_sample(latest.record);
+    std::cout << std::endl;
+}
+
+// --stats: transport accounting per key expression instead of the dashboard.
+bool g_stats_enabled = false;
+std::mutex g_stats_mutex;
+std::map<std::string, std::unique_ptr<TopicStats>, std::less<>> g_topic_stats;
+
+TopicStats& topic_stats(std::string_view key) {
+    std::lock_guard<std::mutex> lock(g_stats_mutex);
+    auto it = g_topic_stats.find(key);
+    if (it == g_topic_stats.end()) {
+        it = g_topic_stats.emplace(std::string(key), std::make_unique<TopicStats>()).first;
+    }
+    return *it->second;
+}
+
+// Reads the sequence number and send time from the binary header or from
+// the trailing seq= and sent_ns= text fields.
+void record_transport(TopicStats& stats, std::span<const std::uint8_t> bytes, std::int64_t received_ns) {
+    std::uint32_t sequence = 0;
+    std::int64_t sent_ns = 0;
+    SampleTime time;
+    if (codec::is_binary(bytes)) {
+        codec::RecordHeader header;
+        if (codec::peek_header(bytes, header)) {
+            sequence = header.sequence;
+            sent_ns = header.sent_ns;
+            time = header.time;
+        }
+    } else {
+        for_each_field(std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size()),
+                       [&](std::string_view key, std::string_view value) {
+                           if (key == "seq") {
+                               parse_number(value, sequence);
+                           } else if (key == "sent_ns") {
+                               parse_number(value, sent_ns);
+                           } else {
+                               parse_time_field(key, value, time);
+                           }
+                       });
+    }
+    if (sent_ns == 0) {
+        stats.record_unstamped();
+        return;
+    }
+    stats.record(sequence, sent_ns, time.unix_ns(), received_ns);
+}
+
+void print_stats() {
+    std::cout << "===== Transport statistics at " << std::time(nullptr) << " =====" << std::endl;
+    std::lock_guard<std::mutex> lock(g_stats_mutex);
+    for (const auto& [key, stats] : g_topic_stats) {
+        std::cout << key << ": " << stats->summary() << std::endl;
+    }
+}
 
 void print_pager() {
     std::cout << "\033[2J\033[1;1H"; // Clear screen and move cursor to top-left
     std::cout << "===== Sensor Readings at " <<  std::to_string(static_cast<long long>(std::time(nullptr))) << " =====" << std::endl;
-    std::lock_guard<std::mutex> lock(g_readings_mutex);
+    print_latest("IMU/MPU9250", g_sensor_readings.imu_mpu9250);
+    print_latest("IMU/LSM9DS1", g_sensor_readings.imu_lsm9ds1);
+    print_latest("ADC", g_sensor_readings.adc);
+    print_latest("Barometer", g_sensor_readings.barometer);
+    print_latest("GPS", g_sensor_readings.gps);
+    print_latest("RCInput", g_sensor_readings.rcinput);
+    print_latest("Attitude/MPU9250", g_sensor_readings.attitude_mpu9250);
+    print_latest("Attitude/LSM9DS1", g_sensor_readings.attitude_lsm9ds1);
+    print_latest("IMU/fused", g_sensor_readings.imu_fused);
+}
+
+// Decodes a text or binary payload straight from the received bytes.
+template <typename Record>
+bool decode_payload(std::span<const std::uint8_t> bytes, Record& record) {
+    if (codec::is_binary(bytes)) {
+        return codec::decode(bytes, record);
+    }
+    return parse_text(std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size()), record);
+}
+
+template <typename Record>
+void store_latest(std::span<const std::uint8_t> bytes, SeqLock<LatestSample<Record>>& cell) {
+    LatestSample<Record> latest;
+    latest.present = decode_payload(bytes, latest.record);
+    cell.store(latest);
+}
 
-    auto print_map = [](const std::string& name, const std::map<std::string, std::string>& data) {
-        if (data.empty()) {
-            return;
+void handle_payload(Topic topic, std::span<const std::uint8_t> bytes) {
+    switch (topic) {
+    case Topic::Imu: {
+        // Both IMUs share the topic; an unavailable one names neither device.
+        // Of a compressed window the dashboard keeps the last sample.
+        LatestSample<codec::ImuRecord> latest;
+        codec::ImuWindowReader window(bytes);
+        if (window.valid()) {
+            while (window.next(latest.record)) {
+                latest.present = true;
+            }
+        } else {
+            latest.present = decode_payload(bytes, latest.record) && latest.record.valid;
         }
-        std::cout << name << ": ";
-        for (const auto& pair : data) {
-            std::cout << pair.first << "=" << pair.second << " ";
+        if (latest.record.device == codec::ImuDevice::Mpu9250) {
+            g_sensor_readings.imu_mpu9250.store(latest);
+        } else if (latest.record.device == codec::ImuDevice::Lsm9ds1) {
+            g_sensor_readings.imu_lsm9ds1.store(latest);
         }
-        std::cout << std::endl;
-    };
-
-    print_map("IMU/MPU9250", g_sensor_readings.imu_mpu9250);
-    print_map("IMU/LSM9DS1", g_sensor_readings.imu_lsm9ds1);
-    print_map("ADC", g_sensor_readings.adc);
-    print_map("Barometer", g_sensor_readings.barometer);
-    print_map("GPS", g_sensor_readings.gps);
-    print_map("RCInput", g_sensor_readings.rcinput);
-}
-
-std::map<std::string, std::string> parse_payload(const std::string& payload) {
-    std::map<std::string, std::string> data;
-    std::stringstream ss(payload);
-    std::string item;
-    while (std::getline(ss, item, ' ')) {
-        size_t pos = item.find('=');
-        if (pos != std::string::npos) {
-            data[item.substr(0, pos)] = item.substr(pos + 1);
+        break;
+    }
+    case Topic::Adc:
+        store_latest(bytes, g_sensor_readings.adc);
+        break;
+    case Topic::Barometer:
+        store_latest(bytes, g_sensor_readings.barometer);
+        break;
+    case Topic::Gps:
+        store_latest(bytes, g_sensor_readings.gps);
+        break;
+    case Topic::RcInput:
+        store_latest(bytes, g_sensor_readings.rcinput);
+        break;
+    case Topic::Attitude: {
+        LatestSample<codec::AttitudeRecord> latest;
+        latest.present = decode_payload(bytes, latest.record) && latest.record.valid;
+        if (latest.record.device == codec::ImuDevice::Mpu9250) {
+            g_sensor_readings.attitude_mpu9250.store(latest);
+        } else if (latest.record.device == codec::ImuDevice::Lsm9ds1) {
+            g_sensor_readings.attitude_lsm9ds1.store(latest);
         }
+        break;
+    }
+    case Topic::FusedImu:
+        store_latest(bytes, g_sensor_readings.imu_fused);
+        break;
+    case Topic::Unknown:
+        break;
     }
-    return data;
 }
 
 void subscriber_callback(const zenoh::Sample& sample) {
-    std::string key(sample.get_keyexpr().as_string_view());
-    std::string value(sample.get_payload().as_string_view());
-    auto data = parse_payload(value);
-
-    std::lock_guard<std::mutex> lock(g_readings_mutex);
-    if (key.find("imu") != std::string::npos) {
-        if (data["name"] == "MPU9250") {
-            g_sensor_readings.imu_mpu9250 = data;
-        } else if (data["name"] == "LSM9DS1") {
-            g_sensor_readings.imu_lsm9ds1 = data;
+    const std::int64_t received_ns = realtime_ns();
+    const std::string_view key = sample.get_keyexpr().as_string_view();
+    const Topic topic = topic_of(key);
+    // Valid for the duration of the callback; nothing below copies it.
+    const std::string_view value = sample.get_payload().as_string_view();
+    const std::span<const std::uint8_t> bytes(reinterpret_cast<const std::uint8_t*>(value.data()), value.size());
+    if (g_capture.is_open() && codec::is_binary(bytes)) {
+        record_payload(bytes);
+    }
+
+    TopicStats* stats = g_stats_enabled ? &topic_stats(key) : nullptr;
+
+    codec::RecordHeader header;
+    if (codec::peek_header(bytes, header) && header.type == codec::RecordType::Batch) {
+        // Unpack every sample in order; the dashboard keeps the latest one.
+        codec::BatchReader batch(bytes);
+        std::int64_t timestamp_ns = 0;
+        std::span<const std::uint8_t> entry;
+        while (batch.next(timestamp_ns, entry)) {
+            if (stats) {
+                record_transport(*stats, entry, received_ns);
+            }
+            handle_payload(topic, entry);
         }
-    } else if (key.find("adc") != std::string::npos) {
-        g_sensor_readings.adc = data;
-    } else if (key.find("barometer") != std::string::npos) {
-        g_sensor_readings.barometer = data;
-    } else if (key.find("gps") != std::string::npos) {
-        g_sensor_readings.gps = data;
-    } else if (key.find("rcinput") != std::string::npos) {
-        g_sensor_readings.rcinput = data;
+        return;
+    }
+    if (stats) {
+        record_transport(*stats, bytes, received_ns);
     }
+    handle_payload(topic, bytes);
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    int stats_interval_s = 5;
+    for (int idx = 1; idx < argc; ++idx) {
+        const std::string arg = argv[idx];
+        if (arg == "--record" && idx + 1 < argc) {
+            g_capture.open(argv[++idx], std::ios::binary | std::ios::trunc);
+            if (!g_capture) {
+                std::cerr << "Cannot open capture file " << argv[idx] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--stats") {
+            g_stats_enabled = true;
+        } else if (arg == "--stats-interval" && idx + 1 < argc &&
+                   parse_number(std::string_view(argv[idx + 1]), stats_interval_s) && stats_interval_s > 0) {
+            ++idx;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--record <file>] [--stats] [--stats-interval <seconds>]" << std::endl;
+            return 1;
+        }
+    }
     try {
         zenoh::Config config;
+#if defined(ZENOHCXX_ZENOHC) && defined(SENSORS_READ_SHM)
+        // Lets same-host publishers hand over shared-memory payloads without copies.
+        config.insert_json(Z_CONFIG_SHARED_MEMORY_KEY, "true");
+#endif
         auto session_or_error = zenoh::open(std::move(config));
         if (auto *session = std::get_if<zenoh::Session>(&session_or_error)) {
             std::string keyexpr = "telemetry/sensors/**";
             auto subscriber_or_error = session->declare_subscriber(keyexpr, subscriber_callback);
             if (std::holds_alternative<zenoh::Subscriber>(subscriber_or_error)) {
                 while (true) {
+                    if (g_stats_enabled) {
+                        std::this_thread::sleep_for(std::chrono::seconds(stats_interval_s));
+                        print_stats();
+                        continue;
+                    }
                     print_pager();
                     std::this_thread::sleep_for(std::chrono::seconds(1));
                 }
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "histogram.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+
+// Loss, ordering and latency accounting for one key expression, fed from the
+// sequence number and send time that sensors_read stamps on every sample.
+//
+// Sequence numbers are tracked relative to the highest one seen: a jump
+// forward counts the skipped numbers as lost, and a number inside the last
+// kWindow that arrives later either recovers one of them (reordered) or was
+// already seen (duplicate). Falling back to zero or far behind the window
+// means the publisher restarted, and tracking starts over.
+class TopicStats {
+public:
+    static constexpr std::int64_t kWindow = 4096;
+
+    // sent_ns and acquired_ns are CLOCK_REALTIME nanoseconds from the
+    // publisher; latencies are only meaningful with synchronized clocks and
+    // are clamped at zero otherwise.
+    void record(std::uint32_t sequence, std::int64_t sent_ns, std::int64_t acquired_ns, std::int64_t received_ns) {
+        latency_.record(static_cast<std::uint64_t>(std::max<std::int64_t>(0, received_ns - sent_ns)));
+        age_.record(static_cast<std::uint64_t>(std::max<std::int64_t>(0, received_ns - acquired_ns)));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++received_;
+        if (received_ == 1) {
+            start(sequence);
+            return;
+        }
+        // Unwraps the 32-bit counter around the highest number seen.
+        const std::int64_t value = highest_ + static_cast<std::int32_t>(sequence - static_cast<std::uint32_t>(highest_));
+        if (value > highest_) {
+            lost_ += value - highest_ - 1;
+            for (std::int64_t missing = std::max(highest_ + 1, value - kWindow + 1); missing < value; ++missing) {
+                seen_.reset(slot(missing));
+            }
+            highest_ = value;
+            seen_.set(slot(value));
+        } else if (sequence == 0 || highest_ - value >= kWindow) {
+            ++restarts_;
+            start(sequence);
+        } else if (seen_.test(slot(value))) {
+            ++duplicates_;
+        } else {
+            seen_.set(slot(value));
+            ++reordered_;
+            --lost_;
+        }
+    }
+
+    // Payloads without a sequence number (older publishers).
+    void record_unstamped() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++unstamped_;
+    }
+
+    // Counters are cumulative; the latency percentiles cover the time since
+    // the previous summary.
+    std::string summary() {
+        std::ostringstream out;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            out << "received=" << received_ << " lost=" << lost_ << " duplicates=" << duplicates_
+                << " reordered=" << reordered_ << " restarts=" << restarts_;
+            if (unstamped_ > 0) {
+                out << " unstamped=" << unstamped_;
+            }
+        }
+        out << "\n    latency_us " << percentiles(latency_) << "\n    age_us     " << percentiles(age_);
+        latency_.reset();
+        age_.reset();
+        return out.str();
+    }
+
+private:
+    static std::size_t slot(std::int64_t value) {
+        return static_cast<std::size_t>(value & (kWindow - 1));
+    }
+
+    static std::string percentiles(const LatencyHistogram& histogram) {
+        std::ostringstream out;
+        out.setf(std::ios::fixed);
+        out.precision(1);
+        out << "n=" << histogram.count();
+        static const std::pair<const char*, double> kPercentiles[] = {
+            {"p50", 50.0}, {"p90", 90.0}, {"p99", 99.0}, {"p99.9", 99.9}};
+        for (const auto& [label, percent] : kPercentiles) {
+            out << " " << label << "=" << static_cast<double>(histogram.percentile(percent)) / 1000.0;
+        }
+        out << " max=" << static_cast<double>(histogram.max()) / 1000.0;
+        return out.str();
+    }
+
+    void start(std::uint32_t sequence) {
+        seen_.reset();
+        highest_ = sequence;
+        seen_.set(slot(highest_));
+    }
+
+    std::mutex mutex_;
+    std::uint64_t received_ = 0;
+    std::int64_t lost_ = 0;
+    std::uint64_t duplicates_ = 0;
+    std::uint64_t reordered_ = 0;
+    std::uint64_t restarts_ = 0;
+    std::uint64_t unstamped_ = 0;
+    std::int64_t highest_ = 0;
+    std::bitset<kWindow> seen_;
+    LatencyHistogram latency_;
+    LatencyHistogram age_;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal unit-test harness for sensors_read_unit_test, run by CTest. A
+// case body runs its checks with CHECK(); a failed check is reported with
+// its file and line and the case carries on, so one run shows every
+// failure. The runner exits non-zero if any check failed.
+namespace unit {
+
+using Body = std::function<void()>;
+
+struct Case {
+    std::string name;
+    Body body;
+};
+
+std::vector<Case> &registry();
+
+// Registers a case at static-initialization time:
+//   const unit::Registrar kRoundTrip("imu_window.round_trip", [] { ... });
+struct Registrar {
+    Registrar(std::string name, Body body);
+};
+
+void fail(const char *file, int line, const char *expression);
+
+} // namespace unit
+
+#define CHECK(expression) ((expression) ? void() : unit::fail(__FILE__, __LINE__, #expression))
@@ -0,0 +1,116 @@
+#include "unit.h"
+
+#include "adc_sensor.h"
+#include "sensor_backend.h"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+double reduce(std::vector<double> block, bool median) { return reduce_adc_block(block, median); }
+
+const unit::Registrar kMean("adc.mean", [] {
+    CHECK(reduce({4.0}, false) == 4.0);
+    CHECK(reduce({1.0, 2.0, 3.0, 6.0}, false) == 3.0);
+    CHECK(reduce({-1.0, 1.0}, false) == 0.0);
+    CHECK(std::isnan(reduce({}, false)));
+});
+
+const unit::Registrar kMedian("adc.median", [] {
+    CHECK(reduce({4.0}, true) == 4.0);
+    CHECK(reduce({3.0, 1.0, 2.0}, true) == 2.0);
+    // Even blocks average the two middle reads.
+    CHECK(reduce({4.0, 1.0, 3.0, 2.0}, true) == 2.5);
+    CHECK(reduce({5.0, 5.0, 1.0, 5.0}, true) == 5.0);
+    // One spike per block moves the mean but not the median.
+    CHECK(reduce({101.0, 102.0, 103.0, 1e6}, true) == 102.5);
+    CHECK(reduce({1e6, 101.0, -1e6, 102.0, 103.0}, true) == 102.0);
+    CHECK(std::isnan(reduce({}, true)));
+    std::vector<double> block(64);
+    for (std::size_t idx = 0; idx < block.size(); ++idx) {
+        block[idx] = static_cast<double>((idx * 37) % 64);
+    }
+    CHECK(reduce(block, true) == 31.5);
+});
+
+// Reading n (from 1) has channel c at c * 100 + n, with a spike on channel 1
+// every fourth reading. Fails every reading while failing is set.
+class ScriptedBackend : public SensorBackend {
+public:
+    const char *name() const override { return "test"; }
+    bool read_imu(ImuType, ImuReading &) override { return false; }
+    bool read_adc(AdcReading &reading) override {
+        if (failing) {
+            return false;
+        }
+        ++readings;
+        reading.count = 3;
+        for (std::size_t idx = 0; idx < reading.count; ++idx) {
+            reading.values[idx] = static_cast<double>(idx * 100 + readings);
+        }
+        if (readings % 4 == 0) {
+            reading.values[1] = 1e6;
+        }
+        return true;
+    }
+    bool read_barometer(BarometerReading &) override { return false; }
+    bool read_gps(GpsReading &) override { return false; }
+    bool read_rcinput(RcInputReading &) override { return false; }
+
+    int readings = 0;
+    bool failing = false;
+};
+
+const unit::Registrar kSampler("adc.sampler_blocks", [] {
+    ScriptedBackend backend;
+    AdcSensor adc(&backend);
+    adc.set_channel_mask(0b111);
+    adc.set_sampling(1, {1000.0, 4, true});
+    adc.set_sampling(2, {1000.0, 4, false});
+    adc.set_sampling(0, {250.0, 1, false});
+    CHECK(adc.sampling());
+    CHECK(adc.sampler_rate_hz() == 1000.0);
+    CHECK(adc.channel_rate_hz(0) == 250.0);
+    // Nothing is reported until every channel completed a block.
+    CHECK(adc.read().count == 0);
+    CHECK(!adc.sample() && !adc.sample() && !adc.sample());
+    CHECK(adc.read().count == 0);
+    CHECK(adc.sample());
+    AdcReading reading = adc.read();
+    CHECK(reading.count == 3);
+    CHECK(reading.values[0] == 4.0);
+    CHECK(reading.values[1] == 102.5);
+    CHECK(reading.values[2] == 202.5);
+
+    // A failed backend read skips the tick for every channel.
+    backend.failing = true;
+    CHECK(!adc.sample());
+    backend.failing = false;
+    for (int tick = 0; tick < 3; ++tick) {
+        adc.sample();
+        CHECK(adc.read().values[1] == 102.5);
+    }
+    CHECK(adc.sample());
+    reading = adc.read();
+    CHECK(reading.values[0] == 8.0);
+    CHECK(reading.values[1] == 106.5);
+    CHECK(reading.values[2] == 206.5);
+});
+
+const unit::Registrar kMask("adc.sampler_mask", [] {
+    ScriptedBackend backend;
+    AdcSensor adc(&backend);
+    adc.set_channel_mask(0b101);
+    adc.set_sampling(2, {100.0, 2, false});
+    adc.set_sampling(0, {100.0, 1, false});
+    CHECK(!adc.sample());
+    CHECK(adc.sample());
+    const AdcReading reading = adc.read();
+    CHECK(reading.count == 3 && reading.mask == 0b101);
+    CHECK(reading.values[0] == 2.0);
+    CHECK(std::isnan(reading.values[1]));
+    CHECK(reading.values[2] == 201.5);
+});
+
+} // namespace
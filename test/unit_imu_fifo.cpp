@@ -0,0 +1,228 @@
+#include "unit.h"
+
+#include "mock_register_bus.h"
+
+#include "imu_fifo.h"
+#include "imu_registers.h"
+#include "sample_time.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+constexpr float kGravity = 9.80665f;
+constexpr float kDegToRad = 3.14159265358979323846f / 180.0f;
+
+bool near(float value, float expected) {
+    return std::fabs(value - expected) <= 1e-5f * std::max(1.0f, std::fabs(expected));
+}
+
+// Sample n of a test stream: distinct, so reordering or loss shows.
+std::array<std::int16_t, 3> accel_raw(int n) { return {static_cast<std::int16_t>(100 * n), -8192, 16384}; }
+std::array<std::int16_t, 3> gyro_raw(int n) { return {static_cast<std::int16_t>(-n), 131, -262}; }
+
+// Samples of one drain are one sample period apart, newest at the drain time.
+bool stamped_backwards(const std::vector<ImuReading> &out, double odr_hz, std::int64_t before_ns,
+                       std::int64_t after_ns) {
+    const auto period_ns = static_cast<std::int64_t>(std::llround(1e9 / odr_hz));
+    for (std::size_t idx = 1; idx < out.size(); ++idx) {
+        if (out[idx].time.monotonic_ns - out[idx - 1].time.monotonic_ns != period_ns) {
+            return false;
+        }
+    }
+    return out.empty() || (out.back().time.monotonic_ns >= before_ns && out.back().time.monotonic_ns <= after_ns);
+}
+
+// Drains into out and checks the time stamps against the drain time.
+bool drain_stamped(ImuFifo &fifo, std::vector<ImuReading> &out) {
+    const std::int64_t before_ns = SampleTime::now().monotonic_ns;
+    const bool drained = fifo.drain(out);
+    const std::int64_t after_ns = SampleTime::now().monotonic_ns;
+    return drained && stamped_backwards(out, fifo.odr_hz(), before_ns, after_ns);
+}
+
+// The MPU9250 scales: +-2 g and +-250 deg/s, as the driver leaves them.
+bool mpu_sample_matches(const ImuReading &reading, int n) {
+    const float accel_scale = kGravity / 16384.0f;
+    const float gyro_scale = kDegToRad / 131.0f;
+    return reading.valid && near(reading.ax, 100.0f * n * accel_scale) && near(reading.ay, -0.5f * kGravity) &&
+           near(reading.az, kGravity) && near(reading.gx_rad, static_cast<float>(-n) * gyro_scale) &&
+           near(reading.gy_rad, kDegToRad) && near(reading.gz_rad, -2.0f * kDegToRad);
+}
+
+// The LSM9DS1 scales for full-scale code 0: 0.061 mg and 8.75 mdps per LSB.
+bool lsm_sample_matches(const ImuReading &reading, int n) {
+    const float accel_scale = 0.061f / 1000.0f * kGravity;
+    const float gyro_scale = 8.75f / 1000.0f * kDegToRad;
+    return reading.valid && near(reading.ax, 100.0f * n * accel_scale) && near(reading.ay, -8192.0f * accel_scale) &&
+           near(reading.az, 16384.0f * accel_scale) && near(reading.gx_rad, static_cast<float>(-n) * gyro_scale) &&
+           near(reading.gy_rad, 131.0f * gyro_scale) && near(reading.gz_rad, -262.0f * gyro_scale);
+}
+
+const unit::Registrar kMpuPartial("imu_fifo.mpu9250_partial_drain", [] {
+    MockMpu9250Bus bus;
+    Mpu9250Fifo fifo(bus);
+    CHECK(fifo.configure(200.0));
+    CHECK(fifo.odr_hz() == 200.0);
+    CHECK(fifo.capacity() == 42);
+    for (int n = 0; n < 5; ++n) {
+        bus.push_sample(accel_raw(n), gyro_raw(n));
+    }
+    std::vector<ImuReading> out;
+    const std::size_t transfers = bus.transfers();
+    CHECK(drain_stamped(fifo, out));
+    // Interrupt status, FIFO count and one burst.
+    CHECK(bus.transfers() - transfers == 3);
+    CHECK(out.size() == 5);
+    for (int n = 0; n < 5 && n < static_cast<int>(out.size()); ++n) {
+        CHECK(mpu_sample_matches(out[static_cast<std::size_t>(n)], n));
+    }
+    CHECK(bus.fifo_bytes() == 0);
+
+    // The next drain picks up where this one stopped and appends.
+    for (int n = 5; n < 8; ++n) {
+        bus.push_sample(accel_raw(n), gyro_raw(n));
+    }
+    std::vector<ImuReading> next;
+    CHECK(drain_stamped(fifo, next));
+    CHECK(next.size() == 3);
+    CHECK(!next.empty() && mpu_sample_matches(next.front(), 5));
+    CHECK(fifo.samples() == 8);
+    CHECK(fifo.drains() == 2);
+    CHECK(fifo.overflows() == 0);
+
+    // An empty FIFO reads the status and count only.
+    next.clear();
+    const std::size_t empty_transfers = bus.transfers();
+    CHECK(fifo.drain(next));
+    CHECK(next.empty());
+    CHECK(bus.transfers() - empty_transfers == 2);
+});
+
+const unit::Registrar kMpuFull("imu_fifo.mpu9250_exactly_full", [] {
+    MockMpu9250Bus bus;
+    Mpu9250Fifo fifo(bus);
+    CHECK(fifo.configure(1000.0));
+    for (int n = 0; n < 42; ++n) {
+        bus.push_sample(accel_raw(n), gyro_raw(n));
+    }
+    CHECK(bus.fifo_bytes() == 42 * mpu9250_reg::kFifoFrameBytes);
+    std::vector<ImuReading> out;
+    const std::size_t transfers = bus.transfers();
+    CHECK(drain_stamped(fifo, out));
+    CHECK(bus.transfers() - transfers == 3);
+    CHECK(out.size() == 42);
+    CHECK(out.size() == 42 && mpu_sample_matches(out.front(), 0) && mpu_sample_matches(out.back(), 41));
+    CHECK(fifo.overflows() == 0);
+});
+
+const unit::Registrar kMpuOverflow("imu_fifo.mpu9250_overflow_and_reset", [] {
+    MockMpu9250Bus bus;
+    Mpu9250Fifo fifo(bus);
+    CHECK(fifo.configure(1000.0));
+    // The 43rd frame does not fit; the FIFO keeps the first 42.
+    for (int n = 0; n < 43; ++n) {
+        bus.push_sample(accel_raw(n), gyro_raw(n));
+    }
+    std::vector<ImuReading> out;
+    CHECK(drain_stamped(fifo, out));
+    CHECK(out.size() == 42);
+    CHECK(out.size() == 42 && mpu_sample_matches(out.back(), 41));
+    CHECK(fifo.overflows() == 1);
+    // Reset leaves the FIFO enabled and empty with the overflow cleared.
+    CHECK((bus.register_value(mpu9250_reg::kUserCtrl) & mpu9250_reg::kUserCtrlFifoEnable) != 0);
+    CHECK(bus.fifo_bytes() == 0);
+
+    bus.push_sample(accel_raw(50), gyro_raw(50));
+    out.clear();
+    CHECK(drain_stamped(fifo, out));
+    CHECK(out.size() == 1 && mpu_sample_matches(out.front(), 50));
+    CHECK(fifo.overflows() == 1);
+});
+
+const unit::Registrar kLsmPartial("imu_fifo.lsm9ds1_partial_drain", [] {
+    MockLsm9ds1Bus bus;
+    Lsm9ds1Fifo fifo(bus);
+    CHECK(fifo.configure(100.0));
+    CHECK(fifo.odr_hz() == 119.0);
+    CHECK(fifo.capacity() == 32);
+    for (int n = 0; n < 7; ++n) {
+        bus.push_sample(accel_raw(n), gyro_raw(n));
+    }
+    std::vector<ImuReading> out;
+    const std::size_t transfers = bus.transfers();
+    CHECK(drain_stamped(fifo, out));
+    // FIFO status, then one burst per output block.
+    CHECK(bus.transfers() - transfers == 3);
+    CHECK(out.size() == 7);
+    for (int n = 0; n < 7 && n < static_cast<int>(out.size()); ++n) {
+        CHECK(lsm_sample_matches(out[static_cast<std::size_t>(n)], n));
+    }
+    CHECK(bus.fifo_samples() == 0);
+    CHECK(fifo.overflows() == 0);
+});
+
+const unit::Registrar kLsmFull("imu_fifo.lsm9ds1_exactly_full", [] {
+    MockLsm9ds1Bus bus;
+    Lsm9ds1Fifo fifo(bus);
+    CHECK(fifo.configure(952.0));
+    for (int n = 0; n < 32; ++n) {
+        bus.push_sample(accel_raw(n), gyro_raw(n));
+    }
+    std::vector<ImuReading> out;
+    const std::size_t transfers = bus.transfers();
+    CHECK(drain_stamped(fifo, out));
+    CHECK(bus.transfers() - transfers == 3);
+    CHECK(out.size() == 32);
+    CHECK(out.size() == 32 && lsm_sample_matches(out.front(), 0) && lsm_sample_matches(out.back(), 31));
+    CHECK(fifo.overflows() == 0);
+});
+
+const unit::Registrar kLsmOverflow("imu_fifo.lsm9ds1_overflow_and_reset", [] {
+    MockLsm9ds1Bus bus;
+    Lsm9ds1Fifo fifo(bus);
+    CHECK(fifo.configure(952.0));
+    for (int n = 0; n < 33; ++n) {
+        bus.push_sample(accel_raw(n), gyro_raw(n));
+    }
+    std::vector<ImuReading> out;
+    CHECK(drain_stamped(fifo, out));
+    CHECK(out.size() == 32);
+    CHECK(out.size() == 32 && lsm_sample_matches(out.back(), 31));
+    CHECK(fifo.overflows() == 1);
+    // The reset passed through bypass mode, clearing the overrun flag.
+    CHECK(bus.register_value(lsm9ds1_reg::kFifoCtrl) == lsm9ds1_reg::kFifoModeStopWhenFull);
+
+    bus.push_sample(accel_raw(40), gyro_raw(40));
+    out.clear();
+    CHECK(drain_stamped(fifo, out));
+    CHECK(out.size() == 1 && lsm_sample_matches(out.front(), 40));
+    CHECK(fifo.overflows() == 1);
+});
+
+const unit::Registrar kLsmMagnetometer("imu_fifo.lsm9ds1_magnetometer", [] {
+    MockLsm9ds1Bus bus;
+    MockRegisterBus magnetometer;
+    // +-4 gauss, 0.14 mgauss/LSB; X = 1000 LSB = 14 uT.
+    magnetometer.set_register(lsm9ds1_reg::kOutXLM, 0xE8);
+    magnetometer.set_register(lsm9ds1_reg::kOutXLM + 1, 0x03);
+    Lsm9ds1Fifo fifo(bus, &magnetometer);
+    CHECK(fifo.configure(119.0));
+    bus.push_sample(accel_raw(0), gyro_raw(0));
+    bus.push_sample(accel_raw(1), gyro_raw(1));
+    std::vector<ImuReading> out;
+    const std::size_t transfers = magnetometer.transfers();
+    CHECK(drain_stamped(fifo, out));
+    // One magnetometer read per drain, copied into every sample.
+    CHECK(magnetometer.transfers() - transfers == 1);
+    CHECK(out.size() == 2);
+    for (const ImuReading &reading : out) {
+        CHECK(near(reading.mx, 14.0f) && reading.my == 0.0f && reading.mz == 0.0f);
+    }
+});
+
+} // namespace
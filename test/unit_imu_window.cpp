@@ -0,0 +1,177 @@
+#include "unit.h"
+
+#include "telemetry_codec.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+const codec::ImuQuantization kSteps{0.001f, 0.0001f, 0.01f};
+
+codec::ImuRecord sample(std::int64_t time_ns, float value) {
+    codec::ImuRecord record;
+    record.time.monotonic_ns = time_ns;
+    record.time.realtime_offset_ns = 42;
+    record.device = codec::ImuDevice::Lsm9ds1;
+    record.valid = true;
+    record.ax = record.ay = record.az = value;
+    record.gx = record.gy = record.gz = value;
+    record.mx = record.my = record.mz = value;
+    return record;
+}
+
+std::vector<codec::ImuRecord> decode(std::span<const std::uint8_t> record) {
+    std::vector<codec::ImuRecord> samples;
+    codec::ImuWindowReader reader(record);
+    codec::ImuRecord decoded;
+    while (reader.next(decoded)) {
+        samples.push_back(decoded);
+    }
+    return samples;
+}
+
+// Within half a step of the original, allowing for float rounding.
+bool close(float decoded, float original, float step) {
+    return std::fabs(decoded - original) <= 0.5f * step + 1e-5f * std::fabs(original);
+}
+
+bool matches(const codec::ImuRecord &decoded, const codec::ImuRecord &original) {
+    return decoded.valid && decoded.device == original.device &&
+           decoded.time.monotonic_ns == original.time.monotonic_ns &&
+           decoded.time.realtime_offset_ns == original.time.realtime_offset_ns &&
+           close(decoded.ax, original.ax, kSteps.accel_step) && close(decoded.ay, original.ay, kSteps.accel_step) &&
+           close(decoded.az, original.az, kSteps.accel_step) && close(decoded.gx, original.gx, kSteps.gyro_step) &&
+           close(decoded.gy, original.gy, kSteps.gyro_step) && close(decoded.gz, original.gz, kSteps.gyro_step) &&
+           close(decoded.mx, original.mx, kSteps.mag_step) && close(decoded.my, original.my, kSteps.mag_step) &&
+           close(decoded.mz, original.mz, kSteps.mag_step);
+}
+
+// A 1 kHz stream with jittered timestamps and sensor noise, windowed the
+// way ImuPipeline does it, comes back sample for sample.
+const unit::Registrar kRoundTrip("imu_window.round_trip", [] {
+    std::mt19937 random(1);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    std::vector<codec::ImuRecord> originals;
+    std::int64_t time_ns = 1000000000;
+    for (int idx = 0; idx < 5000; ++idx) {
+        time_ns += 1000000 + static_cast<std::int64_t>(noise(random) * 30000.0f);
+        codec::ImuRecord record = sample(time_ns, 0.0f);
+        record.ax = 0.05f * noise(random);
+        record.ay = 0.05f * noise(random);
+        record.az = 9.81f + 0.05f * noise(random);
+        record.gx = 0.003f * noise(random);
+        record.gy = 0.003f * noise(random);
+        record.gz = 0.003f * noise(random);
+        record.mx = 22.0f + 0.3f * noise(random);
+        record.my = -3.0f + 0.3f * noise(random);
+        record.mz = 40.0f + 0.3f * noise(random);
+        originals.push_back(record);
+    }
+    codec::ImuWindowEncoder encoder(kSteps);
+    std::vector<codec::ImuRecord> decoded;
+    auto flush = [&] {
+        CHECK(encoder.record().size() <= codec::kMaxImuWindowSize);
+        const std::vector<codec::ImuRecord> window = decode(encoder.record());
+        CHECK(window.size() == encoder.count());
+        decoded.insert(decoded.end(), window.begin(), window.end());
+        encoder.clear();
+    };
+    for (const codec::ImuRecord &record : originals) {
+        if (!encoder.add(record)) {
+            flush();
+            CHECK(encoder.add(record));
+        }
+    }
+    flush();
+    CHECK(decoded.size() == originals.size());
+    for (std::size_t idx = 0; idx < originals.size() && idx < decoded.size(); ++idx) {
+        CHECK(matches(decoded[idx], originals[idx]));
+    }
+});
+
+// Zero samples at one instant take a byte per varint, the fewest there
+// are, so kMaxImuWindowSamples is what ends the window.
+const unit::Registrar kMaxSamples("imu_window.max_samples", [] {
+    codec::ImuWindowEncoder encoder(kSteps);
+    for (std::size_t idx = 0; idx < codec::kMaxImuWindowSamples; ++idx) {
+        CHECK(encoder.add(sample(1000000, 0.0f)));
+    }
+    const std::size_t size = encoder.record().size();
+    CHECK(size == codec::kImuWindowPrefixSize + 9 + 10 * (codec::kMaxImuWindowSamples - 1));
+    CHECK(!encoder.add(sample(1000000, 0.0f)));
+    CHECK(encoder.count() == codec::kMaxImuWindowSamples);
+    CHECK(encoder.record().size() == size);
+    CHECK(size <= codec::kMaxImuWindowSize);
+    CHECK(decode(encoder.record()).size() == codec::kMaxImuWindowSamples);
+});
+
+// Full-scale swings need the widest deltas; the window stops while a
+// worst-case sample still fits and every sample decodes.
+const unit::Registrar kWorstCase("imu_window.worst_case_size", [] {
+    codec::ImuWindowEncoder encoder(kSteps);
+    std::vector<codec::ImuRecord> originals;
+    for (std::int64_t idx = 0;; ++idx) {
+        const codec::ImuRecord record = sample(idx * (idx % 2 == 0 ? 1 : 1000000007), idx % 2 == 0 ? 2e5f : -2e5f);
+        if (!encoder.add(record)) {
+            break;
+        }
+        originals.push_back(record);
+    }
+    CHECK(originals.size() < codec::kMaxImuWindowSamples);
+    CHECK(encoder.record().size() <= codec::kMaxImuWindowSize);
+    const std::vector<codec::ImuRecord> decoded = decode(encoder.record());
+    CHECK(decoded.size() == originals.size());
+    for (std::size_t idx = 0; idx < originals.size() && idx < decoded.size(); ++idx) {
+        CHECK(decoded[idx].time.monotonic_ns == originals[idx].time.monotonic_ns);
+        CHECK(close(decoded[idx].mz, originals[idx].mz, kSteps.mag_step));
+    }
+});
+
+const unit::Registrar kDevice("imu_window.one_device", [] {
+    codec::ImuWindowEncoder encoder(kSteps);
+    CHECK(encoder.record().empty());
+    CHECK(encoder.add(sample(0, 1.0f)));
+    codec::ImuRecord other = sample(1000000, 1.0f);
+    other.device = codec::ImuDevice::Mpu9250;
+    const std::size_t size = encoder.record().size();
+    CHECK(!encoder.add(other));
+    CHECK(encoder.count() == 1 && encoder.record().size() == size);
+    encoder.clear();
+    CHECK(encoder.record().empty());
+    CHECK(encoder.add(other));
+    codec::ImuWindowReader reader(encoder.record());
+    CHECK(reader.valid() && reader.device() == codec::ImuDevice::Mpu9250 && reader.count() == 1);
+});
+
+const unit::Registrar kNonFinite("imu_window.non_finite_and_saturated", [] {
+    codec::ImuWindowEncoder encoder(kSteps);
+    codec::ImuRecord record = sample(0, 0.0f);
+    record.ax = std::numeric_limits<float>::quiet_NaN();
+    record.ay = std::numeric_limits<float>::infinity();
+    record.az = -1e30f;
+    CHECK(encoder.add(record));
+    const std::vector<codec::ImuRecord> decoded = decode(encoder.record());
+    CHECK(decoded.size() == 1);
+    CHECK(decoded[0].ax == 0.0f);
+    CHECK(close(decoded[0].ay, 2147483647.0f * kSteps.accel_step, kSteps.accel_step));
+    CHECK(close(decoded[0].az, -2147483647.0f * kSteps.accel_step, kSteps.accel_step));
+});
+
+// A cut-off record yields the samples that are complete, then stops.
+const unit::Registrar kTruncated("imu_window.truncated", [] {
+    codec::ImuWindowEncoder encoder(kSteps);
+    for (std::int64_t idx = 0; idx < 10; ++idx) {
+        CHECK(encoder.add(sample(idx * 1000000, static_cast<float>(idx))));
+    }
+    const std::span<const std::uint8_t> record = encoder.record();
+    CHECK(decode(record).size() == 10);
+    const std::vector<codec::ImuRecord> decoded = decode(record.first(record.size() - 3));
+    CHECK(decoded.size() == 9);
+    CHECK(decode(record.first(codec::kImuWindowPrefixSize - 1)).empty());
+});
+
+} // namespace
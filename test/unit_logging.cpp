@@ -0,0 +1,63 @@
+#include "unit.h"
+
+#include "logging.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+// What the asynchronous writer printed: the test's messages, and the total
+// of the "Dropped <n> log messages" warnings.
+struct Output {
+    std::uint64_t messages = 0;
+    std::uint64_t reported_drops = 0;
+};
+
+Output parse(const std::string &text) {
+    Output output;
+    std::istringstream lines(text);
+    std::string line;
+    const std::string dropped = "[WARNING] Dropped ";
+    while (std::getline(lines, line)) {
+        if (line.rfind("[CRITICAL] message ", 0) == 0) {
+            ++output.messages;
+        } else if (line.rfind(dropped, 0) == 0) {
+            output.reported_drops += std::stoull(line.substr(dropped.size()));
+        }
+    }
+    return output;
+}
+
+void log_burst(int count) {
+    for (int idx = 0; idx < count; ++idx) {
+        logging::log(logging::Level::Critical, "message ", idx);
+    }
+}
+
+// Each burst overruns its thread's ring. The first thread has exited and
+// its ring has been released by the time the second one drops messages,
+// which must be reported all the same.
+const unit::Registrar kDrops("logging.drops_after_thread_exit", [] {
+    std::ostringstream captured;
+    std::streambuf *const previous = std::cerr.rdbuf(captured.rdbuf());
+    constexpr int kFirst = 5000;
+    constexpr int kSecond = 2000;
+    logging::start_async();
+    std::thread(log_burst, kFirst).join();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const Output first = parse(captured.str());
+    std::thread(log_burst, kSecond).join();
+    logging::stop_async();
+    std::cerr.rdbuf(previous);
+
+    const Output output = parse(captured.str());
+    CHECK(first.messages + first.reported_drops == kFirst);
+    CHECK(output.messages + output.reported_drops == kFirst + kSecond);
+});
+
+} // namespace
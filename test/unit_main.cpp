@@ -0,0 +1,77 @@
+#include "unit.h"
+
+#include "logging.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+
+namespace {
+
+int g_failures = 0;
+
+void print_usage(const char *prog) {
+    std::printf("Usage: %s [--filter <substring>] [--list]\n", prog);
+}
+
+} // namespace
+
+namespace unit {
+
+std::vector<Case> &registry() {
+    static std::vector<Case> cases;
+    return cases;
+}
+
+Registrar::Registrar(std::string name, Body body) {
+    registry().push_back({std::move(name), std::move(body)});
+}
+
+void fail(const char *file, int line, const char *expression) {
+    std::printf("  %s:%d: CHECK(%s) failed\n", file, line, expression);
+    ++g_failures;
+}
+
+} // namespace unit
+
+int main(int argc, char *argv[]) {
+    std::string filter;
+    bool list = false;
+    for (int idx = 1; idx < argc; ++idx) {
+        if (std::strcmp(argv[idx], "--filter") == 0 && idx + 1 < argc) {
+            filter = argv[++idx];
+        } else if (std::strcmp(argv[idx], "--list") == 0) {
+            list = true;
+        } else {
+            print_usage(argv[0]);
+            return std::strcmp(argv[idx], "--help") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    // Cases that exercise rejected input would otherwise log every rejection.
+    logging::set_level(logging::Level::Critical);
+
+    int failed_cases = 0;
+    int run = 0;
+    for (const auto &unit_case : unit::registry()) {
+        if (!filter.empty() && unit_case.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        if (list) {
+            std::printf("%s\n", unit_case.name.c_str());
+            continue;
+        }
+        const int failures = g_failures;
+        unit_case.body();
+        const bool passed = g_failures == failures;
+        std::printf("%-6s %s\n", passed ? "ok" : "FAILED", unit_case.name.c_str());
+        failed_cases += passed ? 0 : 1;
+        ++run;
+    }
+    if (!list) {
+        std::printf("%d of %d cases passed\n", run - failed_cases, run);
+    }
+    return failed_cases == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,105 @@
+#include "unit.h"
+
+#include "publish_queue.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Takes the place of the TelemetryPublisher: keeps what it is handed and
+// rejects every fail_every-th sample, as a failed Zenoh put does.
+class TestSink : public telemetry::PayloadSink {
+public:
+    bool publish_with(const std::string &key, std::size_t capacity, telemetry::PayloadWriter write) override {
+        std::vector<std::uint8_t> payload(capacity);
+        payload.resize(write(payload));
+        const bool ok = calls % fail_every != fail_every - 1;
+        ++calls;
+        if (ok) {
+            sent.emplace_back(key, std::string(payload.begin(), payload.end()));
+        }
+        return ok;
+    }
+
+    std::size_t fail_every = 1000000;
+    std::size_t calls = 0;
+    std::vector<std::pair<std::string, std::string>> sent;
+};
+
+bool push_text(telemetry::PublishChannel &channel, const std::string &text) {
+    auto write = [&text](std::span<std::uint8_t> out) -> std::size_t {
+        std::copy(text.begin(), text.end(), out.begin());
+        return text.size();
+    };
+    return channel.push_with(write);
+}
+
+const unit::Registrar kFailedPuts("publish_queue.failed_puts_counted", [] {
+    TestSink sink;
+    sink.fail_every = 3;
+    telemetry::PublishQueue queue(sink, 16, OverflowPolicy::DropNewest);
+    telemetry::PublishChannel &channel = queue.add_channel("ADC", "telemetry/sensors/adc");
+    for (int idx = 0; idx < 9; ++idx) {
+        CHECK(push_text(channel, "adc " + std::to_string(idx)));
+    }
+    queue.start();
+    queue.stop();
+    CHECK(sink.calls == 9);
+    CHECK(sink.sent.size() == 6);
+    CHECK(channel.published() == 6);
+    CHECK(channel.failed() == 3);
+    CHECK(channel.dropped() == 0);
+    CHECK(channel.queued() == 0);
+});
+
+// The sequence number a text payload was stamped with, or -1.
+long sequence_of(const std::string &payload) {
+    const std::size_t at = payload.find(" seq=");
+    return at == std::string::npos ? -1 : std::stol(payload.substr(at + 5));
+}
+
+std::vector<long> sequences(const TestSink &sink, const std::string &key) {
+    std::vector<long> numbers;
+    for (const auto &[sent_key, payload] : sink.sent) {
+        if (sent_key == key) {
+            numbers.push_back(sequence_of(payload));
+        }
+    }
+    return numbers;
+}
+
+// Both IMU channels share their key's numbers, which follow the order the
+// samples are published in, with a gap where a full ring dropped samples.
+const unit::Registrar kSequence("publish_queue.sequence_in_publish_order", [] {
+    for (OverflowPolicy policy : {OverflowPolicy::DropOldest, OverflowPolicy::DropNewest}) {
+        TestSink sink;
+        telemetry::PublishQueue queue(sink, 4, policy);
+        telemetry::PublishChannel &mpu = queue.add_channel("MPU9250", "telemetry/sensors/imu");
+        telemetry::PublishChannel &adc = queue.add_channel("ADC", "telemetry/sensors/adc");
+        telemetry::PublishChannel &lsm = queue.add_channel("LSM9DS1", "telemetry/sensors/imu");
+        for (int idx = 0; idx < 6; ++idx) {
+            push_text(mpu, "imu MPU9250");
+            push_text(lsm, "imu LSM9DS1");
+        }
+        push_text(adc, "adc");
+        push_text(adc, "adc");
+        queue.start();
+        queue.stop();
+        for (int idx = 0; idx < 5; ++idx) {
+            push_text(lsm, "imu LSM9DS1");
+        }
+        queue.start();
+        queue.stop();
+        CHECK(mpu.dropped() == 2 && lsm.dropped() == 3);
+        CHECK(sequences(sink, "telemetry/sensors/imu") ==
+              std::vector<long>({2, 3, 4, 5, 8, 9, 10, 11, 13, 14, 15, 16}));
+        CHECK(sequences(sink, "telemetry/sensors/adc") == std::vector<long>({0, 1}));
+    }
+});
+
+} // namespace
@@ -0,0 +1,94 @@
+#include "unit.h"
+
+#include "sensor_backend.h"
+#include "telemetry_codec.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr int kRecords = 5;
+constexpr std::int64_t kSpacingNs = 20000000;
+// The capture spans the records plus the millisecond between passes.
+constexpr std::int64_t kWrapNs = 1000000;
+
+// Writes kRecords one-channel ADC records, kSpacingNs apart, whose value is
+// their index, in the framing of sensors_read_test --record.
+std::string write_capture() {
+    const std::string path =
+        (std::filesystem::temp_directory_path() / ("sensors_read_replay_" + std::to_string(getpid()) + ".bin")).string();
+    std::ofstream file(path, std::ios::binary);
+    for (int idx = 0; idx < kRecords; ++idx) {
+        codec::AdcRecord record;
+        record.time.monotonic_ns = 1000000000 + idx * kSpacingNs;
+        record.count = 1;
+        record.values[0] = static_cast<float>(idx);
+        std::uint8_t bytes[codec::kMaxRecordSize];
+        const std::size_t size = codec::encode(record, bytes);
+        const char length[2] = {static_cast<char>(size & 0xFF), static_cast<char>(size >> 8)};
+        file.write(length, 2);
+        file.write(reinterpret_cast<const char *>(bytes), static_cast<std::streamsize>(size));
+    }
+    return path;
+}
+
+const unit::Registrar kOnce("replay.each_sample_once", [] {
+    const std::string path = write_capture();
+    auto backend = make_replay_backend(path);
+    std::filesystem::remove(path);
+    CHECK(backend != nullptr);
+    if (!backend) {
+        return;
+    }
+    // Fall most of a pass behind, then poll faster than the capture: the
+    // backlog comes out first, then one reading per record as it falls due,
+    // across the end of the capture.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::vector<AdcReading> readings;
+    int stale = 0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (readings.size() < 2 * kRecords + 2 && std::chrono::steady_clock::now() < deadline) {
+        AdcReading reading;
+        CHECK(backend->read_adc(reading));
+        if (reading.stale) {
+            ++stale;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        } else {
+            readings.push_back(reading);
+        }
+    }
+    CHECK(readings.size() == 2 * kRecords + 2);
+    CHECK(stale > 0);
+    for (std::size_t idx = 0; idx < readings.size(); ++idx) {
+        CHECK(readings[idx].count == 1);
+        CHECK(readings[idx].values[0] == static_cast<double>(idx % kRecords));
+        if (idx > 0) {
+            const std::int64_t step = readings[idx].time.monotonic_ns - readings[idx - 1].time.monotonic_ns;
+            CHECK(step == (idx % kRecords == 0 ? kWrapNs : kSpacingNs));
+        }
+    }
+});
+
+const unit::Registrar kMissing("replay.missing_stream", [] {
+    const std::string path = write_capture();
+    auto backend = make_replay_backend(path);
+    std::filesystem::remove(path);
+    CHECK(backend != nullptr);
+    if (!backend) {
+        return;
+    }
+    // A sensor the capture never recorded reports itself missing.
+    ImuReading imu;
+    CHECK(!backend->read_imu(ImuType::Mpu9250, imu));
+    RcInputReading rc;
+    CHECK(!backend->read_rcinput(rc));
+});
+
+} // namespace
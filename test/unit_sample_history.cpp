@@ -0,0 +1,153 @@
+#include "unit.h"
+
+#include "sample_history.h"
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace {
+
+using telemetry::HistorySelector;
+using telemetry::HistorySnapshot;
+using telemetry::SampleHistory;
+
+constexpr std::int64_t kNow = 1718000000000000000;
+
+// Sample n holds n in its first byte and is 1 + n % 3 bytes long.
+void record(SampleHistory &history, std::uint8_t n, std::int64_t time_ns) {
+    const std::uint8_t bytes[3] = {n, 0, 0};
+    CHECK(history.record(time_ns, std::span<const std::uint8_t>(bytes, 1 + n % 3)));
+}
+
+// The samples a snapshot holds, by number, checking their sizes.
+std::vector<int> numbers(const HistorySnapshot &snapshot) {
+    std::vector<int> values;
+    for (std::size_t idx = 0; idx < snapshot.size(); ++idx) {
+        const std::span<const std::uint8_t> sample = snapshot[idx];
+        CHECK(sample.size() == 1u + sample[0] % 3);
+        values.push_back(sample[0]);
+    }
+    return values;
+}
+
+const unit::Registrar kParse("history.parse_selector", [] {
+    HistorySelector selector;
+    CHECK(telemetry::parse_history_selector("", kNow, selector));
+    CHECK(selector.last == std::numeric_limits<std::size_t>::max());
+    CHECK(selector.since_ns == std::numeric_limits<std::int64_t>::min());
+    CHECK(selector.until_ns == std::numeric_limits<std::int64_t>::max());
+
+    CHECK(telemetry::parse_history_selector("last=500", kNow, selector));
+    CHECK(selector.last == 500);
+
+    selector = {};
+    CHECK(telemetry::parse_history_selector("since=1718000000000000000;until=1718000005000000000&last=3", kNow,
+                                            selector));
+    CHECK(selector.since_ns == 1718000000000000000 && selector.until_ns == 1718000005000000000);
+    CHECK(selector.last == 3);
+
+    // Negative times are seconds before now.
+    selector = {};
+    CHECK(telemetry::parse_history_selector("since=-10;until=-0.5", kNow, selector));
+    CHECK(selector.since_ns == kNow - 10000000000);
+    CHECK(selector.until_ns == kNow - 500000000);
+
+    // Zenoh's own parameters and ones without a value pass through.
+    selector = {};
+    CHECK(telemetry::parse_history_selector("_time=[..];last=2;flag", kNow, selector));
+    CHECK(selector.last == 2);
+});
+
+const unit::Registrar kParseInvalid("history.parse_invalid", [] {
+    for (const char *parameters : {"last=", "last=abc", "last=-1", "last=5x", "since=", "since=1.5", "until=now",
+                                   "since=-nan", "since=-inf", "last=2;until=12a"}) {
+        HistorySelector selector;
+        CHECK(!telemetry::parse_history_selector(parameters, kNow, selector));
+    }
+});
+
+const unit::Registrar kRing("history.ring", [] {
+    SampleHistory history(5, std::chrono::milliseconds(0));
+    HistorySnapshot snapshot;
+    history.snapshot(HistorySelector{}, kNow, snapshot);
+    CHECK(snapshot.size() == 0);
+    for (std::uint8_t n = 1; n <= 3; ++n) {
+        record(history, n, n * 100);
+    }
+    history.snapshot(HistorySelector{}, kNow, snapshot);
+    CHECK(numbers(snapshot) == std::vector<int>({1, 2, 3}));
+    // Once full the oldest are overwritten, and the snapshot wraps around
+    // the end of the ring.
+    for (std::uint8_t n = 4; n <= 8; ++n) {
+        record(history, n, n * 100);
+    }
+    CHECK(history.size() == 5);
+    history.snapshot(HistorySelector{}, kNow, snapshot);
+    CHECK(numbers(snapshot) == std::vector<int>({4, 5, 6, 7, 8}));
+});
+
+const unit::Registrar kSelect("history.select", [] {
+    SampleHistory history(5, std::chrono::milliseconds(0));
+    for (std::uint8_t n = 1; n <= 8; ++n) {
+        record(history, n, n * 100);
+    }
+    HistorySnapshot snapshot;
+    HistorySelector selector;
+    selector.last = 2;
+    history.snapshot(selector, kNow, snapshot);
+    CHECK(numbers(snapshot) == std::vector<int>({7, 8}));
+
+    selector = {};
+    CHECK(telemetry::parse_history_selector("since=450;until=700", kNow, selector));
+    history.snapshot(selector, kNow, snapshot);
+    CHECK(numbers(snapshot) == std::vector<int>({5, 6, 7}));
+
+    // last counts back from until, not from the newest sample.
+    selector.last = 1;
+    history.snapshot(selector, kNow, snapshot);
+    CHECK(numbers(snapshot) == std::vector<int>({7}));
+
+    selector = {};
+    selector.since_ns = 900;
+    history.snapshot(selector, kNow, snapshot);
+    CHECK(snapshot.size() == 0);
+
+    selector = {};
+    selector.last = 0;
+    history.snapshot(selector, kNow, snapshot);
+    CHECK(snapshot.size() == 0);
+});
+
+const unit::Registrar kMaxAge("history.max_age", [] {
+    SampleHistory history(5, std::chrono::milliseconds(1));
+    record(history, 1, 0);
+    record(history, 2, 2000000);
+    record(history, 3, 2400000);
+    HistorySnapshot snapshot;
+    history.snapshot(HistorySelector{}, 2500000, snapshot);
+    CHECK(numbers(snapshot) == std::vector<int>({2, 3}));
+    // An older since cannot bring expired samples back.
+    HistorySelector selector;
+    selector.since_ns = 0;
+    history.snapshot(selector, 3200000, snapshot);
+    CHECK(numbers(snapshot) == std::vector<int>({3}));
+});
+
+const unit::Registrar kSkipped("history.skipped", [] {
+    SampleHistory history(2, std::chrono::milliseconds(0));
+    const std::vector<std::uint8_t> big(SampleHistory::kSlotSize + 1);
+    CHECK(!history.record(0, big));
+    CHECK(history.record(0, std::span<const std::uint8_t>(big).first(SampleHistory::kSlotSize)));
+    CHECK(history.skipped() == 1);
+    CHECK(history.size() == 1);
+
+    SampleHistory empty(0, std::chrono::milliseconds(0));
+    CHECK(!empty.record(0, std::span<const std::uint8_t>(big).first(1)));
+    HistorySnapshot snapshot;
+    empty.snapshot(HistorySelector{}, kNow, snapshot);
+    CHECK(snapshot.size() == 0);
+});
+
+} // namespace
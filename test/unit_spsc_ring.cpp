@@ -0,0 +1,164 @@
+#include "unit.h"
+
+#include "publish_queue.h"
+#include "spsc_ring.h"
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace {
+
+bool push(SpscRing<std::uint64_t> &ring, std::uint64_t value) {
+    return ring.push_with([value](std::uint64_t &slot) {
+        slot = value;
+        return true;
+    });
+}
+
+std::vector<std::uint64_t> pop_all(SpscRing<std::uint64_t> &ring) {
+    std::vector<std::uint64_t> values;
+    std::uint64_t value = 0;
+    while (ring.pop(value)) {
+        values.push_back(value);
+    }
+    return values;
+}
+
+const unit::Registrar kCapacity("spsc_ring.capacity_rounds_up", [] {
+    CHECK(SpscRing<std::uint64_t>(0, OverflowPolicy::DropNewest).capacity() == 2);
+    CHECK(SpscRing<std::uint64_t>(4, OverflowPolicy::DropNewest).capacity() == 4);
+    CHECK(SpscRing<std::uint64_t>(5, OverflowPolicy::DropNewest).capacity() == 8);
+});
+
+const unit::Registrar kDropNewest("spsc_ring.drop_newest", [] {
+    SpscRing<std::uint64_t> ring(4, OverflowPolicy::DropNewest);
+    for (std::uint64_t value = 1; value <= 4; ++value) {
+        CHECK(push(ring, value));
+    }
+    CHECK(!push(ring, 5));
+    CHECK(!push(ring, 6));
+    CHECK(ring.size() == 4);
+    CHECK(ring.dropped() == 2);
+    CHECK(pop_all(ring) == std::vector<std::uint64_t>({1, 2, 3, 4}));
+    // Room again once drained; the count is cumulative.
+    CHECK(push(ring, 7));
+    CHECK(pop_all(ring) == std::vector<std::uint64_t>({7}));
+    CHECK(ring.dropped() == 2);
+});
+
+const unit::Registrar kDropOldest("spsc_ring.drop_oldest", [] {
+    SpscRing<std::uint64_t> ring(4, OverflowPolicy::DropOldest);
+    for (std::uint64_t value = 1; value <= 6; ++value) {
+        CHECK(push(ring, value));
+    }
+    CHECK(ring.size() == 4);
+    CHECK(ring.dropped() == 2);
+    CHECK(pop_all(ring) == std::vector<std::uint64_t>({3, 4, 5, 6}));
+    // Wraps around the slots more than once.
+    for (std::uint64_t value = 7; value <= 17; ++value) {
+        CHECK(push(ring, value));
+    }
+    CHECK(ring.dropped() == 9);
+    CHECK(pop_all(ring) == std::vector<std::uint64_t>({14, 15, 16, 17}));
+});
+
+const unit::Registrar kAbandoned("spsc_ring.abandoned_fill", [] {
+    auto abandon = [](std::uint64_t &slot) {
+        slot = 99;
+        return false;
+    };
+    for (OverflowPolicy policy : {OverflowPolicy::DropNewest, OverflowPolicy::DropOldest}) {
+        SpscRing<std::uint64_t> ring(2, policy);
+        CHECK(!ring.push_with(abandon));
+        CHECK(ring.size() == 0);
+        CHECK(ring.dropped() == 0);
+        CHECK(push(ring, 1));
+        CHECK(push(ring, 2));
+        // A full DropOldest ring only gives up its oldest element for a
+        // sample that was written; DropNewest drops before calling fill.
+        CHECK(!ring.push_with(abandon));
+        CHECK(ring.dropped() == (policy == OverflowPolicy::DropNewest ? 1u : 0u));
+        CHECK(pop_all(ring) == std::vector<std::uint64_t>({1, 2}));
+    }
+});
+
+// Every element is either received, in order and intact, or counted as
+// dropped, while the consumer races the producer for the oldest one.
+const unit::Registrar kConcurrent("spsc_ring.concurrent_counts", [] {
+    struct Element {
+        std::uint64_t value;
+        std::uint64_t check[7];
+    };
+    constexpr std::uint64_t kPushes = 200000;
+    for (OverflowPolicy policy : {OverflowPolicy::DropNewest, OverflowPolicy::DropOldest}) {
+        SpscRing<Element> ring(8, policy);
+        std::atomic<bool> done{false};
+        std::uint64_t received = 0;
+        bool intact = true;
+        std::thread consumer([&] {
+            Element element;
+            std::uint64_t last = 0;
+            while (true) {
+                const bool finished = done.load(std::memory_order_acquire);
+                if (ring.pop(element)) {
+                    for (std::uint64_t check : element.check) {
+                        intact = intact && check == element.value;
+                    }
+                    intact = intact && element.value > last;
+                    last = element.value;
+                    ++received;
+                } else if (finished) {
+                    return;
+                }
+            }
+        });
+        std::uint64_t queued = 0;
+        for (std::uint64_t value = 1; value <= kPushes; ++value) {
+            queued += ring.push_with([value](Element &element) {
+                element.value = value;
+                for (std::uint64_t &check : element.check) {
+                    check = value;
+                }
+                return true;
+            }) ? 1 : 0;
+        }
+        done.store(true, std::memory_order_release);
+        consumer.join();
+        CHECK(intact);
+        CHECK(received + ring.dropped() == kPushes);
+        if (policy == OverflowPolicy::DropNewest) {
+            CHECK(queued == received);
+        }
+    }
+});
+
+const unit::Registrar kChannel("spsc_ring.publish_channel_counters", [] {
+    for (OverflowPolicy policy : {OverflowPolicy::DropNewest, OverflowPolicy::DropOldest}) {
+        std::atomic<std::uint32_t> pending{0};
+        std::uint32_t sequence = 0;
+        telemetry::PublishChannel channel("imu", "telemetry/sensors/imu", 4, policy, pending, sequence);
+        auto write = [](std::span<std::uint8_t> out) -> std::size_t {
+            out[0] = 'x';
+            return 1;
+        };
+        auto fail = [](std::span<std::uint8_t>) -> std::size_t { return 0; };
+        std::size_t pushed = 0;
+        for (int idx = 0; idx < 6; ++idx) {
+            pushed += channel.push_with(write) ? 1 : 0;
+        }
+        CHECK(pushed == (policy == OverflowPolicy::DropNewest ? 4u : 6u));
+        CHECK(channel.queued() == 4);
+        CHECK(channel.dropped() == 2);
+        CHECK(pending.load() == pushed);
+        // DropNewest drops a sample for a full ring before serializing it;
+        // DropOldest only makes room for one that serialized.
+        CHECK(!channel.push_with(fail));
+        CHECK(channel.queued() == 4);
+        CHECK(channel.dropped() == (policy == OverflowPolicy::DropNewest ? 3u : 2u));
+    }
+});
+
+} // namespace
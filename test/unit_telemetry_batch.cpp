@@ -0,0 +1,108 @@
+#include "unit.h"
+
+#include "telemetry_batch.h"
+#include "telemetry_codec.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+using telemetry::BatchBuffer;
+using telemetry::BatchPolicy;
+
+const std::chrono::steady_clock::time_point kStart{std::chrono::seconds(100)};
+
+std::vector<std::uint8_t> payload(std::size_t size, std::uint8_t value) {
+    return std::vector<std::uint8_t>(size, value);
+}
+
+// Whether the record holds samples of the given sizes, numbered from 0 in
+// both their timestamps and their bytes.
+bool holds(std::span<const std::uint8_t> record, const std::vector<std::size_t> &sizes) {
+    codec::BatchReader reader(record);
+    if (!reader.valid() || reader.count() != sizes.size()) {
+        return false;
+    }
+    std::int64_t timestamp_ns = 0;
+    std::span<const std::uint8_t> sample;
+    for (std::size_t idx = 0; idx < sizes.size(); ++idx) {
+        if (!reader.next(timestamp_ns, sample) || timestamp_ns != static_cast<std::int64_t>(idx) ||
+            sample.size() != sizes[idx]) {
+            return false;
+        }
+        for (std::uint8_t byte : sample) {
+            if (byte != idx) {
+                return false;
+            }
+        }
+    }
+    return !reader.next(timestamp_ns, sample);
+}
+
+const unit::Registrar kMaxSamples("batch.max_samples", [] {
+    BatchBuffer batch(BatchPolicy{3, 0ms});
+    CHECK(batch.take(SampleTime{}).empty());
+    CHECK(!batch.add(kStart, 0, payload(20, 0)));
+    CHECK(!batch.add(kStart, 1, payload(30, 1)));
+    CHECK(batch.add(kStart, 2, payload(40, 2)));
+    CHECK(batch.count() == 3);
+    CHECK(holds(batch.take(SampleTime{}), {20, 30, 40}));
+    CHECK(batch.count() == 0);
+    CHECK(batch.take(SampleTime{}).empty());
+    // Without a latency bound nothing ever expires.
+    CHECK(!batch.add(kStart, 0, payload(20, 0)));
+    CHECK(!batch.expired(kStart + 1h));
+});
+
+const unit::Registrar kCapped("batch.capped_at_max_samples", [] {
+    BatchBuffer batch(BatchPolicy{5000, 0ms});
+    CHECK(batch.policy().max_samples == BatchBuffer::kMaxSamples);
+    const std::vector<std::uint8_t> full = payload(BatchBuffer::kPayloadCapacity, 7);
+    for (std::size_t idx = 1; idx < BatchBuffer::kMaxSamples; ++idx) {
+        CHECK(batch.fits(full.size()));
+        CHECK(!batch.add(kStart, 0, full));
+    }
+    CHECK(batch.fits(full.size()));
+    CHECK(batch.add(kStart, 0, full));
+    const std::span<const std::uint8_t> record = batch.take(SampleTime{});
+    CHECK(codec::BatchReader(record).count() == BatchBuffer::kMaxSamples);
+    CHECK(record.size() ==
+          codec::kBatchPrefixSize + BatchBuffer::kMaxSamples * (codec::kBatchEntryOverhead + full.size()));
+});
+
+const unit::Registrar kMaxLatency("batch.max_latency", [] {
+    BatchBuffer batch(BatchPolicy{100, 10ms});
+    CHECK(!batch.expired(kStart + 1h));
+    CHECK(!batch.add(kStart, 0, payload(8, 0)));
+    CHECK(!batch.add(kStart + 9ms, 1, payload(8, 1)));
+    CHECK(!batch.expired(kStart + 9ms));
+    CHECK(batch.expired(kStart + 10ms));
+    // The bound runs from the oldest sample, not the newest.
+    CHECK(batch.add(kStart + 10ms, 2, payload(8, 2)));
+    CHECK(holds(batch.take(SampleTime{}), {8, 8, 8}));
+    CHECK(!batch.expired(kStart + 20ms));
+    // A new batch starts its own clock.
+    CHECK(!batch.add(kStart + 20ms, 0, payload(8, 0)));
+    CHECK(!batch.expired(kStart + 29ms));
+    CHECK(batch.expired(kStart + 30ms));
+});
+
+const unit::Registrar kBytes("batch.byte_bound", [] {
+    // Room for 4 * (10 + 512) bytes of entries.
+    BatchBuffer batch(BatchPolicy{4, 0ms});
+    const std::size_t room = 4 * (codec::kBatchEntryOverhead + BatchBuffer::kPayloadCapacity);
+    CHECK(batch.fits(room - codec::kBatchEntryOverhead));
+    CHECK(!batch.fits(room - codec::kBatchEntryOverhead + 1));
+    // Large samples borrow the room of the ones that are not there.
+    CHECK(!batch.add(kStart, 0, payload(1500, 0)));
+    CHECK(batch.fits(room - 1500 - 2 * codec::kBatchEntryOverhead));
+    CHECK(!batch.fits(room - 1500 - 2 * codec::kBatchEntryOverhead + 1));
+    CHECK(!batch.add(kStart, 1, payload(500, 1)));
+    CHECK(holds(batch.take(SampleTime{}), {1500, 500}));
+    CHECK(batch.fits(room - codec::kBatchEntryOverhead));
+});
+
+} // namespace
@@ -0,0 +1,56 @@
+#include "unit.h"
+
+#include "text_writer.h"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <string>
+
+namespace {
+
+// What the ostringstream-based formatters used to produce.
+template <typename T>
+std::string streamed(T value) {
+    std::ostringstream out;
+    out << value;
+    return out.str();
+}
+
+template <typename T>
+bool matches_stream(T value) {
+    std::array<char, 64> buffer;
+    TextWriter writer(buffer);
+    writer << value;
+    return writer.ok() && writer.view() == streamed(value);
+}
+
+const unit::Registrar kMatchesStream("text_writer.matches_ostream", [] {
+    for (double value : {0.0, -0.0, 1.0, -9.80665, 0.1, 123456.0, 1234567.0, 1e-7, 3.14159265358979, 1e300}) {
+        CHECK(matches_stream(value));
+    }
+    for (float value : {0.0f, 9.81f, -0.001234f, 65504.0f}) {
+        CHECK(matches_stream(value));
+    }
+    CHECK(matches_stream(std::numeric_limits<std::int64_t>::min()));
+    CHECK(matches_stream(std::numeric_limits<std::uint64_t>::max()));
+    CHECK(matches_stream(-42));
+});
+
+const unit::Registrar kTooSmall("text_writer.too_small", [] {
+    std::array<char, 9> buffer;
+    TextWriter writer(buffer);
+    writer << "imu " << 12345;
+    CHECK(writer.ok());
+    CHECK(writer.view() == "imu 12345");
+    writer << 'x';
+    CHECK(!writer.ok());
+    CHECK(writer.size() == 0);
+    CHECK(writer.written() == 9);
+    // Nothing more is written once the buffer ran out.
+    writer << "";
+    CHECK(writer.written() == 9);
+});
+
+} // namespace
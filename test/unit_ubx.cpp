@@ -0,0 +1,217 @@
+#include "unit.h"
+
+#include "gps_sensor.h"
+#include "sensor_backend.h"
+#include "ubx_parser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+// test/data/ubx_nav_5hz.ubx is the SPI byte stream of a u-blox M8 at 5 Hz:
+// start-up text, then ten epochs of NAV-PVT, NAV-VELNED, NAV-POSLLH,
+// NAV-STATUS and NAV-DOP (checked but not decoded), each followed by an
+// NMEA sentence and idle 0xFF fill. Epoch n moves the fix by a fixed step,
+// so every decoded value can be predicted from its time of week.
+namespace {
+
+constexpr int kEpochs = 10;
+constexpr int kFramesPerEpoch = 5;
+
+std::vector<std::uint8_t> load_fixture() {
+    std::ifstream file(std::string(SENSORS_READ_TEST_DATA_DIR) + "/ubx_nav_5hz.ubx", std::ios::binary);
+    return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Offset of the n-th NAV frame with the given id; the fixture holds no sync
+// pair outside a frame header.
+std::size_t find_frame(const std::vector<std::uint8_t> &stream, std::uint8_t id, int n) {
+    for (std::size_t idx = 0; idx + 4 <= stream.size(); ++idx) {
+        if (stream[idx] == 0xB5 && stream[idx + 1] == 0x62 && stream[idx + 2] == kUbxClassNav &&
+            stream[idx + 3] == id && n-- == 0) {
+            return idx;
+        }
+    }
+    return stream.size();
+}
+
+// Feeds the stream in chunks of 1 to 200 bytes, as SPI transfers and read()
+// calls would split it.
+template <typename Feed>
+void feed_in_chunks(std::span<const std::uint8_t> stream, unsigned seed, Feed &&feed) {
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<std::size_t> size(1, 200);
+    for (std::size_t offset = 0; offset < stream.size();) {
+        const std::size_t count = std::min(size(random), stream.size() - offset);
+        feed(stream.subspan(offset, count));
+        offset += count;
+    }
+}
+
+bool near(double value, double expected) { return std::fabs(value - expected) < 1e-9; }
+
+// Epoch of a decoded time of week, or -1.
+int epoch_of(const GpsReading &state) {
+    const double epoch = (state.time_of_week_s - 356400.0) / 0.2;
+    return std::fabs(epoch - std::round(epoch)) < 1e-6 ? static_cast<int>(std::round(epoch)) : -1;
+}
+
+// The state right after epoch n's NAV-PVT.
+bool pvt_matches(const GpsReading &state, int n) {
+    return state.has_position && state.has_status && state.has_velocity && state.fix_type == 3 && state.fix_ok &&
+           near(state.longitude_deg, (1218000 + 10 * n) / 1e7) && near(state.latitude_deg, (522043000 + 20 * n) / 1e7) &&
+           near(state.height_m, (45230 + n) / 1000.0) && near(state.hmsl_m, (-1770 + n) / 1000.0) &&
+           near(state.horizontal_accuracy_m, 1.5) && near(state.vertical_accuracy_m, 2.5) &&
+           near(state.velocity_north_mps, (1200 + 10 * n) / 1000.0) && near(state.velocity_east_mps, -0.3) &&
+           near(state.velocity_down_mps, 0.05) && near(state.ground_speed_mps, (1237 + 10 * n) / 1000.0) &&
+           near(state.heading_deg, (34000000 - 1000 * n) / 1e5) && near(state.speed_accuracy_mps, 0.4);
+}
+
+// The state right after epoch n's NAV-VELNED, which overrides the velocity
+// at its cm/s resolution.
+bool velned_matches(const GpsReading &state, int n) {
+    return state.has_velocity && near(state.velocity_north_mps, (120 + n) / 100.0) &&
+           near(state.velocity_east_mps, -0.3) && near(state.velocity_down_mps, 0.05) &&
+           near(state.ground_speed_mps, (124 + n) / 100.0) && near(state.heading_deg, (34000000 - 1000 * n) / 1e5) &&
+           near(state.speed_accuracy_mps, 0.4);
+}
+
+// Decodes a stream the way GpsSensor::feed() does and keeps the epochs of
+// every NAV-PVT and NAV-VELNED that decoded, failing the case on any that
+// decoded to the wrong values.
+struct Decoded {
+    std::vector<int> pvt_epochs;
+    std::vector<int> velned_epochs;
+    int posllh = 0;
+    int status = 0;
+    GpsReading state;
+};
+
+Decoded decode(UbxParser &parser, std::span<const std::uint8_t> stream, unsigned seed) {
+    Decoded decoded;
+    feed_in_chunks(stream, seed, [&](std::span<const std::uint8_t> chunk) {
+        parser.feed(chunk, [&](const UbxMessage &message) {
+            if (!apply_ubx(message, SampleTime{}, decoded.state)) {
+                return;
+            }
+            const int epoch = epoch_of(decoded.state);
+            switch (message.id) {
+            case kUbxNavPvt:
+                CHECK(pvt_matches(decoded.state, epoch));
+                decoded.pvt_epochs.push_back(epoch);
+                break;
+            case kUbxNavVelned:
+                CHECK(velned_matches(decoded.state, epoch));
+                decoded.velned_epochs.push_back(epoch);
+                break;
+            case kUbxNavPosllh:
+                ++decoded.posllh;
+                break;
+            case kUbxNavStatus:
+                ++decoded.status;
+                break;
+            }
+        });
+    });
+    return decoded;
+}
+
+std::vector<int> epochs_except(std::initializer_list<int> missing) {
+    std::vector<int> epochs;
+    for (int n = 0; n < kEpochs; ++n) {
+        if (std::find(missing.begin(), missing.end(), n) == missing.end()) {
+            epochs.push_back(n);
+        }
+    }
+    return epochs;
+}
+
+// Frames of the fixture with three faults injected: epoch 2's NAV-PVT
+// claims a payload over kMaxPayload, epoch 5's has a flipped payload byte,
+// and epoch 7's NAV-VELNED claims four bytes more than it carries, so its
+// checksum is read from the next frame's header.
+std::vector<std::uint8_t> corrupted_fixture() {
+    std::vector<std::uint8_t> stream = load_fixture();
+    const std::size_t oversized = find_frame(stream, kUbxNavPvt, 2);
+    const std::size_t flipped = find_frame(stream, kUbxNavPvt, 5);
+    const std::size_t lengthened = find_frame(stream, kUbxNavVelned, 7);
+    if (lengthened + 6 >= stream.size()) {
+        return {};
+    }
+    stream[oversized + 5] = 0x04;
+    stream[flipped + 6 + 30] ^= 0x01;
+    stream[lengthened + 4] = static_cast<std::uint8_t>(stream[lengthened + 4] + 4);
+    return stream;
+}
+
+const unit::Registrar kFixture("ubx.fixture_in_random_chunks", [] {
+    const std::vector<std::uint8_t> stream = load_fixture();
+    CHECK(!stream.empty());
+    for (unsigned seed = 1; seed <= 20; ++seed) {
+        UbxParser parser;
+        const Decoded decoded = decode(parser, stream, seed);
+        CHECK(decoded.pvt_epochs == epochs_except({}));
+        CHECK(decoded.velned_epochs == epochs_except({}));
+        CHECK(decoded.posllh == kEpochs);
+        CHECK(decoded.status == kEpochs);
+        CHECK(parser.frames() == kEpochs * kFramesPerEpoch);
+        CHECK(parser.checksum_errors() == 0);
+        CHECK(parser.oversized() == 0);
+    }
+});
+
+const unit::Registrar kCorrupt("ubx.corrupt_length_and_checksum", [] {
+    const std::vector<std::uint8_t> stream = corrupted_fixture();
+    CHECK(!stream.empty());
+    for (unsigned seed = 1; seed <= 20; ++seed) {
+        UbxParser parser;
+        const Decoded decoded = decode(parser, stream, seed);
+        // Only the damaged frames are lost; the NAV-POSLLH behind the
+        // lengthened NAV-VELNED is found again.
+        CHECK(decoded.pvt_epochs == epochs_except({2, 5}));
+        CHECK(decoded.velned_epochs == epochs_except({7}));
+        CHECK(decoded.posllh == kEpochs);
+        CHECK(decoded.status == kEpochs);
+        CHECK(parser.frames() == kEpochs * kFramesPerEpoch - 3);
+        CHECK(parser.checksum_errors() == 2);
+        CHECK(parser.oversized() == 1);
+    }
+});
+
+// Has no samples of its own, so GpsSensor::read() returns what feed()
+// decoded without touching a receiver.
+class FeedOnlyBackend : public SensorBackend {
+public:
+    const char *name() const override { return "test"; }
+    bool read_imu(ImuType, ImuReading &) override { return false; }
+    bool read_adc(AdcReading &) override { return false; }
+    bool read_barometer(BarometerReading &) override { return false; }
+    bool read_gps(GpsReading &) override { return false; }
+    bool read_rcinput(RcInputReading &) override { return false; }
+};
+
+const unit::Registrar kSensorFeed("ubx.gps_sensor_feed", [] {
+    const std::vector<std::uint8_t> stream = corrupted_fixture();
+    FeedOnlyBackend backend;
+    GpsSensor sensor(&backend);
+    int updates = 0;
+    feed_in_chunks(stream, 7, [&](std::span<const std::uint8_t> chunk) { updates += sensor.feed(chunk) ? 1 : 0; });
+    CHECK(updates > 0);
+    CHECK(sensor.parser().frames() == kEpochs * kFramesPerEpoch - 3);
+    CHECK(sensor.parser().checksum_errors() == 2);
+    CHECK(sensor.parser().oversized() == 1);
+    // The last epoch ends with NAV-STATUS, after its NAV-PVT and NAV-VELNED.
+    const GpsReading state = sensor.read();
+    CHECK(epoch_of(state) == kEpochs - 1);
+    CHECK(velned_matches(state, kEpochs - 1));
+    CHECK(near(state.latitude_deg, (522043000 + 20 * (kEpochs - 1)) / 1e7));
+    CHECK(state.fix_type == 3 && state.fix_ok);
+});
+
+} // namespace
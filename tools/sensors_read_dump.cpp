@@ -0,0 +1,297 @@
+#include "flight_log.h"
+#include "telemetry_codec.h"
+
+#include <getopt.h>
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Prints the records of sensors_read flight log segments, one per line:
+//   <unix time> <channel> <payload>
+// Text payloads are printed as published; binary payloads are decoded into
+// the same key=value form, one line per batched sample.
+
+namespace {
+
+struct DumpOptions {
+  std::string channel;
+  std::string capture_path;
+  bool quiet = false;
+};
+
+void print_usage(const char *prog) {
+  std::cout << "Usage: " << prog << " [options] <segment.srlog>...\n"
+            << "  --channel <name>         Only dump records of this channel (e.g. MPU9250)\n"
+            << "  --capture <file>         Also write the binary records as a replay capture\n"
+            << "  --quiet                  Print only the per-segment summary\n"
+            << "  --help                   Show this message\n";
+}
+
+void print_time(const SampleTime &time) {
+  std::printf("timestamp=%" PRId64 " mono_ns=%" PRId64, time.unix_seconds(), time.monotonic_ns);
+}
+
+void print_imu(const codec::ImuRecord &record) {
+  std::printf("name=%s ", codec::imu_device_name(record.device));
+  print_time(record.time);
+  std::printf(" valid=%d ax=%g ay=%g az=%g gx=%g gy=%g gz=%g mx=%g my=%g mz=%g", record.valid ? 1 : 0, record.ax,
+              record.ay, record.az, record.gx, record.gy, record.gz, record.mx, record.my, record.mz);
+}
+
+void print_binary(std::span<const std::uint8_t> payload) {
+  codec::RecordHeader header;
+  if (!codec::peek_header(payload, header)) {
+    std::printf("<invalid binary record, %zu bytes>", payload.size());
+    return;
+  }
+  switch (header.type) {
+  case codec::RecordType::Imu: {
+    codec::ImuRecord record;
+    if (codec::decode(payload, record)) {
+      print_imu(record);
+      return;
+    }
+    break;
+  }
+  case codec::RecordType::Adc: {
+    codec::AdcRecord record;
+    if (codec::decode(payload, record)) {
+      print_time(record.time);
+      for (std::size_t idx = 0; idx < record.count; ++idx) {
+        std::printf(" a%zu=%g", idx, record.values[idx]);
+      }
+      return;
+    }
+    break;
+  }
+  case codec::RecordType::Barometer: {
+    codec::BarometerRecord record;
+    if (codec::decode(payload, record)) {
+      print_time(record.time);
+      std::printf(" valid=%d temperature=%g pressure=%g", record.valid ? 1 : 0, record.temperature_c,
+                  record.pressure_mbar);
+      return;
+    }
+    break;
+  }
+  case codec::RecordType::Gps: {
+    codec::GpsRecord record;
+    if (codec::decode(payload, record)) {
+      print_time(record.time);
+      std::printf(" fix_ok=%d fix_type=%d lat=%.7f lon=%.7f height=%g hmsl=%g", record.fix_ok ? 1 : 0,
+                  static_cast<int>(record.fix_type), record.latitude_deg, record.longitude_deg,
+                  record.height_m, record.hmsl_m);
+      if (record.has_velocity) {
+        std::printf(" vel_n=%g vel_e=%g vel_d=%g speed=%g heading=%g s_acc=%g", record.velocity_north_mps,
+                    record.velocity_east_mps, record.velocity_down_mps, record.ground_speed_mps,
+                    record.heading_deg, record.speed_accuracy_mps);
+      }
+      return;
+    }
+    break;
+  }
+  case codec::RecordType::RcInput: {
+    codec::RcInputRecord record;
+    if (codec::decode(payload, record)) {
+      print_time(record.time);
+      for (std::size_t idx = 0; idx < record.count; ++idx) {
+        std::printf(" ch%zu=%g", idx + 1, static_cast<double>(record.axes[idx]));
+      }
+      return;
+    }
+    break;
+  }
+  case codec::RecordType::Attitude: {
+    codec::AttitudeRecord record;
+    if (codec::decode(payload, record)) {
+      std::printf("name=%s ", codec::imu_device_name(record.device));
+      print_time(record.time);
+      std::printf(" valid=%d qw=%g qx=%g qy=%g qz=%g roll=%g pitch=%g yaw=%g", record.valid ? 1 : 0, record.qw,
+                  record.qx, record.qy, record.qz, record.roll_deg, record.pitch_deg, record.yaw_deg);
+      return;
+    }
+    break;
+  }
+  case codec::RecordType::FusedImu: {
+    codec::FusedImuRecord record;
+    if (codec::decode(payload, record)) {
+      print_time(record.time);
+      std::printf(" valid=%d sources=0x%02x ax=%g ay=%g az=%g gx=%g gy=%g gz=%g mx=%g my=%g mz=%g res_a=%g res_g=%g "
+                  "res_m=%g",
+                  record.valid ? 1 : 0, static_cast<unsigned>(record.sources), record.ax, record.ay, record.az,
+                  record.gx, record.gy, record.gz, record.mx, record.my, record.mz, record.accel_residual,
+                  record.gyro_residual, record.mag_residual);
+      return;
+    }
+    break;
+  }
+  // Expanded sample by sample in Dumper::print().
+  case codec::RecordType::ImuWindow:
+  case codec::RecordType::Batch:
+    break;
+  }
+  std::printf("<undecodable record type %u, %zu bytes>", static_cast<unsigned>(header.type), payload.size());
+}
+
+class Dumper {
+public:
+  explicit Dumper(DumpOptions options) : options_(std::move(options)) {}
+
+  bool open_capture() {
+    if (options_.capture_path.empty()) {
+      return true;
+    }
+    capture_.open(options_.capture_path, std::ios::binary | std::ios::trunc);
+    if (!capture_) {
+      std::cerr << "Cannot open capture file " << options_.capture_path << '\n';
+      return false;
+    }
+    return true;
+  }
+
+  bool dump(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      std::cerr << "Cannot open " << path << '\n';
+      return false;
+    }
+    const std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    flight_log::SegmentHeader header;
+    if (!flight_log::decode_segment_header(bytes, header)) {
+      std::cerr << path << ": not a flight log segment\n";
+      return false;
+    }
+
+    flight_log::SegmentReader reader(bytes);
+    flight_log::Record record;
+    std::size_t count = 0;
+    while (reader.next(record)) {
+      if (record.channel > header.channels.size()) {
+        std::cerr << path << ": record with unknown channel " << record.channel << '\n';
+        continue;
+      }
+      const std::string &channel = header.channels[record.channel - 1];
+      if (!options_.channel.empty() && channel != options_.channel) {
+        continue;
+      }
+      ++count;
+      if (capture_.is_open() && codec::is_binary(record.payload)) {
+        write_capture(record.payload);
+      }
+      if (!options_.quiet) {
+        print(header, channel, record);
+      }
+    }
+    std::cerr << path << ": segment " << header.sequence << ", " << count << " records"
+              << (reader.truncated() ? ", truncated" : "") << '\n';
+    return true;
+  }
+
+private:
+  void print(const flight_log::SegmentHeader &header, const std::string &channel, const flight_log::Record &record) {
+    const std::int64_t unix_ns = record.monotonic_ns + header.realtime_offset_ns;
+    const auto print_prefix = [&] {
+      std::printf("%" PRId64 ".%09" PRId64 " %s ", unix_ns / 1000000000, unix_ns % 1000000000, channel.c_str());
+    };
+    if (!codec::is_binary(record.payload)) {
+      print_prefix();
+      std::printf("%.*s\n", static_cast<int>(record.payload.size()),
+                  reinterpret_cast<const char *>(record.payload.data()));
+      return;
+    }
+    // One line per sample, whether batched, packed in an IMU window or both.
+    const auto print_record = [&](std::span<const std::uint8_t> payload) {
+      codec::ImuWindowReader window(payload);
+      if (!window.valid()) {
+        print_prefix();
+        print_binary(payload);
+        std::printf("\n");
+        return;
+      }
+      codec::ImuRecord sample;
+      while (window.next(sample)) {
+        print_prefix();
+        print_imu(sample);
+        std::printf("\n");
+      }
+    };
+    codec::RecordHeader record_header;
+    if (codec::peek_header(record.payload, record_header) && record_header.type == codec::RecordType::Batch) {
+      codec::BatchReader batch(record.payload);
+      std::int64_t timestamp_ns = 0;
+      std::span<const std::uint8_t> sample;
+      while (batch.next(timestamp_ns, sample)) {
+        print_record(sample);
+      }
+      return;
+    }
+    print_record(record.payload);
+  }
+
+  // Same framing as sensors_read_test --record.
+  void write_capture(std::span<const std::uint8_t> payload) {
+    if (payload.size() > 0xFFFF) {
+      return;
+    }
+    const char length[2] = {static_cast<char>(payload.size() & 0xFF), static_cast<char>(payload.size() >> 8)};
+    capture_.write(length, sizeof(length));
+    capture_.write(reinterpret_cast<const char *>(payload.data()), static_cast<std::streamsize>(payload.size()));
+  }
+
+  DumpOptions options_;
+  std::ofstream capture_;
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  DumpOptions options;
+  const struct option long_opts[] = {{"channel", required_argument, nullptr, 'c'},
+                                     {"capture", required_argument, nullptr, 'C'},
+                                     {"quiet", no_argument, nullptr, 'q'},
+                                     {"help", no_argument, nullptr, 'h'},
+                                     {nullptr, 0, nullptr, 0}};
+  int opt;
+  while ((opt = getopt_long(argc, argv, "h", long_opts, nullptr)) != -1) {
+    switch (opt) {
+    case 'c':
+      options.channel = optarg;
+      break;
+    case 'C':
+      options.capture_path = optarg;
+      break;
+    case 'q':
+      options.quiet = true;
+      break;
+    case 'h':
+      print_usage(argv[0]);
+      return EXIT_SUCCESS;
+    default:
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (optind >= argc) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  Dumper dumper(options);
+  if (!dumper.open_capture()) {
+    return EXIT_FAILURE;
+  }
+  bool ok = true;
+  for (int idx = optind; idx < argc; ++idx) {
+    ok = dumper.dump(argv[idx]) && ok;
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}